@@ -0,0 +1,599 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG CMD APP ATRIAL SCAR BATCH
+This app runs the automatic atrial scar analysis of the Atrial Scar view
+(CemrgAtrialScarPipeline) headless over a cohort of case directories. Each
+case runs in its own process, up to --jobs cases at a time. Stages whose outputs are newer than
+their inputs are skipped, and the timing of every stage is written to a
+JSON report. MIRTK commands get --threads each; --max-threads caps the
+threads of all cases running at once. Surfaces are extracted in process
+unless --surface asks for MIRTK.
+=========================================================================*/
+
+// Qmitk
+#include <mitkIOUtil.h>
+#include <mitkCommandLineParser.h>
+
+// Qt
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+
+// C++ Standard
+#include <algorithm>
+#include <cstdlib>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// CemrgApp
+#include <CemrgAtrialScarPipeline.h>
+#include <CemrgCommandLine.h>
+#include <CemrgCommandLineJobRunner.h>
+
+namespace {
+
+    const QString CASE_REPORT = "CemrgAtrialScarBatch.json";
+    const QString CASE_STATE = "CemrgAtrialScarBatch.state";
+    const QString CASE_LOG = "CemrgAtrialScarBatch.log";
+    const QString COHORT_REPORT = "CemrgAtrialScarBatchReport.json";
+
+    struct BatchOptions {
+        QString mirtkDirectory;
+        int threads = 0;        // MIRTK -threads, 0 = cores shared by the concurrent cases
+        int maxThreads = 0;     // threads of one case running at once, 0 = no cap
+        int minStep = -1;
+        int maxStep = 3;
+        int methodType = 2;     // 1 = mean, 2 = max
+        int threshType = 1;     // 1 = V*IIR, 2 = mean + V*stdev
+        std::vector<double> thresholds;
+        QString surface = "native"; // native, fidelity (native checked against MIRTK) or mirtk
+        bool force = false;
+        bool verbose = false;
+    };
+
+    struct Stage {
+        QString name;
+        QStringList inputs;
+        QStringList outputs;
+        QString parameters;
+        std::function<void()> run;
+    };
+
+    //CPU time of this process and its finished children
+    double ProcessCpuSeconds() {
+#ifndef _WIN32
+        struct rusage self, children;
+        getrusage(RUSAGE_SELF, &self);
+        getrusage(RUSAGE_CHILDREN, &children);
+        double seconds = 0;
+        for (const struct rusage& usage : {self, children})
+            seconds += usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+        return seconds;
+#else
+        return -1;
+#endif
+    }
+
+    void Check(bool condition, QString message) {
+        if (!condition)
+            throw std::runtime_error(message.toStdString());
+    }
+
+    QJsonObject ReadJson(QString path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return QJsonObject();
+        return QJsonDocument::fromJson(file.readAll()).object();
+    }
+
+    bool WriteJson(QString path, QJsonObject object) {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        file.write(QJsonDocument(object).toJson(QJsonDocument::Indented));
+        return true;
+    }
+
+    /**
+     * A stage is up to date when its last successful run used the same
+     * parameters and every output is non-empty and newer than every input.
+     */
+    bool IsUpToDate(const Stage& stage, const QJsonObject& state) {
+
+        if (!state.contains(stage.name) || state.value(stage.name).toObject().value("parameters").toString() != stage.parameters)
+            return false;
+
+        QDateTime oldestOutput;
+        for (const QString& output : stage.outputs) {
+            QFileInfo finfo(output);
+            if (!finfo.exists() || finfo.size() == 0)
+                return false;
+            if (!oldestOutput.isValid() || finfo.lastModified() < oldestOutput)
+                oldestOutput = finfo.lastModified();
+        }//_for
+
+        for (const QString& input : stage.inputs) {
+            QFileInfo finfo(input);
+            if (!finfo.exists() || finfo.lastModified() > oldestOutput)
+                return false;
+        }//_for
+
+        return true;
+    }
+
+    /***************************************************************************
+     ****************************** Single Case ********************************
+     ***************************************************************************/
+
+    int RunCase(QString direct, const BatchOptions& opts) {
+
+        QElapsedTimer caseTimer;
+        caseTimer.start();
+        direct = QDir(direct).absolutePath();
+        QString prodPath = direct + "/";
+
+        QJsonObject report;
+        report["case"] = direct;
+        QJsonArray stageReports;
+        bool failed = false;
+
+        std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
+        if (!opts.mirtkDirectory.isEmpty())
+            cmd->SetMirtkDirectory(opts.mirtkDirectory);
+        cmd->SetThreadsPerJob(opts.threads);
+        cmd->SetMaximumConcurrentThreads(opts.maxThreads);
+
+        CemrgAtrialScarPipeline pipeline(direct, cmd.get());
+        pipeline.SetSurfaceMethod(opts.surface);
+        pipeline.SetNumberOfThreads(opts.threads);
+        pipeline.SetGeometryCache(true);
+        pipeline.SetMinStep(opts.minStep);
+        pipeline.SetMaxStep(opts.maxStep);
+        pipeline.SetMethodType(opts.methodType);
+        pipeline.SetThresholdType(opts.threshType);
+        pipeline.SetThresholds(opts.thresholds);
+
+        //Missing tools would otherwise raise a dialog nobody can dismiss
+        QString missing;
+        if (!pipeline.FindInputs()) {
+            missing = pipeline.GetErrorMessage();
+        } else {
+            QStringList tools = {"register", "transform-image"};
+            if (opts.surface != "native")
+                tools << "close-image" << "extract-surface" << "smooth-surface";
+            for (const QString& tool : tools) {
+                if (!QFileInfo(cmd->GetMirtkDirectory() + "/" + tool).isExecutable())
+                    missing += (missing.isEmpty() ? "MIRTK executables not found in " + cmd->GetMirtkDirectory() + ": " : QString(", ")) + tool;
+            }
+        }//_if
+
+        QString lgePath = pipeline.GetLgePath();
+        QString mraPath = pipeline.GetMraPath();
+        QString cnnPath = pipeline.GetCnnPath();
+        QString laregPath = pipeline.GetLaRegPath();
+        QString segCleanPath = pipeline.GetCleanPath();
+        QString separatedPath = pipeline.GetSeparatedVeinsPath();
+        QString croppedPath = pipeline.GetCroppedPath();
+        QString shellPath = pipeline.GetShellPath();
+        auto run = [&pipeline](bool successful) { Check(successful, pipeline.GetErrorMessage()); };
+
+        std::vector<Stage> stages;
+
+        //The prediction only depends on the MRA, an existing one newer than the MRA is kept as in the Atrial Scar view
+        stages.push_back({"segmentation", {mraPath}, {cnnPath}, "", [&]() { run(pipeline.Segmentation()); }});
+        stages.push_back({"registration", {lgePath, mraPath, cnnPath}, {pipeline.GetLaPath(), pipeline.GetDofPath(), laregPath}, "", [&]() { run(pipeline.Registration()); }});
+        stages.push_back({"clean", {laregPath}, {segCleanPath}, "", [&]() { run(pipeline.Clean()); }});
+        stages.push_back({"veins", {laregPath, segCleanPath}, {pipeline.GetVeinsPath(), separatedPath}, "", [&]() { run(pipeline.SeparateVeins()); }});
+        stages.push_back({"clipping", {segCleanPath, separatedPath}, {croppedPath, pipeline.GetLabelledPath()}, "surface=" + opts.surface, [&]() { run(pipeline.ClipVeins()); }});
+        stages.push_back({"surface", {laregPath, segCleanPath, croppedPath}, {pipeline.GetMviPath(), shellPath}, "surface=" + opts.surface, [&]() { run(pipeline.ClipMitralValve()); }});
+
+        //Projection and thresholding share the projected scalars, so they run as one stage
+        QString scarParameters = QString("min-step=%1 max-step=%2 method=%3 threshold-method=%4 thresholds=")
+            .arg(opts.minStep).arg(opts.maxStep).arg(opts.methodType).arg(opts.threshType);
+        for (unsigned int ix = 0; ix < opts.thresholds.size(); ix++)
+            scarParameters += (ix == 0 ? "" : ",") + QString::number(opts.thresholds.at(ix), 'g', 17);
+
+        stages.push_back({"scar", {lgePath, croppedPath, shellPath},
+            {pipeline.GetCroppedLgePath(), pipeline.GetScarPath(), pipeline.GetScarDebugPath(), pipeline.GetNormalisedScarPath(), pipeline.GetThresholdsPath()},
+            scarParameters, [&]() { run(pipeline.ScarProjection()); }});
+
+        QJsonObject state = opts.force ? QJsonObject() : ReadJson(prodPath + CASE_STATE);
+        if (!opts.force && !state.contains("segmentation") && QFileInfo(cnnPath).size() > 0) {
+            QJsonObject existing;
+            existing["parameters"] = "";
+            state["segmentation"] = existing;
+        }//_if
+        bool upstreamRan = false;
+        for (const Stage& stage : stages) {
+
+            QJsonObject stageReport;
+            stageReport["name"] = stage.name;
+
+            if (failed || !missing.isEmpty()) {
+                stageReport["status"] = "not run";
+                stageReport["wallSeconds"] = 0.0;
+                stageReport["cpuSeconds"] = 0.0;
+                stageReports.append(stageReport);
+                continue;
+            }//_if
+
+            if (!upstreamRan && IsUpToDate(stage, state)) {
+                MITK_INFO << ("[BATCH] " + stage.name + " is up to date, skipping.").toStdString();
+                stageReport["status"] = "skipped";
+                stageReport["wallSeconds"] = 0.0;
+                stageReport["cpuSeconds"] = 0.0;
+                stageReports.append(stageReport);
+                continue;
+            }//_if
+
+            MITK_INFO << ("[BATCH] Running stage: " + stage.name).toStdString();
+            state.remove(stage.name);
+            WriteJson(prodPath + CASE_STATE, state);
+
+            QElapsedTimer timer;
+            timer.start();
+            double cpuStart = ProcessCpuSeconds();
+            cmd->ClearStageTimings();
+            try {
+                stage.run();
+                for (const QString& output : stage.outputs)
+                    Check(QFileInfo(output).size() > 0, "Missing output " + output);
+                stageReport["status"] = "done";
+                QJsonObject stageState;
+                stageState["parameters"] = stage.parameters;
+                stageState["finished"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+                state[stage.name] = stageState;
+                WriteJson(prodPath + CASE_STATE, state);
+            } catch (const std::exception& e) {
+                MITK_ERROR << ("[BATCH] Stage " + stage.name + " failed: ").toStdString() << e.what();
+                stageReport["status"] = "failed";
+                stageReport["message"] = QString::fromStdString(e.what());
+                failed = true;
+            }//_try
+            stageReport["wallSeconds"] = timer.elapsed() / 1000.0;
+            stageReport["cpuSeconds"] = (cpuStart < 0) ? -1.0 : ProcessCpuSeconds() - cpuStart;
+
+            //External commands of the stage, e.g. register and transform-image
+            QJsonArray commandReports;
+            for (const CemrgCommandLine::StageTiming& timing : cmd->GetStageTimings()) {
+                QJsonObject commandReport;
+                commandReport["name"] = timing.stage;
+                commandReport["threads"] = timing.threads;
+                commandReport["wallSeconds"] = timing.wallSeconds;
+                commandReport["cpuSeconds"] = timing.cpuSeconds;
+                commandReports.append(commandReport);
+            }//_for
+            if (!commandReports.isEmpty())
+                stageReport["commands"] = commandReports;
+            stageReports.append(stageReport);
+            upstreamRan = true;
+        }//_for
+
+        if (!missing.isEmpty()) {
+            MITK_ERROR << missing.toStdString();
+            report["message"] = missing;
+            failed = true;
+        }//_if
+        report["status"] = failed ? "failed" : "done";
+        report["stages"] = stageReports;
+        report["wallSeconds"] = caseTimer.elapsed() / 1000.0;
+        WriteJson(prodPath + CASE_REPORT, report);
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /***************************************************************************
+     ******************************** Cohort ***********************************
+     ***************************************************************************/
+
+    QStringList ReadCaseList(QString casesFile, QString casesRoot) {
+
+        QStringList cases;
+        if (!casesFile.isEmpty()) {
+            QFile file(casesFile);
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                QDir listDir = QFileInfo(casesFile).absoluteDir();
+                QTextStream in(&file);
+                while (!in.atEnd()) {
+                    QString line = in.readLine().trimmed();
+                    if (line.isEmpty() || line.startsWith("#"))
+                        continue;
+                    cases << QDir::cleanPath(listDir.absoluteFilePath(line));
+                }//_while
+            } else {
+                MITK_WARN << ("Could not read case list: " + casesFile).toStdString();
+            }//_if
+        }//_if
+
+        if (!casesRoot.isEmpty()) {
+            QDir root(casesRoot);
+            for (const QFileInfo& finfo : root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+                cases << finfo.absoluteFilePath();
+        }//_if
+
+        cases.removeDuplicates();
+        return cases;
+    }
+
+    int RunCohort(QStringList cases, QStringList forwardedArguments, int jobs, QString reportPath) {
+
+        QElapsedTimer cohortTimer;
+        cohortTimer.start();
+
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        if (!environment.contains("QT_QPA_PLATFORM"))
+            environment.insert("QT_QPA_PLATFORM", "offscreen");
+
+        //One process per case keeps a crashing case from taking the cohort down
+        CemrgCommandLineJobRunner runner(jobs);
+        std::vector<CemrgCommandLineJob::Pointer> caseJobs;
+        for (const QString& direct : cases) {
+            QFile::remove(direct + "/" + CASE_REPORT);
+            QStringList arguments;
+            arguments << "--case" << direct << forwardedArguments;
+            caseJobs.push_back(runner.Submit(QCoreApplication::applicationFilePath(), arguments, direct, environment));
+        }//_for
+
+        QObject::connect(&runner, &CemrgCommandLineJobRunner::JobFinished, [](CemrgCommandLineJob* job) {
+            MITK_INFO << ("[BATCH] Finished " + job->GetWorkingDirectory() + " with exit code " + QString::number(job->GetExitCode()) +
+                " after " + QString::number(job->GetElapsedSeconds()) + " s").toStdString();
+        });
+        runner.WaitForAll();
+
+        QJsonArray caseReports;
+        int done = 0;
+        for (unsigned int ix = 0; ix < caseJobs.size(); ix++) {
+            CemrgCommandLineJob::Pointer job = caseJobs.at(ix);
+            QString direct = cases.at(ix);
+
+            QFile logFile(direct + "/" + CASE_LOG);
+            if (logFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+                logFile.write(job->GetLog().toUtf8());
+
+            QJsonObject caseReport = ReadJson(direct + "/" + CASE_REPORT);
+            if (caseReport.isEmpty()) {
+                caseReport["case"] = direct;
+                caseReport["status"] = "failed";
+                caseReport["message"] = job->GetErrorString().isEmpty() ? "No report written, see " + CASE_LOG : job->GetErrorString();
+            }//_if
+            caseReport["exitCode"] = job->GetExitCode();
+            caseReport["processSeconds"] = job->GetElapsedSeconds();
+            if (job->IsSuccessful() && caseReport["status"].toString() == "done")
+                done++;
+            caseReports.append(caseReport);
+        }//_for
+
+        QJsonObject report;
+        report["jobs"] = runner.GetMaximumConcurrentJobs();
+        report["cases"] = caseReports;
+        report["done"] = done;
+        report["failed"] = static_cast<int>(cases.size()) - done;
+        report["wallSeconds"] = cohortTimer.elapsed() / 1000.0;
+        if (!WriteJson(reportPath, report))
+            MITK_ERROR << ("Could not write report: " + reportPath).toStdString();
+
+        MITK_INFO << ("[BATCH] " + QString::number(done) + " of " + QString::number(cases.size()) + " cases finished in " +
+            QString::number(cohortTimer.elapsed() / 1000.0) + " s").toStdString();
+        return (done == cases.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Batch processing");
+    parser.setTitle("Atrial Scar Batch Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Runs the automatic atrial scar analysis (registration, clean-up, vein separation, "
+        "clipping, mitral valve clipping, projection and thresholding) over a cohort of case directories.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "cases", "c", mitkCommandLineParser::InputFile,
+        "Case list", "Text file with one case directory per line (relative to the file, # for comments).");
+    parser.addArgument(
+        "cases-root", "r", mitkCommandLineParser::InputDirectory,
+        "Cases root", "Directory whose subdirectories are the cases.");
+    parser.addArgument(
+        "case", "d", mitkCommandLineParser::InputDirectory,
+        "Single case", "Run a single case in this process.");
+    parser.addArgument(
+        "report", "o", mitkCommandLineParser::OutputFile,
+        "Report", "JSON report with the status and timing of every stage. Default=<cases>/CemrgAtrialScarBatchReport.json");
+    parser.addArgument(
+        "jobs", "j", mitkCommandLineParser::Int,
+        "Concurrent cases", "Number of cases processed at the same time, 0 for one per core. Default=1");
+    parser.addArgument(
+        "threads", "n", mitkCommandLineParser::Int,
+        "Threads per command", "Threads of every MIRTK command. Default=cores divided by the concurrent cases");
+    parser.addArgument(
+        "max-threads", "N", mitkCommandLineParser::Int,
+        "Thread budget", "Threads running at once over all cases, split evenly between them. Default=no cap");
+    parser.addArgument(
+        "mirtk-dir", "m", mitkCommandLineParser::InputDirectory,
+        "MIRTK directory", "Directory with the MIRTK executables. Default=<app dir>/MLib");
+    parser.addArgument(
+        "min-step", "minS", mitkCommandLineParser::Int,
+        "number of voxels", "Number of voxels towards the interior to project LGE. Default=-1");
+    parser.addArgument(
+        "max-step", "maxS", mitkCommandLineParser::Int,
+        "number of voxels", "Number of voxels towards the exterior to project LGE. Default=3");
+    parser.addArgument(
+        "method", "p", mitkCommandLineParser::String,
+        "Projection", "Intensity projection, max or mean. Default=max");
+    parser.addArgument(
+        "threshold-method", "t", mitkCommandLineParser::String,
+        "Thresholding", "iir (V*IIR) or sd (mean+V*stdev). Default=iir");
+    parser.addArgument(
+        "surface", "s", mitkCommandLineParser::String,
+        "Surface extraction", "native (in process), fidelity (native, checked against MIRTK by Hausdorff distance) or mirtk. Default=native");
+    parser.addArgument(
+        "thresholds", "thr", mitkCommandLineParser::String,
+        "Threshold values", "Comma separated values of V. Default=0.97,1.16 (iir) or 2.3,3.3 (sd)");
+    parser.addArgument(
+        "force", "f", mitkCommandLineParser::Bool,
+        "Force", "Run every stage even when its outputs are up to date");
+    parser.addArgument( // optional
+        "verbose", "v", mitkCommandLineParser::Bool,
+        "Verbose Output", "Whether to produce verbose output");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    if (parsedArgs["cases"].Empty() && parsedArgs["cases-root"].Empty() && parsedArgs["case"].Empty()) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+
+    // Default values for optional arguments
+    BatchOptions opts;
+    int jobs = 1;
+    QString method = "max", threshMethod = "iir", thresholdList;
+    QStringList forwardedArguments;
+
+    // Parse, cast and set optional arguments
+    if (parsedArgs.end() != parsedArgs.find("verbose"))
+        opts.verbose = us::any_cast<bool>(parsedArgs["verbose"]);
+    if (parsedArgs.end() != parsedArgs.find("force"))
+        opts.force = us::any_cast<bool>(parsedArgs["force"]);
+    if (parsedArgs.end() != parsedArgs.find("jobs"))
+        jobs = us::any_cast<int>(parsedArgs["jobs"]);
+    if (parsedArgs.end() != parsedArgs.find("threads"))
+        opts.threads = std::max(0, us::any_cast<int>(parsedArgs["threads"]));
+    if (parsedArgs.end() != parsedArgs.find("max-threads"))
+        opts.maxThreads = std::max(0, us::any_cast<int>(parsedArgs["max-threads"]));
+    if (parsedArgs.end() != parsedArgs.find("mirtk-dir"))
+        opts.mirtkDirectory = QDir(QString::fromStdString(us::any_cast<std::string>(parsedArgs["mirtk-dir"]))).absolutePath();
+    if (parsedArgs.end() != parsedArgs.find("min-step"))
+        opts.minStep = -std::abs(us::any_cast<int>(parsedArgs["min-step"]));
+    if (parsedArgs.end() != parsedArgs.find("max-step"))
+        opts.maxStep = std::abs(us::any_cast<int>(parsedArgs["max-step"]));
+    if (parsedArgs.end() != parsedArgs.find("method"))
+        method = QString::fromStdString(us::any_cast<std::string>(parsedArgs["method"])).toLower();
+    if (parsedArgs.end() != parsedArgs.find("threshold-method"))
+        threshMethod = QString::fromStdString(us::any_cast<std::string>(parsedArgs["threshold-method"])).toLower();
+    if (parsedArgs.end() != parsedArgs.find("thresholds"))
+        thresholdList = QString::fromStdString(us::any_cast<std::string>(parsedArgs["thresholds"]));
+    if (parsedArgs.end() != parsedArgs.find("surface"))
+        opts.surface = QString::fromStdString(us::any_cast<std::string>(parsedArgs["surface"])).toLower();
+
+    if ((method != "max" && method != "mean") || (threshMethod != "iir" && threshMethod != "sd") ||
+        (opts.surface != "native" && opts.surface != "fidelity" && opts.surface != "mirtk")) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+    opts.methodType = (method == "max") ? 2 : 1;
+    opts.threshType = (threshMethod == "iir") ? 1 : 2;
+
+    thresholdList.remove(" ");
+    if (thresholdList.isEmpty())
+        thresholdList = (opts.threshType == 1) ? "0.97,1.16" : "2.3,3.3";
+    for (const QString& value : thresholdList.split(",", QString::SkipEmptyParts)) {
+        bool vOK;
+        double tryNumber = value.toDouble(&vOK);
+        if (vOK) opts.thresholds.push_back(tryNumber);
+    }//_for
+    std::sort(opts.thresholds.begin(), opts.thresholds.end());
+    opts.thresholds.erase(std::unique(opts.thresholds.begin(), opts.thresholds.end()), opts.thresholds.end());
+
+    forwardedArguments << "--min-step" << QString::number(opts.minStep) << "--max-step" << QString::number(opts.maxStep);
+    forwardedArguments << "--method" << method << "--threshold-method" << threshMethod << "--thresholds" << thresholdList;
+    forwardedArguments << "--surface" << opts.surface;
+    if (!opts.mirtkDirectory.isEmpty()) forwardedArguments << "--mirtk-dir" << opts.mirtkDirectory;
+    if (parsedArgs["case"].Empty()) {
+        //The cases share the machine: each one gets its part of the cores and of the thread budget
+        int concurrentCases = (jobs < 1) ? std::max(1, QThread::idealThreadCount()) : jobs;
+        int caseThreads = opts.threads;
+        if (caseThreads < 1)
+            caseThreads = std::max(1, QThread::idealThreadCount() / concurrentCases);
+        int caseThreadBudget = 0;
+        if (opts.maxThreads > 0) {
+            caseThreadBudget = std::max(1, opts.maxThreads / concurrentCases);
+            caseThreads = std::min(caseThreads, caseThreadBudget);
+        }//_if
+        forwardedArguments << "--threads" << QString::number(caseThreads);
+        if (caseThreadBudget > 0) forwardedArguments << "--max-threads" << QString::number(caseThreadBudget);
+    }//_if
+    if (opts.force) forwardedArguments << "--force";
+    if (opts.verbose) forwardedArguments << "--verbose";
+
+    try {
+        MITK_INFO(opts.verbose) << "Verbose mode ON.";
+
+        if (!parsedArgs["case"].Empty()) {
+            //CemrgCommandLine builds a (hidden) log dialog, so a case needs a widget application
+            if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+                qputenv("QT_QPA_PLATFORM", "offscreen");
+            QApplication app(argc, argv);
+            return RunCase(QString::fromStdString(us::any_cast<std::string>(parsedArgs["case"])), opts);
+        }//_if
+
+        QCoreApplication app(argc, argv);
+        QString casesFile, casesRoot, reportPath;
+        if (parsedArgs.end() != parsedArgs.find("cases"))
+            casesFile = QString::fromStdString(us::any_cast<std::string>(parsedArgs["cases"]));
+        if (parsedArgs.end() != parsedArgs.find("cases-root"))
+            casesRoot = QString::fromStdString(us::any_cast<std::string>(parsedArgs["cases-root"]));
+        if (parsedArgs.end() != parsedArgs.find("report"))
+            reportPath = QString::fromStdString(us::any_cast<std::string>(parsedArgs["report"]));
+        if (reportPath.isEmpty())
+            reportPath = (casesRoot.isEmpty() ? QFileInfo(casesFile).absolutePath() : QDir(casesRoot).absolutePath()) + "/" + COHORT_REPORT;
+
+        QStringList cases = ReadCaseList(casesFile, casesRoot);
+        if (cases.isEmpty()) {
+            MITK_ERROR << "No cases found.";
+            return EXIT_FAILURE;
+        }
+        MITK_INFO << ("[BATCH] " + QString::number(cases.size()) + " cases, report: " + reportPath).toStdString();
+
+        return RunCohort(cases, forwardedArguments, jobs, reportPath);
+
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,678 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+CEMRG CMD APP BENCHMARK
+This app times the hot paths of the CemrgAppModule on synthetic phantoms
+built in code: an LGE shell with enhanced patches, sphere meshes, a
+deformed sphere sequence and a tetrahedral slab. Every benchmark runs a
+warm-up iteration and then repeats until --min-time has passed. Results
+are printed as a table and optionally written as JSON, with the layout
+of Google Benchmark (name, iterations, real_time, cpu_time,
+items_per_second) so two runs can be compared with its tools.
+=========================================================================*/
+
+// Qmitk
+#include <mitkSurface.h>
+#include <mitkPointSet.h>
+#include <mitkDataNode.h>
+#include <mitkITKImageImport.h>
+#include <mitkCommandLineParser.h>
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkPolyDataWriter.h>
+#include <vtkSphereSource.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkDijkstraGraphGeodesicPath.h>
+
+// ITK
+#include <itkImage.h>
+
+// Qt
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTemporaryDir>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CemrgApp
+#include <CemrgScar3D.h>
+#include <CemrgProjectionGeometry.h>
+#include <CemrgLvScarSegmentation.h>
+#include <CemrgStrains.h>
+#include <CemrgMeasure.h>
+#include <CemrgCommonUtils.h>
+#include <CemrgScarAdvanced.h>
+
+typedef itk::Image<short, 3> ImageType;
+typedef itk::Image<float, 3> FloatImageType;
+
+namespace {
+
+    struct BenchmarkOptions {
+        double minTime = 0.5;   // seconds of timed iterations per benchmark
+        int maxIterations = 1000;
+        int threads = 0;        // threads of the library code, 0 = all cores
+        bool quick = false;     // smallest size of every benchmark only
+        QRegularExpression filter;
+        QString workDirectory;
+    };
+
+    struct BenchmarkResult {
+        QString name;
+        qint64 iterations;
+        double realTime, cpuTime, minRealTime, stddevRealTime; // seconds per iteration
+        double items;                                          // items per iteration
+        QString itemLabel;
+    };
+
+    //CPU time of this process, all threads included
+    double ProcessCpuSeconds() {
+#ifndef _WIN32
+        struct rusage self;
+        getrusage(RUSAGE_SELF, &self);
+        return self.ru_utime.tv_sec + self.ru_stime.tv_sec + (self.ru_utime.tv_usec + self.ru_stime.tv_usec) / 1e6;
+#else
+        return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+    }
+
+    class BenchmarkRunner {
+
+    public:
+
+        BenchmarkRunner(const BenchmarkOptions& options) : options(options) {}
+
+        bool IsEnabled(QString name) const {
+            return options.filter.pattern().isEmpty() || options.filter.match(name).hasMatch();
+        }
+
+        //setup runs before every iteration and is not timed
+        void Run(QString name, double items, QString itemLabel, std::function<void()> function, std::function<void()> setup = nullptr) {
+
+            if (!IsEnabled(name))
+                return;
+
+            //Warm-up, so caches and lazily built structures are not in the timings
+            if (setup) setup();
+            function();
+
+            std::vector<double> times;
+            double totalReal = 0, totalCpu = 0;
+            while ((totalReal < options.minTime || times.empty()) && (int)times.size() < options.maxIterations) {
+                if (setup) setup();
+                QElapsedTimer timer;
+                double cpu0 = ProcessCpuSeconds();
+                timer.start();
+                function();
+                double real = timer.nsecsElapsed() / 1e9;
+                totalCpu += ProcessCpuSeconds() - cpu0;
+                totalReal += real;
+                times.push_back(real);
+            }//_while
+
+            BenchmarkResult result;
+            result.name = name;
+            result.iterations = times.size();
+            result.realTime = totalReal / times.size();
+            result.cpuTime = totalCpu / times.size();
+            result.minRealTime = *std::min_element(times.begin(), times.end());
+            double var = 0;
+            for (double t : times)
+                var += (t - result.realTime) * (t - result.realTime);
+            result.stddevRealTime = std::sqrt(var / times.size());
+            result.items = items;
+            result.itemLabel = itemLabel;
+            results.push_back(result);
+
+            std::cout << std::left << std::setw(56) << name.toStdString() << std::right
+                << std::setw(12) << std::fixed << std::setprecision(3) << result.realTime * 1e3 << " ms"
+                << std::setw(12) << result.cpuTime * 1e3 << " ms"
+                << std::setw(10) << result.iterations
+                << std::setw(14) << std::setprecision(0) << ItemsPerSecond(result) << " " << itemLabel.toStdString() << "/s"
+                << std::endl;
+        }
+
+        QJsonObject Report() const {
+
+            QJsonObject context;
+            context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+            context["host_name"] = QSysInfo::machineHostName();
+            context["num_cpus"] = (int)std::thread::hardware_concurrency();
+            context["library_threads"] = options.threads;
+            context["min_time"] = options.minTime;
+            context["quick"] = options.quick;
+#ifdef NDEBUG
+            context["library_build_type"] = "release";
+#else
+            context["library_build_type"] = "debug";
+#endif
+
+            QJsonArray benchmarks;
+            for (const BenchmarkResult& result : results) {
+                QJsonObject entry;
+                entry["name"] = result.name;
+                entry["run_name"] = result.name;
+                entry["run_type"] = "iteration";
+                entry["iterations"] = (double)result.iterations;
+                entry["real_time"] = result.realTime * 1e3;
+                entry["cpu_time"] = result.cpuTime * 1e3;
+                entry["min_real_time"] = result.minRealTime * 1e3;
+                entry["stddev_real_time"] = result.stddevRealTime * 1e3;
+                entry["time_unit"] = "ms";
+                entry["items_per_second"] = ItemsPerSecond(result);
+                entry["items_per_iteration"] = result.items;
+                entry["item_label"] = result.itemLabel;
+                benchmarks.append(entry);
+            }//_for
+
+            QJsonObject report;
+            report["context"] = context;
+            report["benchmarks"] = benchmarks;
+            return report;
+        }
+
+        inline const BenchmarkOptions& GetOptions() const { return options; };
+
+    private:
+
+        static double ItemsPerSecond(const BenchmarkResult& result) {
+            return (result.realTime > 0) ? result.items / result.realTime : 0;
+        }
+
+        BenchmarkOptions options;
+        std::vector<BenchmarkResult> results;
+    };
+
+    /* Phantoms */
+
+    //Sphere mesh, open at the top when startPhi > 0
+    vtkSmartPointer<vtkPolyData> SpherePhantom(int resolution, double radius, const double centre[3], double startPhi = 0) {
+        vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+        sphere->SetCenter(centre[0], centre[1], centre[2]);
+        sphere->SetRadius(radius);
+        sphere->SetThetaResolution(resolution);
+        sphere->SetPhiResolution(resolution);
+        sphere->SetStartPhi(startPhi);
+        sphere->Update();
+        vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+        pd->DeepCopy(sphere->GetOutput());
+        return pd;
+    }
+
+    //LGE of a wall shell around a bright blood pool, with enhanced patches on the wall
+    template <typename TImage>
+    typename TImage::Pointer ShellPhantom(int n, double radius, double thickness, bool wallOnly = false) {
+        typename TImage::Pointer image = TImage::New();
+        typename TImage::RegionType region;
+        typename TImage::SizeType size;
+        size.Fill(n);
+        region.SetSize(size);
+        image->SetRegions(region);
+        image->Allocate();
+
+        //Patch centres (unit directions) and their angular radius
+        const double patches[4][3] = {{1, 0, 0}, {0, 1, 0}, {-0.577, -0.577, 0.577}, {0, 0, -1}};
+        const double patchCos = std::cos(25.0 * M_PI / 180.0);
+
+        std::mt19937 generator(42);
+        std::normal_distribution<double> noise(0.0, 8.0);
+        typename TImage::PixelType* buffer = image->GetBufferPointer();
+        const double c = n / 2.0;
+        for (int z = 0; z < n; z++) {
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    double d[3] = {x - c, y - c, z - c};
+                    double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                    bool inWall = std::abs(r - radius) <= thickness / 2.0;
+                    double value = 20;
+                    if (inWall) {
+                        value = 80;
+                        for (int p = 0; p < 4 && r > 0; p++)
+                            if ((d[0] * patches[p][0] + d[1] * patches[p][1] + d[2] * patches[p][2]) / r > patchCos)
+                                value = 400;
+                    } else if (r < radius) {
+                        value = 150;
+                    }//_if
+                    if (wallOnly)
+                        value = inWall ? 1 : 0;
+                    else
+                        value = std::max(0.0, value + noise(generator));
+                    buffer[(z * n + y) * n + x] = static_cast<typename TImage::PixelType>(value);
+                }//_for
+            }//_for
+        }//_for
+        return image;
+    }
+
+    /* Benchmarks */
+
+    void BenchmarkProjection(BenchmarkRunner& runner) {
+
+        const BenchmarkOptions& opts = runner.GetOptions();
+        std::vector<int> imageSizes = opts.quick ? std::vector<int>{64} : std::vector<int>{64, 128, 192};
+        std::vector<int> meshSizes = opts.quick ? std::vector<int>{32} : std::vector<int>{32, 96, 192};
+        std::vector<double> thresholds;
+        for (double v = 1.0; v <= 5.0 + 1e-9; v += 0.1)
+            thresholds.push_back(v);
+
+        for (int n : imageSizes) {
+            const double radius = 0.35 * n, thickness = std::max(3.0, 0.04 * n), voxels = double(n) * n * n;
+            const double centre[3] = {n / 2.0, n / 2.0, n / 2.0};
+            QString imageTag = "/image:" + QString::number(n);
+
+            ImageType::Pointer lgeITK = ShellPhantom<ImageType>(n, radius, thickness);
+            mitk::Image::Pointer lgeImage = mitk::ImportItkImage(lgeITK);
+
+            for (int m : meshSizes) {
+                mitk::Surface::Pointer surface = mitk::Surface::New();
+                surface->SetVtkPolyData(SpherePhantom(m, radius, centre));
+                double cells = surface->GetVtkPolyData()->GetNumberOfCells();
+                QString tag = imageTag + "/mesh:" + QString::number(m);
+
+                std::unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+                scar->SetMinStep(-1);
+                scar->SetMaxStep(3);
+                scar->SetMethodType(2);
+                scar->SetNumberOfThreads(opts.threads);
+
+                CemrgProjectionGeometry geometry;
+                runner.Run("ProjectionGeometry" + tag, cells, "cells", [&]() {
+                    geometry.Compute(surface->GetVtkPolyData(), lgeITK);
+                });
+                if (geometry.IsEmpty())
+                    geometry.Compute(surface->GetVtkPolyData(), lgeITK);
+
+                for (int k = CemrgLgeSampler::NEAREST; k <= CemrgLgeSampler::BSPLINE; k++) {
+                    CemrgLgeSampler::Kernel kernel = static_cast<CemrgLgeSampler::Kernel>(k);
+                    scar->SetSamplingKernel(kernel);
+                    runner.Run("Scar3D/" + QString::fromStdString(CemrgLgeSampler::KernelName(kernel)) + tag, cells, "cells", [&]() {
+                        scar->Scar3D(geometry, lgeImage);
+                    });
+                }//_for
+
+                //Thresholding of a nearest kernel projection
+                if (!runner.IsEnabled("ThresholdingSweep" + tag))
+                    continue;
+                scar->SetSamplingKernel(CemrgLgeSampler::NEAREST);
+                scar->Scar3D(geometry, lgeImage);
+                runner.Run("ThresholdingSweep" + tag, cells * thresholds.size(), "cell-thresholds", [&]() {
+                    scar->ThresholdingSweep(thresholds);
+                });
+            }//_for
+
+            //Blood pool statistics and LV scar thresholds on the whole grid
+            FloatImageType::Pointer lgeFloat = ShellPhantom<FloatImageType>(n, radius, thickness);
+            FloatImageType::Pointer roiFloat = ShellPhantom<FloatImageType>(n, radius - thickness, thickness, true);
+            mitk::Image::Pointer lgeFloatImage = mitk::ImportItkImage(lgeFloat);
+            mitk::Image::Pointer roiFloatImage = mitk::ImportItkImage(roiFloat);
+            std::unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+            scar->SetNumberOfThreads(opts.threads);
+            runner.Run("CalculateMeanStd" + imageTag, voxels, "voxels", [&]() {
+                double mean, stdv;
+                scar->CalculateMeanStd(lgeFloatImage, roiFloatImage, mean, stdv);
+            });
+
+            ImageType::Pointer wallITK = ShellPhantom<ImageType>(n, radius, thickness, true);
+            ImageType::Pointer remoteITK = ShellPhantom<ImageType>(n, radius - thickness, thickness, true);
+            ImageType::Pointer maskITK = ShellPhantom<ImageType>(n, radius, thickness, true);
+            CemrgLvScarSegmentation segmentation;
+            segmentation.SetNumberOfThreads(opts.threads);
+            runner.Run("LvScarSegmentation" + imageTag, voxels, "voxels", [&]() {
+                segmentation.Build(lgeITK, wallITK, remoteITK);
+                segmentation.WriteMask(maskITK, segmentation.GetSDThreshold(4));
+            });
+        }//_for
+    }
+
+    void BenchmarkStrains(BenchmarkRunner& runner) {
+
+        const BenchmarkOptions& opts = runner.GetOptions();
+        std::vector<int> meshSizes = opts.quick ? std::vector<int>{32} : std::vector<int>{32, 96};
+        const int frames = 10;
+        const double radius = 30, centre[3] = {0, 0, 0};
+
+        for (int m : meshSizes) {
+            //Deformed sphere sequence, open at the base like an LV shell
+            QString dir = opts.workDirectory + "/strains-" + QString::number(m);
+            QDir().mkpath(dir);
+            vtkSmartPointer<vtkPolyData> reference = SpherePhantom(m, radius, centre, 30);
+            for (int f = 0; f < frames; f++) {
+                double phase = std::sin(M_PI * f / frames);
+                vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+                pd->DeepCopy(reference);
+                for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++) {
+                    double p[3];
+                    pd->GetPoint(i, p);
+                    double radial = 1.0 - 0.15 * phase, longitudinal = 1.0 - 0.10 * phase;
+                    //Saved with x and y negated, as LoadVTKMesh flips them back
+                    pd->GetPoints()->SetPoint(i, -p[0] * radial, -p[1] * radial, p[2] * longitudinal);
+                }//_for
+                vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+                writer->SetInputData(pd);
+                writer->SetFileName((dir + "/transformed-" + QString::number(f) + ".vtk").toStdString().c_str());
+                writer->SetFileTypeToBinary();
+                writer->Write();
+            }//_for
+
+            //Landmarks: apex, base centre and the two RV insertion points
+            mitk::PointSet::Pointer landmarks = mitk::PointSet::New();
+            const double lm[4][3] = {
+                {0, 0, -radius}, {0, 0, radius * std::cos(M_PI / 6)},
+                {-0.8 * radius, 0.5 * radius, 0}, {-0.8 * radius, -0.5 * radius, 0}};
+            for (int i = 0; i < 4; i++) {
+                mitk::Point3D point;
+                point[0] = lm[i][0];
+                point[1] = lm[i][1];
+                point[2] = lm[i][2];
+                landmarks->InsertPoint(i, point);
+            }//_for
+            mitk::DataNode::Pointer lmNode = mitk::DataNode::New();
+            lmNode->SetData(landmarks);
+
+            std::unique_ptr<CemrgStrains> strains(new CemrgStrains(dir, 0));
+            strains->SetNumberOfThreads(opts.threads);
+            int segRatios[3] = {40, 40, 20};
+            strains->ReferenceAHA(lmNode, segRatios, false);
+            double cells = reference->GetNumberOfCells() * double(frames);
+            QString tag = "/mesh:" + QString::number(m) + "/frames:" + QString::number(frames);
+
+            runner.Run("CalculateStrainsPlot" + tag, cells, "cell-frames", [&]() {
+                for (int f = 0; f < frames; f++)
+                    strains->CalculateStrainsPlot(f, lmNode, 1);
+            });
+            runner.Run("CalculateStrainCurves" + tag, cells, "cell-frames", [&]() {
+                strains->CalculateStrainCurves(frames, lmNode, false);
+            });
+        }//_for
+    }
+
+    void BenchmarkSphericity(BenchmarkRunner& runner) {
+
+        const BenchmarkOptions& opts = runner.GetOptions();
+        std::vector<int> meshSizes = opts.quick ? std::vector<int>{32} : std::vector<int>{32, 96, 192};
+        const double centre[3] = {0, 0, 0};
+
+        for (int m : meshSizes) {
+            mitk::Surface::Pointer surface = mitk::Surface::New();
+            surface->SetVtkPolyData(SpherePhantom(m, 20, centre));
+            double cells = surface->GetVtkPolyData()->GetNumberOfCells();
+            QString tag = "/mesh:" + QString::number(m);
+            std::unique_ptr<CemrgMeasure> measure(new CemrgMeasure());
+
+            runner.Run("GetSphericity" + tag, cells, "cells", [&]() {
+                measure->GetSphericity(surface->GetVtkPolyData());
+            });
+            runner.Run("MassProperties" + tag, cells, "cells", [&]() {
+                measure->calcVolumeMesh(surface);
+                measure->calcSurfaceMesh(surface);
+            });
+            runner.Run("ComputeMeshGeometry" + tag, cells, "cells", [&]() {
+                measure->ComputeMeshGeometry(surface->GetVtkPolyData(), opts.threads);
+            });
+        }//_for
+    }
+
+    void BenchmarkCarp(BenchmarkRunner& runner) {
+
+        const BenchmarkOptions& opts = runner.GetOptions();
+        std::vector<int> slabSizes = opts.quick ? std::vector<int>{10} : std::vector<int>{10, 20, 40};
+
+        for (int s : slabSizes) {
+            //Tetrahedral slab: s x s x s/2 cubes of 6 tetrahedra, in micrometres
+            const int nx = s, ny = s, nz = std::max(1, s / 2);
+            auto pointId = [&](int i, int j, int k) { return (k * (ny + 1) + j) * (nx + 1) + i; };
+            std::vector<double> pts;
+            for (int k = 0; k <= nz; k++)
+                for (int j = 0; j <= ny; j++)
+                    for (int i = 0; i <= nx; i++) {
+                        pts.push_back(i * 500.0);
+                        pts.push_back(j * 500.0);
+                        pts.push_back(k * 500.0);
+                    }//_for
+
+            CemrgCommonUtils::CarpElements elems;
+            elems.offsets.push_back(0);
+            const int cubeTets[6][4] = {{0, 1, 3, 7}, {0, 1, 5, 7}, {0, 2, 3, 7}, {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 6, 7}};
+            for (int k = 0; k < nz; k++)
+                for (int j = 0; j < ny; j++)
+                    for (int i = 0; i < nx; i++) {
+                        int corners[8];
+                        for (int c = 0; c < 8; c++)
+                            corners[c] = pointId(i + (c & 1), j + ((c >> 1) & 1), k + ((c >> 2) & 1));
+                        for (int t = 0; t < 6; t++) {
+                            elems.types.push_back(CemrgCommonUtils::CARP_TT);
+                            for (int v = 0; v < 4; v++)
+                                elems.nodes.push_back(corners[cubeTets[t][v]]);
+                            elems.offsets.push_back(elems.nodes.size());
+                            elems.regions.push_back(1 + (i * 2 / nx));
+                        }//_for
+                    }//_for
+
+            QString base = opts.workDirectory + "/slab-" + QString::number(s);
+            QString ptsPath = base + ".pts", elemPath = base + ".elem", vtkPath = base + ".vtk";
+            CemrgCommonUtils::WriteCarpPoints(ptsPath, pts);
+            CemrgCommonUtils::WriteCarpElements(elemPath, elems);
+
+            std::vector<CemrgCommonUtils::CarpVtkField> fields(1);
+            fields[0].name = "x";
+            fields[0].cellData = false;
+            fields[0].numberOfComponents = 1;
+            for (size_t p = 0; p < pts.size(); p += 3)
+                fields[0].values.push_back(pts[p]);
+
+            double numElems = elems.Size();
+            QString tag = "/slab:" + QString::number(s);
+            runner.Run("ReadCarp" + tag, numElems, "elements", [&]() {
+                std::vector<double> readPts;
+                CemrgCommonUtils::CarpElements readElems;
+                CemrgCommonUtils::ReadCarpPoints(ptsPath, readPts);
+                CemrgCommonUtils::ReadCarpElements(elemPath, readElems);
+            });
+            runner.Run("CarpToVtkFields" + tag, numElems, "elements", [&]() {
+                CemrgCommonUtils::CarpToVtkFields(elemPath, ptsPath, vtkPath, fields);
+            });
+        }//_for
+    }
+
+    void BenchmarkCorridor(BenchmarkRunner& runner) {
+
+        const BenchmarkOptions& opts = runner.GetOptions();
+        std::vector<int> meshSizes = opts.quick ? std::vector<int>{32} : std::vector<int>{32, 96};
+        const double centre[3] = {0, 0, 0};
+
+        for (int m : meshSizes) {
+            //Scar map on a sphere, scalar rising towards +x
+            vtkSmartPointer<vtkPolyData> pd = SpherePhantom(m, 20, centre);
+            vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+            for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+                scalars->InsertNextTuple1(1.0 + pd->GetPoint(i)[0] / 20.0);
+            pd->GetPointData()->SetScalars(scalars);
+
+            QString dir = opts.workDirectory + "/corridor-" + QString::number(m) + "/";
+            QDir().mkpath(dir);
+            std::unique_ptr<CemrgScarAdvanced> advanced(new CemrgScarAdvanced());
+            advanced->SetInputData(pd);
+            advanced->SetOutputPath(dir.toStdString());
+            advanced->SetOutputPrefix("bench");
+            advanced->SetOutputFileName((dir + "corridor.csv").toStdString());
+            advanced->SetNeighbourhoodSize(3);
+
+            //Closed loop through four points around the equator
+            std::vector<vtkIdType> loop;
+            for (int q = 0; q < 4; q++) {
+                double a = q * M_PI / 2, target[3] = {20 * std::cos(a), 20 * std::sin(a), 0};
+                vtkIdType best = 0;
+                double bestDistance = 1e30;
+                for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++) {
+                    const double* p = pd->GetPoint(i);
+                    double d = (p[0] - target[0]) * (p[0] - target[0]) + (p[1] - target[1]) * (p[1] - target[1]) + p[2] * p[2];
+                    if (d < bestDistance) {
+                        bestDistance = d;
+                        best = i;
+                    }//_if
+                }//_for
+                loop.push_back(best);
+            }//_for
+
+            QString tag = "/mesh:" + QString::number(m);
+            runner.Run("CorridorExtraction" + tag, pd->GetNumberOfPoints(), "points", [&]() {
+                std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath>> paths;
+                for (size_t q = 0; q < loop.size(); q++) {
+                    vtkSmartPointer<vtkDijkstraGraphGeodesicPath> path = vtkSmartPointer<vtkDijkstraGraphGeodesicPath>::New();
+                    path->SetInputData(advanced->GetSourcePolyData());
+                    path->SetStartVertex(loop[q]);
+                    path->SetEndVertex(loop[(q + 1) % loop.size()]);
+                    path->Update();
+                    paths.push_back(path);
+                }//_for
+                advanced->ExtractCorridorData(paths);
+            }, [&]() {
+                //The corridor table is appended to, start each iteration from scratch
+                QFile::remove(dir + "corridor.csv");
+            });
+        }//_for
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    mitkCommandLineParser parser;
+
+    // Set general information about your command-line app
+    parser.setCategory("Benchmark");
+    parser.setTitle("CemrgAppModule Benchmark Command-line App");
+    parser.setContributor("CEMRG, KCL");
+    parser.setDescription(
+        "Times projection, thresholding, strains, sphericity, CARP parsing and corridor extraction "
+        "on synthetic phantoms at several mesh and image sizes.");
+
+    // How should arguments be prefixed
+    parser.setArgumentPrefix("--", "-");
+
+    // Add arguments. Unless specified otherwise, each argument is optional.
+    // See mitkCommandLineParser::addArgument() for more information.
+    parser.addArgument(
+        "output", "o", mitkCommandLineParser::OutputFile,
+        "JSON output", "Where to write the results as JSON.");
+    parser.addArgument(
+        "filter", "f", mitkCommandLineParser::String,
+        "Filter", "Regular expression, only benchmarks whose name matches are run (e.g. Scar3D|Strain).");
+    parser.addArgument(
+        "min-time", "t", mitkCommandLineParser::Float,
+        "Minimum time", "Seconds of timed iterations per benchmark. Default=0.5");
+    parser.addArgument(
+        "max-iterations", "i", mitkCommandLineParser::Int,
+        "Maximum iterations", "Upper bound of the iterations per benchmark. Default=1000");
+    parser.addArgument(
+        "threads", "n", mitkCommandLineParser::Int,
+        "Threads", "Threads of the library code, 0 uses all cores. Default=0");
+    parser.addArgument(
+        "quick", "q", mitkCommandLineParser::Bool,
+        "Quick", "Only the smallest size of every benchmark.");
+    parser.addArgument(
+        "work-dir", "w", mitkCommandLineParser::InputDirectory,
+        "Working directory", "Where the phantom files are written. Default=a temporary directory");
+
+    // Parse arguments.
+    // This method returns a mapping of long argument names to their values.
+    auto parsedArgs = parser.parseArguments(argc, argv);
+
+    if (parsedArgs.empty())
+        return EXIT_FAILURE;
+
+    BenchmarkOptions opts;
+    QString outputPath;
+    if (parsedArgs.end() != parsedArgs.find("output"))
+        outputPath = QString::fromStdString(us::any_cast<std::string>(parsedArgs["output"]));
+    if (parsedArgs.end() != parsedArgs.find("filter"))
+        opts.filter = QRegularExpression(QString::fromStdString(us::any_cast<std::string>(parsedArgs["filter"])));
+    if (parsedArgs.end() != parsedArgs.find("min-time"))
+        opts.minTime = std::max(0.0f, us::any_cast<float>(parsedArgs["min-time"]));
+    if (parsedArgs.end() != parsedArgs.find("max-iterations"))
+        opts.maxIterations = std::max(1, us::any_cast<int>(parsedArgs["max-iterations"]));
+    if (parsedArgs.end() != parsedArgs.find("threads"))
+        opts.threads = std::max(0, us::any_cast<int>(parsedArgs["threads"]));
+    if (parsedArgs.end() != parsedArgs.find("quick"))
+        opts.quick = us::any_cast<bool>(parsedArgs["quick"]);
+
+    if (!opts.filter.isValid()) {
+        MITK_ERROR << ("Invalid filter: " + opts.filter.errorString()).toStdString();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        QTemporaryDir temporary;
+        opts.workDirectory = temporary.path();
+        if (parsedArgs.end() != parsedArgs.find("work-dir"))
+            opts.workDirectory = QString::fromStdString(us::any_cast<std::string>(parsedArgs["work-dir"]));
+        QDir().mkpath(opts.workDirectory);
+
+        std::cout << std::left << std::setw(56) << "Benchmark" << std::right
+            << std::setw(15) << "Time" << std::setw(15) << "CPU" << std::setw(10) << "Iterations"
+            << std::setw(14) << "Throughput" << std::endl;
+
+        BenchmarkRunner runner(opts);
+        BenchmarkProjection(runner);
+        BenchmarkStrains(runner);
+        BenchmarkSphericity(runner);
+        BenchmarkCarp(runner);
+        BenchmarkCorridor(runner);
+
+        if (!outputPath.isEmpty()) {
+            QFile file(outputPath);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                MITK_ERROR << ("Could not write " + outputPath).toStdString();
+                return EXIT_FAILURE;
+            }
+            file.write(QJsonDocument(runner.Report()).toJson(QJsonDocument::Indented));
+            MITK_INFO << ("Results written to " + outputPath).toStdString();
+        }
+
+    } catch (const std::exception &e) {
+        MITK_ERROR << e.what();
+        return EXIT_FAILURE;
+    } catch (...) {
+        MITK_ERROR << "Unexpected error";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -220,7 +220,10 @@ int main(int argc, char* argv[]) {
         mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
 
         double mean = 0.0, stdv = 0.0;
-        scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
+        if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv)) {
+            MITK_ERROR << "Mean and standard deviation of the blood pool failed";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Performing Scar projection using " + segvtk.toStdString();
 
@@ -186,11 +186,13 @@ int main(int argc, char* argv[]) {
 
             //Volume and surface calculations
             std::unique_ptr<CemrgMeasure> morphAnal = std::unique_ptr<CemrgMeasure>(new CemrgMeasure());
-            double surfceLA = morphAnal->calcSurfaceMesh(surfLA);
-            double volumeLA = morphAnal->calcVolumeMesh(surfLA);
-            double surfceAP = morphAnal->calcSurfaceMesh(surfAP);
-            double volumeAP = morphAnal->calcVolumeMesh(surfAP);
-            double sphereLA = morphAnal->GetSphericity(surfLA->GetVtkPolyData());
+            CemrgMeasure::MeshGeometry geometryLA = morphAnal->ComputeMeshGeometry(surfLA->GetVtkPolyData());
+            CemrgMeasure::MeshGeometry geometryAP = morphAnal->ComputeMeshGeometry(surfAP->GetVtkPolyData());
+            double surfceLA = geometryLA.area;
+            double volumeLA = geometryLA.volume;
+            double surfceAP = geometryAP.area;
+            double volumeAP = geometryAP.volume;
+            double sphereLA = geometryLA.sphericity;
 
             //Store in text file
             ofstream morphResult;
@@ -98,6 +98,9 @@ int main(int argc, char* argv[]) {
     parser.addArgument( // optional
         "single-voxel-projection", "svp", mitkCommandLineParser::Bool,
         "Single Voxel Projection", "Project LGE voxels onto Scar Map ONLY ONCE (Default=OFF)");
+    parser.addArgument( // optional
+        "kernel", "k", mitkCommandLineParser::String,
+        "Sampling kernel", "LGE sampling along the normals: nearest, trilinear or bspline (Default=nearest)");
     parser.addArgument( // optional
         "multi-thresholds", "t", mitkCommandLineParser::Bool,
         "Multiple thresholds", "Produce the output for the scar score using multiple thresholds:\n\t  (mean+V*stdev) V = 1:0.1:5\n\t (V*IIR) V = 0.7:0.01:1.61");
@@ -128,6 +131,7 @@ int main(int argc, char* argv[]) {
     auto singlevoxelprojection = false;
     auto multithreshold = false;
     auto verbose = false;
+    std::string kernelName = "nearest";
 
     // Parse, cast and set optional argument
     MITK_INFO << "Parsing optional arguments";
@@ -146,6 +150,17 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "single voxel " << singlevoxelprojection << '\n';
 
+    if (parsedArgs.end() != parsedArgs.find("kernel")) {
+        kernelName = us::any_cast<std::string>(parsedArgs["kernel"]);
+    }
+    bool kernelOK;
+    CemrgLgeSampler::Kernel kernel = CemrgLgeSampler::KernelFromName(kernelName, &kernelOK);
+    if (!kernelOK) {
+        MITK_INFO << parser.helpText();
+        return EXIT_FAILURE;
+    }
+    std::cout << "kernel " << CemrgLgeSampler::KernelName(kernel) << '\n';
+
     if (parsedArgs.end() != parsedArgs.find("verbose")) {
         verbose = us::any_cast<bool>(parsedArgs["verbose"]);
     }
@@ -199,6 +214,7 @@ int main(int argc, char* argv[]) {
         MITK_INFO(singlevoxelprojection) << "Setting Single voxel projection";
         MITK_INFO(!singlevoxelprojection) << "Setting multiple voxels projection";
         scar->SetVoxelBasedProjection(singlevoxelprojection);
+        scar->SetSamplingKernel(kernel);
 
         ImageTypeCHAR::Pointer segITK = ImageTypeCHAR::New();
         ImageTypeSHRT::Pointer lgeITK = ImageTypeSHRT::New();
@@ -240,7 +256,10 @@ int main(int argc, char* argv[]) {
         mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
 
         double mean = 0.0, stdv = 0.0;
-        scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
+        if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv)) {
+            MITK_ERROR << "Mean and standard deviation of the blood pool failed";
+            return EXIT_FAILURE;
+        }//_if
 
         MITK_INFO(verbose) << "Performing Scar projection using " + segvtk.toStdString();
 
@@ -271,14 +290,19 @@ int main(int argc, char* argv[]) {
             endVal = (method == 2) ? 5.0 : 1.61;
             increment = (method == 2) ? 0.1 : 0.01;
 
+            std::vector<double> values, thresholds;
             double thisVal = startVal;
             while (thisVal <= endVal) {
-                double thisthres = (method == 2) ? mean + thisVal * stdv : mean * thisVal;
-                double thispercentage = scar->Thresholding(thisthres);
-                prodFile1 << "V=" << thisVal << ", SCORE=" << thispercentage << std::endl;
-
+                values.push_back(thisVal);
+                thresholds.push_back((method == 2) ? mean + thisVal * stdv : mean * thisVal);
                 thisVal += increment;
             }
+
+            // One pass over the scalars for the whole sweep
+            std::vector<double> percentages = scar->ThresholdingSweep(thresholds);
+            for (unsigned int ix = 0; ix < values.size(); ix++) {
+                prodFile1 << "V=" << values.at(ix) << ", SCORE=" << percentages.at(ix) << std::endl;
+            }
         }
 
         prodFile1.close();
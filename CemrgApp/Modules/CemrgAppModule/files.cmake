@@ -1,12 +1,23 @@
 set(CPP_FILES
     CemrgCommandLine.cpp
+    CemrgCommandLineJobRunner.cpp
+    CemrgCommandLineCache.cpp
     CemrgCommonUtils.cpp
     CemrgMeasure.cpp
     CemrgScar3D.cpp
     CemrgStrains.cpp
     CemrgPower.cpp
     CemrgAtriaClipper.cpp
+    CemrgAtrialScarPipeline.cpp
     CemrgScarAdvanced.cpp
+    CemrgMeshAdjacency.cpp
+    CemrgKdTree.cpp
+    CemrgLgeSampler.cpp
+    CemrgImageStatistics.cpp
+    CemrgLvScarSegmentation.cpp
+    CemrgProjectionGeometry.cpp
+    CemrgSurfaceExtraction.cpp
+    CemrgWallThickness.cpp
     CemrgTests.cpp
 )
 
@@ -15,13 +26,24 @@ set(UI_FILES
 
 set(MOC_H_FILES
   include/CemrgAtriaClipper.h
+  include/CemrgAtrialScarPipeline.h
   include/CemrgCommandLine.h
+  include/CemrgCommandLineJobRunner.h
+  include/CemrgCommandLineCache.h
   include/CemrgCommonUtils.h
   include/CemrgMeasure.h
   include/CemrgScar3D.h
   include/CemrgStrains.h
   include/CemrgPower.h
   include/CemrgScarAdvanced.h
+  include/CemrgMeshAdjacency.h
+  include/CemrgKdTree.h
+  include/CemrgLgeSampler.h
+  include/CemrgImageStatistics.h
+  include/CemrgLvScarSegmentation.h
+  include/CemrgProjectionGeometry.h
+  include/CemrgSurfaceExtraction.h
+  include/CemrgWallThickness.h
 )
 
 set(RESOURCE_FILES
@@ -67,12 +67,31 @@ public:
     inline void SetRadiusAdjustment(double value) { radiusAdj = value; };
     inline bool GetCentreLinesOrientation() { return ctrlnOrientation; };
 
+    //Experimental: ClipVeinsImage works on each cutter's bounding region instead of the whole image.
+    //Off by default, CemrgAtriaClipperTest checks it against the whole-image clipping on phantoms only
+    inline void SetClipImageRegionsOfInterest(bool value) { roiClipping = value; };
+    inline void ClipImageRegionsOfInterestOn() { roiClipping = true; };
+    inline void ClipImageRegionsOfInterestOff() { roiClipping = false; };
+
+    //ComputeCtrLines computes the veins concurrently, each on its own copy of the shell.
+    //Off by default, CemrgAtriaClipperTest compares it with the sequential run
+    inline void SetConcurrentCentreLines(bool value) { concurrentCtrLines = value; };
+    inline void ConcurrentCentreLinesOn() { concurrentCtrLines = true; };
+    inline void ConcurrentCentreLinesOff() { concurrentCtrLines = false; };
+    inline void SetNumberOfThreads(int value) { numberOfThreads = value; };
+
+    //Debug files written by ComputeCtrLines to reproduce the centre lines
+    inline void SetProducibilityOutput(bool value) { producibilityOutput = value; };
+    inline void ProducibilityOutputOn() { producibilityOutput = true; };
+    inline void ProducibilityOutputOff() { producibilityOutput = false; };
+
     void SetMClipperAngles(double* value, int clippersIndex);
     void SetMClipperSeeds(vtkSmartPointer<vtkPolyData> pickedCutterSeeds, int clippersIndex);
 
 private:
 
     vtkIdType CentreOfMass(mitk::Surface::Pointer surface);
+    vtkSmartPointer<vtkvmtkPolyDataCenterlines> ComputeCtrLine(vtkSmartPointer<vtkPolyData> shell, vtkIdType inletSeedId, vtkIdType outletSeedId, bool flipNormals);
     void VTKWriter(vtkSmartPointer<vtkPolyData> PD, QString path);
 
     QString directory;
@@ -91,6 +110,10 @@ private:
     double criterion = 0.025; //Ostium if slope higher than highslope and above bump criterion
     double clSpacing = 2.000; //Resample the centerline with this spacing
     double radiusAdj = 2.000; //Adjustment for cutter planes radii
+    bool roiClipping = false; //Clip the image inside each cutter's bounding region only
+    bool concurrentCtrLines = false; //One centre line per worker thread
+    int numberOfThreads = 0; //Worker threads, 0 uses all cores
+    bool producibilityOutput = false; //Write the centre lines' debug files
 
     //Cutters properties
     std::vector<int> manuals; //Cutter's tilt manual or automatic
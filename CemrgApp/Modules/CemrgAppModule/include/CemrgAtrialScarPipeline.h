@@ -0,0 +1,124 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Atrial Scar Pipeline
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgAtrialScarPipeline_h
+#define CemrgAtrialScarPipeline_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// Qt
+#include <QFileInfo>
+#include <QString>
+
+// C++ Standard
+#include <vector>
+
+class CemrgCommandLine;
+
+/**
+ * Stages of the automatic atrial scar analysis of a case directory, shared by
+ * the Atrial Scar view and the CemrgAtrialScarBatch app. Each stage reads the
+ * files written by the ones before it, named by the getters below, and
+ * returns false with GetErrorMessage() set when it fails.
+ *
+ * The CemrgNet prediction is left untouched: registration works on a rounded
+ * copy (LA.nii), and the scar stage projects on a copy of the clipped
+ * segmentation resampled to the LGE grid (PVeinsCroppedImage-LGE.nii).
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgAtrialScarPipeline {
+
+public:
+
+    //External commands run through cmd, not owned
+    CemrgAtrialScarPipeline(QString directory, CemrgCommandLine* cmd);
+
+    //dcm-LGE*.nii, dcm-MRA*.nii and LA-cemrgnet.nii in the directory or below, false without LGE or MRA
+    bool FindInputs();
+    inline QString GetLgePath() const { return lgePath; };
+    inline QString GetMraPath() const { return mraPath; };
+    inline QString GetCnnPath() const { return cnnPath; };
+    inline bool HasPrediction() const { return QFileInfo(cnnPath).size() > 0; };
+
+    //Surface extraction: native (in process), fidelity (native checked against MIRTK) or mirtk
+    inline void SetSurfaceMethod(QString method) { surfaceMethod = method; };
+    inline void SetNumberOfThreads(int n) { numberOfThreads = n; };
+    inline void SetGeometryCache(bool b) { geometryCache = b; };
+
+    //Projection and thresholding, as in CemrgScar3D and CemrgScar3D::PrintThresholdingResults
+    inline void SetMinStep(int value) { minStep = value; };
+    inline void SetMaxStep(int value) { maxStep = value; };
+    inline void SetMethodType(int value) { methodType = value; };
+    inline void SetThresholdType(int value) { threshType = value; };
+    inline void SetThresholds(std::vector<double> values) { thresholds = values; };
+
+    //Stage outputs
+    inline QString GetLaPath() const { return prodPath + "LA.nii"; };
+    inline QString GetLaRegPath() const { return prodPath + "LA-reg.nii"; };
+    inline QString GetDofPath() const { return prodPath + "rigid.dof"; };
+    inline QString GetCleanPath() const { return prodPath + "prodClean.nii"; };
+    inline QString GetVeinsPath() const { return prodPath + "prodVeins.nii"; };
+    inline QString GetSeparatedVeinsPath() const { return prodPath + "prodSeparatedVeins.nii"; };
+    inline QString GetCroppedPath() const { return prodPath + "PVeinsCroppedImage.nii"; };
+    inline QString GetLabelledPath() const { return prodPath + "PVeinsLabelled.nii"; };
+    inline QString GetMviPath() const { return prodPath + "prodMVI.nii"; };
+    inline QString GetShellPath() const { return prodPath + "segmentation.vtk"; };
+    inline QString GetCroppedLgePath() const { return prodPath + "PVeinsCroppedImage-LGE.nii"; };
+    inline QString GetScarPath() const { return prodPath + "MaxScar.vtk"; };
+    inline QString GetScarDebugPath() const { return prodPath + "Max_debugScar.nii"; };
+    inline QString GetNormalisedScarPath() const { return prodPath + "MaxScar_Normalised.vtk"; };
+    inline QString GetThresholdsPath() const { return prodPath + "prodThresholds.txt"; };
+
+    bool Segmentation();   //CemrgNet prediction of the MRA, moved to GetCnnPath()
+    bool Registration();   //LA.nii on the MRA grid, LGE to MRA registration, LA-reg.nii
+    bool Clean();          //Largest component of LA-reg.nii as a binary mask
+    bool SeparateVeins();  //Veins (label 2) opened and split into components
+    bool ClipVeins();      //Centre lines from the vein centroids, veins clipped off the clean mask
+    bool ClipMitralValve();//Surface of the clipped segmentation without the mitral valve (label 3)
+    bool ScarProjection(); //LGE projected on the shell, normalised scalars and thresholds
+
+    inline QString GetErrorMessage() const { return errorMessage; };
+
+private:
+
+    QString Surface(QString segPath);
+    bool Fail(QString message);
+
+    QString directory, prodPath;
+    QString lgePath, mraPath, cnnPath;
+    CemrgCommandLine* cmd;
+    QString errorMessage;
+
+    QString surfaceMethod;
+    int numberOfThreads;
+    bool geometryCache;
+    int minStep, maxStep, methodType, threshType;
+    std::vector<double> thresholds;
+};
+
+#endif // CemrgAtrialScarPipeline_h
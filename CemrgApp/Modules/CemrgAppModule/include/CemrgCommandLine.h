@@ -32,10 +32,14 @@ PURPOSE.  See the above copyright notices for more information.
 
 // Qt
 #include <memory>
+#include <vector>
+#include <QDir>
 #include <QProcess>
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <MitkCemrgAppModuleExports.h>
+#include "CemrgCommandLineJobRunner.h"
+#include "CemrgCommandLineCache.h"
 
 class MITKCEMRGAPPMODULE_EXPORT CemrgCommandLine: public QObject {
 
@@ -53,6 +57,7 @@ public:
     QString ExecuteSurf(QString dir, QString segPath, QString morphOperation = "close", int iter = 1, float th = 0.5, int blur = 0, int smth = 10);
     QString ExecuteCreateCGALMesh(QString dir, QString outputName, QString paramsFullPath, QString segmentationName = "converted.inr");
     void ExecuteTracking(QString dir, QString imgTimes, QString param, QString output = "tsffd.dof");
+    //Frames run concurrently up to GetJobRunner()->GetMaximumConcurrentJobs(), see SetMaximumConcurrentJobs
     void ExecuteApplying(QString dir, QString inputMesh, double iniTime, QString dofin, int noFrames, int smooth);
     void ExecuteRegistration(QString dir, QString fixed, QString moving, QString transformFileName = "rigid.dof", QString modelname = "Rigid");
     void ExecuteTransformation(QString dir, QString imgNamefullpath, QString regImgNamefullpath, QString transformFileFullPath = "rigid.dof");
@@ -87,31 +92,86 @@ public:
     inline QString GetDockerImage() { return _dockerimage; };
     QStringList GetDockerArguments(QString volume, QString dockerexe = "");
 
+    //Local MIRTK executables, <application dir>/MLib unless set
+    inline void SetMirtkDirectory(QString dir) { _mirtkDirectory = dir; };
+    inline QString GetMirtkDirectory() { return _mirtkDirectory; };
+
+    //Job Runner Functions
+    CemrgCommandLineJob::Pointer SubmitCommand(QString executableName, QStringList arguments);
+    inline CemrgCommandLineJobRunner* GetJobRunner() { return runner.get(); };
+    inline void SetMaximumConcurrentJobs(int n) { runner->SetMaximumConcurrentJobs(n); };
+    inline void SetWorkingDirectory(QString dir) { _workingDirectory = dir; };
+    inline void SetProcessEnvironment(QProcessEnvironment env) { _processEnvironment = env; };
+
+    //Resource profile: MIRTK -threads per job, jobs and total threads running at once
+    struct ResourceProfile {
+        int threadsPerJob = 0; // 0: hardware threads shared by the concurrent jobs
+        int maxConcurrentJobs = 1;
+        int maxConcurrentThreads = 0; // 0: no cap
+    };
+    void SetResourceProfile(ResourceProfile profile);
+    ResourceProfile GetResourceProfile();
+    inline void SetThreadsPerJob(int n) { _threadsPerJob = n; };
+    inline void SetMaximumConcurrentThreads(int n) { runner->SetMaximumConcurrentThreads(n); };
+    int GetThreadsPerJob();
+
+    //Wall and CPU time of every finished command, optionally appended to a CSV file
+    struct StageTiming {
+        QString stage;
+        int threads;
+        double wallSeconds;
+        double cpuSeconds; // -1 when unknown
+        int exitCode;
+    };
+    inline std::vector<StageTiming> GetStageTimings() { return stageTimings; };
+    inline void ClearStageTimings() { stageTimings.clear(); };
+    inline void SetTimingLogFile(QString path) { _timingLogFile = path; };
+
+    //Output cache, opt-in through SetOutputCache or CEMRGAPP_COMMANDLINE_CACHE
+    inline void SetOutputCache(std::shared_ptr<CemrgCommandLineCache> c) { cache = c; };
+    inline std::shared_ptr<CemrgCommandLineCache> GetOutputCache() { return cache; };
+
     //Helper Functions
-    bool CheckForStartedProcess();
+    bool CheckForStartedProcess(CemrgCommandLineJob::Pointer job);
     void ExecuteTouch(QString filepath);
     bool IsOutputSuccessful(QString outputFullPath);
     std::string PrintFullCommand(QString command, QStringList arguments);
-    bool ExecuteCommand(QString executableName, QStringList arguments, QString outputPath, bool isOutputFile = true);
+    //cacheInputs: files read without being named as an argument; useCache false when they cannot all be listed
+    bool ExecuteCommand(QString executableName, QStringList arguments, QString outputPath, bool isOutputFile = true, QStringList cacheInputs = QStringList(), bool useCache = true);
 
 protected slots:
 
-    void UpdateStdText();
-    void UpdateErrText();
-    void FinishedAlert();
+    void UpdateStdText(QString data);
+    void FinishedAlert(CemrgCommandLineJob* job);
 
 private:
 
+    QStringList ThreadArguments();
+    QStringList TransformationOnPointsArguments(QString dir, QString meshFullPath, QString outputMeshFullPath, QString transformFileFullPath, double applyingIniTime, QString& outAbsolutePath);
+
+    //Cache inputs and identity, false when the command cannot be cached
+    bool CacheIdentity(QString executableName, QStringList arguments, QStringList& identity);
+    QString DockerImageDigest(QString executableName, QStringList arguments);
+    bool ImageListFiles(QString listPath, QStringList& files);
+    bool MeshFiles(QDir home, QString meshName, QStringList& files);
+    bool VertexFiles(QDir home, QString vtxName, QStringList& files);
+
     //Dial and panel
     QDialog* dial;
     QTextEdit* panel;
     QVBoxLayout* layout;
 
     //QProcess
-    bool completion;
     QString _dockerimage;
     bool _useDockerContainers, _debugvar;
-    std::unique_ptr<QProcess> process;
+    QString _workingDirectory;
+    QString _mirtkDirectory;
+    QString _timingLogFile;
+    int _threadsPerJob;
+    std::vector<StageTiming> stageTimings;
+    QProcessEnvironment _processEnvironment;
+    std::unique_ptr<CemrgCommandLineJobRunner> runner;
+    std::shared_ptr<CemrgCommandLineCache> cache;
 };
 
 #endif // CemrgCommandLine_h
\ No newline at end of file
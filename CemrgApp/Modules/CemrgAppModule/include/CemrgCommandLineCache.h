@@ -0,0 +1,97 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Commandline Output Cache
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgCommandLineCache_h
+#define CemrgCommandLineCache_h
+
+// Qt
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+
+// C++ Standard
+#include <memory>
+#include <MitkCemrgAppModuleExports.h>
+
+/**
+ * On-disk cache of the output file of external commands. Entries are keyed by
+ * the executable identity, the arguments and the contents of every argument
+ * that names an existing file, so paths to identical inputs share an entry.
+ * Files a command reads without naming them as an argument (image lists,
+ * relative paths inside a docker volume) must be passed as extra inputs.
+ * The MIRTK -threads option is left out of the key.
+ * The cache is capped in size and evicts the least recently used entries.
+ * Several processes may share the same directory.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgCommandLineCache {
+
+public:
+
+    CemrgCommandLineCache(QString directory, qint64 maxBytes = 4LL * 1024 * 1024 * 1024);
+
+    // Shared cache from CEMRGAPP_COMMANDLINE_CACHE (directory) and CEMRGAPP_COMMANDLINE_CACHE_MB, null when unset
+    static std::shared_ptr<CemrgCommandLineCache> FromEnvironment();
+
+    // Empty when the executable cannot be identified or an input cannot be read
+    // identity: what the executable runs beyond its own file, e.g. a docker image digest
+    QString Key(QString executableName, QStringList arguments, QString outputPath, QStringList extraInputs = QStringList(), QStringList identity = QStringList());
+
+    // Copies the cached output to outputPath and counts a hit, otherwise counts a miss
+    bool Restore(QString key, QString outputPath);
+    bool Store(QString key, QString outputPath);
+    void Evict();
+    void Clear();
+
+    inline QString GetDirectory() const { return directory; };
+    inline qint64 GetMaximumSize() const { return maxBytes; };
+    inline void SetMaximumSize(qint64 bytes) { maxBytes = bytes; };
+    int GetHits();
+    int GetMisses();
+    qint64 GetSize();
+
+private:
+
+    struct FileHash {
+        qint64 size;
+        QDateTime modified;
+        QByteArray hash;
+    };
+
+    QByteArray HashFile(QString path);
+    QString EntryPath(QString key) const;
+
+    QString directory;
+    qint64 maxBytes;
+    int hits, misses;
+    QHash<QString, FileHash> fileHashes;
+    QMutex mutex;
+};
+
+#endif // CemrgCommandLineCache_h
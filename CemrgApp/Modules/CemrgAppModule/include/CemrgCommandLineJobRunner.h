@@ -0,0 +1,163 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Commandline Job Runner
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgCommandLineJobRunner_h
+#define CemrgCommandLineJobRunner_h
+
+// Qt
+#include <QObject>
+#include <QProcess>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QStringList>
+
+// C++ Standard
+#include <deque>
+#include <vector>
+#include <MitkCemrgAppModuleExports.h>
+
+class CemrgCommandLineJobRunner;
+
+/**
+ * Handle to one external process submitted to a CemrgCommandLineJobRunner.
+ * The handle outlives the process: exit code, exit status and the merged
+ * stdout/stderr log stay available once the job has finished.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgCommandLineJob: public QObject {
+
+    Q_OBJECT
+
+public:
+
+    typedef QSharedPointer<CemrgCommandLineJob> Pointer;
+    enum JobState { QUEUED, RUNNING, FINISHED, FAILED_TO_START };
+
+    ~CemrgCommandLineJob();
+
+    inline QString GetProgram() const { return program; };
+    inline QStringList GetArguments() const { return arguments; };
+    inline QString GetWorkingDirectory() const { return workingDirectory; };
+    inline JobState GetState() const { return state; };
+    inline int GetExitCode() const { return exitCode; };
+    inline QProcess::ExitStatus GetExitStatus() const { return exitStatus; };
+    inline QString GetLog() const { return log; };
+    inline QString GetErrorString() const { return errorString; };
+    inline double GetElapsedSeconds() const { return elapsedMilliseconds / 1000.0; };
+    inline int GetThreads() const { return threads; };
+
+    // User + system time of the finished process, -1 when unknown. Exact when jobs
+    // finish one at a time, shared out by reap order when several finish together.
+    inline double GetCpuSeconds() const { return cpuSeconds; };
+
+    inline bool IsDone() const { return state == FINISHED || state == FAILED_TO_START; };
+    inline bool HasStarted() const { return state == RUNNING || state == FINISHED; };
+    inline bool IsSuccessful() const { return state == FINISHED && exitStatus == QProcess::NormalExit && exitCode == 0; };
+
+    // Blocks on a local event loop (no polling) until the job is done; msecs < 0 waits forever
+    bool Wait(int msecs = -1);
+    void Kill();
+
+signals:
+
+    void Started();
+    void Output(QString data);
+    void Finished();
+
+private:
+
+    friend class CemrgCommandLineJobRunner;
+    CemrgCommandLineJob(QString program, QStringList arguments, QString workingDirectory, QProcessEnvironment environment, int threads);
+
+    void Launch();
+    void Complete(JobState finalState);
+
+    QString program;
+    QStringList arguments;
+    QString workingDirectory;
+    QProcessEnvironment environment;
+    int threads;
+
+    JobState state;
+    int exitCode;
+    QProcess::ExitStatus exitStatus;
+    QString log;
+    QString errorString;
+    qint64 elapsedMilliseconds;
+    double cpuSeconds;
+    QElapsedTimer timer;
+    QProcess* process;
+};
+
+/**
+ * Bounded pool of external processes driven by QProcess signals. Jobs are
+ * started in submission order, at most GetMaximumConcurrentJobs() at a time
+ * and, when a thread cap is set, only while the threads of the running jobs
+ * fit under it. A job larger than the cap still runs, on its own.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgCommandLineJobRunner: public QObject {
+
+    Q_OBJECT
+
+public:
+
+    CemrgCommandLineJobRunner(int maxConcurrentJobs = 1, QObject* parent = nullptr);
+    ~CemrgCommandLineJobRunner();
+
+    CemrgCommandLineJob::Pointer Submit(QString program, QStringList arguments, QString workingDirectory = "", QProcessEnvironment environment = QProcessEnvironment(), int threads = 1);
+    bool WaitForAll(int msecs = -1);
+    void KillAll();
+
+    // Values below 1 use the number of hardware threads
+    void SetMaximumConcurrentJobs(int n);
+    inline int GetMaximumConcurrentJobs() const { return maxConcurrentJobs; };
+    inline int GetNumberOfRunningJobs() const { return static_cast<int>(running.size()); };
+    inline int GetNumberOfQueuedJobs() const { return static_cast<int>(queued.size()); };
+
+    // Cap on the sum of GetThreads() over running jobs, values below 1 remove the cap
+    inline void SetMaximumConcurrentThreads(int n) { maxConcurrentThreads = (n < 1) ? 0 : n; Schedule(); };
+    inline int GetMaximumConcurrentThreads() const { return maxConcurrentThreads; };
+    int GetNumberOfRunningThreads() const;
+
+signals:
+
+    void JobStarted(CemrgCommandLineJob* job);
+    void JobOutput(QString data);
+    void JobFinished(CemrgCommandLineJob* job);
+
+private:
+
+    void Schedule();
+    void OnJobFinished(CemrgCommandLineJob* job);
+
+    int maxConcurrentJobs;
+    int maxConcurrentThreads;
+    std::deque<CemrgCommandLineJob::Pointer> queued;
+    std::vector<CemrgCommandLineJob::Pointer> running;
+};
+
+#endif // CemrgCommandLineJobRunner_h
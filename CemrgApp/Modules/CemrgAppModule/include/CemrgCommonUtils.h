@@ -35,8 +35,15 @@ PURPOSE.  See the above copyright notices for more information.
 #include <mitkBoundingObject.h>
 #include <mitkDataNode.h>
 #include <mitkDataStorage.h>
+#include <itkImage.h>
+#include <vtkPoints.h>
 #include <QString>
 
+// C++ Standard
+#include <cstdint>
+#include <string>
+#include <vector>
+
 class MITKCEMRGAPPMODULE_EXPORT CemrgCommonUtils {
 
 public:
@@ -58,6 +65,22 @@ public:
     // Image Analysis Utils
     static void SetSegmentationEdgesToZero(mitk::Image::Pointer image, QString outPath = "");
 
+    //Label geometry, every label of the image in one pass
+    typedef itk::Image<short, 3> LabelImageType;
+    struct LabelGeometry {
+        int label;
+        uint64_t count;
+        double centroid[3];                 // physical coordinates
+        itk::IndexValueType lower[3];       // bounding box, inclusive image indices
+        itk::IndexValueType upper[3];
+        double principalMoments[3];         // variance along each principal axis (mm^2), ascending
+        double principalAxes[3][3];         // unit axis of principalMoments[k] in principalAxes[k]
+        LabelImageType::RegionType Region() const;
+    };
+    static std::vector<LabelGeometry> ComputeLabelGeometry(LabelImageType::Pointer image, bool ignoreBackground = true, int numberOfThreads = 0);
+    static std::vector<LabelGeometry> ComputeLabelGeometry(mitk::Image::Pointer image, bool ignoreBackground = true, int numberOfThreads = 0);
+    static const LabelGeometry* FindLabelGeometry(const std::vector<LabelGeometry>& geometry, int label);
+
     //Nifti Conversion Utils
     static bool ConvertToNifti(mitk::BaseData::Pointer oneNode, QString path2file, bool resample = false, bool reorient = false);
     static void RoundPixelValues(QString pathToImage, QString outputPath = "");
@@ -65,7 +88,11 @@ public:
     // static void RoundPointDataValues(vtkSmartPointer<vtkPolyData> pd);
 
     //Mesh Utils
-    static mitk::Surface::Pointer LoadVTKMesh(std::string path);
+    //Meshes from MIRTK have x and y negated. With lazyFlip the points are kept as read and the flip
+    //goes in the surface geometry instead, so only use it when GetVtkPolyData() is not read directly
+    static mitk::Surface::Pointer LoadVTKMesh(std::string path, bool lazyFlip = false);
+    //Negates x and y on the point array, in place and in parallel chunks. Bounds of the result in bounds
+    static void FlipXYPoints(vtkPoints* points, double bounds[6] = nullptr, int numberOfThreads = 0);
     static mitk::Surface::Pointer ExtractSurfaceFromSegmentation(mitk::Image::Pointer image, double thresh = 0.5, double blur = 0.8, double smoothIterations = 3, double decimation = 0.5);
     static mitk::Surface::Pointer ClipWithSphere(mitk::Surface::Pointer surface, double x_c, double y_c, double z_c, double radius, QString saveToPath = "");
     static void FlipXYPlane(mitk::Surface::Pointer surf, QString dir, QString vtkname = "segmentation.vtk");
@@ -81,6 +108,16 @@ public:
     static mitk::DataNode::Pointer AddToStorage(mitk::BaseData* data, std::string nodeName, mitk::DataStorage::Pointer ds, bool init = true);
 
     //Carp Utils
+    enum CarpElementType { CARP_TT = 0, CARP_HX, CARP_OC, CARP_PY, CARP_PR, CARP_QD, CARP_TR, CARP_LN, CARP_UNKNOWN };
+    struct CarpElements {
+        std::vector<int> types;   // CarpElementType of each element
+        std::vector<int> offsets; // nodes of element i are nodes[offsets[i]] to nodes[offsets[i+1]-1]
+        std::vector<int> nodes;
+        std::vector<int> regions;
+        inline int Size() const { return types.size(); };
+        inline int NumberOfNodes(int i) const { return offsets[i + 1] - offsets[i]; };
+    };
+
     static void OriginalCoordinates(QString imagePath, QString pointPath, QString outputPath, double scaling = 1000);
     static void CalculateCentreOfGravity(QString pointPath, QString elemPath, QString outputPath);
     static void RegionMapping(QString bpPath, QString pointPath, QString elemPath, QString outputPath);
@@ -92,6 +129,29 @@ public:
     static void AppendScalarFieldToVtk(QString vtkPath, QString fieldName, QString typeData, std::vector<double> field, bool setHeader = true);
     static void AppendVectorFieldToVtk(QString vtkPath, QString fieldName, QString typeData, std::vector<double> field, bool setHeader = true);
 
+    //Carp to VTK in one streamed pass: legacy ASCII, legacy binary or appended raw XML (.vtu)
+    enum CarpVtkFormat { CARP_VTK_ASCII = 0, CARP_VTK_BINARY, CARP_VTU_APPENDED };
+    struct CarpVtkField {
+        std::string name;
+        bool cellData;          // CELL_DATA when true, POINT_DATA otherwise
+        int numberOfComponents; // 1 to 4, tuples stored interleaved
+        std::vector<double> values;
+    };
+    static int CarpElementVtkCellType(int type);
+    static bool CarpToVtkFields(QString elemPath, QString ptsPath, QString outputPath, const std::vector<CarpVtkField>& fields, int format = CARP_VTK_BINARY, bool saveRegionlabels = true);
+    static bool WriteCarpVtk(QString outputPath, const std::vector<double>& pts, const CarpElements& elems, const std::vector<CarpVtkField>& fields, int format = CARP_VTK_BINARY, bool saveRegionlabels = true);
+
+    //Carp mesh I/O, binary (.bpts, .belem, .blon) or ASCII chosen by file extension
+    static bool ReadCarpPoints(QString ptsPath, std::vector<double>& pts);
+    static bool WriteCarpPoints(QString ptsPath, const std::vector<double>& pts);
+    static bool ReadCarpElements(QString elemPath, CarpElements& elems);
+    static bool WriteCarpElements(QString elemPath, const CarpElements& elems);
+    static bool ReadCarpFibres(QString lonPath, std::vector<double>& fibres, int& numAxes);
+    static bool WriteCarpFibres(QString lonPath, const std::vector<double>& fibres, int numAxes);
+    static int CarpElementTypeFromTag(std::string tag);
+    static std::string CarpElementTag(int type);
+    static int CarpElementNumberOfNodes(int type);
+
 private:
 
     //Cropping Utils
@@ -0,0 +1,114 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Streaming Image Statistics
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgImageStatistics_h
+#define CemrgImageStatistics_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// C++ Standard
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Count, mean, variance, min and max of a stream of values, accumulated in
+ * one pass with Welford's update. Masked image buffers are processed in fixed
+ * blocks that are merged in order, so the result does not depend on the
+ * number of threads. NaN and infinite values are skipped everywhere.
+ *
+ * With the histogram enabled, Accumulate also bins the values for percentiles
+ * and rank sums. Bins are one unit wide, and the answers exact, when every
+ * value is an integer and the range fits in the maximum number of bins;
+ * otherwise values are interpolated inside their bin.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgImageStatistics {
+
+public:
+
+    CemrgImageStatistics();
+
+    void Add(double value);
+    void Merge(const CemrgImageStatistics& other);
+    void Clear();
+
+    //Voxels whose mask equals maskLabel (any non-zero mask if maskLabel < 0). All voxels if mask is null.
+    //False when no finite voxel is under the mask, nothing is accumulated then.
+    template <typename TPixel, typename TMask>
+    bool Accumulate(const TPixel* image, const TMask* mask, size_t numVoxels, int maskLabel = -1);
+
+    //Values given as a unit-width histogram, counts[k] being the number of values equal to firstValue + k.
+    //False when every count is zero.
+    bool AccumulateHistogram(const std::vector<uint64_t>& counts, double firstValue);
+
+    inline void SetNumberOfThreads(int n) { numberOfThreads = n; };
+    inline void SetHistogram(bool b) { histogramOn = b; };
+    inline void SetHistogramOn() { SetHistogram(true); };
+    inline void SetHistogramOff() { SetHistogram(false); };
+    inline void SetMaximumNumberOfBins(int n) { maxBins = (n < 1) ? 1 : n; };
+
+    inline uint64_t GetCount() const { return count; };
+    inline double GetMean() const { return mean; };
+    inline double GetSum() const { return mean * count; };
+    inline double GetMinimum() const { return minimum; };
+    inline double GetMaximum() const { return maximum; };
+    //Population variance (divided by the count), as used by the scar thresholds
+    inline double GetVariance() const { return count > 0 ? m2 / count : 0.0; };
+    double GetStandardDeviation() const;
+
+    inline bool HasHistogram() const { return !histogram.empty(); };
+    inline bool IsHistogramExact() const { return histogramExact; };
+    inline const std::vector<uint64_t>& GetHistogram() const { return histogram; };
+    inline double GetHistogramMinimum() const { return histogramMinimum; };
+    inline double GetBinWidth() const { return binWidth; };
+
+    //Value of the given rank (0 = smallest) in sorted order
+    double GetValueAtRank(uint64_t rank) const;
+    //Sum of the sorted values from rank first up to, not including, rank last
+    double GetRankSum(uint64_t first, uint64_t last) const;
+    //Percentile in [0, 100], interpolated between the two closest ranks
+    double GetPercentile(double percent) const;
+
+private:
+
+    double BinValue(size_t bin, uint64_t rankInBin) const;
+
+    int numberOfThreads;
+    bool histogramOn;
+    int maxBins;
+
+    uint64_t count;
+    double mean, m2, minimum, maximum;
+
+    std::vector<uint64_t> histogram;
+    double histogramMinimum, binWidth;
+    bool histogramExact;
+};
+
+#endif // CemrgImageStatistics_h
@@ -0,0 +1,83 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Static KD-Tree Point Search
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgKdTree_h
+#define CemrgKdTree_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// VTK
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+
+// C++ Standard
+#include <vector>
+#include <utility>
+
+/**
+ * KD-tree over a fixed point set. The tree is built once and never modified,
+ * so the const queries can be issued from any number of threads at once.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgKdTree {
+
+public:
+
+    CemrgKdTree();
+
+    void Build(vtkPoints* points);
+    void Clear();
+
+    //Closest point id (-1 when empty), squared distance returned in dist2
+    vtkIdType FindClosestPoint(const double x[3], double& dist2) const;
+
+    //Up to k closest points as (squared distance, id), sorted by distance
+    void FindClosestNPoints(int k, const double x[3], std::vector<std::pair<double, vtkIdType>>& result) const;
+
+    inline bool IsBuilt() const { return !nodes.empty(); };
+    inline vtkIdType GetNumberOfPoints() const { return coords.size() / 3; };
+    inline const double* GetPoint(vtkIdType id) const { return coords.data() + 3 * id; };
+
+private:
+
+    struct Node {
+        vtkIdType begin, end;   // range in order, leaves only
+        int left, right;        // child nodes, -1 for leaves
+        int axis;
+        double split;
+    };
+
+    int BuildNode(vtkIdType begin, vtkIdType end);
+    void SearchNode(int nodeId, const double x[3], size_t k, std::vector<std::pair<double, vtkIdType>>& heap) const;
+
+    std::vector<double> coords;
+    std::vector<vtkIdType> order;
+    std::vector<Node> nodes;
+};
+
+#endif // CemrgKdTree_h
@@ -0,0 +1,91 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * LGE Sampling Along Normals
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgLgeSampler_h
+#define CemrgLgeSampler_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// ITK
+#include <itkImage.h>
+
+// C++ Standard
+#include <string>
+#include <vector>
+
+/**
+ * Samples the 3x3x3 neighbourhood of every step along a normal straight from
+ * the pixel buffer. Positions are in index space and the image must outlive
+ * the sampler. Once built, the const queries can run from any number of
+ * threads at once.
+ *
+ * NEAREST reproduces the original projection: each step is floored to a voxel
+ * and out-of-image neighbours are dropped. TRILINEAR and BSPLINE (cubic, on
+ * prefiltered coefficients) interpolate at the exact step position, and every
+ * sample reports the voxel closest to it for the cut test and visited list.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgLgeSampler {
+
+public:
+
+    typedef itk::Image<short, 3> ImageType;
+    enum Kernel { NEAREST = 0, TRILINEAR, BSPLINE };
+
+    CemrgLgeSampler();
+
+    //cutImage is optional and must share the grid of image, voxels labelled 3 are cut
+    void Build(const ImageType* image, const ImageType* cutImage = nullptr);
+    void Clear();
+
+    inline void SetKernel(Kernel k) { kernel = k; };
+    inline Kernel GetKernel() const { return kernel; };
+    inline bool IsBuilt() const { return buffer != nullptr; };
+
+    //Values and voxel offsets from minStep to maxStep, in the original order. False if a sample is cut.
+    bool SampleAlongNormal(const double centre[3], const double direction[3], int minStep, int maxStep,
+        std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const;
+
+    static Kernel KernelFromName(std::string name, bool* ok = nullptr);
+    static std::string KernelName(Kernel k);
+
+private:
+
+    bool SampleNearest(const double* p, std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const;
+    template <int TAPS, typename TPixel>
+    bool SampleInterpolated(const TPixel* source, const double* p, std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const;
+
+    Kernel kernel;
+    const short* buffer;
+    const short* cutBuffer;
+    itk::OffsetValueType size[3];
+    itk::OffsetValueType stride[3];
+    std::vector<float> coefficients;
+};
+
+#endif // CemrgLgeSampler_h
@@ -0,0 +1,92 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * LV Scar Segmentation Thresholds
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgLvScarSegmentation_h
+#define CemrgLvScarSegmentation_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// ITK
+#include <itkImage.h>
+
+// C++ Standard
+#include <vector>
+#include "CemrgImageStatistics.h"
+
+/**
+ * Scar thresholds of the LV wall from a single pass over the LGE image, the
+ * wall segmentation and (optionally) a remote myocardium segmentation. The
+ * pass keeps the intensity histograms of both regions and the wall voxels
+ * themselves, so every method is answered and its mask written without going
+ * back to the images, even after the LGE has been overwritten by a mask.
+ *
+ * As in the YZSeg view, the wall is where the segmentation is non-zero and
+ * the LGE intensity is non-zero. Scar voxels are written as 256.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgLvScarSegmentation {
+
+public:
+
+    typedef itk::Image<short, 3> ImageType;
+
+    CemrgLvScarSegmentation();
+
+    //All images share the same grid, remote may be null. False if the grids differ or the wall is empty.
+    bool Build(const ImageType* image, const ImageType* wall, const ImageType* remote = nullptr);
+    void Clear();
+
+    inline void SetNumberOfThreads(int n) { numberOfThreads = n; };
+    inline bool IsBuilt() const { return built; };
+    inline bool HasRemote() const { return remoteStats.GetCount() > 0; };
+    inline const CemrgImageStatistics& GetWallStatistics() const { return wallStats; };
+    inline const CemrgImageStatistics& GetRemoteStatistics() const { return remoteStats; };
+
+    //Half the mean of the brightest 0.2% of the wall (Schmidt et al.)
+    double GetFWHMThreshold() const;
+    //Remote mean + n remote standard deviations
+    double GetSDThreshold(double n) const;
+    //The wall reaches the threshold
+    bool IsInRange(double threshold) const;
+
+    //256 on wall voxels at or above the threshold, 0 everywhere else
+    void WriteMask(ImageType* output, double threshold) const;
+    //Wall voxels labelled with the number of thresholds they reach, 0 everywhere else
+    void WriteLabels(ImageType* output, std::vector<double> thresholds) const;
+
+private:
+
+    int numberOfThreads;
+    bool built;
+    itk::SizeValueType numVoxels;
+    std::vector<itk::SizeValueType> wallOffsets;
+    std::vector<short> wallValues;
+    CemrgImageStatistics wallStats, remoteStats;
+};
+
+#endif // CemrgLvScarSegmentation_h
@@ -51,6 +51,22 @@ public:
     double CalcArea(Points& points);
     mitk::Point3D FindCentre(mitk::PointSet::Pointer pointset);
 
+    //Surface geometry of a triangle mesh, see ComputeMeshGeometry
+    struct MeshGeometry {
+        vtkIdType numberOfTriangles = 0;
+        double area = 0;                        // as vtkMassProperties
+        double volume = 0;                      // as vtkMassProperties
+        double centroid[3] = {0, 0, 0};         // area weighted centre of the triangles
+        double averageRadius = 0;               // area weighted distance of the triangles to the centroid
+        double sigma = 0;                       // area weighted deviation of that distance
+        double sphericity = 0;                  // 100 * (1 - sigma / averageRadius)
+        double ellipsoidAxes[3][3] = {{0}};     // principal axes of the surface, smallest first
+        double ellipsoidRadii[3] = {0, 0, 0};   // semi-axes of the moment ellipsoid, scaled until every vertex is inside
+    };
+
+    //All of the above from the triangles packed once, then passes over the packed data in parallel
+    MeshGeometry ComputeMeshGeometry(vtkPolyData* poly, int numberOfThreads = 0);
+
     //Sphericity Tools
     double GetSphericity(vtkPolyData* poly);
 
@@ -65,13 +81,6 @@ private:
     double CalcDist3D(Point& pointA, Point& pointB);
     double Heron(Point& pointA, Point& pointB, Point& centre);
     std::vector<std::string>& Split(const std::string& str, std::vector<std::string>& elements);
-
-    //Sphericity Tools
-    void GetArea(vtkPolyData* polys, double* TiA, double& LACA);
-    void GetCentreOfMass(double** TiMC, double* TiA, int TiMC_size, double LACA, double* LAC_mc);
-    void GetCentreOfMassOfEachT(vtkPolyData* polys, double** TiMC);
-    void GetAverageRadius(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double& AR);
-    void LASphericity(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double AR, double& sigma, double& Sphericity);
 };
 
 #endif // CemrgMeasure_h
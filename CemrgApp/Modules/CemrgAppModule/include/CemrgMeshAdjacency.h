@@ -0,0 +1,77 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Point Adjacency Tools
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgMeshAdjacency_h
+#define CemrgMeshAdjacency_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// C++ Standard
+#include <vector>
+#include <utility>
+
+/**
+ * Point to point adjacency of a surface mesh in compressed sparse row form.
+ * Two points are neighbours when they share a cell edge; poly-lines chain their
+ * points without closing and vertex cells add none. Build it once per mesh
+ * and query k-rings with a bounded breadth first search.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgMeshAdjacency {
+
+public:
+
+    CemrgMeshAdjacency();
+
+    void Build(vtkPolyData* mesh);
+    void Clear();
+
+    //Points at most maxOrder-1 edges from the seed, paired with maxOrder minus their edge distance
+    void KRing(vtkIdType seed, int maxOrder, std::vector<std::pair<int, int>>& pointNeighbourAndOrder);
+
+    inline bool IsBuilt() const { return !offsets.empty(); };
+    inline vtkIdType GetNumberOfPoints() const { return offsets.empty() ? 0 : offsets.size() - 1; };
+    inline vtkIdType GetDegree(vtkIdType id) const { return offsets[id + 1] - offsets[id]; };
+    inline const vtkIdType* GetNeighbours(vtkIdType id) const { return neighbours.data() + offsets[id]; };
+
+private:
+
+    std::vector<vtkIdType> offsets;
+    std::vector<vtkIdType> neighbours;
+
+    //BFS scratch, a point is visited when its stamp equals the current epoch
+    std::vector<unsigned int> visitedEpoch;
+    std::vector<vtkIdType> frontier;
+    unsigned int epoch;
+};
+
+#endif // CemrgMeshAdjacency_h
@@ -0,0 +1,101 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Projection Geometry Cache
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgProjectionGeometry_h
+#define CemrgProjectionGeometry_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// ITK
+#include <itkImage.h>
+
+// Qt
+#include <QByteArray>
+#include <QString>
+
+// C++ Standard
+#include <vector>
+
+/**
+ * What the scar projection needs from a mesh: the mesh with its cell normals,
+ * and the cell centres and normals in the index space of an LGE grid. It only
+ * depends on the mesh file and the image header, so it can be saved next to
+ * the mesh and reused by later projections with other steps or measures.
+ *
+ * A saved geometry records the hash of the mesh file and the grid it was
+ * computed for. Load refuses it once either has changed.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgProjectionGeometry {
+
+public:
+
+    typedef itk::Image<short, 3> ImageType;
+
+    CemrgProjectionGeometry();
+
+    //Mesh points are expected in the physical space of the image
+    void Compute(vtkSmartPointer<vtkPolyData> mesh, const ImageType* image);
+    void Clear();
+
+    //The image is on the grid the geometry was computed for
+    bool Matches(const ImageType* image) const;
+    inline bool IsEmpty() const { return polyData.GetPointer() == nullptr; };
+
+    inline vtkSmartPointer<vtkPolyData> GetPolyData() const { return polyData; };
+    inline const std::vector<double>& GetCentres() const { return centres; };
+    inline const std::vector<double>& GetNormals() const { return normals; };
+    inline QByteArray GetMeshHash() const { return meshHash; };
+    inline void SetMeshHash(QByteArray hash) { meshHash = hash; };
+
+    bool Save(QString path) const;
+    //False when the file is missing or unreadable, or was saved for another mesh file or image grid
+    bool Load(QString path, QByteArray expectedMeshHash, const ImageType* image);
+
+    //File saved next to a mesh
+    static QString CachePath(QString meshPath);
+    static QByteArray HashFile(QString path);
+
+private:
+
+    bool SameGrid(const ImageType* image) const;
+
+    vtkSmartPointer<vtkPolyData> polyData;
+    std::vector<double> centres, normals;
+    QByteArray meshHash;
+    ImageType::PointType origin;
+    ImageType::SpacingType spacing;
+    ImageType::DirectionType direction;
+    ImageType::SizeType size;
+};
+
+#endif // CemrgProjectionGeometry_h
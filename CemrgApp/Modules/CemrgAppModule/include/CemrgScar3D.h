@@ -37,19 +37,35 @@ PURPOSE.  See the above copyright notices for more information.
 #include <MitkCemrgAppModuleExports.h>
 #include <QString>
 
+// C++ Standard
+#include <atomic>
+#include <vector>
+#include "CemrgLgeSampler.h"
+#include "CemrgProjectionGeometry.h"
+
 class MITKCEMRGAPPMODULE_EXPORT CemrgScar3D {
 
 public:
 
     CemrgScar3D();
     mitk::Surface::Pointer Scar3D(std::string directory, mitk::Image::Pointer lgeImage, std::string segname = "segmentation.vtk");
+    //Projection split in two, so several LGE images on one grid share the mesh and its transform
+    CemrgProjectionGeometry ComputeProjectionGeometry(mitk::Surface::Pointer surface, mitk::Image::Pointer lgeImage);
+    //Geometry of a mesh file read with LoadVTKMesh, taken from the file next to the mesh while it is valid
+    CemrgProjectionGeometry GetProjectionGeometry(std::string meshPath, mitk::Image::Pointer lgeImage);
+    mitk::Surface::Pointer Scar3D(const CemrgProjectionGeometry& geometry, mitk::Image::Pointer lgeImage);
 
     mitk::Surface::Pointer ClipMesh3D(mitk::Surface::Pointer surface, mitk::PointSet::Pointer landmarks);
     bool CalculateMeanStd(mitk::Image::Pointer lgeImage, mitk::Image::Pointer roiImage, double& mean, double& stdv);
     double Thresholding(double thresh);
+    std::vector<double> ThresholdingSweep(const std::vector<double>& thresholds);
+    //Threshold of a value V: V*IIR (threshType 1) or mean + V*stdev (threshType 2)
+    static double ThresholdValue(double value, int threshType, double mean, double stdv);
     void SaveScarDebugImage(QString name, QString dir);
     void SaveNormalisedScalars(double divisor, mitk::Surface::Pointer surface, QString name);
     void PrintThresholdingResults(QString dir, std::vector<double> values_vector, int threshType, double mean, double stdv, bool printGuide = true);
+    //Same, with the percentages of a ThresholdingSweep already run on these values
+    void PrintThresholdingResults(QString dir, std::vector<double> values_vector, int threshType, double mean, double stdv, const std::vector<double>& percentages, bool printGuide = true);
     void PrintSingleThresholdingResult(QString dir, double value, int threshType, double mean, double stdv);
 
     double GetMinScalar() const;
@@ -59,6 +75,21 @@ public:
     void SetMethodType(int value);
     void SetScarSegImage(const mitk::Image::Pointer image);
     void SetVoxelBasedProjection(bool value);
+    void SetNumberOfThreads(int value);
+    void SetSamplingKernel(CemrgLgeSampler::Kernel value);
+    inline CemrgLgeSampler::Kernel GetSamplingKernel() const { return samplingKernel; };
+
+    //Cell scalars of a scar map read from file, to threshold it without projecting again
+    inline void SetScalars(vtkSmartPointer<vtkFloatArray> values){scalars=values;};
+
+    inline void SetDeterministic(bool b){deterministic=b;};
+    inline void SetDeterministicOn(){SetDeterministic(true);};
+    inline void SetDeterministicOff(){SetDeterministic(false);};
+
+    //Saves the projection geometry next to the mesh (<mesh>.geometry) and reuses it, off by default
+    inline void SetGeometryCache(bool b){geometryCache=b;};
+    inline void SetGeometryCacheOn(){SetGeometryCache(true);};
+    inline void SetGeometryCacheOff(){SetGeometryCache(false);};
 
     inline void SetDebug(bool b){debugging=b;};
     inline void SetDebugOn(){SetDebug(true);};
@@ -68,7 +99,9 @@ private:
 
     int methodType;
     int minStep, maxStep;
-    bool voxelBasedProjection, debugging;
+    int numberOfThreads;
+    CemrgLgeSampler::Kernel samplingKernel;
+    bool voxelBasedProjection, debugging, deterministic, geometryCache;
     double minScalar, maxScalar;
     vtkSmartPointer<vtkFloatArray> scalars;
 
@@ -76,12 +109,18 @@ private:
     itkImageType::Pointer scarSegImage;
     itk::Image<short, 3>::Pointer scarDebugLabel;
 
-    double GetIntensityAlongNormal(
+    void ProjectAlongNormals(
         itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-        double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z);
+        const std::vector<double>& centres, const std::vector<double>& normals, std::vector<double>& values);
+    double GetIntensityAlongNormal(
+        const CemrgLgeSampler& sampler, std::atomic<unsigned char>* visited,
+        const double* normal, const double* centre,
+        std::vector<float>& valuesOnAndAroundNormal, std::vector<itk::OffsetValueType>& offsetsOnAndAroundNormal, itk::OffsetValueType& maxOffset);
     double GetStatisticalMeasure(
-        std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-        itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure);
+        const std::vector<float>& valuesOnAndAroundNormal, const std::vector<itk::OffsetValueType>& offsetsOnAndAroundNormal,
+        std::atomic<unsigned char>* visited, int measure, itk::OffsetValueType& maxOffset);
+    CemrgProjectionGeometry GetProjectionGeometry(std::string meshPath, itkImageType::Pointer scarImage);
+    mitk::Surface::Pointer Scar3D(const CemrgProjectionGeometry& geometry, itkImageType::Pointer scarImage);
     void ItkDeepCopy(itkImageType::Pointer input, itkImageType::Pointer output);
 };
 
@@ -87,10 +87,22 @@ PURPOSE.  See the above copyright notices for more information.
 #include <string>
 #include <sstream>
 
+// CemrgApp
+#include "CemrgMeshAdjacency.h"
+#include "CemrgKdTree.h"
+
 class MITKCEMRGAPPMODULE_EXPORT CemrgScarAdvanced {
 
 public:
 
+    // Scalar transfer in TransformSource2Target
+    enum TransferMethod {
+        TRANSFER_LOCATOR = 0,   // serial vtkPointLocator, closest point value (default)
+        TRANSFER_NEAREST,       // KD-tree, closest point value
+        TRANSFER_IDW,           // KD-tree, inverse squared distance over the k closest points
+        TRANSFER_BARYCENTRIC    // KD-tree, interpolated on the closest triangle around the k closest points
+    };
+
     bool _debugScarAdvanced;
 
     int _neighbourhood_size;
@@ -126,6 +138,19 @@ public:
     std::vector<int> _pointidarray;
     std::vector<int> _corridoridarray;
 
+    CemrgMeshAdjacency _adjacency; // point neighbours of _SourcePolyData, built on demand
+    vtkMTimeType _adjacencyMTime;
+
+    int _transferMethod;
+    int _transferNeighbours;
+    int _transferThreads;
+    bool _transferCacheTree;
+    CemrgKdTree _transferTree; // points of _target, reused while _target is unchanged
+    vtkSmartPointer<vtkPolyData> _transferTreeMesh;
+    vtkMTimeType _transferTreeMTime;
+    std::vector<vtkIdType> _transferTriangles; // 3 point ids per triangle of _target
+    std::vector<vtkIdType> _transferPointCellOffsets, _transferPointCells;
+
     // Getters and setters
     inline bool IsDebug() { return _debugScarAdvanced; };
 
@@ -193,6 +218,7 @@ public:
     void NeighbourhoodFillingPercentage(std::vector<int> points);
     int RecursivePointNeighbours(vtkIdType pointId, int order);
     void GetNeighboursAroundPoint2(int pointID, std::vector<std::pair<int, int>>& pointNeighbourAndOrder, int max_order);
+    void UpdatePointAdjacency();
     void getCorridorPoints(std::vector<vtkSmartPointer<vtkDijkstraGraphGeodesicPath>> allShortestPaths);
     bool InsertPointIntoVisitedList2(vtkIdType id, int order);
     void CorridorFromPointList(std::vector<int> points, bool circleToStart = true);
@@ -200,6 +226,15 @@ public:
     // F&I T3
     void SetSourceAndTarget(vtkSmartPointer<vtkPolyData> sc, vtkSmartPointer<vtkPolyData> tg);
     void TransformSource2Target();
+    void UpdateTransferTree();
+    double TransferValue(const double x[3], const std::vector<double>& targetValues, std::vector<std::pair<double, vtkIdType>>& closest);
+
+    inline void SetTransferMethod(int m) { _transferMethod = m; };
+    inline void SetTransferNeighbours(int k) { _transferNeighbours = k; };
+    inline void SetTransferThreads(int n) { _transferThreads = n; };
+    inline void SetTransferCacheTree(bool b) { _transferCacheTree = b; };
+    inline void SetTransferCacheTreeOn() { SetTransferCacheTree(true); };
+    inline void SetTransferCacheTreeOff() { SetTransferCacheTree(false); };
 
     CemrgScarAdvanced();
 };
@@ -38,11 +38,22 @@ class MITKCEMRGAPPMODULE_EXPORT CemrgStrains {
 
 public:
 
+    //AHA curves of all frames: [frame][AHA segment], flat values in flattened AHA cell order
+    struct StrainCurves {
+        std::vector<std::vector<double>> sqz, radial, circumferential, longitudinal;
+        std::vector<std::vector<float>> flatSqz, flatRadial, flatCircumferential, flatLongitudinal;
+    };
+
+    //Curve of the last frame left in the flat surface scalars by CalculateStrainCurves
+    enum CurveType { CURVE_SQUEEZE = 0, CURVE_RADIAL, CURVE_CIRCUMFERENTIAL, CURVE_LONGITUDINAL };
+
     CemrgStrains();
     CemrgStrains(QString dir, int refMeshNo);
     ~CemrgStrains();
 
     double CalculateGlobalSqzPlot(int meshNo);
+    StrainCurves CalculateStrainCurves(int noFrames, mitk::DataNode::Pointer lmNode, bool largeStrain, int flatCurve = CURVE_SQUEEZE);
+    void SetNumberOfThreads(int value);
     std::vector<double> CalculateSqzPlot(int meshNo);
     std::vector<double> CalculateStrainsPlot(int meshNo, mitk::DataNode::Pointer lmNode, int flag);
     double CalculateSDI(std::vector<std::vector<double>> valueVectors, int cycleLengths, int noFrames);
@@ -80,16 +91,29 @@ private:
     void AssignpLabels(int layer, std::vector<double>& pLabel, std::vector<int> index, std::vector<double> pAngles, double sepA, double freeA);
     void AssigncLabels(int layer, std::vector<int>& refCellLabels, std::vector<int> index, std::vector<double> cAngles, double sepA, double freeA);
 
+    //Batched strains
+    void CacheReferenceGeometry(vtkSmartPointer<vtkPolyData> pd);
+    bool ReadFramePoints(int meshNo, std::vector<double>& points);
+    void CalculateFrameCurves(const std::vector<double>& points, const double apex[3], const double rotation[9], bool largeStrain, StrainCurves& curves, int frame);
+
     QString projectDirectory;
     std::vector<double> refArea;
     std::vector<double> refAhaArea;
     std::vector<mitk::Matrix<double, 3, 3>> refJ;
     std::vector<mitk::Matrix<double, 3, 3>> refQ;
+    std::vector<mitk::Matrix<double, 3, 3>> refJInv;
+    std::vector<int> refAhaCount;
     std::vector<int> refCellLabels;
     std::vector<double> refPointLabels;
     mitk::Surface::Pointer refSurface;
     mitk::Surface::Pointer flatSurface;
     vtkSmartPointer<vtkFloatArray> flatSurfScalars;
+    int numberOfThreads;
+
+    //Reference AHA triangles as structure of arrays, ordered as refArea
+    std::vector<vtkIdType> refTriA, refTriB, refTriC;
+    std::vector<int> refTriLabel;
+    std::vector<double> refJInvFlat, refQFlat;
 };
 
 #endif // CemrgStrains_h
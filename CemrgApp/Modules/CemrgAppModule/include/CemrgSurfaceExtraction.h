@@ -0,0 +1,96 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Surface Extraction
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgSurfaceExtraction_h
+#define CemrgSurfaceExtraction_h
+
+// Qmitk
+#include <mitkImage.h>
+#include <MitkCemrgAppModuleExports.h>
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+// Qt
+#include <QString>
+
+class CemrgCommandLine;
+
+/**
+ * In-process version of CemrgCommandLine::ExecuteSurf. The MIRTK close-image,
+ * extract-surface and smooth-surface steps are replaced by ITK grayscale
+ * morphology, a Gaussian blur, VTK flying edges and windowed-sinc smoothing,
+ * all in memory. Parameters have the same meaning as in ExecuteSurf, and the
+ * surface is written in the same frame as the MIRTK output (x and y negated
+ * from the image's physical space), so the two are interchangeable.
+ *
+ * In fidelity mode the MIRTK pipeline is also run through the given command
+ * line and the native surface is only kept when its Hausdorff distance to the
+ * MIRTK surface is within the tolerance.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgSurfaceExtraction {
+
+public:
+
+    CemrgSurfaceExtraction();
+
+    //In memory, morphOperation is one of dilate, erode, open or close. Null on failure
+    vtkSmartPointer<vtkPolyData> Execute(mitk::Image::Pointer segmentation, QString morphOperation = "close", int iter = 1, float th = 0.5, int blur = 0, int smth = 10);
+    //Drop-in for CemrgCommandLine::ExecuteSurf, writes dir/segmentation.vtk
+    QString ExecuteSurf(QString dir, QString segPath, QString morphOperation = "close", int iter = 1, float th = 0.5, int blur = 0, int smth = 10);
+
+    inline void SetNumberOfThreads(int n) { numberOfThreads = n; };
+    inline void SetFidelityMode(bool b) { fidelityMode = b; };
+    inline void SetFidelityModeOn() { SetFidelityMode(true); };
+    inline void SetFidelityModeOff() { SetFidelityMode(false); };
+    inline void SetFidelityTolerance(double mm) { fidelityTolerance = mm; };
+    //Runs the MIRTK pipeline in fidelity mode, not owned
+    inline void SetCommandLine(CemrgCommandLine* cmd) { commandLine = cmd; };
+
+    //Hausdorff distance of the last fidelity check, negative if there was none
+    inline double GetLastHausdorffDistance() const { return lastHausdorffDistance; };
+    inline bool GetLastUsedNative() const { return lastUsedNative; };
+
+    //Symmetric Hausdorff distance between the vertices of two surfaces, negative if either is empty
+    static double HausdorffDistance(vtkPolyData* surface1, vtkPolyData* surface2, int numberOfThreads = 0);
+
+private:
+
+    QString WriteSurface(vtkSmartPointer<vtkPolyData> surface, QString path);
+
+    int numberOfThreads;
+    bool fidelityMode;
+    double fidelityTolerance;
+    CemrgCommandLine* commandLine;
+
+    double lastHausdorffDistance;
+    bool lastUsedNative;
+};
+
+#endif // CemrgSurfaceExtraction_h
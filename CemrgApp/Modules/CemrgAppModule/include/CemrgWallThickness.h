@@ -0,0 +1,107 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Wall Thickness
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#ifndef CemrgWallThickness_h
+#define CemrgWallThickness_h
+
+// Qmitk
+#include <MitkCemrgAppModuleExports.h>
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+// ITK
+#include <itkImage.h>
+
+// C++ Standard
+#include <string>
+#include <vector>
+
+/**
+ * Thickness of a wall label in a segmentation, computed on the voxel grid
+ * with the Laplace streamline method (Jones et al. 2000, Yezzi and Prince
+ * 2003). A potential is solved between the inner side of the wall, at 0,
+ * and the outer side, at 1. The thickness of a voxel is the length of the
+ * streamline of the potential through it, from one side to the other.
+ *
+ * The outer side is the background connected to the edge of the image.
+ * The inner side is every other voxel that is not wall, i.e. the other
+ * labels (blood pool) and enclosed background. The Laplace solve is a
+ * multithreaded red-black SOR over the wall voxels only, and its result does
+ * not depend on the number of threads.
+ */
+class MITKCEMRGAPPMODULE_EXPORT CemrgWallThickness {
+
+public:
+
+    typedef itk::Image<short, 3> ImageType;
+    typedef itk::Image<float, 3> ThicknessImageType;
+
+    CemrgWallThickness();
+
+    bool Compute(const ImageType* segmentation);
+    void Clear();
+
+    inline void SetWallLabel(int label) { wallLabel = label; };
+    inline void SetNumberOfThreads(int n) { numberOfThreads = n; };
+    inline void SetTolerance(double tol) { tolerance = tol; };
+    inline void SetMaximumIterations(int n) { maxIterations = n; };
+    //Voxels searched around a surface point before giving up
+    inline void SetSearchRadius(int voxels) { searchRadius = (voxels < 1) ? 1 : voxels; };
+
+    inline bool IsComputed() const { return computed; };
+    inline size_t GetNumberOfWallVoxels() const { return wallVoxels.size(); };
+    inline int GetNumberOfIterations() const { return iterations; };
+    inline const std::vector<double>& GetVoxelThickness() const { return thickness; };
+    double GetMeanThickness() const;
+
+    //Thickness in mm on the wall, 0 elsewhere
+    inline ThicknessImageType::Pointer GetThicknessImage() const { return thicknessImage; };
+    //Distance weighted mean of the nearest wall voxels, NaN if there is none within the search radius
+    double GetThicknessAt(const double point[3]) const;
+    //Per-vertex thickness as point data, vertices in the segmentation's physical space
+    bool MapToSurface(vtkSmartPointer<vtkPolyData> surface, std::string arrayName = "Thickness") const;
+
+private:
+
+    int wallLabel;
+    int numberOfThreads;
+    double tolerance;
+    int maxIterations;
+    int searchRadius;
+
+    bool computed;
+    int iterations;
+    ThicknessImageType::Pointer thicknessImage;
+    std::vector<int> wallIndex;              // per voxel, index into wallVoxels or < 0
+    std::vector<itk::SizeValueType> wallVoxels;
+    std::vector<double> thickness;
+};
+
+#endif // CemrgWallThickness_h
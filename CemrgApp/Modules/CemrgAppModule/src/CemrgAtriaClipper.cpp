@@ -54,8 +54,10 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkPolyDataWriter.h>
 #include <vtkPolygon.h>
 #include <vtkCellArray.h>
+#include <vtkImageData.h>
 
 // ITK
+#include <itkImage.h>
 #include <itkSubtractImageFilter.h>
 #include <itkConnectedComponentImageFilter.h>
 #include <itkLabelShapeKeepNObjectsImageFilter.h>
@@ -66,16 +68,259 @@ PURPOSE.  See the above copyright notices for more information.
 #include <itkImageDuplicator.h>
 #include <itkResampleImageFilter.h>
 #include <itkNearestNeighborInterpolateImageFunction.h>
+#include <itkContinuousIndex.h>
 
 // Qt
 #include <QDebug>
 #include <QString>
+#include <QElapsedTimer>
+
+// C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 // CemrgApp
 #include "CemrgCommonUtils.h"
 #include "CemrgMeasure.h"
 
 
+namespace {
+
+    typedef itk::Image<short, 3> ClipImageType;
+
+    void CutterRegionsOfInterest(const double bounds[6], const double origin[3], const double spacing[3], const int wholeExtent[6], ClipImageType::Pointer segItkImage, int cutExtent[6], ClipImageType::RegionType& segRegion) {
+
+        //The stencil reaches half a voxel past the cutter, resampling and dilation add up to two more
+        const int margin = 3;
+        double maxSpacing = std::max(spacing[0], std::max(spacing[1], spacing[2]));
+        double box[6];
+        for (int a = 0; a < 3; a++) {
+            box[2 * a] = bounds[2 * a] - margin * maxSpacing;
+            box[2 * a + 1] = bounds[2 * a + 1] + margin * maxSpacing;
+            cutExtent[2 * a] = std::max(wholeExtent[2 * a], (int)std::floor((box[2 * a] - origin[a]) / spacing[a]));
+            cutExtent[2 * a + 1] = std::min(wholeExtent[2 * a + 1], (int)std::ceil((box[2 * a + 1] - origin[a]) / spacing[a]));
+        }//_for
+
+        //Corners of the box in the seg image's own index space
+        ClipImageType::IndexType lower, upper;
+        lower.Fill(itk::NumericTraits<ClipImageType::IndexValueType>::max());
+        upper.Fill(itk::NumericTraits<ClipImageType::IndexValueType>::NonpositiveMin());
+        for (int corner = 0; corner < 8; corner++) {
+            ClipImageType::PointType point;
+            for (int a = 0; a < 3; a++)
+                point[a] = box[2 * a + ((corner >> a) & 1)];
+            itk::ContinuousIndex<double, 3> cidx;
+            segItkImage->TransformPhysicalPointToContinuousIndex(point, cidx);
+            for (int a = 0; a < 3; a++) {
+                lower[a] = std::min(lower[a], (ClipImageType::IndexValueType)std::floor(cidx[a]) - margin);
+                upper[a] = std::max(upper[a], (ClipImageType::IndexValueType)std::ceil(cidx[a]) + margin);
+            }//_for
+        }//_for
+
+        ClipImageType::RegionType region;
+        region.SetIndex(lower);
+        for (int a = 0; a < 3; a++)
+            region.SetSize(a, upper[a] >= lower[a] ? upper[a] - lower[a] + 1 : 0);
+
+        //A cutter that misses the image falls back to the whole image
+        bool missed = !region.Crop(segItkImage->GetLargestPossibleRegion());
+        for (int a = 0; a < 3; a++)
+            missed = missed || cutExtent[2 * a] > cutExtent[2 * a + 1];
+        if (missed) {
+            std::copy(wholeExtent, wholeExtent + 6, cutExtent);
+            region = segItkImage->GetLargestPossibleRegion();
+        }//_if
+        segRegion = region;
+    }
+
+    ClipImageType::Pointer StencilToItkImage(vtkImageData* stencil) {
+
+        int extent[6];
+        double spacing[3], origin[3];
+        stencil->GetExtent(extent);
+        stencil->GetSpacing(spacing);
+        stencil->GetOrigin(origin);
+
+        ClipImageType::Pointer image = ClipImageType::New();
+        ClipImageType::RegionType region;
+        ClipImageType::PointType itkOrigin;
+        ClipImageType::SpacingType itkSpacing;
+        for (int a = 0; a < 3; a++) {
+            region.SetIndex(a, 0);
+            region.SetSize(a, extent[2 * a + 1] - extent[2 * a] + 1);
+            itkOrigin[a] = origin[a] + extent[2 * a] * spacing[a];
+            itkSpacing[a] = spacing[a];
+        }//_for
+        image->SetRegions(region);
+        image->SetOrigin(itkOrigin);
+        image->SetSpacing(itkSpacing);
+        image->Allocate();
+
+        const unsigned char* values = static_cast<const unsigned char*>(stencil->GetScalarPointer());
+        std::copy(values, values + region.GetNumberOfPixels(), image->GetBufferPointer());
+        return image;
+    }
+
+    void KeepLargestComponentAfterCut(ClipImageType::Pointer image, const ClipImageType::RegionType& roi) {
+
+        /*
+         * The foreground was a single 6-connected component before the voxels in roi changed,
+         * so every piece left now reaches into roi. Pieces grow from roi in turns; once all but
+         * one have been traced, the remaining one is larger than any of them and is never traced
+         * in full. Ties go to the piece met first in raster order, as the relabelling does.
+         */
+        typedef itk::ImageRegionIteratorWithIndex<ClipImageType> ItType;
+        typedef long long IndexType;
+        ClipImageType::SizeType size = image->GetBufferedRegion().GetSize();
+        ClipImageType::IndexType start = image->GetBufferedRegion().GetIndex();
+        ClipImageType::PixelType* buffer = image->GetBufferPointer();
+        const IndexType nx = size[0], ny = size[1], nz = size[2];
+        const IndexType strides[3] = {1, nx, nx * ny};
+
+        struct Piece {
+            std::vector<IndexType> queue;
+            size_t head;
+            IndexType count;
+            IndexType firstVoxel;
+            bool done;
+        };
+        std::vector<Piece> pieces;
+        std::vector<int> parent;
+        std::unordered_map<IndexType, int> owner;
+
+        auto root = [&parent](int p) {
+            while (parent[p] != p)
+                p = parent[p] = parent[parent[p]];
+            return p;
+        };
+        auto merge = [&](int a, int b) {
+            a = root(a);
+            b = root(b);
+            if (a == b)
+                return a;
+            if (pieces[a].queue.size() - pieces[a].head < pieces[b].queue.size() - pieces[b].head)
+                std::swap(a, b);
+            Piece& pa = pieces[a];
+            Piece& pb = pieces[b];
+            pa.queue.insert(pa.queue.end(), pb.queue.begin() + pb.head, pb.queue.end());
+            pa.count += pb.count;
+            pa.firstVoxel = std::min(pa.firstVoxel, pb.firstVoxel);
+            pa.done = pa.head == pa.queue.size();
+            std::vector<IndexType>().swap(pb.queue);
+            pb.head = 0;
+            parent[b] = a;
+            return a;
+        };
+        auto isInRoi = [&](IndexType x, IndexType y, IndexType z) {
+            return x >= roi.GetIndex(0) - start[0] && x < roi.GetIndex(0) - start[0] + (IndexType)roi.GetSize(0) &&
+                y >= roi.GetIndex(1) - start[1] && y < roi.GetIndex(1) - start[1] + (IndexType)roi.GetSize(1) &&
+                z >= roi.GetIndex(2) - start[2] && z < roi.GetIndex(2) - start[2] + (IndexType)roi.GetSize(2);
+        };
+        //Visits the face neighbours of voxel v, mode 0: all, mode 1: inside roi only, mode 2: outside roi only.
+        //New voxels go to local when given, otherwise to the front of the piece they joined
+        auto expand = [&](int p, IndexType v, int mode, std::vector<IndexType>* local) {
+            IndexType coord[3] = {v % nx, (v / nx) % ny, v / (nx * ny)};
+            const IndexType dims[3] = {nx, ny, nz};
+            for (int a = 0; a < 3; a++) {
+                for (int step = -1; step <= 1; step += 2) {
+                    IndexType c = coord[a] + step;
+                    if (c < 0 || c >= dims[a])
+                        continue;
+                    IndexType n = v + step * strides[a];
+                    if (buffer[n] == 0)
+                        continue;
+                    if (mode != 0) {
+                        IndexType nc[3] = {coord[0], coord[1], coord[2]};
+                        nc[a] = c;
+                        if (isInRoi(nc[0], nc[1], nc[2]) != (mode == 1))
+                            continue;
+                    }//_if
+                    auto found = owner.find(n);
+                    if (found == owner.end()) {
+                        owner.emplace(n, p);
+                        p = root(p);
+                        (local != nullptr ? *local : pieces[p].queue).push_back(n);
+                        pieces[root(p)].count++;
+                        pieces[root(p)].firstVoxel = std::min(pieces[root(p)].firstVoxel, n);
+                    } else if (root(found->second) != root(p)) {
+                        p = merge(p, found->second);
+                    }//_if
+                }//_for
+            }//_for
+            return root(p);
+        };
+
+        //Pieces as seen inside roi, their voxels leaving roi form the first fronts
+        ItType it(image, roi);
+        for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+            if (it.Get() == 0)
+                continue;
+            ClipImageType::IndexType idx = it.GetIndex();
+            IndexType v = (idx[0] - start[0]) + (idx[1] - start[1]) * strides[1] + (idx[2] - start[2]) * strides[2];
+            if (owner.count(v))
+                continue;
+            int p = pieces.size();
+            pieces.push_back(Piece{std::vector<IndexType>(), 0, 1, v, false});
+            parent.push_back(p);
+            owner.emplace(v, p);
+            std::vector<IndexType> local(1, v);
+            for (size_t k = 0; k < local.size(); k++)
+                expand(p, local[k], 1, &local);
+            for (size_t k = 0; k < local.size(); k++)
+                expand(p, local[k], 2, nullptr);
+        }//_for
+
+        for (size_t p = 0; p < pieces.size(); p++)
+            if (root(p) == (int)p)
+                pieces[p].done = pieces[p].queue.empty();
+
+        //Grow all unfinished pieces in turns
+        const int voxelsPerTurn = 4096;
+        int largest = -1;
+        for (;;) {
+            std::vector<int> active;
+            int bestDone = -1;
+            for (size_t p = 0; p < pieces.size(); p++) {
+                if (root(p) != (int)p)
+                    continue;
+                if (!pieces[p].done)
+                    active.push_back(p);
+                else if (bestDone < 0 || pieces[p].count > pieces[bestDone].count || (pieces[p].count == pieces[bestDone].count && pieces[p].firstVoxel < pieces[bestDone].firstVoxel))
+                    bestDone = p;
+            }//_for
+
+            if (active.empty()) {
+                largest = bestDone;
+                break;
+            }//_if
+            if (active.size() == 1 && (bestDone < 0 || pieces[active[0]].count > pieces[bestDone].count)) {
+                largest = active[0];
+                break;
+            }//_if
+
+            for (int p : active) {
+                p = root(p);
+                for (int k = 0; k < voxelsPerTurn && !pieces[p].done; k++) {
+                    IndexType v = pieces[p].queue[pieces[p].head++];
+                    p = expand(p, v, 0, nullptr);
+                    pieces[p].done = pieces[p].head == pieces[p].queue.size();
+                }//_for
+                if (pieces[p].done) {
+                    std::vector<IndexType>().swap(pieces[p].queue);
+                    pieces[p].head = 0;
+                }//_if
+            }//_for
+        }//_for
+
+        //Everything traced outside the largest piece is removed, the largest piece is set to 1
+        for (const auto& visited : owner)
+            buffer[visited.first] = (largest >= 0 && root(visited.second) == largest) ? 1 : 0;
+    }
+
+} // namespace
+
 CemrgAtriaClipper::CemrgAtriaClipper(QString directory, mitk::Surface::Pointer surface) {
 
     this->directory = directory;
@@ -89,64 +334,96 @@ bool CemrgAtriaClipper::ComputeCtrLines(std::vector<int> pickedSeedLabels, vtkSm
 
     try {
 
-        MITK_INFO << "Producibility test. ";
-        QString prodPath = directory + "/";
-        mitk::IOUtil::Save(surface, (prodPath + "prodLineSurface.vtk").toStdString());
-        ofstream prodFile1;
-        prodFile1.open((prodPath + "prodSeedLabels.txt").toStdString());
-        for (unsigned int i = 0; i < pickedSeedLabels.size(); i++)
-            prodFile1 << pickedSeedLabels.at(i) << "\n";
-        prodFile1.close();
-        ofstream prodFile2;
-        prodFile2.open((prodPath + "prodSeedIds.txt").toStdString());
-        for (unsigned int i = 0; i < pickedSeedIds->GetNumberOfIds(); i++)
-            prodFile2 << pickedSeedIds->GetId(i) << "\n";
-        prodFile2.close();
-        ofstream prodFile3;
-        prodFile3.open((prodPath + "prodLineFlip.txt").toStdString());
-        prodFile3 << autoLines << "\n";
-        prodFile3.close();
+        if (producibilityOutput) {
+            MITK_INFO << "Producibility test. ";
+            QString prodPath = directory + "/";
+            mitk::IOUtil::Save(surface, (prodPath + "prodLineSurface.vtk").toStdString());
+            ofstream prodFile1;
+            prodFile1.open((prodPath + "prodSeedLabels.txt").toStdString());
+            for (unsigned int i = 0; i < pickedSeedLabels.size(); i++)
+                prodFile1 << pickedSeedLabels.at(i) << "\n";
+            prodFile1.close();
+            ofstream prodFile2;
+            prodFile2.open((prodPath + "prodSeedIds.txt").toStdString());
+            for (unsigned int i = 0; i < pickedSeedIds->GetNumberOfIds(); i++)
+                prodFile2 << pickedSeedIds->GetId(i) << "\n";
+            prodFile2.close();
+            ofstream prodFile3;
+            prodFile3.open((prodPath + "prodLineFlip.txt").toStdString());
+            prodFile3 << autoLines << "\n";
+            prodFile3.close();
+        }//_if
 
         if (centreLines.size() == 0) {
 
-            //Prepare source and target seeds
-            vtkSmartPointer<vtkIdList> inletSeedIds = vtkSmartPointer<vtkIdList>::New();
-            vtkSmartPointer<vtkIdList> outletSeedIds = vtkSmartPointer<vtkIdList>::New();
-
             MITK_INFO << "Determining centre lines' orientation.";
             vtkIdType centreOfMassId = CentreOfMass(surface);
-            inletSeedIds->InsertNextId(centreOfMassId);
             MITK_INFO << "Number of pickedSeedLabels: ";
             MITK_INFO << pickedSeedLabels.size();
             MITK_INFO(!autoLines) << "Centre lines orientation set manually.";
             MITK_INFO(autoLines) << "Centre lines orientation set automatically.";
+            bool flipNormals = autoLines ? ctrlnOrientation : !ctrlnOrientation;
+
+            unsigned int noVeins = pickedSeedLabels.size();
+            std::vector<vtkSmartPointer<vtkvmtkPolyDataCenterlines>> filters(noVeins);
+            //A seed outside the shell fails the call before any vein is computed, in both modes
+            if (pickedSeedIds->GetNumberOfIds() < (vtkIdType)noVeins)
+                return false;
+            for (unsigned int i = 0; i < noVeins; i++) {
+                if (pickedSeedIds->GetId(i) < 0 || pickedSeedIds->GetId(i) >= surface->GetVtkPolyData()->GetNumberOfPoints()) {
+                    MITK_WARN << "Seed of vein " << i << " is not a point of the shell.";
+                    return false;
+                }//_if
+            }//_for
+
+            std::vector<vtkSmartPointer<vtkPolyData>> shells(noVeins, surface->GetVtkPolyData());
+            int nThreads = 1;
+            if (concurrentCtrLines && noVeins > 1) {
+
+                //Every vein gets its own copy of the shell, copied before any worker starts
+                for (unsigned int i = 0; i < noVeins; i++) {
+                    shells[i] = vtkSmartPointer<vtkPolyData>::New();
+                    shells[i]->DeepCopy(surface->GetVtkPolyData());
+                }//_for
 
-            for (unsigned int i = 0; i < pickedSeedLabels.size(); i++) {
-
-                //Compute Centre Lines
-                outletSeedIds->InsertNextId(pickedSeedIds->GetId(i));
-                vtkSmartPointer<vtkvmtkPolyDataCenterlines> centreLineFilter = vtkSmartPointer<vtkvmtkPolyDataCenterlines>::New();
-                centreLineFilter->SetInputData(surface->GetVtkPolyData());
-                centreLineFilter->SetSourceSeedIds(inletSeedIds);
-                centreLineFilter->SetTargetSeedIds(outletSeedIds);
-                centreLineFilter->SetRadiusArrayName("MaximumInscribedSphereRadius");
-                centreLineFilter->SetCostFunction("1/R");
-                centreLineFilter->SetFlipNormals(autoLines ? ctrlnOrientation : !ctrlnOrientation);
-                centreLineFilter->SetAppendEndPointsToCenterlines(0);
-                centreLineFilter->SetSimplifyVoronoi(0);
-                centreLineFilter->SetCenterlineResampling(1);
-                centreLineFilter->SetResamplingStepLength(clSpacing);
-                centreLineFilter->Update();
-                outletSeedIds->DeleteId(pickedSeedIds->GetId(i));
-
-                //Centrelines labels
+                nThreads = numberOfThreads;
+                if (nThreads <= 0)
+                    nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+                nThreads = std::min<int>(nThreads, noVeins);
+            }//_if
+            MITK_INFO << "Computing " << noVeins << " centre lines using " << nThreads << " thread(s)";
+
+            //Workers take the next vein until none are left, a failed vein fails the call in both modes
+            std::atomic<unsigned int> nextVein(0);
+            std::atomic<bool> failed(false);
+            auto computeVeins = [&]() {
+                for (unsigned int i = nextVein++; i < noVeins; i = nextVein++) {
+                    try {
+                        filters[i] = ComputeCtrLine(shells[i], centreOfMassId, pickedSeedIds->GetId(i), flipNormals);
+                    } catch (...) {
+                        MITK_WARN << "Centre line of vein " << i << " could not be computed.";
+                        failed = true;
+                    }//_try
+                }//_for
+            };
+
+            std::vector<std::thread> workers;
+            for (int t = 1; t < nThreads; t++)
+                workers.push_back(std::thread(computeVeins));
+            computeVeins();
+            for (unsigned int t = 0; t < workers.size(); t++)
+                workers[t].join();
+            if (failed)
+                return false;
+
+            //Centrelines labels, in the order of the picked seeds
+            for (unsigned int i = 0; i < noVeins; i++) {
                 vtkSmartPointer<vtkIntArray> label = vtkSmartPointer<vtkIntArray>::New();
                 label->SetNumberOfComponents(1);
                 label->SetName("PickedSeedLabels");
                 label->InsertNextValue(pickedSeedLabels.at(i));
-                centreLineFilter->GetOutput()->GetFieldData()->AddArray(label);
-                centreLines.push_back(centreLineFilter);
-
+                filters[i]->GetOutput()->GetFieldData()->AddArray(label);
+                centreLines.push_back(filters[i]);
             }//_for
         }//_if
 
@@ -156,6 +433,30 @@ bool CemrgAtriaClipper::ComputeCtrLines(std::vector<int> pickedSeedLabels, vtkSm
     return true;
 }
 
+vtkSmartPointer<vtkvmtkPolyDataCenterlines> CemrgAtriaClipper::ComputeCtrLine(vtkSmartPointer<vtkPolyData> shell, vtkIdType inletSeedId, vtkIdType outletSeedId, bool flipNormals) {
+
+    //Prepare source and target seeds
+    vtkSmartPointer<vtkIdList> inletSeedIds = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkIdList> outletSeedIds = vtkSmartPointer<vtkIdList>::New();
+    inletSeedIds->InsertNextId(inletSeedId);
+    outletSeedIds->InsertNextId(outletSeedId);
+
+    //Compute Centre Lines
+    vtkSmartPointer<vtkvmtkPolyDataCenterlines> centreLineFilter = vtkSmartPointer<vtkvmtkPolyDataCenterlines>::New();
+    centreLineFilter->SetInputData(shell);
+    centreLineFilter->SetSourceSeedIds(inletSeedIds);
+    centreLineFilter->SetTargetSeedIds(outletSeedIds);
+    centreLineFilter->SetRadiusArrayName("MaximumInscribedSphereRadius");
+    centreLineFilter->SetCostFunction("1/R");
+    centreLineFilter->SetFlipNormals(flipNormals);
+    centreLineFilter->SetAppendEndPointsToCenterlines(0);
+    centreLineFilter->SetSimplifyVoronoi(0);
+    centreLineFilter->SetCenterlineResampling(1);
+    centreLineFilter->SetResamplingStepLength(clSpacing);
+    centreLineFilter->Update();
+    return centreLineFilter;
+}
+
 bool CemrgAtriaClipper::ComputeCtrLinesClippers(std::vector<int> pickedSeedLabels) {
 
     //Compute centreline cut points
@@ -273,24 +574,41 @@ void CemrgAtriaClipper::ClipVeinsMesh(std::vector<int> pickedSeedLabels) {
 void CemrgAtriaClipper::ClipVeinsImage(std::vector<int> pickedSeedLabels, mitk::Image::Pointer segImage, bool morphAnalysis) {
 
     //Type definitions for new cut seg images
-    typedef itk::Image<short, 3> ImageType;
-    typedef itk::ImageRegionIteratorWithIndex<ImageType> ItType;
-    typedef itk::SubtractImageFilter<ImageType, ImageType, ImageType> SubtractFilterType;
-    typedef itk::BinaryBallStructuringElement<ImageType::PixelType, 3> BallType;
-    typedef itk::GrayscaleDilateImageFilter<ImageType, ImageType, BallType> DilationFilterType;
-    typedef itk::ImageDuplicator<ImageType> DuplicatorType;
+    typedef itk::ImageRegionIteratorWithIndex<ClipImageType> ItType;
+    typedef itk::BinaryBallStructuringElement<ClipImageType::PixelType, 3> BallType;
+    typedef itk::GrayscaleDilateImageFilter<ClipImageType, ClipImageType, BallType> DilationFilterType;
+    typedef itk::ResampleImageFilter<ClipImageType, ClipImageType> ResampleFilterType;
 
     //Cast Seg to ITK formats
-    ImageType::Pointer segItkImage = ImageType::New();
+    ClipImageType::Pointer segItkImage = ClipImageType::New();
     CastToItkImage(segImage, segItkImage);
-    ImageType::Pointer orgSegItkImage = ImageType::New();
+    ClipImageType::Pointer orgSegItkImage = ClipImageType::New();
     CastToItkImage(segImage, orgSegItkImage);
-    ImageType::Pointer pvLblsItkImage = ImageType::New();
+    ClipImageType::Pointer pvLblsItkImage = ClipImageType::New();
     CastToItkImage(segImage, pvLblsItkImage);
-    std::vector<ImageType::Pointer> cutRegions;
+    std::vector<ClipImageType::Pointer> cutRegions;
+    std::vector<ClipImageType::RegionType> cutVeinRegions;
+
+    //Labels of the original segmentation, one pass before any cut
+    std::vector<CemrgCommonUtils::LabelGeometry> orgGeometry = CemrgCommonUtils::ComputeLabelGeometry(orgSegItkImage);
+
+    //Cutter grid, the seg image's voxels without its orientation
+    double spacing[3];
+    segImage->GetVtkImageData()->GetSpacing(spacing);
+    int dimensions[3];
+    segImage->GetVtkImageData()->GetDimensions(dimensions);
+    int wholeExtent[6] = {0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1};
+    double origin[3];
+    segImage->GetGeometry()->GetOrigin().ToArray(origin);
+
+    //Foreground is a single component once the first vein has been cut
+    bool segIsConnected = false;
 
     for (unsigned int i = 0; i < pickedSeedLabels.size(); i++) {
 
+        QElapsedTimer veinTimer;
+        veinTimer.start();
+
         //Find the right vein section by removing unwanted ones
         vtkSmartPointer<vtkPolyData> line = centreLines.at(i)->GetOutput();
         int position = line->FindPoint(centreLinePolyPlanes.at(i)->GetCenter());
@@ -355,12 +673,8 @@ void CemrgAtriaClipper::ClipVeinsImage(std::vector<int> pickedSeedLabels, mitk::
             circle = centreLinePolyPlanes.at(i)->GetOutput();
         else
             circle = centreLineVeinPlanes.at(i);
-        for (int j = 0; j < circle->GetNumberOfPoints(); j++) {
-            double* point = circle->GetPoint(j);
-            point[0] = -point[0];
-            point[1] = -point[1];
-            circle->GetPoints()->SetPoint(j, point);
-        }//_for
+        CemrgCommonUtils::FlipXYPoints(circle->GetPoints());
+        circle->Modified();
 
         /*
          * Producibility Test
@@ -382,32 +696,33 @@ void CemrgAtriaClipper::ClipVeinsImage(std::vector<int> pickedSeedLabels, mitk::
          * End Test
          **/
 
-         //Prepare empty image
+        //Sweep polygonal data
+        vtkSmartPointer<vtkLinearExtrusionFilter> extruder = vtkSmartPointer<vtkLinearExtrusionFilter>::New();
+        extruder->SetInputData(circle);
+        extruder->SetScaleFactor(1.0);
+        extruder->SetExtrusionTypeToNormalExtrusion();
+        extruder->SetVector(centreLinePolyPlanes.at(i)->GetNormal());
+        extruder->Update();
+
+        //Regions the cutter can reach: whole images, or the extruded cutter's bounds plus a margin
+        int cutExtent[6];
+        ClipImageType::RegionType segRegion = segItkImage->GetLargestPossibleRegion();
+        std::copy(wholeExtent, wholeExtent + 6, cutExtent);
+        if (roiClipping)
+            CutterRegionsOfInterest(extruder->GetOutput()->GetBounds(), origin, spacing, wholeExtent, segItkImage, cutExtent, segRegion);
+
+        //Prepare empty image
         vtkSmartPointer<vtkImageData> whiteImage = vtkSmartPointer<vtkImageData>::New();
-        double spacing[3];
-        segImage->GetVtkImageData()->GetSpacing(spacing);
         whiteImage->SetSpacing(spacing);
-        int dimensions[3];
-        segImage->GetVtkImageData()->GetDimensions(dimensions);
-        whiteImage->SetDimensions(dimensions);
-        whiteImage->SetExtent(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1);
-        double origin[3];
-        segImage->GetGeometry()->GetOrigin().ToArray(origin);
+        whiteImage->SetExtent(cutExtent);
         whiteImage->SetOrigin(origin);
         whiteImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
         unsigned char otval = 0;
         unsigned char inval = 255;
         vtkIdType count = whiteImage->GetNumberOfPoints();
-        for (vtkIdType j = 0; j < count; j++)
-            whiteImage->GetPointData()->GetScalars()->SetTuple1(j, inval);
+        std::fill_n(static_cast<unsigned char*>(whiteImage->GetScalarPointer()), count, inval);
 
-        //Sweep polygonal data to create an image
-        vtkSmartPointer<vtkLinearExtrusionFilter> extruder = vtkSmartPointer<vtkLinearExtrusionFilter>::New();
-        extruder->SetInputData(circle);
-        extruder->SetScaleFactor(1.0);
-        extruder->SetExtrusionTypeToNormalExtrusion();
-        extruder->SetVector(centreLinePolyPlanes.at(i)->GetNormal());
-        extruder->Update();
+        //Turn the swept cutter into an image
         vtkSmartPointer<vtkPolyDataToImageStencil> pol2stenc = vtkSmartPointer<vtkPolyDataToImageStencil>::New();
         pol2stenc->SetTolerance(0.5);
         pol2stenc->SetInputConnection(extruder->GetOutputPort());
@@ -423,113 +738,149 @@ void CemrgAtriaClipper::ClipVeinsImage(std::vector<int> pickedSeedLabels, mitk::
         imgstenc->Update();
 
         // VTK to ITK conversion
-        mitk::Image::Pointer cutImg = mitk::Image::New();
-        cutImg->Initialize(imgstenc->GetOutput());
-        cutImg->SetVolume(imgstenc->GetOutput()->GetScalarPointer());
-        ImageType::Pointer cutItkImage = ImageType::New();
-        CastToItkImage(cutImg, cutItkImage);
-        itk::ResampleImageFilter<ImageType, ImageType>::Pointer resampleFilter;
-        resampleFilter = itk::ResampleImageFilter<ImageType, ImageType >::New();
+        ClipImageType::Pointer cutItkImage = ClipImageType::New();
+        if (roiClipping) {
+            cutItkImage = StencilToItkImage(imgstenc->GetOutput());
+        } else {
+            mitk::Image::Pointer cutImg = mitk::Image::New();
+            cutImg->Initialize(imgstenc->GetOutput());
+            cutImg->SetVolume(imgstenc->GetOutput()->GetScalarPointer());
+            CastToItkImage(cutImg, cutItkImage);
+        }//_if
+        ResampleFilterType::Pointer resampleFilter = ResampleFilterType::New();
         resampleFilter->SetInput(cutItkImage);
-        resampleFilter->SetReferenceImage(segItkImage);
-        resampleFilter->SetUseReferenceImage(true);
-        resampleFilter->SetInterpolator(itk::NearestNeighborInterpolateImageFunction<ImageType>::New());
+        resampleFilter->SetOutputOrigin(segItkImage->GetOrigin());
+        resampleFilter->SetOutputSpacing(segItkImage->GetSpacing());
+        resampleFilter->SetOutputDirection(segItkImage->GetDirection());
+        resampleFilter->SetOutputStartIndex(segRegion.GetIndex());
+        resampleFilter->SetSize(segRegion.GetSize());
+        resampleFilter->SetInterpolator(itk::NearestNeighborInterpolateImageFunction<ClipImageType>::New());
         resampleFilter->SetDefaultPixelValue(0);
         resampleFilter->UpdateLargestPossibleRegion();
-        cutItkImage = resampleFilter->GetOutput();
 
         //Image Dilation
         BallType binaryBall;
         binaryBall.SetRadius(1); // before, radius=(manuals[i] == 1 ? 1 : 1.5) change to a larger value if problems arise
         binaryBall.CreateStructuringElement();
         DilationFilterType::Pointer dilationFilter = DilationFilterType::New();
-        dilationFilter->SetInput(cutItkImage);
+        dilationFilter->SetInput(resampleFilter->GetOutput());
         dilationFilter->SetKernel(binaryBall);
         dilationFilter->UpdateLargestPossibleRegion();
-        cutImg = mitk::ImportItkImage(dilationFilter->GetOutput())->Clone();
-        CastToItkImage(cutImg, cutItkImage);
-
-        //Subtract images
-        SubtractFilterType::Pointer subFilter = SubtractFilterType::New();
-        subFilter->SetInput1(segItkImage);
-        subFilter->SetInput2(cutItkImage);
-        subFilter->UpdateLargestPossibleRegion();
-
-        //Duplicate subtract images
-        DuplicatorType::Pointer duplicator = DuplicatorType::New();
-        duplicator->SetInputImage(subFilter->GetOutput());
-        duplicator->Update();
-        cutRegions.push_back(duplicator->GetOutput());
-
-        //Record voxel locations before cut
-        ItType itSub(subFilter->GetOutput(), subFilter->GetOutput()->GetRequestedRegion());
-        ItType itLbl(pvLblsItkImage, pvLblsItkImage->GetRequestedRegion());
+        cutItkImage = dilationFilter->GetOutput();
+
+        //Subtract images, the untouched copy is kept for the labelling below
+        ClipImageType::Pointer cutRegion = ClipImageType::New();
+        cutRegion->CopyInformation(segItkImage);
+        cutRegion->SetRegions(segRegion);
+        cutRegion->Allocate();
+        ItType itSeg(segItkImage, segRegion);
+        ItType itDil(cutItkImage, segRegion);
+        ItType itSub(cutRegion, segRegion);
+        for (itSub.GoToBegin(), itSeg.GoToBegin(), itDil.GoToBegin(); !itSub.IsAtEnd(); ++itSub, ++itSeg, ++itDil)
+            itSub.Set(itSeg.Get() - itDil.Get());
+        cutRegions.push_back(cutRegion);
+
+        //Record voxel locations before cut, and the box around the vein voxels
+        ClipImageType::IndexType veinLower, veinUpper;
+        veinLower.Fill(itk::NumericTraits<ClipImageType::IndexValueType>::max());
+        veinUpper.Fill(itk::NumericTraits<ClipImageType::IndexValueType>::NonpositiveMin());
+        ItType itLbl(pvLblsItkImage, segRegion);
         itLbl.GoToBegin();
+        itSeg.GoToBegin();
         for (itSub.GoToBegin(); !itSub.IsAtEnd(); ++itSub) {
-            if ((int)itSub.Get() == -254 || (int)itSub.Get() == -255) {
-                if (pickedSeedLabels.at(i) == APPENDAGEUNCUT && (int)itSub.Get() == -255)
-                    itSub.Set(0);
+            int value = (int)itSub.Get();
+            if (value == -254) {
+                ClipImageType::IndexType index = itSub.GetIndex();
+                for (int a = 0; a < 3; a++) {
+                    veinLower[a] = std::min(veinLower[a], index[a]);
+                    veinUpper[a] = std::max(veinUpper[a], index[a]);
+                }//_for
+            }//_if
+            if (value == -254 || value == -255) {
+                if (pickedSeedLabels.at(i) == APPENDAGEUNCUT && value == -255)
+                    value = 0;
                 if (pickedSeedLabels.at(i) != APPENDAGEUNCUT)
-                    itSub.Set(0);
+                    value = 0;
                 itLbl.Set(0);
             }//_if
+            itSeg.Set(value);
             ++itLbl;
+            ++itSeg;
         }//_for
-
-        //Relabel the components
-        typedef itk::ConnectedComponentImageFilter<ImageType, ImageType> ConnectedComponentImageFilterType;
-        ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
-        connected->SetInput(subFilter->GetOutput());
-        connected->Update();
-        typedef itk::RelabelComponentImageFilter<ImageType, ImageType> RelabelFilterType;
-        RelabelFilterType::Pointer relabeler = RelabelFilterType::New();
-        relabeler->SetInput(connected->GetOutput());
-        relabeler->Update();
+        ClipImageType::RegionType veinRegion;
+        veinRegion.SetIndex(veinLower);
+        for (int a = 0; a < 3; a++)
+            veinRegion.SetSize(a, veinUpper[a] >= veinLower[a] ? veinUpper[a] - veinLower[a] + 1 : 0);
+        cutVeinRegions.push_back(veinRegion);
 
         //Keep the single largest component
-        typedef itk::LabelShapeKeepNObjectsImageFilter<ImageType> LabelShapeKeepNObjImgFilterType;
-        LabelShapeKeepNObjImgFilterType::Pointer lblShpKpNObjImgFltr = LabelShapeKeepNObjImgFilterType::New();
-        lblShpKpNObjImgFltr->SetInput(relabeler->GetOutput());
-        lblShpKpNObjImgFltr->SetBackgroundValue(0);
-        lblShpKpNObjImgFltr->SetNumberOfObjects(1);
-        lblShpKpNObjImgFltr->SetAttribute(LabelShapeKeepNObjImgFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-        lblShpKpNObjImgFltr->Update();
-        segItkImage = lblShpKpNObjImgFltr->GetOutput();
+        if (roiClipping && segIsConnected) {
+            KeepLargestComponentAfterCut(segItkImage, segRegion);
+        } else {
+            typedef itk::ConnectedComponentImageFilter<ClipImageType, ClipImageType> ConnectedComponentImageFilterType;
+            ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
+            connected->SetInput(segItkImage);
+            connected->Update();
+            typedef itk::RelabelComponentImageFilter<ClipImageType, ClipImageType> RelabelFilterType;
+            RelabelFilterType::Pointer relabeler = RelabelFilterType::New();
+            relabeler->SetInput(connected->GetOutput());
+            relabeler->Update();
+            typedef itk::LabelShapeKeepNObjectsImageFilter<ClipImageType> LabelShapeKeepNObjImgFilterType;
+            LabelShapeKeepNObjImgFilterType::Pointer lblShpKpNObjImgFltr = LabelShapeKeepNObjImgFilterType::New();
+            lblShpKpNObjImgFltr->SetInput(relabeler->GetOutput());
+            lblShpKpNObjImgFltr->SetBackgroundValue(0);
+            lblShpKpNObjImgFltr->SetNumberOfObjects(1);
+            lblShpKpNObjImgFltr->SetAttribute(LabelShapeKeepNObjImgFilterType::LabelObjectType::NUMBER_OF_PIXELS);
+            lblShpKpNObjImgFltr->Update();
+            segItkImage = lblShpKpNObjImgFltr->GetOutput();
+            segItkImage->DisconnectPipeline();
+            segIsConnected = true;
+        }//_if
+
+        MITK_INFO << ("[ClipVeinsImage] Vein " + QString::number(pickedSeedLabels.at(i)) + " clipped in " +
+            QString::number(veinTimer.elapsed() / 1000.0) + " s (" + QString::number(segRegion.GetNumberOfPixels()) + " voxels)").toStdString();
 
     }//_for
 
     //Label individual veins
-    typedef itk::ConnectedComponentImageFilter<ImageType, ImageType> ConnectedComponentImageFilterType;
+    typedef itk::ConnectedComponentImageFilter<ClipImageType, ClipImageType> ConnectedComponentImageFilterType;
     ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
     connected->SetInput(pvLblsItkImage);
     connected->Update();
-    typedef itk::RelabelComponentImageFilter<ImageType, ImageType> RelabelFilterType;
+    typedef itk::RelabelComponentImageFilter<ClipImageType, ClipImageType> RelabelFilterType;
     RelabelFilterType::Pointer relabeler = RelabelFilterType::New();
     relabeler->SetInput(connected->GetOutput());
     relabeler->Update();
     pvLblsItkImage = relabeler->GetOutput();
 
-    //Adjust voxel labels after cut MV
-    ItType itCut(segItkImage, segItkImage->GetRequestedRegion());
-    ItType itLbl(pvLblsItkImage, pvLblsItkImage->GetRequestedRegion());
-    ItType itOrg(orgSegItkImage, orgSegItkImage->GetRequestedRegion());
-    itCut.GoToBegin();
-    itLbl.GoToBegin();
-    for (itOrg.GoToBegin(); !itOrg.IsAtEnd(); ++itOrg) {
-        //MV labels
-        if ((int)itOrg.Get() == 2) {
-            itCut.Set(2);
-            itLbl.Set(10);
-        }//_if
-        ++itCut;
-        ++itLbl;
-    }//_for
+    //Adjust voxel labels after cut MV, only inside the box of the MV label
+    const CemrgCommonUtils::LabelGeometry* mvGeometry = CemrgCommonUtils::FindLabelGeometry(orgGeometry, 2);
+    if (mvGeometry != nullptr) {
+        ClipImageType::RegionType mvRegion = mvGeometry->Region();
+        ItType itCut(segItkImage, mvRegion);
+        ItType itLbl(pvLblsItkImage, mvRegion);
+        ItType itOrg(orgSegItkImage, mvRegion);
+        itCut.GoToBegin();
+        itLbl.GoToBegin();
+        for (itOrg.GoToBegin(); !itOrg.IsAtEnd(); ++itOrg) {
+            //MV labels
+            if ((int)itOrg.Get() == 2) {
+                itCut.Set(2);
+                itLbl.Set(10);
+            }//_if
+            ++itCut;
+            ++itLbl;
+        }//_for
+    }//_if
 
-    //Adjust voxel labels after cut PV
+    //Adjust voxel labels after cut PV, only inside the box of each vein's voxels
     for (unsigned int i = 0; i < pickedSeedLabels.size(); i++) {
-        ItType itCutSub(segItkImage, segItkImage->GetRequestedRegion());
-        ItType itLblSub(pvLblsItkImage, pvLblsItkImage->GetRequestedRegion());
-        ItType itOrgSub(cutRegions.at(i), cutRegions.at(i)->GetRequestedRegion());
+        ClipImageType::RegionType region = cutVeinRegions.at(i);
+        if (region.GetNumberOfPixels() == 0)
+            continue;
+        ItType itCutSub(segItkImage, region);
+        ItType itLblSub(pvLblsItkImage, region);
+        ItType itOrgSub(cutRegions.at(i), region);
         itCutSub.GoToBegin();
         itLblSub.GoToBegin();
         for (itOrgSub.GoToBegin(); !itOrgSub.IsAtEnd(); ++itOrgSub) {
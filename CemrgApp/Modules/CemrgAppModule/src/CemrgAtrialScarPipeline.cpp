@@ -0,0 +1,414 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Atrial Scar Pipeline
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkIOUtil.h>
+#include <mitkSurface.h>
+#include <mitkImageCast.h>
+#include <mitkITKImageImport.h>
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkIdList.h>
+#include <vtkPointLocator.h>
+#include <vtkImageResize.h>
+#include <vtkImageChangeInformation.h>
+#include <vtkCellDataToPointData.h>
+#include <vtkClipPolyData.h>
+#include <vtkCleanPolyData.h>
+#include <vtkImplicitPolyDataDistance.h>
+#include <vtkDecimatePro.h>
+#include <vtkDataSetSurfaceFilter.h>
+#include <vtkPolyDataConnectivityFilter.h>
+
+// ITK
+#include <itkResampleImageFilter.h>
+#include <itkNearestNeighborInterpolateImageFunction.h>
+#include <itkBinaryCrossStructuringElement.h>
+#include <itkBinaryBallStructuringElement.h>
+#include <itkGrayscaleErodeImageFilter.h>
+#include <itkConnectedComponentImageFilter.h>
+#include <itkLabelShapeKeepNObjectsImageFilter.h>
+#include <itkBinaryMorphologicalOpeningImageFilter.h>
+#include <itkRelabelComponentImageFilter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// Qt
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+
+// C++ Standard
+#include <memory>
+#include "CemrgAtrialScarPipeline.h"
+
+// CemrgApp
+#include "CemrgAtriaClipper.h"
+#include "CemrgCommandLine.h"
+#include "CemrgCommonUtils.h"
+#include "CemrgScar3D.h"
+#include "CemrgSurfaceExtraction.h"
+
+namespace {
+
+    typedef itk::Image<short, 3> ImageType;
+    typedef itk::Image<float, 3> FloatImageType;
+    typedef itk::ImageRegionIteratorWithIndex<ImageType> ItType;
+
+    ImageType::Pointer LoadItkImage(QString path) {
+        ImageType::Pointer image = ImageType::New();
+        mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(path.toStdString()), image);
+        return image;
+    }
+
+    ImageType::Pointer LargestComponent(ImageType::Pointer image) {
+
+        typedef itk::ConnectedComponentImageFilter<ImageType, ImageType> ConnectedComponentImageFilterType;
+        typedef itk::LabelShapeKeepNObjectsImageFilter<ImageType> LabelShapeKeepNObjImgFilterType;
+
+        ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
+        connected->SetInput(image);
+        connected->Update();
+
+        LabelShapeKeepNObjImgFilterType::Pointer lblShpKpNObjImgFltr = LabelShapeKeepNObjImgFilterType::New();
+        lblShpKpNObjImgFltr->SetInput(connected->GetOutput());
+        lblShpKpNObjImgFltr->SetBackgroundValue(0);
+        lblShpKpNObjImgFltr->SetNumberOfObjects(1);
+        lblShpKpNObjImgFltr->SetAttribute(LabelShapeKeepNObjImgFilterType::LabelObjectType::NUMBER_OF_PIXELS);
+        lblShpKpNObjImgFltr->Update();
+        return lblShpKpNObjImgFltr->GetOutput();
+    }
+
+    //Voxels inside mask take the label of labels, those not equal to keep are cleared
+    void KeepLabelInsideMask(ImageType::Pointer mask, ImageType::Pointer labels, int keep) {
+
+        ItType itMSK(mask, mask->GetRequestedRegion());
+        ItType itLBL(labels, labels->GetRequestedRegion());
+        for (itMSK.GoToBegin(), itLBL.GoToBegin(); !itMSK.IsAtEnd(); ++itMSK, ++itLBL) {
+            int value = ((int)itMSK.Get() != 0) ? (int)itLBL.Get() : 0;
+            itMSK.Set(value == keep ? keep : 0);
+        }//_for
+    }
+
+} // namespace
+
+CemrgAtrialScarPipeline::CemrgAtrialScarPipeline(QString directory, CemrgCommandLine* cmd) {
+
+    this->directory = QDir(directory).absolutePath();
+    this->prodPath = this->directory + "/";
+    this->cmd = cmd;
+    this->surfaceMethod = "native";
+    this->numberOfThreads = 0;
+    this->geometryCache = false;
+    this->minStep = -1;
+    this->maxStep = 3;
+    this->methodType = 2;
+    this->threshType = 1;
+}
+
+bool CemrgAtrialScarPipeline::FindInputs() {
+
+    lgePath = mraPath = cnnPath = "";
+    QDirIterator searchit(directory, QDirIterator::Subdirectories);
+    while (searchit.hasNext()) {
+        QFileInfo searchfinfo(searchit.next());
+        if (searchfinfo.fileName().contains(".nii", Qt::CaseSensitive)) {
+            if (searchfinfo.fileName().contains("dcm-LGE", Qt::CaseSensitive))
+                lgePath = searchfinfo.absoluteFilePath();
+            if (searchfinfo.fileName().contains("dcm-MRA", Qt::CaseSensitive))
+                mraPath = searchfinfo.absoluteFilePath();
+            if (searchfinfo.fileName().contains("LA-cemrgnet.nii", Qt::CaseSensitive))
+                cnnPath = searchfinfo.absoluteFilePath();
+        }//_if
+    }//_while
+
+    //Where DockerCemrgNetPrediction writes it
+    if (cnnPath.isEmpty() && !mraPath.isEmpty())
+        cnnPath = QFileInfo(mraPath).absolutePath() + "/LA-cemrgnet.nii";
+
+    if (lgePath.isEmpty() || mraPath.isEmpty())
+        return Fail("LGE (dcm-LGE*.nii) or MRA (dcm-MRA*.nii) image not found");
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::Segmentation() {
+
+    QString prediction = cmd->DockerCemrgNetPrediction(mraPath);
+    if (prediction.isEmpty())
+        return Fail("CemrgNet prediction failed");
+
+    if (prediction != cnnPath) {
+        QFile::remove(cnnPath);
+        if (!QFile::rename(prediction, cnnPath))
+            return Fail("Could not move prediction to " + cnnPath);
+    }//_if
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::Registration() {
+
+    //Rounded copy, the prediction itself is left untouched
+    CemrgCommonUtils::RoundPixelValues(cnnPath, GetLaPath());
+    mitk::Image::Pointer mraIMG = mitk::IOUtil::Load<mitk::Image>(mraPath.toStdString());
+    mitk::Image::Pointer cnnIMG = mitk::IOUtil::Load<mitk::Image>(GetLaPath().toStdString());
+    double origin[3]; double spacing[3];
+    mraIMG->GetGeometry()->GetOrigin().ToArray(origin);
+    mraIMG->GetGeometry()->GetSpacing().ToArray(spacing);
+
+    vtkSmartPointer<vtkImageResize> resizeFilter = vtkSmartPointer<vtkImageResize>::New();
+    resizeFilter->SetResizeMethodToOutputDimensions();
+    resizeFilter->SetOutputDimensions(mraIMG->GetDimension(0), mraIMG->GetDimension(1), mraIMG->GetDimension(2));
+    resizeFilter->InterpolateOff();
+    resizeFilter->SetInputData(cnnIMG->GetVtkImageData());
+    resizeFilter->Update();
+
+    vtkSmartPointer<vtkImageChangeInformation> changeFilter = vtkSmartPointer<vtkImageChangeInformation>::New();
+    changeFilter->SetInputConnection(resizeFilter->GetOutputPort());
+    changeFilter->SetOutputSpacing(spacing);
+    changeFilter->SetOutputOrigin(origin);
+    changeFilter->Update();
+
+    cnnIMG->Initialize(changeFilter->GetOutput());
+    cnnIMG->SetVolume(changeFilter->GetOutput()->GetScalarPointer());
+    mitk::IOUtil::Save(cnnIMG, GetLaPath().toStdString());
+
+    cmd->ExecuteRegistration(directory, lgePath, mraPath); // rigid.dof is the default name
+    if (!cmd->IsOutputSuccessful(GetDofPath()))
+        return Fail("Registration failed");
+    cmd->ExecuteTransformation(directory, GetLaPath(), GetLaRegPath());
+    if (!cmd->IsOutputSuccessful(GetLaRegPath()))
+        return Fail("Transformation failed");
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::Clean() {
+
+    ImageType::Pointer cleanImage = LargestComponent(LoadItkImage(GetLaRegPath()));
+    ItType itCLN(cleanImage, cleanImage->GetRequestedRegion());
+    for (itCLN.GoToBegin(); !itCLN.IsAtEnd(); ++itCLN)
+        if ((int)itCLN.Get() != 0)
+            itCLN.Set(1);
+    mitk::IOUtil::Save(mitk::ImportItkImage(cleanImage), GetCleanPath().toStdString());
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::SeparateVeins() {
+
+    typedef itk::BinaryCrossStructuringElement<ImageType::PixelType, 3> CrossType;
+    typedef itk::BinaryMorphologicalOpeningImageFilter<ImageType, ImageType, CrossType> MorphFilterType;
+    typedef itk::ConnectedComponentImageFilter<ImageType, ImageType> ConnectedComponentImageFilterType;
+    typedef itk::RelabelComponentImageFilter<ImageType, ImageType> RelabelFilterType;
+
+    ImageType::Pointer veinsSegImage = LoadItkImage(GetCleanPath());
+    KeepLabelInsideMask(veinsSegImage, LoadItkImage(GetLaRegPath()), 2);
+
+    CrossType binaryCross;
+    binaryCross.SetRadius(2.0);
+    binaryCross.CreateStructuringElement();
+    MorphFilterType::Pointer morphFilter = MorphFilterType::New();
+    morphFilter->SetInput(veinsSegImage);
+    morphFilter->SetKernel(binaryCross);
+    morphFilter->SetForegroundValue(2);
+    morphFilter->SetBackgroundValue(0);
+    morphFilter->UpdateLargestPossibleRegion();
+    mitk::IOUtil::Save(mitk::ImportItkImage(morphFilter->GetOutput()), GetVeinsPath().toStdString());
+
+    ConnectedComponentImageFilterType::Pointer connected = ConnectedComponentImageFilterType::New();
+    connected->SetInput(morphFilter->GetOutput());
+    connected->Update();
+    RelabelFilterType::Pointer relabeler = RelabelFilterType::New();
+    relabeler->SetInput(connected->GetOutput());
+    relabeler->Update();
+    mitk::IOUtil::Save(mitk::ImportItkImage(relabeler->GetOutput()), GetSeparatedVeinsPath().toStdString());
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::ClipVeins() {
+
+    QString output1 = Surface(GetCleanPath());
+    if (output1.isEmpty())
+        return false;
+
+    mitk::Surface::Pointer shell = mitk::IOUtil::Load<mitk::Surface>(output1.toStdString());
+    vtkSmartPointer<vtkDecimatePro> deci = vtkSmartPointer<vtkDecimatePro>::New();
+    deci->SetInputData(shell->GetVtkPolyData());
+    deci->SetTargetReduction(0.1);
+    deci->PreserveTopologyOn();
+    deci->Update();
+    shell->SetVtkPolyData(deci->GetOutput());
+
+    //The shell is in the MIRTK frame (x and y negated), so the seeds are flipped instead of the points
+    vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
+    pointLocator->SetDataSet(shell->GetVtkPolyData());
+    pointLocator->BuildLocator();
+
+    //Vein centroids in one pass, labels are consecutive after relabelling
+    std::vector<CemrgCommonUtils::LabelGeometry> veinsGeometry = CemrgCommonUtils::ComputeLabelGeometry(LoadItkImage(GetSeparatedVeinsPath()));
+    vtkSmartPointer<vtkIdList> pickedSeedIds = vtkSmartPointer<vtkIdList>::New();
+    pickedSeedIds->Initialize();
+    std::vector<int> pickedSeedLabels;
+    for (const CemrgCommonUtils::LabelGeometry& vein : veinsGeometry) {
+        const double seed[3] = {-vein.centroid[0], -vein.centroid[1], vein.centroid[2]};
+        pickedSeedIds->InsertNextId(pointLocator->FindClosestPoint(seed));
+        pickedSeedLabels.push_back(21);
+    }//_for
+    if (pickedSeedLabels.empty())
+        return Fail("No veins found in " + GetSeparatedVeinsPath());
+    MITK_INFO << ("[...] Number of veins found: " + QString::number(pickedSeedLabels.size())).toStdString();
+
+    std::unique_ptr<CemrgAtriaClipper> clipper(new CemrgAtriaClipper(directory, shell));
+    if (!clipper->ComputeCtrLines(pickedSeedLabels, pickedSeedIds, true))
+        return Fail("Computation of centrelines failed");
+    if (!clipper->ComputeCtrLinesClippers(pickedSeedLabels))
+        return Fail("Computation of clipper planes failed");
+    clipper->ClipVeinsImage(pickedSeedLabels, mitk::ImportItkImage(LoadItkImage(GetCleanPath())), false);
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::ClipMitralValve() {
+
+    QString output2 = Surface(GetCroppedPath());
+    if (output2.isEmpty())
+        return false;
+    mitk::Surface::Pointer LAShell = mitk::IOUtil::Load<mitk::Surface>(output2.toStdString());
+
+    ImageType::Pointer mvImage = LoadItkImage(GetCleanPath());
+    KeepLabelInsideMask(mvImage, LoadItkImage(GetLaRegPath()), 3);
+    mvImage = LargestComponent(mvImage);
+    mitk::IOUtil::Save(mitk::ImportItkImage(mvImage), GetMviPath().toStdString());
+
+    QString mviShellPath = Surface(GetMviPath());
+    if (mviShellPath.isEmpty())
+        return false;
+    mitk::Surface::Pointer ClipperSurface = mitk::IOUtil::Load<mitk::Surface>(mviShellPath.toStdString());
+    vtkSmartPointer<vtkImplicitPolyDataDistance> implicitFn = vtkSmartPointer<vtkImplicitPolyDataDistance>::New();
+    implicitFn->SetInput(ClipperSurface->GetVtkPolyData());
+    vtkSmartPointer<vtkClipPolyData> mvclipper = vtkSmartPointer<vtkClipPolyData>::New();
+    mvclipper->SetClipFunction(implicitFn);
+    mvclipper->SetInputData(LAShell->GetVtkPolyData());
+    mvclipper->InsideOutOff();
+    mvclipper->Update();
+
+    //Extract, clean and keep the largest region
+    vtkSmartPointer<vtkDataSetSurfaceFilter> surfer = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
+    surfer->SetInputData(mvclipper->GetOutput());
+    surfer->Update();
+    vtkSmartPointer<vtkCleanPolyData> clean = vtkSmartPointer<vtkCleanPolyData>::New();
+    clean->SetInputConnection(surfer->GetOutputPort());
+    clean->Update();
+    vtkSmartPointer<vtkPolyDataConnectivityFilter> lrgRegion = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
+    lrgRegion->SetInputConnection(clean->GetOutputPort());
+    lrgRegion->SetExtractionModeToLargestRegion();
+    lrgRegion->Update();
+    clean = vtkSmartPointer<vtkCleanPolyData>::New();
+    clean->SetInputConnection(lrgRegion->GetOutputPort());
+    clean->Update();
+
+    LAShell->SetVtkPolyData(clean->GetOutput());
+    mitk::IOUtil::Save(LAShell, GetShellPath().toStdString());
+    return true;
+}
+
+bool CemrgAtrialScarPipeline::ScarProjection() {
+
+    std::unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
+    scar->SetMinStep(minStep);
+    scar->SetMaxStep(maxStep);
+    scar->SetMethodType(methodType);
+    scar->SetGeometryCache(geometryCache);
+
+    //Resampled copy on the LGE grid, PVeinsCroppedImage.nii stays the input of ClipMitralValve
+    ImageType::Pointer lgeITK = LoadItkImage(lgePath);
+    itk::ResampleImageFilter<ImageType, ImageType>::Pointer resampleFilter = itk::ResampleImageFilter<ImageType, ImageType>::New();
+    resampleFilter->SetInput(LoadItkImage(GetCroppedPath()));
+    resampleFilter->SetReferenceImage(lgeITK);
+    resampleFilter->SetUseReferenceImage(true);
+    resampleFilter->SetInterpolator(itk::NearestNeighborInterpolateImageFunction<ImageType>::New());
+    resampleFilter->SetDefaultPixelValue(0);
+    resampleFilter->UpdateLargestPossibleRegion();
+    ImageType::Pointer segITK = resampleFilter->GetOutput();
+    mitk::IOUtil::Save(mitk::ImportItkImage(segITK), GetCroppedLgePath().toStdString());
+
+    scar->SetScarSegImage(mitk::ImportItkImage(segITK));
+    mitk::Surface::Pointer scarShell = scar->Scar3D(directory.toStdString(), mitk::ImportItkImage(lgeITK));
+    vtkSmartPointer<vtkCellDataToPointData> cell_to_point = vtkSmartPointer<vtkCellDataToPointData>::New();
+    cell_to_point->SetInputData(scarShell->GetVtkPolyData());
+    cell_to_point->PassCellDataOn();
+    cell_to_point->Update();
+    scarShell->SetVtkPolyData(cell_to_point->GetPolyDataOutput());
+    mitk::IOUtil::Save(scarShell, GetScarPath().toStdString());
+    scar->SaveScarDebugImage(QFileInfo(GetScarDebugPath()).fileName(), directory);
+
+    //Blood pool statistics inside the eroded segmentation
+    typedef itk::BinaryBallStructuringElement<ImageType::PixelType, 3> BallType;
+    typedef itk::GrayscaleErodeImageFilter<ImageType, FloatImageType, BallType> ErosionFilterType;
+    BallType binaryBall;
+    binaryBall.SetRadius(3);
+    binaryBall.CreateStructuringElement();
+    ErosionFilterType::Pointer erosionFilter = ErosionFilterType::New();
+    erosionFilter->SetInput(segITK);
+    erosionFilter->SetKernel(binaryBall);
+    erosionFilter->UpdateLargestPossibleRegion();
+    mitk::Image::Pointer roiImage = mitk::ImportItkImage(erosionFilter->GetOutput())->Clone();
+    FloatImageType::Pointer lgeFloat = FloatImageType::New();
+    mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
+
+    double mean = 0.0, stdv = 0.0;
+    if (!scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv))
+        return Fail("Mean and standard deviation of the blood pool failed");
+    scar->SaveNormalisedScalars(mean, scarShell, GetNormalisedScarPath());
+    scar->PrintThresholdingResults(directory, thresholds, threshType, mean, stdv);
+    return true;
+}
+
+QString CemrgAtrialScarPipeline::Surface(QString segPath) {
+
+    QString output;
+    if (surfaceMethod == "mirtk") {
+        output = cmd->ExecuteSurf(directory, segPath, "close", 1, .5, 0, 10);
+    } else {
+        CemrgSurfaceExtraction surf;
+        surf.SetNumberOfThreads(numberOfThreads);
+        surf.SetFidelityMode(surfaceMethod == "fidelity");
+        surf.SetCommandLine(cmd);
+        output = surf.ExecuteSurf(directory, segPath, "close", 1, .5, 0, 10);
+    }//_if
+
+    if (!cmd->IsOutputSuccessful(output)) {
+        Fail("Surface extraction failed for " + segPath);
+        return "";
+    }//_if
+    return output;
+}
+
+bool CemrgAtrialScarPipeline::Fail(QString message) {
+
+    MITK_WARN << message.toStdString();
+    errorMessage = message;
+    return false;
+}
@@ -36,13 +36,15 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFileInfo>
 #include <QFile>
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QMessageBox>
+#include <QTextStream>
+#include <QThread>
 
 // C++ Standard
-#include <thread>
-#include <chrono>
+#include <algorithm>
 #include <sys/stat.h>
 #include "CemrgCommandLine.h"
 
@@ -51,6 +53,9 @@ CemrgCommandLine::CemrgCommandLine() {
     _useDockerContainers = true;
     _debugvar = false;
     _dockerimage = "biomedia/mirtk:v1.1.0";
+    _mirtkDirectory = QCoreApplication::applicationDirPath() + "/MLib";
+    _threadsPerJob = 0;
+    cache = CemrgCommandLineCache::FromEnvironment();
 
     //Setup panel
     panel = new QTextEdit(0,0);
@@ -68,17 +73,15 @@ CemrgCommandLine::CemrgCommandLine() {
     dial->layout()->addWidget(panel);
     dial->show();
 
-    //Setup the process
-    process = std::unique_ptr<QProcess>(new QProcess(this));
-    process->setProcessChannelMode(QProcess::MergedChannels);
-    connect(process.get(), SIGNAL(readyReadStandardOutput()), this, SLOT(UpdateStdText()));
-    connect(process.get(), SIGNAL(readyReadStandardError()), this, SLOT(UpdateErrText()));
-    connect(process.get(), SIGNAL(finished(int)), this, SLOT(FinishedAlert()));
+    //Setup the job runner (one process at a time unless asked otherwise)
+    runner = std::unique_ptr<CemrgCommandLineJobRunner>(new CemrgCommandLineJobRunner(1));
+    connect(runner.get(), &CemrgCommandLineJobRunner::JobOutput, this, &CemrgCommandLine::UpdateStdText);
+    connect(runner.get(), &CemrgCommandLineJobRunner::JobFinished, this, &CemrgCommandLine::FinishedAlert);
 }
 
 CemrgCommandLine::~CemrgCommandLine() {
 
-    process->close();
+    runner->KillAll();
     dial->deleteLater();
     panel->deleteLater();
     layout->deleteLater();
@@ -139,7 +142,7 @@ QString CemrgCommandLine::ExecuteCreateCGALMesh(QString dir, QString outputName,
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << "-f" << paramsFullPath;
         arguments << "-seg_dir" << segmentationDirectory;;
         arguments << "-seg_name" << segmentationName;
@@ -155,10 +158,13 @@ QString CemrgCommandLine::ExecuteCreateCGALMesh(QString dir, QString outputName,
 #ifndef _WIN32
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     env.insert("TBB_NUM_THREADS","12");
-    process->setProcessEnvironment(env);
+    SetProcessEnvironment(env);
 #endif
 
-    bool successful = ExecuteCommand(executableName, arguments, outAbsolutePath);
+    //The segmentation is named by directory and file name, not by path
+    QStringList inputs;
+    inputs << segmentationDirectory + segmentationName;
+    bool successful = ExecuteCommand(executableName, arguments, outAbsolutePath, true, inputs, QFileInfo(inputs.first()).isFile());
     if (!successful) {
         MITK_WARN << "MeshTools3D did not produce a good outcome.";
         return "ERROR_IN_PROCESSING";
@@ -184,18 +190,18 @@ void CemrgCommandLine::ExecuteTracking(QString dir, QString imgTimes, QString pa
     MITK_INFO << ("[...] OUTPUT DOF: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << "-images" << imgTimesFilePath;
         if (!param.isEmpty()) arguments << "-parin" << param;
         arguments << "-dofout" << outAbsolutePath;
-        arguments << "-threads" << "12";
+        arguments << ThreadArguments();
         arguments << "-verbose" << "3";
 
     } else {
@@ -204,7 +210,10 @@ void CemrgCommandLine::ExecuteTracking(QString dir, QString imgTimes, QString pa
                         mitk::IOUtil::GetProgramPath();
     }//_if
 
-    bool successful = ExecuteCommand(executableName, arguments, outAbsolutePath);
+    //register reads the frames listed in the file, not only the file
+    QStringList frames;
+    bool listed = ImageListFiles(imgTimesFilePath, frames);
+    bool successful = ExecuteCommand(executableName, arguments, outAbsolutePath, true, frames, listed);
     if (!successful)
         MITK_WARN << "Local MIRTK libraries did not produce a good outcome.";
 }
@@ -220,14 +229,54 @@ void CemrgCommandLine::ExecuteApplying(QString dir, QString inputMesh, double in
         fctTime = 2;
     }
 
+    MITK_INFO << "[ATTENTION] Attempting Pointset transformation of all frames.";
+
+    QString executablePath = _mirtkDirectory;
+    QString executableName = executablePath + "/transform-points";
+    if (!QDir(executablePath).exists()) {
+        QMessageBox::warning(NULL, "Please check the LOG", "MIRTK libraries not found");
+        MITK_WARN << "MIRTK libraries not found. Please make sure the MLib folder is inside the directory;\n\t"+
+                        mitk::IOUtil::GetProgramPath();
+        //The caller added a step per frame
+        mitk::ProgressBar::GetInstance()->Progress(noFrames);
+        return;
+    }//_if
+    SetWorkingDirectory(executablePath);
+
+    //Frames are independent, the runner keeps up to GetMaximumConcurrentJobs() of them running
+    struct FrameJob {
+        QString output;
+        QString cacheKey;
+        CemrgCommandLineJob::Pointer job;
+    };
+    std::vector<FrameJob> frames(noFrames);
     QString output = dir + "/transformed-";
-    QString thisOutput;
     for (int i=0; i<noFrames; i++) {
-        thisOutput = output + QString::number(i)+".vtk";
-        ExecuteTransformationOnPoints(dir, inputMesh, thisOutput, dofin, iniTime);
+        QStringList arguments = TransformationOnPointsArguments(dir, inputMesh, output + QString::number(i) + ".vtk", dofin, iniTime, frames[i].output);
         iniTime += fctTime;
+
+        if (cache) {
+            frames[i].cacheKey = cache->Key(executableName, arguments, frames[i].output);
+            if (cache->Restore(frames[i].cacheKey, frames[i].output))
+                continue;
+        }//_if
+
+        MITK_INFO << PrintFullCommand(executableName, arguments);
+        ExecuteTouch(frames[i].output);
+        frames[i].job = SubmitCommand(executableName, arguments);
+    }//_for
+
+    //Collected in frame order, whatever order they finish in
+    for (int i=0; i<noFrames; i++) {
+        if (!frames[i].job.isNull()) {
+            frames[i].job->Wait();
+            bool successful = CheckForStartedProcess(frames[i].job) && IsOutputSuccessful(frames[i].output);
+            if (successful && !frames[i].cacheKey.isEmpty())
+                cache->Store(frames[i].cacheKey, frames[i].output);
+            MITK_WARN(!successful) << ("Local MIRTK libraries did not produce a good outcome for frame " + QString::number(i)).toStdString();
+        }//_if
         mitk::ProgressBar::GetInstance()->Progress();
-    }
+    }//_for
 }
 
 void CemrgCommandLine::ExecuteRegistration(QString dir, QString fixed, QString moving, QString transformFileName, QString modelname) {
@@ -252,18 +301,19 @@ void CemrgCommandLine::ExecuteRegistration(QString dir, QString fixed, QString m
     MITK_INFO << ("[...] OUTPUT DOF: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << movingfullpath;
         arguments << fixedfullpath;
         arguments << "-dofout" << outAbsolutePath;
         arguments << "-model" << modelname;
+        arguments << ThreadArguments();
         arguments << "-verbose" << "3";
 
     } else {
@@ -294,17 +344,18 @@ void CemrgCommandLine::ExecuteTransformation(QString dir, QString imgname, QStri
     MITK_INFO << ("[...] OUTPUT IMAGE: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << imgNamefullpath; //input
         arguments << outAbsolutePath; //output
         arguments << "-dofin" << dofpath;
+        arguments << ThreadArguments();
         arguments << "-verbose" << "3";
 
     } else {
@@ -331,13 +382,13 @@ void CemrgCommandLine::ExecuteSimpleTranslation(QString dir, QString sourceMeshP
     outAbsolutePath = transformFileName.contains(dir, Qt::CaseSensitive) ? transformFileName : prodPath + transformFileName;
 
     MITK_INFO << "Using static MIRTK libraries.";
-    executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    executablePath = _mirtkDirectory;
     executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << outAbsolutePath;
         arguments << "-translations" << "-norotations" << "-noscaling" << "-noshearing";
         if (transformThePoints) {
@@ -395,17 +446,18 @@ QString CemrgCommandLine::ExecuteMorphologicalOperation(QString operation, QStri
     MITK_INFO << ("[...] OUTPUT IMAGE: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << inputImgFullPath;
         arguments << outAbsolutePath;
         arguments << "-iterations" << QString::number(iter);
+        arguments << ThreadArguments();
 
     } else {
         QMessageBox::warning(NULL, "Please check the LOG", "MIRTK libraries not found");
@@ -437,19 +489,20 @@ QString CemrgCommandLine::ExecuteExtractSurface(QString dir, QString segPath, QS
     MITK_INFO << ("[...] OUTPUT MESH: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << inputImgFullPath;
         arguments << outAbsolutePath;
         arguments << "-isovalue" << QString::number(th);
         arguments << "-blur" << QString::number(blur);
         arguments << "-ascii";
+        arguments << ThreadArguments();
         arguments << "-verbose" << "3";
 
     } else {
@@ -482,14 +535,14 @@ QString CemrgCommandLine::ExecuteSmoothSurface(QString dir, QString segPath, QSt
     MITK_INFO << ("[...] OUTPUT MESH: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << inputMeshFullPath;
         arguments << outAbsolutePath;
         arguments << "-iterations" << QString::number(smth);
@@ -514,37 +567,18 @@ void CemrgCommandLine::ExecuteTransformationOnPoints(QString dir, QString meshFu
 
     MITK_INFO << "[ATTENTION] Attempting Pointset transformation.";
 
-    QString commandName = "transform-points";
-    QString dofpath, inputMeshFullPath, outAbsolutePath;
-    QString prodPath = dir + "/";
-
-    inputMeshFullPath = meshFullPath.contains(dir, Qt::CaseSensitive) ? meshFullPath : prodPath + meshFullPath;
-    outAbsolutePath = outputMeshFullPath.contains(dir, Qt::CaseSensitive) ? outputMeshFullPath : prodPath + outputMeshFullPath;
-    dofpath = transformFileFullPath.contains(dir, Qt::CaseSensitive) ? transformFileFullPath : prodPath + transformFileFullPath;
-
-    MITK_INFO << ("[...] INPUT IMAGE: " + inputMeshFullPath).toStdString();
-    MITK_INFO << ("[...] INPUT DOF: " + dofpath).toStdString();
-    MITK_INFO << ("[...] OUTPUT IMAGE: " + outAbsolutePath).toStdString();
-
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString commandName = "transform-points";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
+    QString outAbsolutePath;
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
-        arguments << inputMeshFullPath; // input
-        arguments << outAbsolutePath; // output
-        arguments << "-dofin" << dofpath;
-        arguments << "-ascii";
-        if (applyingIniTime != -100) {
-            // -100 is the default value indicating ExecuteApplying is not being called.
-            arguments << "-St";
-            arguments << QString::number(applyingIniTime);
-        }
-        arguments << "-verbose" << "3";
+        SetWorkingDirectory(executablePath);
+        arguments = TransformationOnPointsArguments(dir, meshFullPath, outputMeshFullPath, transformFileFullPath, applyingIniTime, outAbsolutePath);
 
     } else {
         QMessageBox::warning(NULL, "Please check the LOG", "MIRTK libraries not found");
@@ -569,14 +603,14 @@ void CemrgCommandLine::ExecuteResamplingOnNifti(QString niiFullPath, QString out
     MITK_INFO << ("[...] OUTPUT IMAGE: " + outAbsolutePath).toStdString();
 
     MITK_INFO << "Using static MIRTK libraries.";
-    QString executablePath = QCoreApplication::applicationDirPath() + "/MLib";
+    QString executablePath = _mirtkDirectory;
     QString executableName = executablePath + "/" + commandName;
     QDir apathd(executablePath);
     QStringList arguments;
 
     if (apathd.exists()) {
 
-        process->setWorkingDirectory(executablePath);
+        SetWorkingDirectory(executablePath);
         arguments << imgNamefullpath; //input
         arguments << outAbsolutePath; //output
         arguments << "-isotropic" << QString::number(isovalue);
@@ -624,7 +658,7 @@ QString CemrgCommandLine::DockerCemrgNetPrediction(QString mra) {
 
     if (test) {
 
-        process->setWorkingDirectory(cemrgnethome.absolutePath());
+        SetWorkingDirectory(cemrgnethome.absolutePath());
 
         //Setup docker
         QString docker = executablePath+"docker";
@@ -641,18 +675,25 @@ QString CemrgCommandLine::DockerCemrgNetPrediction(QString mra) {
         }
         MITK_INFO << PrintFullCommand(docker, arguments);
 
-        completion = false;
-        process->start(docker, arguments);
-        CheckForStartedProcess();
-        while (!completion) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-        }
+        //The input is only visible through the mounted volume
+        QString cacheKey;
+        QStringList identity;
+        if (cache && CacheIdentity(docker, arguments, identity)) {
+            cacheKey = cache->Key(docker, arguments, outputfilepath, QStringList() << inputfilepath, identity);
+            if (cache->Restore(cacheKey, outputfilepath))
+                return outputfilepath;
+        }//_if
+
+        CemrgCommandLineJob::Pointer job = SubmitCommand(docker, arguments);
+        job->Wait();
+        CheckForStartedProcess(job);
 
         bool test2 = QFile::rename(tempfilepath, outputfilepath);
         if (test2) {
             MITK_INFO << "[CEMRGNET] Prediction and output creation - successful.";
             res = outputfilepath;
+            if (!cacheKey.isEmpty())
+                cache->Store(cacheKey, outputfilepath);
         } else if (IsOutputSuccessful(tempfilepath)) {
             MITK_INFO << "[CEMRGNET] Prediction - successful.";
             res = tempfilepath;
@@ -733,7 +774,10 @@ QString CemrgCommandLine::DockerSurfaceFromMesh(QString dir, QString meshname, Q
 
     QString outPath = home.absolutePath() + "/" + outname + ".surf.vtx";
 
-    bool successful = ExecuteCommand(executableName, arguments, outPath);
+    //The mesh is only visible through the mounted volume
+    QStringList inputs;
+    bool declared = MeshFiles(home, meshname, inputs);
+    bool successful = ExecuteCommand(executableName, arguments, outPath, true, inputs, declared);
 
     if (successful) {
         MITK_INFO << "Surface extraction successful.";
@@ -767,7 +811,10 @@ QString CemrgCommandLine::DockerExtractGradient(QString dir, QString meshname, Q
 
     QString outPath = home.absolutePath() + "/" + odatName + ".grad.vec";
 
-    bool successful = ExecuteCommand(executableName, arguments, outPath);
+    QStringList inputs;
+    bool declared = MeshFiles(home, meshname, inputs) && QFileInfo(home.absoluteFilePath(idatName)).isFile();
+    inputs << home.absoluteFilePath(idatName);
+    bool successful = ExecuteCommand(executableName, arguments, outPath, true, inputs, declared);
 
     if (successful) {
         MITK_INFO << "Gradient extraction successful.";
@@ -806,7 +853,9 @@ QString CemrgCommandLine::DockerRemeshSurface(QString dir, QString meshname, QSt
 
     QString outPath = home.absolutePath() + "/" + outname + ".vtk";
 
-    bool successful = ExecuteCommand(executableName, arguments, outPath);
+    QStringList inputs;
+    bool declared = MeshFiles(home, meshname, inputs);
+    bool successful = ExecuteCommand(executableName, arguments, outPath, true, inputs, declared);
 
     if (successful) {
         MITK_INFO << "Surface remeshing successful.";
@@ -903,7 +952,12 @@ QString CemrgCommandLine::OpenCarpDockerLaplaceSolves(QString dir, QString meshN
                 arguments << "-gregion[0].ID[" +QString::number(ix)+ "]"<< regionLabels.at(ix);
             }
 
-            bool successful = ExecuteCommand(executableName, arguments, outIgbFile);
+            //Mesh and stimulus files are read through the mounted volume
+            QStringList inputs;
+            bool declared = MeshFiles(home, meshName, inputs);
+            for (const QString& vtx : zeroName + oneName)
+                declared = VertexFiles(home, vtx, inputs) && declared;
+            bool successful = ExecuteCommand(executableName, arguments, outIgbFile, true, inputs, declared);
 
             if (successful) {
                 MITK_INFO << "Laplace solves generation successful. Creating .dat file";
@@ -914,7 +968,7 @@ QString CemrgCommandLine::OpenCarpDockerLaplaceSolves(QString dir, QString meshN
                 arguments << "docker.opencarp.org/opencarp/opencarp:latest";
                 arguments << "igbextract" << home.relativeFilePath(outIgbFile) << "-O";
                 arguments << home.relativeFilePath(outPathFile) << "-o" << "ascii_1pL";
-                successful = ExecuteCommand(executableName, arguments, outPathFile);
+                successful = ExecuteCommand(executableName, arguments, outPathFile, true, QStringList() << outIgbFile);
                 if(successful){
                     outAbsolutePath =  outPathFile;
                 }
@@ -930,10 +984,10 @@ QString CemrgCommandLine::OpenCarpDockerLaplaceSolves(QString dir, QString meshN
  **************************** Helper Functions *****************************
  ***************************************************************************/
 
-bool CemrgCommandLine::CheckForStartedProcess() {
+bool CemrgCommandLine::CheckForStartedProcess(CemrgCommandLineJob::Pointer job) {
 
     //CHECK FOR STARTED PROCESS
-    //This function prevents freezing of the app when something goes wrong with the Qt process.
+    //Reports on jobs that never ran, instead of waiting for an output that will not come.
     bool startedProcess = false;
 
     if (_debugvar) {
@@ -945,19 +999,18 @@ bool CemrgCommandLine::CheckForStartedProcess() {
         MITK_INFO << errorInfoString.toStdString();
     }
 
-    if (process->waitForStarted()) {
+    if (job->HasStarted()) {
 
-        MITK_INFO << "Starting process";
+        MITK_INFO << "Process started";
         startedProcess = true;
 
     } else {
 
-        completion = true;
         MITK_WARN << "[ATTENTION] Process error!";
         MITK_INFO << "STATE:";
-        MITK_INFO << process->state();
+        MITK_INFO << job->GetState();
         MITK_INFO << "ERROR:";
-        MITK_INFO << process->error();
+        MITK_INFO << job->GetErrorString().toStdString();
 
     }//_if
 
@@ -966,25 +1019,13 @@ bool CemrgCommandLine::CheckForStartedProcess() {
 
 void CemrgCommandLine::ExecuteTouch(QString filepath) {
 
-#ifdef _WIN32
-    MITK_INFO << "[ATTENTION] touch command is not necessary on Windows systems. Step ignored.";
-#else
-
-    QString commandName;
-    QStringList arguments;
-    commandName = "touch"; // touch filepath
-    arguments << filepath;
-
-    completion = false;
-    process->start(commandName, arguments);
-    bool processStarted = CheckForStartedProcess();
-    while (!completion) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-    }
-    MITK_INFO(!processStarted) << "[ATTENTION] TOUCH Process never started.";
-
-#endif
+    // Creates the file if missing and updates its modification time, without spawning a separate touch process
+    QFile touchFile(filepath);
+    bool touched = touchFile.open(QIODevice::Append);
+    if (touched)
+        touched = touchFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    touchFile.close();
+    MITK_INFO(!touched) << ("[ATTENTION] Could not touch file: " + filepath).toStdString();
 }
 
 bool CemrgCommandLine::IsOutputSuccessful(QString outputFullPath) {
@@ -1030,50 +1071,255 @@ std::string CemrgCommandLine::PrintFullCommand(QString command, QStringList argu
     return (command + " " + argumentList).toStdString();
 }
 
-bool CemrgCommandLine::ExecuteCommand(QString executableName, QStringList arguments, QString outputPath, bool isOutputFile) {
+bool CemrgCommandLine::ExecuteCommand(QString executableName, QStringList arguments, QString outputPath, bool isOutputFile, QStringList cacheInputs, bool useCache) {
 
     MITK_INFO << PrintFullCommand(executableName, arguments);
 
+    //Key from the inputs as they are now, before the output is touched
+    QString cacheKey;
+    QStringList identity;
+    if (cache && isOutputFile && useCache && CacheIdentity(executableName, arguments, identity)) {
+        cacheKey = cache->Key(executableName, arguments, outputPath, cacheInputs, identity);
+        if (cache->Restore(cacheKey, outputPath))
+            return true;
+    }//_if
+
     if(isOutputFile){ // if false, the output is a folder and does not need touch
         MITK_INFO << ("[ExecuteCommand] Creating empty file at output:" + outputPath).toStdString();
         ExecuteTouch(outputPath);
     }
 
-    completion = false;
-    process->start(executableName, arguments);
-    bool successful = false;
-    bool processStarted = CheckForStartedProcess();
+    CemrgCommandLineJob::Pointer job = SubmitCommand(executableName, arguments);
+    job->Wait();
 
-    while (!completion) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-    }
+    bool successful = false;
+    bool processStarted = CheckForStartedProcess(job);
+    MITK_INFO(processStarted) << ("[ExecuteCommand] Exit code " + QString::number(job->GetExitCode()) + " after " + QString::number(job->GetElapsedSeconds()) + " s").toStdString();
 
     if (processStarted)
         successful = IsOutputSuccessful(outputPath);
 
+    if (successful && !cacheKey.isEmpty())
+        cache->Store(cacheKey, outputPath);
+
     return successful;
 }
 
-/***************************************************************************
- ************************** Protected Slots ********************************
- ***************************************************************************/
+bool CemrgCommandLine::CacheIdentity(QString executableName, QStringList arguments, QStringList& identity) {
+
+    identity.clear();
+    if (QFileInfo(executableName).fileName() != "docker")
+        return true;
+
+    //A tag names whatever was last pulled, the digest names what runs
+    QString digest = DockerImageDigest(executableName, arguments);
+    if (digest.isEmpty()) {
+        MITK_INFO << "[ExecuteCommand] Docker image digest unknown, output not cached.";
+        return false;
+    }//_if
+
+    identity << digest;
+    return true;
+}
+
+QString CemrgCommandLine::DockerImageDigest(QString executableName, QStringList arguments) {
+
+    //The image is the first argument of 'run' that is not an option
+    int runIndex = arguments.indexOf("run");
+    if (runIndex < 0)
+        return "";
+
+    QString image;
+    for (int i=runIndex+1; i<arguments.size() && image.isEmpty(); i++) {
+        if (!arguments.at(i).startsWith("-"))
+            image = arguments.at(i);
+    }//_for
+    if (image.isEmpty())
+        return "";
 
-void CemrgCommandLine::UpdateStdText() {
+    QProcess inspect;
+    inspect.setProcessEnvironment(_processEnvironment);
+    inspect.start(executableName, QStringList() << "image" << "inspect" << "--format={{.Id}}" << image);
+    if (!inspect.waitForFinished(30000) || inspect.exitStatus() != QProcess::NormalExit || inspect.exitCode() != 0)
+        return "";
 
-    QByteArray data = process->readAllStandardOutput();
-    panel->append(QString(data));
+    return QString::fromUtf8(inspect.readAllStandardOutput()).trimmed();
 }
 
-void CemrgCommandLine::UpdateErrText() {
+bool CemrgCommandLine::ImageListFiles(QString listPath, QStringList& files) {
+
+    //MIRTK image list: "<prefix> <suffix>", then "<frame> <time>" per line; frame i is <prefix>i<suffix>
+    files.clear();
+    QFile list(listPath);
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QDir listDir = QFileInfo(listPath).absoluteDir();
+    QTextStream in(&list);
+    QString header = in.readLine().trimmed();
+    int split = header.lastIndexOf(' ');
+    if (split <= 0)
+        return false;
+
+    QString prefix = header.left(split).trimmed();
+    QString suffix = header.mid(split + 1);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QString frame = listDir.absoluteFilePath(prefix + line.section(' ', 0, 0, QString::SectionSkipEmpty) + suffix);
+        if (!QFileInfo(frame).isFile()) {
+            MITK_INFO << ("[ExecuteCommand] Frame not found, output not cached: " + frame).toStdString();
+            files.clear();
+            return false;
+        }//_if
+        files << frame;
+    }//_while
+
+    return !files.isEmpty();
+}
+
+bool CemrgCommandLine::MeshFiles(QDir home, QString meshName, QStringList& files) {
+
+    //meshtool and openCARP take the mesh without extension and read the formats found
+    QString base = home.absoluteFilePath(meshName);
+    bool carp = QFileInfo::exists(base + ".pts") && QFileInfo::exists(base + ".elem");
+    bool vtk = QFileInfo::exists(base + ".vtk") || QFileInfo::exists(base + ".vtu");
+
+    QStringList extensions;
+    extensions << ".pts" << ".elem" << ".lon" << ".vtk" << ".vtu";
+    for (const QString& ext : extensions) {
+        if (QFileInfo::exists(base + ext))
+            files << base + ext;
+    }//_for
+
+    return carp || vtk;
+}
+
+bool CemrgCommandLine::VertexFiles(QDir home, QString vtxName, QStringList& files) {
+
+    QString path = home.absoluteFilePath(vtxName);
+    if (!QFileInfo(path).isFile())
+        path += ".vtx";
+
+    if (!QFileInfo(path).isFile())
+        return false;
+
+    files << path;
+    return true;
+}
+
+CemrgCommandLineJob::Pointer CemrgCommandLine::SubmitCommand(QString executableName, QStringList arguments) {
+
+    //MIRTK jobs count for the threads they were given
+    int threads = 1;
+    int threadsIndex = arguments.indexOf("-threads");
+    if (threadsIndex >= 0 && threadsIndex + 1 < arguments.size())
+        threads = std::max(1, arguments.at(threadsIndex + 1).toInt());
+
+    return runner->Submit(executableName, arguments, _workingDirectory, _processEnvironment, threads);
+}
+
+void CemrgCommandLine::SetResourceProfile(ResourceProfile profile) {
+
+    _threadsPerJob = profile.threadsPerJob;
+    runner->SetMaximumConcurrentJobs(profile.maxConcurrentJobs);
+    runner->SetMaximumConcurrentThreads(profile.maxConcurrentThreads);
+}
+
+CemrgCommandLine::ResourceProfile CemrgCommandLine::GetResourceProfile() {
+
+    ResourceProfile profile;
+    profile.threadsPerJob = _threadsPerJob;
+    profile.maxConcurrentJobs = runner->GetMaximumConcurrentJobs();
+    profile.maxConcurrentThreads = runner->GetMaximumConcurrentThreads();
+    return profile;
+}
+
+int CemrgCommandLine::GetThreadsPerJob() {
+
+    int threads = _threadsPerJob;
+    if (threads < 1) {
+        //Share the hardware between the jobs allowed to run together
+        int hardware = std::max(1, QThread::idealThreadCount());
+        threads = std::max(1, hardware / runner->GetMaximumConcurrentJobs());
+    }//_if
+    if (runner->GetMaximumConcurrentThreads() > 0)
+        threads = std::min(threads, runner->GetMaximumConcurrentThreads());
+    return threads;
+}
+
+QStringList CemrgCommandLine::ThreadArguments() {
 
-    QByteArray data = process->readAllStandardError();
-    panel->append(QString(data));
+    return QStringList() << "-threads" << QString::number(GetThreadsPerJob());
 }
 
-void CemrgCommandLine::FinishedAlert() {
+QStringList CemrgCommandLine::TransformationOnPointsArguments(QString dir, QString meshFullPath, QString outputMeshFullPath, QString transformFileFullPath, double applyingIniTime, QString& outAbsolutePath) {
 
-    completion = true;
-    QString data = process->program() + " Completed!";
+    QString dofpath, inputMeshFullPath;
+    QString prodPath = dir + "/";
+
+    inputMeshFullPath = meshFullPath.contains(dir, Qt::CaseSensitive) ? meshFullPath : prodPath + meshFullPath;
+    outAbsolutePath = outputMeshFullPath.contains(dir, Qt::CaseSensitive) ? outputMeshFullPath : prodPath + outputMeshFullPath;
+    dofpath = transformFileFullPath.contains(dir, Qt::CaseSensitive) ? transformFileFullPath : prodPath + transformFileFullPath;
+
+    MITK_INFO << ("[...] INPUT IMAGE: " + inputMeshFullPath).toStdString();
+    MITK_INFO << ("[...] INPUT DOF: " + dofpath).toStdString();
+    MITK_INFO << ("[...] OUTPUT IMAGE: " + outAbsolutePath).toStdString();
+
+    QStringList arguments;
+    arguments << inputMeshFullPath; // input
+    arguments << outAbsolutePath; // output
+    arguments << "-dofin" << dofpath;
+    arguments << "-ascii";
+    if (applyingIniTime != -100) {
+        // -100 is the default value indicating ExecuteApplying is not being called.
+        arguments << "-St";
+        arguments << QString::number(applyingIniTime);
+    }
+    arguments << ThreadArguments();
+    arguments << "-verbose" << "3";
+
+    return arguments;
+}
+
+/***************************************************************************
+ ************************** Protected Slots ********************************
+ ***************************************************************************/
+
+void CemrgCommandLine::UpdateStdText(QString data) {
+
+    panel->append(data);
+}
+
+void CemrgCommandLine::FinishedAlert(CemrgCommandLineJob* job) {
+
+    QString data = job->GetProgram() + " Completed!";
     panel->append(data);
-}
\ No newline at end of file
+
+    if (job->GetState() != CemrgCommandLineJob::FINISHED)
+        return;
+
+    StageTiming timing;
+    timing.stage = QFileInfo(job->GetProgram()).fileName();
+    timing.threads = job->GetThreads();
+    timing.wallSeconds = job->GetElapsedSeconds();
+    timing.cpuSeconds = job->GetCpuSeconds();
+    timing.exitCode = job->GetExitCode();
+    stageTimings.push_back(timing);
+
+    MITK_INFO << ("[TIMING] " + timing.stage + ": wall " + QString::number(timing.wallSeconds, 'f', 2) + " s, cpu " +
+        QString::number(timing.cpuSeconds, 'f', 2) + " s, " + QString::number(timing.threads) + " threads").toStdString();
+
+    if (!_timingLogFile.isEmpty()) {
+        QFile logFile(_timingLogFile);
+        bool newFile = !logFile.exists();
+        if (logFile.open(QIODevice::Append | QIODevice::Text)) {
+            QTextStream out(&logFile);
+            if (newFile)
+                out << "stage,threads,wall_s,cpu_s,exit_code\n";
+            out << timing.stage << "," << timing.threads << "," << timing.wallSeconds << "," << timing.cpuSeconds << "," << timing.exitCode << "\n";
+        }//_if
+    }//_if
+}
@@ -0,0 +1,313 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Commandline Output Cache
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// Qt
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+// C++ Standard
+#include <algorithm>
+#include <vector>
+#include "CemrgCommandLineCache.h"
+
+namespace {
+    const QString ENTRY_OUTPUT = "output";
+    const QString ENTRY_META = "meta.json";
+
+    void WriteMeta(QString entryPath, QString name, qint64 bytes) {
+        QJsonObject meta;
+        meta["name"] = name;
+        meta["bytes"] = bytes;
+        meta["lastUsed"] = QDateTime::currentMSecsSinceEpoch();
+        QFile file(entryPath + "/" + ENTRY_META);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            file.write(QJsonDocument(meta).toJson(QJsonDocument::Compact));
+    }
+}
+
+CemrgCommandLineCache::CemrgCommandLineCache(QString directory, qint64 maxBytes) :
+    directory(QDir(directory).absolutePath()), maxBytes(maxBytes), hits(0), misses(0) {
+
+    QDir().mkpath(this->directory);
+}
+
+std::shared_ptr<CemrgCommandLineCache> CemrgCommandLineCache::FromEnvironment() {
+
+    // One instance per process so the counters cover the whole session
+    static std::shared_ptr<CemrgCommandLineCache> cache = []() {
+        std::shared_ptr<CemrgCommandLineCache> envCache;
+        QString cacheDir = QString::fromLocal8Bit(qgetenv("CEMRGAPP_COMMANDLINE_CACHE"));
+        if (!cacheDir.isEmpty()) {
+            envCache = std::make_shared<CemrgCommandLineCache>(cacheDir);
+            bool ok = false;
+            qint64 megabytes = qgetenv("CEMRGAPP_COMMANDLINE_CACHE_MB").toLongLong(&ok);
+            if (ok && megabytes > 0)
+                envCache->SetMaximumSize(megabytes * 1024 * 1024);
+            MITK_INFO << ("[CACHE] Command line output cache at " + envCache->GetDirectory() + ", " +
+                QString::number(envCache->GetMaximumSize() / (1024 * 1024)) + " MB").toStdString();
+        }//_if
+        return envCache;
+    }();
+    return cache;
+}
+
+QString CemrgCommandLineCache::Key(QString executableName, QStringList arguments, QString outputPath, QStringList extraInputs, QStringList identity) {
+
+    QFileInfo exeInfo(executableName);
+    if (!exeInfo.exists())
+        exeInfo = QFileInfo(QStandardPaths::findExecutable(executableName));
+    if (!exeInfo.exists() || !exeInfo.isFile())
+        return "";
+
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    auto addToken = [&hasher](QByteArray token) {
+        hasher.addData(token);
+        hasher.addData("\n", 1);
+    };
+
+    //Same executable file: same name, size and modification time
+    addToken(exeInfo.fileName().toUtf8());
+    addToken(QByteArray::number(exeInfo.size()));
+    addToken(QByteArray::number(exeInfo.lastModified().toMSecsSinceEpoch()));
+
+    //What the executable runs, e.g. the digest of a docker image
+    for (const QString& token : identity)
+        addToken("<identity>" + token.toUtf8());
+
+    QFileInfo outInfo(outputPath);
+    QString outputAbsolute = outInfo.absoluteFilePath();
+    addToken(outInfo.suffix().toUtf8());
+
+    //An output passed more than once is also read by the command (in-place operation)
+    int outputCount = 0;
+    for (const QString& arg : arguments)
+        if (QFileInfo(arg).absoluteFilePath() == outputAbsolute)
+            outputCount++;
+
+    for (int i = 0; i < arguments.size(); i++) {
+        const QString& arg = arguments.at(i);
+        //Thread count (MIRTK -threads N) does not change the output
+        if (arg == "-threads") {
+            i++;
+            continue;
+        }//_if
+        QFileInfo argInfo(arg);
+        if (!arg.isEmpty() && argInfo.absoluteFilePath() == outputAbsolute) {
+            addToken("<output>");
+            if (outputCount > 1) {
+                QByteArray hash = HashFile(outputAbsolute);
+                if (hash.isEmpty()) return "";
+                addToken(hash);
+            }
+        } else if (!arg.isEmpty() && argInfo.isFile()) {
+            QByteArray hash = HashFile(argInfo.absoluteFilePath());
+            if (hash.isEmpty()) return "";
+            addToken("<file>" + hash);
+        } else {
+            //Kept as is: a directory (e.g. a docker volume) names the case its relative inputs come from
+            addToken(arg.toUtf8());
+        }//_if
+    }//_for
+
+    for (const QString& input : extraInputs) {
+        QByteArray hash = HashFile(QFileInfo(input).absoluteFilePath());
+        if (hash.isEmpty()) return "";
+        addToken("<input>" + hash);
+    }//_for
+
+    return QString(hasher.result().toHex());
+}
+
+bool CemrgCommandLineCache::Restore(QString key, QString outputPath) {
+
+    if (key.isEmpty())
+        return false;
+
+    QString entryPath = EntryPath(key);
+    QString cachedOutput = entryPath + "/" + ENTRY_OUTPUT;
+    bool restored = false;
+    if (QFileInfo(cachedOutput).isFile()) {
+        //Copy next to the target first so a partial copy never looks like an output
+        QString temporary = outputPath + ".cache" + QString::number(QCoreApplication::applicationPid());
+        QFile::remove(temporary);
+        if (QFile::copy(cachedOutput, temporary)) {
+            QFile::remove(outputPath);
+            restored = QFile::rename(temporary, outputPath);
+        }
+        QFile::remove(temporary);
+        if (restored)
+            WriteMeta(entryPath, QFileInfo(outputPath).fileName(), QFileInfo(outputPath).size());
+    }//_if
+
+    int h, m;
+    {
+        QMutexLocker locker(&mutex);
+        restored ? hits++ : misses++;
+        h = hits;
+        m = misses;
+    }
+    MITK_INFO << ("[CACHE] " + QString(restored ? "Hit: " : "Miss: ") + QFileInfo(outputPath).fileName() +
+        " (hits: " + QString::number(h) + ", misses: " + QString::number(m) + ")").toStdString();
+    return restored;
+}
+
+bool CemrgCommandLineCache::Store(QString key, QString outputPath) {
+
+    QFileInfo outInfo(outputPath);
+    if (key.isEmpty() || !outInfo.isFile() || outInfo.size() == 0)
+        return false;
+    if (outInfo.size() > maxBytes) {
+        MITK_INFO << ("[CACHE] Not caching " + outInfo.fileName() + ", larger than the cache").toStdString();
+        return false;
+    }//_if
+
+    QString entryPath = EntryPath(key);
+    QDir().mkpath(entryPath);
+    QString temporary = entryPath + "/" + ENTRY_OUTPUT + "." + QString::number(QCoreApplication::applicationPid());
+    QFile::remove(temporary);
+    bool stored = QFile::copy(outputPath, temporary);
+    if (stored) {
+        QFile::remove(entryPath + "/" + ENTRY_OUTPUT);
+        stored = QFile::rename(temporary, entryPath + "/" + ENTRY_OUTPUT);
+    }
+    QFile::remove(temporary);
+
+    if (stored) {
+        WriteMeta(entryPath, outInfo.fileName(), outInfo.size());
+        Evict();
+    } else {
+        MITK_WARN << ("[CACHE] Could not store " + outputPath).toStdString();
+    }//_if
+    return stored;
+}
+
+void CemrgCommandLineCache::Evict() {
+
+    struct Entry {
+        QString path;
+        qint64 bytes;
+        qint64 lastUsed;
+    };
+    std::vector<Entry> entries;
+    qint64 total = 0;
+
+    QDir cacheDir(directory);
+    for (const QFileInfo& prefix : cacheDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        for (const QFileInfo& entry : QDir(prefix.absoluteFilePath()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            QFileInfo output(entry.absoluteFilePath() + "/" + ENTRY_OUTPUT);
+            QFile metaFile(entry.absoluteFilePath() + "/" + ENTRY_META);
+            qint64 lastUsed = output.lastModified().toMSecsSinceEpoch();
+            if (metaFile.open(QIODevice::ReadOnly))
+                lastUsed = QJsonDocument::fromJson(metaFile.readAll()).object().value("lastUsed").toVariant().toLongLong();
+            entries.push_back(Entry{entry.absoluteFilePath(), output.size(), lastUsed});
+            total += output.size();
+        }//_for
+    }//_for
+
+    if (total <= maxBytes)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+    int evicted = 0;
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes)
+            break;
+        if (QDir(entry.path).removeRecursively()) {
+            total -= entry.bytes;
+            evicted++;
+        }
+    }//_for
+    MITK_INFO << ("[CACHE] Evicted " + QString::number(evicted) + " entries, " + QString::number(total) + " bytes in use").toStdString();
+}
+
+void CemrgCommandLineCache::Clear() {
+
+    QDir(directory).removeRecursively();
+    QDir().mkpath(directory);
+}
+
+int CemrgCommandLineCache::GetHits() {
+
+    QMutexLocker locker(&mutex);
+    return hits;
+}
+
+int CemrgCommandLineCache::GetMisses() {
+
+    QMutexLocker locker(&mutex);
+    return misses;
+}
+
+qint64 CemrgCommandLineCache::GetSize() {
+
+    qint64 total = 0;
+    QDir cacheDir(directory);
+    for (const QFileInfo& prefix : cacheDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+        for (const QFileInfo& entry : QDir(prefix.absoluteFilePath()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+            total += QFileInfo(entry.absoluteFilePath() + "/" + ENTRY_OUTPUT).size();
+    return total;
+}
+
+QByteArray CemrgCommandLineCache::HashFile(QString path) {
+
+    QFileInfo info(path);
+    {
+        //Unchanged files are not read again
+        QMutexLocker locker(&mutex);
+        auto it = fileHashes.find(path);
+        if (it != fileHashes.end() && it->size == info.size() && it->modified == info.lastModified())
+            return it->hash;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    if (!hasher.addData(&file))
+        return QByteArray();
+    QByteArray hash = hasher.result().toHex();
+
+    QMutexLocker locker(&mutex);
+    fileHashes.insert(path, FileHash{info.size(), info.lastModified(), hash});
+    return hash;
+}
+
+QString CemrgCommandLineCache::EntryPath(QString key) const {
+
+    return directory + "/" + key.left(2) + "/" + key;
+}
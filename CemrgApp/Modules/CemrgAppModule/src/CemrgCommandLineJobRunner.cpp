@@ -0,0 +1,309 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Commandline Job Runner
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// Qt
+#include <QEventLoop>
+#include <QTimer>
+#include <QThread>
+
+// C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "CemrgCommandLineJobRunner.h"
+
+namespace {
+
+    // CPU time of reaped child processes is only available as a process-wide total,
+    // each finished job takes what was added since the previous sample
+    std::mutex cpuSampleMutex;
+    double lastChildrenCpu = 0.0;
+    std::atomic<int> jobsAlive(0);
+
+    double ChildrenCpuSeconds() {
+#ifndef _WIN32
+        struct rusage usage;
+        if (getrusage(RUSAGE_CHILDREN, &usage) == 0)
+            return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+        return -1.0;
+    }
+
+    void ResetChildrenCpuSample() {
+        std::lock_guard<std::mutex> lock(cpuSampleMutex);
+        lastChildrenCpu = ChildrenCpuSeconds();
+    }
+
+    double TakeChildrenCpuSample() {
+        std::lock_guard<std::mutex> lock(cpuSampleMutex);
+        double now = ChildrenCpuSeconds();
+        if (now < 0)
+            return -1.0;
+        double delta = now - lastChildrenCpu;
+        lastChildrenCpu = now;
+        return delta;
+    }
+}
+
+/***************************************************************************
+ ****************************** Job Handle *********************************
+ ***************************************************************************/
+
+CemrgCommandLineJob::CemrgCommandLineJob(QString program, QStringList arguments, QString workingDirectory, QProcessEnvironment environment, int threads) :
+    program(program), arguments(arguments), workingDirectory(workingDirectory), environment(environment), threads(std::max(1, threads)),
+    state(QUEUED), exitCode(-1), exitStatus(QProcess::NormalExit), elapsedMilliseconds(0), cpuSeconds(-1.0), process(nullptr) {
+}
+
+CemrgCommandLineJob::~CemrgCommandLineJob() {
+
+    if (process != nullptr) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(1000);
+        jobsAlive--;
+    }//_if
+}
+
+void CemrgCommandLineJob::Launch() {
+
+    process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    if (!workingDirectory.isEmpty())
+        process->setWorkingDirectory(workingDirectory);
+    if (!environment.isEmpty())
+        process->setProcessEnvironment(environment);
+
+    connect(process, &QProcess::readyReadStandardOutput, this, [this]() {
+        QString data = QString(process->readAllStandardOutput());
+        log += data;
+        emit Output(data);
+    });
+    connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this](int code, QProcess::ExitStatus status) {
+        exitCode = code;
+        exitStatus = status;
+        Complete(FINISHED);
+    });
+    connect(process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        // Crashes are followed by finished(); only a failed start ends the job here
+        if (error == QProcess::FailedToStart) {
+            errorString = process->errorString();
+            Complete(FAILED_TO_START);
+        }
+    });
+
+    // Nothing else alive: children reaped from now on belong to the jobs
+    if (jobsAlive++ == 0)
+        ResetChildrenCpuSample();
+
+    state = RUNNING;
+    timer.start();
+    process->start(program, arguments);
+    if (state == RUNNING)
+        emit Started();
+}
+
+void CemrgCommandLineJob::Complete(JobState finalState) {
+
+    if (IsDone())
+        return;
+
+    if (process != nullptr) {
+        QByteArray remaining = process->readAllStandardOutput();
+        if (!remaining.isEmpty()) {
+            log += QString(remaining);
+            emit Output(QString(remaining));
+        }
+        process->disconnect(this);
+        process->deleteLater();
+        process = nullptr;
+        elapsedMilliseconds = timer.elapsed();
+        if (finalState == FINISHED)
+            cpuSeconds = TakeChildrenCpuSample();
+        jobsAlive--;
+    }//_if
+
+    state = finalState;
+    emit Finished();
+}
+
+bool CemrgCommandLineJob::Wait(int msecs) {
+
+    if (IsDone())
+        return true;
+
+    QEventLoop loop;
+    QTimer timeout;
+    connect(this, &CemrgCommandLineJob::Finished, &loop, &QEventLoop::quit);
+    if (msecs >= 0) {
+        timeout.setSingleShot(true);
+        connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        timeout.start(msecs);
+    }//_if
+
+    // Finished() may have been emitted while the connections above were made
+    if (!IsDone())
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+    return IsDone();
+}
+
+void CemrgCommandLineJob::Kill() {
+
+    if (state == QUEUED) {
+        errorString = "Job cancelled before it started";
+        Complete(FAILED_TO_START);
+    } else if (state == RUNNING && process != nullptr) {
+        process->kill();
+    }//_if
+}
+
+/***************************************************************************
+ ****************************** Job Runner *********************************
+ ***************************************************************************/
+
+CemrgCommandLineJobRunner::CemrgCommandLineJobRunner(int maxConcurrentJobs, QObject* parent) : QObject(parent), maxConcurrentThreads(0) {
+
+    SetMaximumConcurrentJobs(maxConcurrentJobs);
+}
+
+CemrgCommandLineJobRunner::~CemrgCommandLineJobRunner() {
+
+    for (auto& job : queued)
+        job->disconnect(this);
+    for (auto& job : running)
+        job->disconnect(this);
+}
+
+void CemrgCommandLineJobRunner::SetMaximumConcurrentJobs(int n) {
+
+    maxConcurrentJobs = (n < 1) ? std::max(1, QThread::idealThreadCount()) : n;
+    Schedule();
+}
+
+CemrgCommandLineJob::Pointer CemrgCommandLineJobRunner::Submit(QString program, QStringList arguments, QString workingDirectory, QProcessEnvironment environment, int threads) {
+
+    // deleteLater: the last reference may be dropped from inside the job's own signals
+    CemrgCommandLineJob::Pointer job(new CemrgCommandLineJob(program, arguments, workingDirectory, environment, threads), &QObject::deleteLater);
+    CemrgCommandLineJob* rawJob = job.data();
+
+    connect(rawJob, &CemrgCommandLineJob::Output, this, &CemrgCommandLineJobRunner::JobOutput);
+    connect(rawJob, &CemrgCommandLineJob::Finished, this, [this, rawJob]() { OnJobFinished(rawJob); });
+
+    queued.push_back(job);
+    Schedule();
+
+    return job;
+}
+
+bool CemrgCommandLineJobRunner::WaitForAll(int msecs) {
+
+    if (queued.empty() && running.empty())
+        return true;
+
+    QEventLoop loop;
+    QTimer timeout;
+    connect(this, &CemrgCommandLineJobRunner::JobFinished, &loop, [this, &loop]() {
+        if (queued.empty() && running.empty())
+            loop.quit();
+    });
+    if (msecs >= 0) {
+        timeout.setSingleShot(true);
+        connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        timeout.start(msecs);
+    }//_if
+
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+    return queued.empty() && running.empty();
+}
+
+void CemrgCommandLineJobRunner::KillAll() {
+
+    // Empty the queue first so finishing jobs do not launch the next ones
+    std::deque<CemrgCommandLineJob::Pointer> pending;
+    pending.swap(queued);
+    for (auto& job : pending)
+        job->Kill();
+
+    std::vector<CemrgCommandLineJob::Pointer> current = running;
+    for (auto& job : current)
+        job->Kill();
+}
+
+int CemrgCommandLineJobRunner::GetNumberOfRunningThreads() const {
+
+    int threads = 0;
+    for (const auto& job : running)
+        threads += job->GetThreads();
+    return threads;
+}
+
+void CemrgCommandLineJobRunner::Schedule() {
+
+    while (static_cast<int>(running.size()) < maxConcurrentJobs && !queued.empty()) {
+        // Submission order is kept: a job that does not fit waits for threads to free up
+        if (maxConcurrentThreads > 0 && !running.empty() && GetNumberOfRunningThreads() + queued.front()->GetThreads() > maxConcurrentThreads)
+            break;
+
+        // Local reference keeps the job alive if it fails to start synchronously
+        CemrgCommandLineJob::Pointer job = queued.front();
+        queued.pop_front();
+        running.push_back(job);
+        emit JobStarted(job.data());
+        job->Launch();
+    }//_while
+}
+
+void CemrgCommandLineJobRunner::OnJobFinished(CemrgCommandLineJob* job) {
+
+    auto isThisJob = [job](const CemrgCommandLineJob::Pointer& ptr) { return ptr.data() == job; };
+
+    // Hold a reference until listeners have been told
+    CemrgCommandLineJob::Pointer keep;
+    auto runIt = std::find_if(running.begin(), running.end(), isThisJob);
+    if (runIt != running.end()) {
+        keep = *runIt;
+        running.erase(runIt);
+    } else {
+        auto queueIt = std::find_if(queued.begin(), queued.end(), isThisJob);
+        if (queueIt != queued.end()) {
+            keep = *queueIt;
+            queued.erase(queueIt);
+        }
+    }//_if
+
+    MITK_INFO(job->GetState() == CemrgCommandLineJob::FAILED_TO_START) << ("[JobRunner] " + job->GetProgram() + " failed to start: " + job->GetErrorString()).toStdString();
+    emit JobFinished(job);
+    Schedule();
+}
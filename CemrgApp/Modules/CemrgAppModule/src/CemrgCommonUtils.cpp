@@ -33,6 +33,8 @@ PURPOSE.  See the above copyright notices for more information.
 #include <itkImageRegionIteratorWithIndex.h>
 #include <itkResampleImageFilter.h>
 #include <itkOrientImageFilter.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
 
 // VTK
 #include <vtkPolyData.h>
@@ -42,6 +44,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkCellData.h>
 #include <vtkFloatArray.h>
 #include <vtkCell.h>
+#include <vtkCellType.h>
 #include <vtkImageMapper.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkActor2D.h>
@@ -89,10 +92,433 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
-
+#include <QByteArray>
+#include <QSysInfo>
+
+// C++ Standard
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <thread>
 
 #include "CemrgCommonUtils.h"
 
+namespace {
+
+// Size of the ASCII header that starts the openCARP binary mesh files
+const int CARP_BINARY_HEADER_SIZE = 1024;
+const int CARP_BINARY_CHECKSUM = 666;
+
+/**
+ * Whole file view for the ASCII CARP parsers. The file is memory mapped
+ * when possible and read in one go otherwise.
+ */
+class CarpFileView {
+
+public:
+
+    CarpFileView(QString path) : file(path), data(NULL), size(0) {
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+        size = file.size();
+        if (size > 0)
+            data = reinterpret_cast<const char*>(file.map(0, size));
+        if (data == NULL && size > 0) {
+            buffer = file.readAll();
+            data = buffer.constData();
+            size = buffer.size();
+        }//_if
+    }
+
+    inline bool IsOpen() const { return file.isOpen(); };
+    inline const char* Begin() const { return data; };
+    inline const char* End() const { return data + size; };
+
+private:
+
+    QFile file;
+    QByteArray buffer;
+    const char* data;
+    qint64 size;
+};
+
+/**
+ * Tokenizer for CARP text files. Doubles are correctly rounded, so values
+ * are the same as reading them with std::ifstream.
+ */
+class CarpTextScanner {
+
+public:
+
+    CarpTextScanner(const char* begin, const char* end) : pos(begin), end(end) {}
+
+    inline void SkipSpace() {
+        while (pos < end && std::isspace(static_cast<unsigned char>(*pos)))
+            pos++;
+    }
+
+    inline bool AtEnd() {
+        SkipSpace();
+        return pos >= end;
+    }
+
+    // True if there is another token before the end of the current line
+    inline bool HasMoreOnLine() {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+            pos++;
+        return pos < end && *pos != '\n';
+    }
+
+    bool NextTag(std::string& tag) {
+        SkipSpace();
+        const char* start = pos;
+        while (pos < end && !std::isspace(static_cast<unsigned char>(*pos)))
+            pos++;
+        tag.assign(start, pos);
+        return pos > start;
+    }
+
+    bool NextInt(int& value) {
+        SkipSpace();
+        const char* start = pos;
+        bool negative = false;
+        if (pos < end && (*pos == '-' || *pos == '+'))
+            negative = (*pos++ == '-');
+        long long number = 0;
+        const char* digits = pos;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+            number = number * 10 + (*pos++ - '0');
+        if (pos == digits) {
+            pos = start;
+            return false;
+        }//_if
+        value = static_cast<int>(negative ? -number : number);
+        return true;
+    }
+
+    bool NextDouble(double& value) {
+        static const double powersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        SkipSpace();
+        const char* start = pos;
+        bool negative = false;
+        if (pos < end && (*pos == '-' || *pos == '+'))
+            negative = (*pos++ == '-');
+
+        unsigned long long mantissa = 0;
+        int significant = 0, exponent = 0, numDigits = 0;
+        bool truncated = false;
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (*pos - '0');
+                significant += (mantissa != 0);
+            } else {
+                truncated |= (*pos != '0');
+                exponent++;
+            }//_if
+            pos++;
+            numDigits++;
+        }//_while
+        if (pos < end && *pos == '.') {
+            pos++;
+            while (pos < end && *pos >= '0' && *pos <= '9') {
+                if (significant < 19) {
+                    mantissa = mantissa * 10 + (*pos - '0');
+                    significant += (mantissa != 0);
+                    exponent--;
+                } else {
+                    truncated |= (*pos != '0');
+                }//_if
+                pos++;
+                numDigits++;
+            }//_while
+        }//_if
+        if (numDigits == 0) {
+            pos = start;
+            return false;
+        }//_if
+        if (pos < end && (*pos == 'e' || *pos == 'E')) {
+            const char* mark = pos++;
+            bool negativeExp = false;
+            if (pos < end && (*pos == '-' || *pos == '+'))
+                negativeExp = (*pos++ == '-');
+            if (pos < end && *pos >= '0' && *pos <= '9') {
+                int expValue = 0;
+                while (pos < end && *pos >= '0' && *pos <= '9') {
+                    if (expValue < 100000)
+                        expValue = expValue * 10 + (*pos - '0');
+                    pos++;
+                }//_while
+                exponent += negativeExp ? -expValue : expValue;
+            } else {
+                pos = mark;
+            }//_if
+        }//_if
+
+        // Exact when mantissa and power of ten are both exact doubles
+        if (!truncated && mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+            double result = static_cast<double>(mantissa);
+            result = (exponent < 0) ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+            value = negative ? -result : result;
+            return true;
+        }//_if
+
+        // Rare long or large numbers go through the standard parser
+        std::istringstream token(std::string(start, pos));
+        token.imbue(std::locale::classic());
+        token >> value;
+        return !token.fail();
+    }
+
+private:
+
+    const char* pos;
+    const char* end;
+};
+
+bool IsCarpBinary(QString path, QString binarySuffix) {
+
+    return QFileInfo(path).suffix().compare(binarySuffix, Qt::CaseInsensitive) == 0;
+}
+
+bool ReadCarpBinaryHeader(QFile& file, std::vector<long long>& fields) {
+
+    QByteArray header = file.read(CARP_BINARY_HEADER_SIZE);
+    if (header.size() != CARP_BINARY_HEADER_SIZE)
+        return false;
+
+    std::istringstream hdr(std::string(header.constData(), qstrnlen(header.constData(), header.size())));
+    long long field;
+    fields.clear();
+    while (hdr >> field)
+        fields.push_back(field);
+    return !fields.empty();
+}
+
+bool WriteCarpBinaryHeader(QFile& file, std::string text) {
+
+    QByteArray header(CARP_BINARY_HEADER_SIZE, '\0');
+    std::copy(text.begin(), text.end(), header.begin());
+    return file.write(header) == CARP_BINARY_HEADER_SIZE;
+}
+
+// Binary files flag little endian with 0 and big endian with 1
+inline int HostEndianness() {
+
+    return (QSysInfo::ByteOrder == QSysInfo::LittleEndian) ? 0 : 1;
+}
+
+template <typename T>
+void SwapBytes(std::vector<T>& values) {
+
+    for (size_t i = 0; i < values.size(); i++) {
+        char* bytes = reinterpret_cast<char*>(&values[i]);
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+}
+
+template <typename T>
+bool ReadCarpBinaryBody(QFile& file, std::vector<T>& values, bool swap) {
+
+    qint64 numBytes = file.size() - CARP_BINARY_HEADER_SIZE;
+    values.resize(numBytes / sizeof(T));
+    qint64 numRead = file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+    if (numRead != (qint64)(values.size() * sizeof(T)))
+        return false;
+    if (swap)
+        SwapBytes(values);
+    return true;
+}
+
+/**
+ * Buffered output for the VTK writers. Arrays are converted to the file
+ * type one chunk at a time, so large meshes are never copied whole.
+ */
+class VtkStreamWriter {
+
+public:
+
+    VtkStreamWriter(QFile& f, bool ascii, bool bigEndian) : file(f), isAscii(ascii), ok(true) {
+        swap = (HostEndianness() == 1) != bigEndian;
+    }
+
+    ~VtkStreamWriter() { Flush(); }
+
+    inline bool IsOk() const { return ok; };
+
+    void Text(const std::string& text) {
+        buffer.append(text.data(), (int)text.size());
+        if (buffer.size() > BUFFER_SIZE)
+            Flush();
+    }
+
+    // ASCII: values as given, perLine on each line; binary: raw OutT values
+    template <typename OutT, typename InT>
+    void Array(const InT* values, size_t n, int perLine) {
+        if (isAscii) {
+            char number[32];
+            for (size_t i = 0; i < n; i++) {
+                int len = FormatAscii(number, sizeof(number), values[i]);
+                buffer.append(number, len);
+                buffer.append(((i + 1) % perLine == 0 || i + 1 == n) ? '\n' : ' ');
+                if (buffer.size() > BUFFER_SIZE)
+                    Flush();
+            }//_for
+        } else {
+            std::vector<OutT> chunk;
+            for (size_t first = 0; first < n; first += CHUNK_SIZE) {
+                size_t count = (n - first < CHUNK_SIZE) ? n - first : CHUNK_SIZE;
+                chunk.resize(count);
+                for (size_t i = 0; i < count; i++)
+                    chunk[i] = (OutT)values[first + i];
+                if (swap)
+                    SwapBytes(chunk);
+                buffer.append(reinterpret_cast<const char*>(chunk.data()), (int)(count * sizeof(OutT)));
+                if (buffer.size() > BUFFER_SIZE)
+                    Flush();
+            }//_for
+        }//_if
+    }
+
+    template <typename T>
+    void Value(T value) {
+        Array<T, T>(&value, 1, 1);
+    }
+
+    void Flush() {
+        if (!buffer.isEmpty() && file.write(buffer) != buffer.size())
+            ok = false;
+        buffer.clear();
+    }
+
+private:
+
+    static const int BUFFER_SIZE = 1 << 22;
+    static const size_t CHUNK_SIZE = 1 << 16;
+
+    static int FormatAscii(char* out, size_t size, float value) { return snprintf(out, size, "%.12g", (double)value); }
+    static int FormatAscii(char* out, size_t size, double value) { return snprintf(out, size, "%.12g", value); }
+    static int FormatAscii(char* out, size_t size, int value) { return snprintf(out, size, "%d", value); }
+    static int FormatAscii(char* out, size_t size, long value) { return snprintf(out, size, "%ld", value); }
+    static int FormatAscii(char* out, size_t size, long long value) { return snprintf(out, size, "%lld", value); }
+    static int FormatAscii(char* out, size_t size, unsigned char value) { return snprintf(out, size, "%u", (unsigned)value); }
+    static int FormatAscii(char* out, size_t size, unsigned long value) { return snprintf(out, size, "%lu", value); }
+    static int FormatAscii(char* out, size_t size, unsigned long long value) { return snprintf(out, size, "%llu", value); }
+
+    QFile& file;
+    QByteArray buffer;
+    bool isAscii, swap, ok;
+};
+
+/**
+ * Raw moments of one label in buffer index space. Voxels are added a row
+ * run at a time and all sums are integers, so partial moments from any
+ * number of slabs merge to exactly the same totals.
+ */
+struct LabelMoments {
+
+    uint64_t count = 0;
+    uint64_t sum[3] = {0, 0, 0};
+    uint64_t sumProducts[6] = {0, 0, 0, 0, 0, 0}; // xx, yy, zz, xy, xz, yz
+    itk::IndexValueType lower[3] = {
+        std::numeric_limits<itk::IndexValueType>::max(),
+        std::numeric_limits<itk::IndexValueType>::max(),
+        std::numeric_limits<itk::IndexValueType>::max()};
+    itk::IndexValueType upper[3] = {-1, -1, -1};
+
+    //Voxels i0 to i1 of row (j, k)
+    void AddRun(uint64_t i0, uint64_t i1, uint64_t j, uint64_t k) {
+        uint64_t n = i1 - i0 + 1;
+        uint64_t sumI = (i0 + i1) * n / 2;
+        uint64_t sumII = SumOfSquares(i1) - (i0 > 0 ? SumOfSquares(i0 - 1) : 0);
+        count += n;
+        sum[0] += sumI;
+        sum[1] += n * j;
+        sum[2] += n * k;
+        sumProducts[0] += sumII;
+        sumProducts[1] += n * j * j;
+        sumProducts[2] += n * k * k;
+        sumProducts[3] += sumI * j;
+        sumProducts[4] += sumI * k;
+        sumProducts[5] += n * j * k;
+        lower[0] = std::min(lower[0], (itk::IndexValueType)i0);
+        upper[0] = std::max(upper[0], (itk::IndexValueType)i1);
+        lower[1] = std::min(lower[1], (itk::IndexValueType)j);
+        upper[1] = std::max(upper[1], (itk::IndexValueType)j);
+        lower[2] = std::min(lower[2], (itk::IndexValueType)k);
+        upper[2] = std::max(upper[2], (itk::IndexValueType)k);
+    }
+
+    void Merge(const LabelMoments& other) {
+        count += other.count;
+        for (int a = 0; a < 3; a++) {
+            sum[a] += other.sum[a];
+            lower[a] = std::min(lower[a], other.lower[a]);
+            upper[a] = std::max(upper[a], other.upper[a]);
+        }//_for
+        for (int a = 0; a < 6; a++)
+            sumProducts[a] += other.sumProducts[a];
+    }
+
+    static uint64_t SumOfSquares(uint64_t m) { return m * (m + 1) * (2 * m + 1) / 6; }
+};
+
+//Negates x and y of n interleaved points in place, bounds of the result in bounds
+template <typename T>
+void FlipXYInPlace(T* xyz, vtkIdType n, int numberOfThreads, double bounds[6]) {
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = (int)std::min<vtkIdType>(nThreads, std::max<vtkIdType>(1, n / 65536));
+
+    std::vector<double> chunkBounds(6 * nThreads);
+    auto flipChunk = [&](int t) {
+        double* b = chunkBounds.data() + 6 * t;
+        for (int a = 0; a < 3; a++) {
+            b[2 * a] = std::numeric_limits<double>::max();
+            b[2 * a + 1] = std::numeric_limits<double>::lowest();
+        }//_for
+        for (T* p = xyz + 3 * (n * t / nThreads); p < xyz + 3 * (n * (t + 1) / nThreads); p += 3) {
+            p[0] = -p[0];
+            p[1] = -p[1];
+            for (int a = 0; a < 3; a++) {
+                b[2 * a] = std::min(b[2 * a], (double)p[a]);
+                b[2 * a + 1] = std::max(b[2 * a + 1], (double)p[a]);
+            }//_for
+        }//_for
+    };
+
+    if (nThreads == 1) {
+        flipChunk(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(flipChunk, t));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }//_if
+
+    for (int a = 0; a < 6; a++)
+        bounds[a] = chunkBounds[a];
+    for (int t = 1; t < nThreads; t++) {
+        for (int a = 0; a < 3; a++) {
+            bounds[2 * a] = std::min(bounds[2 * a], chunkBounds[6 * t + 2 * a]);
+            bounds[2 * a + 1] = std::max(bounds[2 * a + 1], chunkBounds[6 * t + 2 * a + 1]);
+        }//_for
+    }//_for
+}
+
+} // namespace
+
 
 mitk::DataNode::Pointer CemrgCommonUtils::imageNode;
 mitk::DataNode::Pointer CemrgCommonUtils::cuttingNode;
@@ -314,6 +740,130 @@ void CemrgCommonUtils::SetSegmentationEdgesToZero(mitk::Image::Pointer image, QS
     }
 }
 
+CemrgCommonUtils::LabelImageType::RegionType CemrgCommonUtils::LabelGeometry::Region() const {
+
+    LabelImageType::RegionType region;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, lower[a]);
+        region.SetSize(a, upper[a] >= lower[a] ? upper[a] - lower[a] + 1 : 0);
+    }//_for
+    return region;
+}
+
+std::vector<CemrgCommonUtils::LabelGeometry> CemrgCommonUtils::ComputeLabelGeometry(LabelImageType::Pointer image, bool ignoreBackground, int numberOfThreads) {
+
+    std::vector<LabelGeometry> geometry;
+    if (image.IsNull() || image->GetBufferedRegion().GetNumberOfPixels() == 0)
+        return geometry;
+
+    const LabelImageType::RegionType region = image->GetBufferedRegion();
+    const uint64_t nx = region.GetSize(0), ny = region.GetSize(1), nz = region.GetSize(2);
+    const short* buffer = image->GetBufferPointer();
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = (int)std::min<uint64_t>(nThreads, nz);
+
+    //Slabs of whole slices, each row scanned as runs of equal labels
+    std::vector<std::map<int, LabelMoments>> slabs(nThreads);
+    auto scanSlab = [&](int t) {
+        std::map<int, LabelMoments>& moments = slabs[t];
+        const uint64_t firstSlice = nz * t / nThreads, lastSlice = nz * (t + 1) / nThreads;
+        for (uint64_t k = firstSlice; k < lastSlice; k++) {
+            for (uint64_t j = 0; j < ny; j++) {
+                const short* row = buffer + (k * ny + j) * nx;
+                uint64_t i0 = 0;
+                while (i0 < nx) {
+                    const short label = row[i0];
+                    uint64_t i1 = i0;
+                    while (i1 + 1 < nx && row[i1 + 1] == label)
+                        i1++;
+                    if (!(ignoreBackground && label == 0))
+                        moments[label].AddRun(i0, i1, j, k);
+                    i0 = i1 + 1;
+                }//_while
+            }//_for
+        }//_for
+    };
+
+    if (nThreads == 1) {
+        scanSlab(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(scanSlab, t));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }//_if
+
+    std::map<int, LabelMoments> total;
+    for (const std::map<int, LabelMoments>& moments : slabs)
+        for (const std::pair<const int, LabelMoments>& entry : moments)
+            total[entry.first].Merge(entry.second);
+
+    //Index space to physical space, physical = origin + M * index
+    vnl_matrix_fixed<double, 3, 3> M = image->GetDirection().GetVnlMatrix();
+    for (int a = 0; a < 3; a++)
+        for (int b = 0; b < 3; b++)
+            M(a, b) *= image->GetSpacing()[b];
+    const LabelImageType::PointType origin = image->GetOrigin();
+
+    for (const std::pair<const int, LabelMoments>& entry : total) {
+        const LabelMoments& m = entry.second;
+        LabelGeometry g;
+        g.label = entry.first;
+        g.count = m.count;
+
+        double mean[3];
+        for (int a = 0; a < 3; a++) {
+            mean[a] = (double)m.sum[a] / m.count;
+            g.lower[a] = region.GetIndex(a) + m.lower[a];
+            g.upper[a] = region.GetIndex(a) + m.upper[a];
+        }//_for
+        for (int a = 0; a < 3; a++) {
+            g.centroid[a] = origin[a];
+            for (int b = 0; b < 3; b++)
+                g.centroid[a] += M(a, b) * (region.GetIndex(b) + mean[b]);
+        }//_for
+
+        //Covariance is translation invariant, the buffer offset drops out
+        const int pairs[6][2] = {{0, 0}, {1, 1}, {2, 2}, {0, 1}, {0, 2}, {1, 2}};
+        vnl_matrix_fixed<double, 3, 3> covariance;
+        for (int p = 0; p < 6; p++) {
+            int a = pairs[p][0], b = pairs[p][1];
+            covariance(a, b) = covariance(b, a) = (double)m.sumProducts[p] / m.count - mean[a] * mean[b];
+        }//_for
+        vnl_matrix_fixed<double, 3, 3> physical = M * covariance * M.transpose();
+
+        vnl_symmetric_eigensystem<double> eigen(physical.as_matrix());
+        for (int k = 0; k < 3; k++) {
+            g.principalMoments[k] = std::max(0.0, eigen.get_eigenvalue(k));
+            vnl_vector<double> axis = eigen.get_eigenvector(k);
+            for (int a = 0; a < 3; a++)
+                g.principalAxes[k][a] = axis[a];
+        }//_for
+        geometry.push_back(g);
+    }//_for
+
+    return geometry;
+}
+
+std::vector<CemrgCommonUtils::LabelGeometry> CemrgCommonUtils::ComputeLabelGeometry(mitk::Image::Pointer image, bool ignoreBackground, int numberOfThreads) {
+
+    LabelImageType::Pointer itkImage = LabelImageType::New();
+    mitk::CastToItkImage(image, itkImage);
+    return ComputeLabelGeometry(itkImage, ignoreBackground, numberOfThreads);
+}
+
+const CemrgCommonUtils::LabelGeometry* CemrgCommonUtils::FindLabelGeometry(const std::vector<LabelGeometry>& geometry, int label) {
+
+    //Sorted by label
+    auto it = std::lower_bound(geometry.begin(), geometry.end(), label,
+        [](const LabelGeometry& g, int l) { return g.label < l; });
+    return (it != geometry.end() && it->label == label) ? &(*it) : nullptr;
+}
+
 void CemrgCommonUtils::RoundPixelValues(QString pathToImage, QString outputPath) {
     QFileInfo fi(pathToImage);
     if (fi.exists()) {
@@ -347,39 +897,30 @@ void CemrgCommonUtils::RoundPixelValues(QString pathToImage, QString outputPath)
 }
 
 
-mitk::Surface::Pointer CemrgCommonUtils::LoadVTKMesh(std::string path) {
+mitk::Surface::Pointer CemrgCommonUtils::LoadVTKMesh(std::string path, bool lazyFlip) {
 
     try {
         //Load the mesh
         mitk::Surface::Pointer surface = mitk::IOUtil::Load<mitk::Surface>(path);
         vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
+        if (pd->GetPoints() == nullptr)
+            return surface;
 
         //Prepare points for MITK visualisation
-        double Xmin = 0, Xmax = 0, Ymin = 0, Ymax = 0, Zmin = 0, Zmax = 0;
-        for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-            double* point = pd->GetPoint(i);
-            point[0] = -point[0];
-            point[1] = -point[1];
-            pd->GetPoints()->SetPoint(i, point);
-            //Find mins and maxs
-            if (i == 0) {
-                Xmin = point[0];
-                Xmax = point[0];
-                Ymin = point[1];
-                Ymax = point[1];
-                Zmin = point[2];
-                Zmax = point[2];
-            } else {
-                if (point[0] < Xmin) Xmin = point[0];
-                if (point[0] > Xmax) Xmax = point[0];
-                if (point[1] < Ymin) Ymin = point[1];
-                if (point[1] > Ymax) Ymax = point[1];
-                if (point[2] < Zmin) Zmin = point[2];
-                if (point[2] > Zmax) Zmax = point[2];
-            }//_if
-        }//_for
-        double bounds[6] = {Xmin, Xmax, Ymin, Ymax, Zmin, Zmax};
-        surface->GetGeometry()->SetBounds(bounds);
+        if (lazyFlip) {
+            mitk::AffineTransform3D::Pointer flip = mitk::AffineTransform3D::New();
+            mitk::AffineTransform3D::MatrixType matrix;
+            matrix.SetIdentity();
+            matrix(0, 0) = -1;
+            matrix(1, 1) = -1;
+            flip->SetMatrix(matrix);
+            surface->GetGeometry()->SetIndexToWorldTransform(flip);
+            surface->GetGeometry()->SetBounds(pd->GetBounds());
+        } else {
+            double bounds[6];
+            FlipXYPoints(pd->GetPoints(), bounds);
+            surface->GetGeometry()->SetBounds(bounds);
+        }//_if
 
         return surface;
 
@@ -388,6 +929,32 @@ mitk::Surface::Pointer CemrgCommonUtils::LoadVTKMesh(std::string path) {
     }//_catch
 }
 
+void CemrgCommonUtils::FlipXYPoints(vtkPoints* points, double bounds[6], int numberOfThreads) {
+
+    double flippedBounds[6] = {0, 0, 0, 0, 0, 0};
+    if (points != nullptr && points->GetNumberOfPoints() > 0) {
+        vtkDataArray* data = points->GetData();
+        if (points->GetDataType() == VTK_FLOAT) {
+            FlipXYInPlace(static_cast<float*>(data->GetVoidPointer(0)), points->GetNumberOfPoints(), numberOfThreads, flippedBounds);
+        } else if (points->GetDataType() == VTK_DOUBLE) {
+            FlipXYInPlace(static_cast<double*>(data->GetVoidPointer(0)), points->GetNumberOfPoints(), numberOfThreads, flippedBounds);
+        } else {
+            for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++) {
+                double point[3];
+                points->GetPoint(i, point);
+                point[0] = -point[0];
+                point[1] = -point[1];
+                points->SetPoint(i, point);
+            }//_for
+            points->GetBounds(flippedBounds);
+        }//_if
+        points->Modified();
+    }//_if
+
+    if (bounds != nullptr)
+        std::copy(flippedBounds, flippedBounds + 6, bounds);
+}
+
 mitk::Surface::Pointer CemrgCommonUtils::ExtractSurfaceFromSegmentation(mitk::Image::Pointer image, double thresh, double blur, double smooth, double decimation) {
     auto im2surf = mitk::ManualSegmentationToSurfaceFilter::New();
 
@@ -461,12 +1028,8 @@ void CemrgCommonUtils::FlipXYPlane(mitk::Surface::Pointer surf, QString dir, QSt
 
     //Prepare points for MITK visualisation - (CemrgCommonUtils::LoadVTKMesh)
     vtkSmartPointer<vtkPolyData> pd = surf->GetVtkPolyData();
-    for (int ix = 0; ix < pd->GetNumberOfPoints(); ix++) {
-        double* point = pd->GetPoint(ix);
-        point[0] = -point[0];
-        point[1] = -point[1];
-        pd->GetPoints()->SetPoint(ix, point);
-    }
+    FlipXYPoints(pd->GetPoints());
+    pd->Modified();
 
     if (!vtkname.isEmpty()) {
         vtkname += (!vtkname.contains(".vtk")) ? ".vtk" : "";
@@ -841,38 +1404,31 @@ void CemrgCommonUtils::OriginalCoordinates(QString imagePath, QString pointPath,
         mitk::CastToItkImage(image, itkInput);
         origin = itkInput->GetOrigin();
 
-        std::ifstream pointFileRead;
-
-        int nPts;
-        pointFileRead.open(pointPath.toStdString());
-        pointFileRead >> nPts;
-
-        double x, y, z;
-
-        std::ofstream outputFileWrite;
-        outputFileWrite.open(outputPath.toStdString());
-        outputFileWrite << nPts << std::endl;
+        std::vector<double> pts;
+        if (!ReadCarpPoints(pointPath, pts))
+            return;
 
+        int nPts = pts.size() / 3;
         for (int iPt = 0; iPt < nPts; iPt++) {
-            double xt, yt, zt;
-            pointFileRead >> x;
-            pointFileRead >> y;
-            pointFileRead >> z;
-            if (pointFileRead.eof()) {
-                MITK_WARN << " WARNING!: File ended prematurely " << endl;
-                break;
-            }
-
-            xt = x + (origin[0] * scaling);
-            yt = y + (origin[1] * scaling);
-            zt = z + (origin[2] * scaling);
+            pts[3 * iPt + 0] += (origin[0] * scaling);
+            pts[3 * iPt + 1] += (origin[1] * scaling);
+            pts[3 * iPt + 2] += (origin[2] * scaling);
+        }
 
-            outputFileWrite << std::fixed << xt << " ";
-            outputFileWrite << std::fixed << yt << " ";
-            outputFileWrite << std::fixed << zt << std::endl;
+        if (IsCarpBinary(outputPath, "bpts")) {
+            WriteCarpPoints(outputPath, pts);
+        } else {
+            std::ofstream outputFileWrite;
+            outputFileWrite.open(outputPath.toStdString());
+            outputFileWrite << nPts << std::endl;
+
+            for (int iPt = 0; iPt < nPts; iPt++) {
+                outputFileWrite << std::fixed << pts[3 * iPt + 0] << " ";
+                outputFileWrite << std::fixed << pts[3 * iPt + 1] << " ";
+                outputFileWrite << std::fixed << pts[3 * iPt + 2] << std::endl;
+            }
+            outputFileWrite.close();
         }
-        pointFileRead.close();
-        outputFileWrite.close();
         MITK_INFO << ("Saved to file: " + outputPath).toStdString();
 
     } else {
@@ -884,82 +1440,53 @@ void CemrgCommonUtils::OriginalCoordinates(QString imagePath, QString pointPath,
 
 void CemrgCommonUtils::CalculateCentreOfGravity(QString pointPath, QString elemPath, QString outputPath) {
     if (QFileInfo::exists(elemPath) && QFileInfo::exists(pointPath)) {
-        FILE* pointFileRead = fopen(pointPath.toStdString().c_str(), "r");
-        FILE* elemFileRead = fopen(elemPath.toStdString().c_str(), "r");
-        int nPts, nElem;
-
-        int fscanOut1 = fscanf(pointFileRead, "%d\n", &nPts);
-        MITK_INFO(fscanOut1 == 1) << "File size read correctly";
-
-        double* pts_array = (double*)malloc(nPts * 3 * sizeof(double));
-        if (pts_array == NULL) {
-            MITK_ERROR << "pts_array malloc FAIL";
-            fclose(pointFileRead);
-            fclose(elemFileRead);
-            return;
-        }
+        std::vector<double> pts;
+        CarpElements elems;
 
-        MITK_INFO << "Beginning input .pts file";
-        for (int i = 0; i < nPts; i++) {
-            double* loc = pts_array + 3 * i;
-            fscanOut1 = fscanf(pointFileRead, "%lf %lf %lf\n", loc, loc + 1, loc + 2);
-            MITK_INFO(fscanOut1 != 3) << ("Error reading file at line: " + QString::number(i)).toStdString();
-        }
-        MITK_INFO << "Completed input .pts file";
-        fclose(pointFileRead);
+        MITK_INFO << "Beginning input points file";
+        if (!ReadCarpPoints(pointPath, pts))
+            return;
+        MITK_INFO << "Completed input points file";
 
-        fscanOut1 = fscanf(elemFileRead, "%d\n", &nElem);
-        MITK_INFO(fscanOut1 == 1) << "File size read correctly";
+        MITK_INFO << "Beginning input elements file";
+        if (!ReadCarpElements(elemPath, elems))
+            return;
+        MITK_INFO << "Completed input elements file";
 
+        int nPts = pts.size() / 3;
+        int nElem = elems.Size();
         std::ofstream outputFileWrite;
         outputFileWrite.open(outputPath.toStdString());
         outputFileWrite << nElem << " 3" << std::endl;
 
-        MITK_INFO << "Beginning input .elem file, simultaneous output";
+        MITK_INFO << "Calculating centres of gravity";
         for (int i = 0; i < nElem; i++) {
-            // 		int* loc = elem_array + 4*i;
-            int p1, p2, p3, p4, region;
-            fscanOut1 = fscanf(elemFileRead, "Tt %d %d %d %d %d\n", &p1, &p2, &p3, &p4, &region);
-            MITK_INFO(fscanOut1 != 5) << ("Error reading file at line: " + QString::number(i)).toStdString();
 
             // Calculate and output cog
             double x = 0.0, y = 0.0, z = 0.0;
+            for (int j = elems.offsets[i]; j < elems.offsets[i + 1]; j++) {
+                if (elems.nodes[j] < 0 || elems.nodes[j] >= nPts) {
+                    MITK_INFO << ("Error reading file at line: " + QString::number(i)).toStdString();
+                    continue;
+                }
+                double *loc = pts.data() + 3 * elems.nodes[j];
+                x += loc[0];
+                y += loc[1];
+                z += loc[2];
+            }
 
-            double *loc = pts_array + 3 * p1;
-            x += loc[0];
-            y += loc[1];
-            z += loc[2];
-
-            loc = pts_array + 3 * p2;
-            x += loc[0];
-            y += loc[1];
-            z += loc[2];
-
-            loc = pts_array + 3 * p3;
-            x += loc[0];
-            y += loc[1];
-            z += loc[2];
-
-            loc = pts_array + 3 * p4;
-            x += loc[0];
-            y += loc[1];
-            z += loc[2];
-
-            x /= 4.0 * 1000;
-            y /= 4.0 * 1000;
-            z /= 4.0 * 1000;
+            double numNodes = elems.NumberOfNodes(i);
+            x /= numNodes * 1000;
+            y /= numNodes * 1000;
+            z /= numNodes * 1000;
 
             outputFileWrite << std::fixed << std::setprecision(6) << x << std::endl;
             outputFileWrite << std::fixed << std::setprecision(6) << y << std::endl;
             outputFileWrite << std::fixed << std::setprecision(6) << z << std::endl;
 
         }
-        MITK_INFO << "Completed input .elem file";
-
-        fclose(elemFileRead);
         outputFileWrite.close();
-        MITK_INFO << "Completed input .elem file";
-
+        MITK_INFO << "Completed centre of gravity file";
 
     } else {
         MITK_ERROR(QFileInfo::exists(elemPath)) << ("Could not read file" + elemPath).toStdString();
@@ -998,51 +1525,37 @@ void CemrgCommonUtils::RegionMapping(QString bpPath, QString pointPath, QString
             }
         }
 
-        std::ofstream outputFileWrite;
-        std::ifstream cogFileRead, elemFileRead;
-        cogFileRead.open(pointPath.toStdString());
+        CarpFileView cogFileView(pointPath);
+        CarpTextScanner cogFileRead(cogFileView.Begin(), cogFileView.End());
 
-        int nElemCOG, dim, count;
+        int nElemCOG = 0, dim = 0, count;
         double x, y, z;
 
-        cogFileRead >> nElemCOG;
-        cogFileRead >> dim;
-
-
-        outputFileWrite.open(outputPath.toStdString());
-        outputFileWrite << nElemCOG << std::endl;
+        cogFileRead.NextInt(nElemCOG);
+        cogFileRead.NextInt(dim);
 
         MITK_INFO << ("Number of elements (COG file):" + QString::number(nElemCOG)).toStdString();
         MITK_INFO << ("Dimension= " + QString::number(dim)).toStdString();
 
-        elemFileRead.open(elemPath.toStdString());
-        int nElem;
+        CarpElements elems;
+        if (!ReadCarpElements(elemPath, elems))
+            return;
 
-        elemFileRead >> nElem;
+        int nElem = elems.Size();
         if (nElem != nElemCOG) {
             MITK_ERROR << "Number of elements in files are not consistent.";
         }
 
         count = 0;
-        char type[2];
-        int nodes[4], imregion, newRegion;
+        int imregion, newRegion;
         int newRegionCount = 0;
 
-        for (int iElem = 0; iElem < nElemCOG; iElem++) {
-            cogFileRead >> x;
-            cogFileRead >> y;
-            cogFileRead >> z;
-            if (cogFileRead.eof()) {
+        for (int iElem = 0; iElem < nElemCOG && iElem < nElem; iElem++) {
+            if (!cogFileRead.NextDouble(x) || !cogFileRead.NextDouble(y) || !cogFileRead.NextDouble(z)) {
                 MITK_WARN << "File ended prematurely";
                 break;
             }
-
-            elemFileRead >> type;
-            elemFileRead >> nodes[0];
-            elemFileRead >> nodes[1];
-            elemFileRead >> nodes[2];
-            elemFileRead >> nodes[3];
-            elemFileRead >> imregion;
+            imregion = elems.regions[iElem];
 
             // checking point belonging to imregion (cm2carp/carp_scar_map::inScar())
             double xt, yt, zt;
@@ -1076,17 +1589,16 @@ void CemrgCommonUtils::RegionMapping(QString bpPath, QString pointPath, QString
                 newRegionCount++;
             }
 
-            outputFileWrite << type << " ";
-            outputFileWrite << nodes[0] << " ";
-            outputFileWrite << nodes[1] << " ";
-            outputFileWrite << nodes[2] << " ";
-            outputFileWrite << nodes[3] << " ";
-            outputFileWrite << imregion << std::endl;
-
+            elems.regions[iElem] = imregion;
             count++;
         }
 
-        outputFileWrite.close();
+        // Only the elements with a centre of gravity are written
+        elems.types.resize(count);
+        elems.offsets.resize(count + 1);
+        elems.nodes.resize(elems.offsets.back());
+        elems.regions.resize(count);
+        WriteCarpElements(outputPath, elems);
 
         MITK_INFO << ("Number of element COG read: " + QString::number(count)).toStdString();
         MITK_INFO << ("Number of new regions determined: " + QString::number(newRegionCount)).toStdString();
@@ -1113,105 +1625,28 @@ void CemrgCommonUtils::RegionMapping(QString bpPath, QString pointPath, QString
 
 void CemrgCommonUtils::NormaliseFibreFiles(QString fibresPath, QString outputPath) {
     MITK_INFO << "Normalise fibres file";
-    std::ifstream ffibres(fibresPath.toStdString());
-    std::ofstream fo(outputPath.toStdString());
-
+    std::vector<double> fibres;
     int numVect;
-    ffibres >> numVect;
+    if (!ReadCarpFibres(fibresPath, fibres, numVect))
+        return;
     MITK_INFO << ("Number of vectors per line in file: " + QString::number(numVect)).toStdString();
 
-    double x, y, z;
-    double norm;
-    // prime read
-    ffibres >> x;
-    ffibres >> y;
-    ffibres >> z;
-    fo << numVect << std::endl;
-    while (!ffibres.eof()) {
-        for (int i = 0; i < numVect; i++) {
-            norm = sqrt(x * x + y * y + z * z);
-            if (norm > 0) {
-                fo << std::fixed << std::setprecision(8) << x / norm << " " << y / norm << " " << z / norm << " ";
-            } else {
-                fo << std::fixed << std::setprecision(8) << x << " " << y << " " << z << " ";
-            }
-            ffibres >> x;
-            ffibres >> y;
-            ffibres >> z;
+    for (size_t ix = 0; ix + 2 < fibres.size(); ix += 3) {
+        double x = fibres[ix], y = fibres[ix + 1], z = fibres[ix + 2];
+        double norm = sqrt(x * x + y * y + z * z);
+        if (norm > 0) {
+            fibres[ix] = x / norm;
+            fibres[ix + 1] = y / norm;
+            fibres[ix + 2] = z / norm;
         }
-        fo << std::endl;
     }
-    ffibres.close();
-    fo.close();
+    WriteCarpFibres(outputPath, fibres, numVect);
 }
 
 void CemrgCommonUtils::CarpToVtk(QString elemPath, QString ptsPath, QString outputPath, bool saveRegionlabels) {
-    std::ofstream VTKFile;
-    std::ifstream ptsFileRead, elemFileRead;
-    short int precision = 12;
-    short int numColsLookupTable = 1;
-
-    VTKFile.open(outputPath.toStdString());
-    MITK_INFO << "Writing vtk file header.";
-    VTKFile << "# vtk DataFile Version 4.0" << std::endl;
-    VTKFile << "vtk output" << std::endl;
-    VTKFile << "ASCII" << std::endl;
-    VTKFile << "DATASET UNSTRUCTURED_GRID" << std::endl;
-
-    int nElem, nPts;
-    ptsFileRead.open(ptsPath.toStdString());
-    ptsFileRead >> nPts;
-
-    MITK_INFO << "Setting geometry - Points";
-    VTKFile << "POINTS " << nPts << " float" << std::endl;
-    double x, y, z;
-    for (int ix = 0; ix < nPts; ix++) {
-        ptsFileRead >> x;
-        ptsFileRead >> y;
-        ptsFileRead >> z;
-
-        VTKFile << std::setprecision(precision) << x << " " << y << " " << z << std::endl;
-    }
-    ptsFileRead.close();
-
-    MITK_INFO << "Setting geometry - Tetrahedral elements";
-    elemFileRead.open(elemPath.toStdString());
-    elemFileRead >> nElem;
-    std::string type;
-    int p0, p1, p2, p3;
-    std::vector<double> regionVector(nElem);
-    VTKFile << "CELLS " << nElem << " " << (4 + 1) * nElem << std::endl;
-    for (int ix = 0; ix < nElem; ix++) {
-        elemFileRead >> type;
-        elemFileRead >> p0;
-        elemFileRead >> p1;
-        elemFileRead >> p2;
-        if (type.compare("Tr") == 0) {
-            elemFileRead >> p3;
-        }
-        elemFileRead >> regionVector[ix];
-
-        if (type.compare("Tr") == 0) {
-            VTKFile << "3 " << p0 << " " << p1 << " " << p2 << std::endl;
-        } else {
-            VTKFile << "4 " << p0 << " " << p1 << " " << p2 << " " << p3 << std::endl;
-        }
-    }
 
-    VTKFile << "CELL_TYPES " << nElem << " ";
-    for (int ix = 0; ix < nElem; ix++) {
-        VTKFile << "10"; // type for tetrahedral mesh
-        if (((1 + ix) % numColsLookupTable) && (ix < (nElem - 1))) {
-            VTKFile << " ";
-        } else {
-            VTKFile << std::endl;
-        }
-    }
-    elemFileRead.close();
-    VTKFile.close();
-    if (saveRegionlabels) {
-        AppendScalarFieldToVtk(outputPath, "region_labels", "CELL", regionVector);
-    }
+    // ASCII keeps the output compatible with AppendScalarFieldToVtk and AppendVectorFieldToVtk
+    CarpToVtkFields(elemPath, ptsPath, outputPath, std::vector<CarpVtkField>(), CARP_VTK_ASCII, saveRegionlabels);
 }
 
 void CemrgCommonUtils::RectifyFileValues(QString pathToFile, double minVal, double maxVal) {
@@ -1342,4 +1777,489 @@ void CemrgCommonUtils::AppendVectorFieldToVtk(QString vtkPath, QString fieldName
     }
 
     VTKFile.close();
-}
\ No newline at end of file
+}
+int CemrgCommonUtils::CarpElementVtkCellType(int type) {
+
+    // Tt, Hx, Oc, Py, Pr, Qd, Tr, Ln; octahedra have no linear VTK cell
+    const int vtkTypes[] = {VTK_TETRA, VTK_HEXAHEDRON, VTK_CONVEX_POINT_SET, VTK_PYRAMID, VTK_WEDGE, VTK_QUAD, VTK_TRIANGLE, VTK_LINE};
+    return (type >= CARP_TT && type < CARP_UNKNOWN) ? vtkTypes[type] : VTK_EMPTY_CELL;
+}
+
+bool CemrgCommonUtils::CarpToVtkFields(QString elemPath, QString ptsPath, QString outputPath, const std::vector<CarpVtkField>& fields, int format, bool saveRegionlabels) {
+
+    std::vector<double> pts;
+    CarpElements elems;
+    if (!ReadCarpPoints(ptsPath, pts) || !ReadCarpElements(elemPath, elems))
+        return false;
+
+    return WriteCarpVtk(outputPath, pts, elems, fields, format, saveRegionlabels);
+}
+
+bool CemrgCommonUtils::WriteCarpVtk(QString outputPath, const std::vector<double>& pts, const CarpElements& elems, const std::vector<CarpVtkField>& fields, int format, bool saveRegionlabels) {
+
+    int nElem = elems.Size(), nPts = pts.size() / 3;
+
+    //Fields that do not match the mesh are left out
+    std::vector<const CarpVtkField*> pointFields, cellFields;
+    for (const CarpVtkField& field : fields) {
+        size_t numTuples = field.cellData ? nElem : nPts;
+        if (field.numberOfComponents < 1 || field.numberOfComponents > 4 || field.values.size() != numTuples * field.numberOfComponents) {
+            MITK_WARN << "Field " << field.name << " does not match the mesh, skipped.";
+            continue;
+        }
+        (field.cellData ? cellFields : pointFields).push_back(&field);
+    }//_for
+    bool writeRegions = saveRegionlabels && elems.regions.size() == (size_t)nElem;
+
+    std::vector<unsigned char> cellTypes(nElem);
+    for (int ix = 0; ix < nElem; ix++)
+        cellTypes[ix] = CarpElementVtkCellType(elems.types[ix]);
+
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        MITK_ERROR << ("Could not open VTK file for writing: " + outputPath).toStdString();
+        return false;
+    }//_if
+
+    bool ok = true;
+    if (format == CARP_VTU_APPENDED) {
+
+        MITK_INFO << "Writing appended raw VTU file.";
+        VtkStreamWriter out(file, false, HostEndianness() == 1);
+
+        //Offsets of each block in the appended section, each block preceded by its UInt64 byte count
+        std::ostringstream xml;
+        uint64_t offset = 0;
+        auto dataArray = [&xml, &offset](std::string type, std::string name, int numComponents, uint64_t numBytes) {
+            xml << "        <DataArray type=\"" << type << "\"";
+            if (!name.empty())
+                xml << " Name=\"" << name << "\"";
+            xml << " NumberOfComponents=\"" << numComponents << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+            offset += sizeof(uint64_t) + numBytes;
+        };
+
+        xml << "<?xml version=\"1.0\"?>\n";
+        xml << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << (HostEndianness() == 1 ? "BigEndian" : "LittleEndian") << "\" header_type=\"UInt64\">\n";
+        xml << "  <UnstructuredGrid>\n";
+        xml << "    <Piece NumberOfPoints=\"" << nPts << "\" NumberOfCells=\"" << nElem << "\">\n";
+        xml << "      <PointData>\n";
+        for (const CarpVtkField* field : pointFields)
+            dataArray("Float32", field->name, field->numberOfComponents, field->values.size() * sizeof(float));
+        xml << "      </PointData>\n";
+        xml << "      <CellData>\n";
+        if (writeRegions)
+            dataArray("Float32", "region_labels", 1, nElem * sizeof(float));
+        for (const CarpVtkField* field : cellFields)
+            dataArray("Float32", field->name, field->numberOfComponents, field->values.size() * sizeof(float));
+        xml << "      </CellData>\n";
+        xml << "      <Points>\n";
+        dataArray("Float32", "", 3, pts.size() * sizeof(float));
+        xml << "      </Points>\n";
+        xml << "      <Cells>\n";
+        dataArray("Int32", "connectivity", 1, elems.nodes.size() * sizeof(int32_t));
+        dataArray("Int32", "offsets", 1, nElem * sizeof(int32_t));
+        dataArray("UInt8", "types", 1, nElem * sizeof(uint8_t));
+        xml << "      </Cells>\n";
+        xml << "    </Piece>\n";
+        xml << "  </UnstructuredGrid>\n";
+        xml << "  <AppendedData encoding=\"raw\">\n_";
+        out.Text(xml.str());
+
+        //Blocks in the same order as declared above
+        for (const CarpVtkField* field : pointFields) {
+            out.Value<uint64_t>(field->values.size() * sizeof(float));
+            out.Array<float>(field->values.data(), field->values.size(), 1);
+        }
+        if (writeRegions) {
+            out.Value<uint64_t>(nElem * sizeof(float));
+            out.Array<float>(elems.regions.data(), nElem, 1);
+        }
+        for (const CarpVtkField* field : cellFields) {
+            out.Value<uint64_t>(field->values.size() * sizeof(float));
+            out.Array<float>(field->values.data(), field->values.size(), 1);
+        }
+        out.Value<uint64_t>(pts.size() * sizeof(float));
+        out.Array<float>(pts.data(), pts.size(), 1);
+        out.Value<uint64_t>(elems.nodes.size() * sizeof(int32_t));
+        out.Array<int32_t>(elems.nodes.data(), elems.nodes.size(), 1);
+        out.Value<uint64_t>(nElem * sizeof(int32_t));
+        out.Array<int32_t>(elems.offsets.data() + 1, nElem, 1);
+        out.Value<uint64_t>(nElem * sizeof(uint8_t));
+        out.Array<uint8_t>(cellTypes.data(), nElem, 1);
+        out.Text("\n  </AppendedData>\n</VTKFile>\n");
+
+        out.Flush();
+        ok = out.IsOk();
+
+    } else {
+
+        bool ascii = (format == CARP_VTK_ASCII);
+        MITK_INFO << (ascii ? "Writing ASCII VTK file." : "Writing binary VTK file.");
+        VtkStreamWriter out(file, ascii, true);
+        std::string binaryEnd = ascii ? "" : "\n";
+
+        out.Text("# vtk DataFile Version 4.0\nvtk output\n");
+        out.Text(ascii ? "ASCII\n" : "BINARY\n");
+        out.Text("DATASET UNSTRUCTURED_GRID\n");
+
+        MITK_INFO << "Setting geometry - Points";
+        out.Text("POINTS " + std::to_string(nPts) + " float\n");
+        out.Array<float>(pts.data(), pts.size(), 3);
+        out.Text(binaryEnd);
+
+        MITK_INFO << "Setting geometry - Elements";
+        out.Text("CELLS " + std::to_string(nElem) + " " + std::to_string(elems.nodes.size() + nElem) + "\n");
+        std::vector<int> cell;
+        for (int ix = 0; ix < nElem; ix++) {
+            cell.assign(1, elems.NumberOfNodes(ix));
+            cell.insert(cell.end(), elems.nodes.begin() + elems.offsets[ix], elems.nodes.begin() + elems.offsets[ix + 1]);
+            out.Array<int32_t>(cell.data(), cell.size(), cell.size());
+        }//_for
+        out.Text(binaryEnd);
+
+        out.Text("CELL_TYPES " + std::to_string(nElem) + "\n");
+        out.Array<int32_t>(cellTypes.data(), nElem, 1);
+        out.Text(binaryEnd);
+
+        //All fields of one kind share a single data section
+        auto writeSection = [&](const std::vector<const CarpVtkField*>& list, std::string section, int numTuples, bool regions) {
+            if (list.empty() && !regions)
+                return;
+            out.Text(section + "_DATA " + std::to_string(numTuples) + "\n");
+            if (regions) {
+                out.Text("SCALARS region_labels float 1\nLOOKUP_TABLE default\n");
+                out.Array<float>(elems.regions.data(), nElem, 1);
+                out.Text(binaryEnd);
+            }
+            for (const CarpVtkField* field : list) {
+                MITK_INFO << ("Writing " + section + " field <<" + field->name + ">>").c_str();
+                if (field->numberOfComponents == 3)
+                    out.Text("VECTORS " + field->name + " float\n");
+                else
+                    out.Text("SCALARS " + field->name + " float " + std::to_string(field->numberOfComponents) + "\nLOOKUP_TABLE default\n");
+                out.Array<float>(field->values.data(), field->values.size(), field->numberOfComponents);
+                out.Text(binaryEnd);
+            }//_for
+        };
+        writeSection(cellFields, "CELL", nElem, writeRegions);
+        writeSection(pointFields, "POINT", nPts, false);
+
+        out.Flush();
+        ok = out.IsOk();
+    }//_if
+
+    file.close();
+    MITK_INFO(!ok) << ("Error while writing VTK file: " + outputPath).toStdString();
+    return ok;
+}
+
+int CemrgCommonUtils::CarpElementTypeFromTag(std::string tag) {
+
+    const char* tags[] = {"Tt", "Hx", "Oc", "Py", "Pr", "Qd", "Tr", "Ln"};
+    for (int ix = CARP_TT; ix < CARP_UNKNOWN; ix++) {
+        if (tag.compare(tags[ix]) == 0)
+            return ix;
+    }
+    return CARP_UNKNOWN;
+}
+
+std::string CemrgCommonUtils::CarpElementTag(int type) {
+
+    const char* tags[] = {"Tt", "Hx", "Oc", "Py", "Pr", "Qd", "Tr", "Ln"};
+    return (type >= CARP_TT && type < CARP_UNKNOWN) ? tags[type] : "";
+}
+
+int CemrgCommonUtils::CarpElementNumberOfNodes(int type) {
+
+    const int numNodes[] = {4, 8, 6, 5, 6, 4, 3, 2};
+    return (type >= CARP_TT && type < CARP_UNKNOWN) ? numNodes[type] : 0;
+}
+
+bool CemrgCommonUtils::ReadCarpPoints(QString ptsPath, std::vector<double>& pts) {
+
+    pts.clear();
+    if (IsCarpBinary(ptsPath, "bpts")) {
+        QFile file(ptsPath);
+        std::vector<long long> header;
+        if (!file.open(QIODevice::ReadOnly) || !ReadCarpBinaryHeader(file, header)) {
+            MITK_ERROR << ("Could not read binary points file: " + ptsPath).toStdString();
+            return false;
+        }//_if
+
+        long long nPts = header[0];
+        bool swap = header.size() > 1 && header[1] != HostEndianness();
+        std::vector<float> values;
+        if (!ReadCarpBinaryBody(file, values, swap) || (long long)values.size() < 3 * nPts) {
+            MITK_WARN << ("File ended prematurely: " + ptsPath).toStdString();
+            values.resize(3 * (values.size() / 3));
+        }//_if
+        values.resize(std::min<long long>(values.size(), 3 * nPts));
+        pts.assign(values.begin(), values.end());
+        return true;
+    }//_if
+
+    CarpFileView view(ptsPath);
+    if (!view.IsOpen()) {
+        MITK_ERROR << ("Could not read points file: " + ptsPath).toStdString();
+        return false;
+    }//_if
+
+    CarpTextScanner scanner(view.Begin(), view.End());
+    int nPts = 0;
+    if (!scanner.NextInt(nPts)) {
+        MITK_ERROR << ("Could not read size of points file: " + ptsPath).toStdString();
+        return false;
+    }//_if
+
+    pts.resize(3 * (size_t)nPts);
+    for (int ix = 0; ix < nPts; ix++) {
+        double* loc = pts.data() + 3 * ix;
+        if (!scanner.NextDouble(loc[0]) || !scanner.NextDouble(loc[1]) || !scanner.NextDouble(loc[2])) {
+            MITK_WARN << ("File ended prematurely: " + ptsPath).toStdString();
+            pts.resize(3 * (size_t)ix);
+            break;
+        }//_if
+    }//_for
+    return true;
+}
+
+bool CemrgCommonUtils::WriteCarpPoints(QString ptsPath, const std::vector<double>& pts) {
+
+    long long nPts = pts.size() / 3;
+    if (IsCarpBinary(ptsPath, "bpts")) {
+        QFile file(ptsPath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            MITK_ERROR << ("Could not write binary points file: " + ptsPath).toStdString();
+            return false;
+        }//_if
+
+        std::ostringstream header;
+        header << nPts << " " << HostEndianness() << " " << CARP_BINARY_CHECKSUM;
+        std::vector<float> values(pts.begin(), pts.begin() + 3 * nPts);
+        return WriteCarpBinaryHeader(file, header.str()) &&
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float)) == (qint64)(values.size() * sizeof(float));
+    }//_if
+
+    std::ofstream ptsFile(ptsPath.toStdString());
+    if (!ptsFile.is_open()) {
+        MITK_ERROR << ("Could not write points file: " + ptsPath).toStdString();
+        return false;
+    }//_if
+
+    short int precision = 12;
+    ptsFile << nPts << std::endl;
+    for (long long ix = 0; ix < nPts; ix++)
+        ptsFile << std::setprecision(precision) << pts[3 * ix] << " " << pts[3 * ix + 1] << " " << pts[3 * ix + 2] << std::endl;
+    ptsFile.close();
+    return true;
+}
+
+bool CemrgCommonUtils::ReadCarpElements(QString elemPath, CarpElements& elems) {
+
+    elems = CarpElements();
+    elems.offsets.push_back(0);
+
+    if (IsCarpBinary(elemPath, "belem")) {
+        QFile file(elemPath);
+        std::vector<long long> header;
+        if (!file.open(QIODevice::ReadOnly) || !ReadCarpBinaryHeader(file, header)) {
+            MITK_ERROR << ("Could not read binary elements file: " + elemPath).toStdString();
+            return false;
+        }//_if
+
+        // Each element is its type, its nodes and its region, all as 32 bit integers
+        long long nElem = header[0];
+        bool swap = header.size() > 1 && header[1] != HostEndianness();
+        std::vector<qint32> values;
+        ReadCarpBinaryBody(file, values, swap);
+
+        size_t pos = 0;
+        elems.types.reserve(nElem);
+        elems.regions.reserve(nElem);
+        for (long long ix = 0; ix < nElem; ix++) {
+            int type = (pos < values.size()) ? values[pos] : CARP_UNKNOWN;
+            int numNodes = CarpElementNumberOfNodes(type);
+            if (numNodes == 0 || pos + numNodes + 2 > values.size()) {
+                MITK_WARN << ("File ended prematurely or unknown element type: " + elemPath).toStdString();
+                break;
+            }//_if
+            elems.types.push_back(type);
+            elems.nodes.insert(elems.nodes.end(), values.begin() + pos + 1, values.begin() + pos + 1 + numNodes);
+            elems.offsets.push_back(elems.nodes.size());
+            elems.regions.push_back(values[pos + 1 + numNodes]);
+            pos += numNodes + 2;
+        }//_for
+        return true;
+    }//_if
+
+    CarpFileView view(elemPath);
+    if (!view.IsOpen()) {
+        MITK_ERROR << ("Could not read elements file: " + elemPath).toStdString();
+        return false;
+    }//_if
+
+    CarpTextScanner scanner(view.Begin(), view.End());
+    int nElem = 0;
+    if (!scanner.NextInt(nElem)) {
+        MITK_ERROR << ("Could not read size of elements file: " + elemPath).toStdString();
+        return false;
+    }//_if
+
+    std::string tag;
+    elems.types.reserve(nElem);
+    elems.regions.reserve(nElem);
+    elems.nodes.reserve(4 * (size_t)nElem);
+    for (int ix = 0; ix < nElem; ix++) {
+        int type = scanner.NextTag(tag) ? CarpElementTypeFromTag(tag) : CARP_UNKNOWN;
+        int numNodes = CarpElementNumberOfNodes(type);
+        if (numNodes == 0) {
+            MITK_WARN << ("File ended prematurely or unknown element type at element " + QString::number(ix) + ": " + elemPath).toStdString();
+            break;
+        }//_if
+
+        bool ok = true;
+        for (int jx = 0; jx < numNodes && ok; jx++) {
+            int node;
+            ok = scanner.NextInt(node);
+            elems.nodes.push_back(node);
+        }//_for
+
+        // Region tag is optional and defaults to 0
+        int region = 0;
+        if (ok && scanner.HasMoreOnLine())
+            ok = scanner.NextInt(region);
+
+        if (!ok) {
+            MITK_WARN << ("Error reading file at element: " + QString::number(ix)).toStdString();
+            elems.nodes.resize(elems.offsets.back());
+            break;
+        }//_if
+        elems.types.push_back(type);
+        elems.offsets.push_back(elems.nodes.size());
+        elems.regions.push_back(region);
+    }//_for
+    return true;
+}
+
+bool CemrgCommonUtils::WriteCarpElements(QString elemPath, const CarpElements& elems) {
+
+    int nElem = elems.Size();
+    if (IsCarpBinary(elemPath, "belem")) {
+        QFile file(elemPath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            MITK_ERROR << ("Could not write binary elements file: " + elemPath).toStdString();
+            return false;
+        }//_if
+
+        std::ostringstream header;
+        header << nElem << " " << HostEndianness() << " " << CARP_BINARY_CHECKSUM;
+        std::vector<qint32> values;
+        values.reserve(elems.nodes.size() + 2 * nElem);
+        for (int ix = 0; ix < nElem; ix++) {
+            values.push_back(elems.types[ix]);
+            values.insert(values.end(), elems.nodes.begin() + elems.offsets[ix], elems.nodes.begin() + elems.offsets[ix + 1]);
+            values.push_back(elems.regions[ix]);
+        }//_for
+        return WriteCarpBinaryHeader(file, header.str()) &&
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(qint32)) == (qint64)(values.size() * sizeof(qint32));
+    }//_if
+
+    std::ofstream elemFile(elemPath.toStdString());
+    if (!elemFile.is_open()) {
+        MITK_ERROR << ("Could not write elements file: " + elemPath).toStdString();
+        return false;
+    }//_if
+
+    elemFile << nElem << std::endl;
+    for (int ix = 0; ix < nElem; ix++) {
+        elemFile << CarpElementTag(elems.types[ix]) << " ";
+        for (int jx = elems.offsets[ix]; jx < elems.offsets[ix + 1]; jx++)
+            elemFile << elems.nodes[jx] << " ";
+        elemFile << elems.regions[ix] << std::endl;
+    }//_for
+    elemFile.close();
+    return true;
+}
+
+bool CemrgCommonUtils::ReadCarpFibres(QString lonPath, std::vector<double>& fibres, int& numAxes) {
+
+    fibres.clear();
+    numAxes = 0;
+    if (IsCarpBinary(lonPath, "blon")) {
+        QFile file(lonPath);
+        std::vector<long long> header;
+        if (!file.open(QIODevice::ReadOnly) || !ReadCarpBinaryHeader(file, header) || header.size() < 2) {
+            MITK_ERROR << ("Could not read binary fibres file: " + lonPath).toStdString();
+            return false;
+        }//_if
+
+        // Header holds the number of axes (fibre, or fibre and sheet) and the number of elements
+        numAxes = header[0];
+        long long nElem = header[1];
+        bool swap = header.size() > 2 && header[2] != HostEndianness();
+        std::vector<float> values;
+        ReadCarpBinaryBody(file, values, swap);
+        size_t total = std::min<size_t>(values.size(), 3 * numAxes * nElem);
+        if ((long long)total < 3 * numAxes * nElem)
+            MITK_WARN << ("File ended prematurely: " + lonPath).toStdString();
+        fibres.assign(values.begin(), values.begin() + total);
+        return true;
+    }//_if
+
+    CarpFileView view(lonPath);
+    if (!view.IsOpen()) {
+        MITK_ERROR << ("Could not read fibres file: " + lonPath).toStdString();
+        return false;
+    }//_if
+
+    CarpTextScanner scanner(view.Begin(), view.End());
+    if (!scanner.NextInt(numAxes)) {
+        MITK_ERROR << ("Could not read number of axes of fibres file: " + lonPath).toStdString();
+        return false;
+    }//_if
+
+    double value;
+    while (scanner.NextDouble(value))
+        fibres.push_back(value);
+
+    size_t valuesPerElement = 3 * std::max(numAxes, 1);
+    if (fibres.size() % valuesPerElement != 0) {
+        MITK_WARN << ("File ended prematurely: " + lonPath).toStdString();
+        fibres.resize(fibres.size() - (fibres.size() % valuesPerElement));
+    }//_if
+    return true;
+}
+
+bool CemrgCommonUtils::WriteCarpFibres(QString lonPath, const std::vector<double>& fibres, int numAxes) {
+
+    size_t valuesPerElement = 3 * std::max(numAxes, 1);
+    long long nElem = fibres.size() / valuesPerElement;
+    if (IsCarpBinary(lonPath, "blon")) {
+        QFile file(lonPath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            MITK_ERROR << ("Could not write binary fibres file: " + lonPath).toStdString();
+            return false;
+        }//_if
+
+        std::ostringstream header;
+        header << numAxes << " " << nElem << " " << HostEndianness() << " " << CARP_BINARY_CHECKSUM;
+        std::vector<float> values(fibres.begin(), fibres.begin() + nElem * valuesPerElement);
+        return WriteCarpBinaryHeader(file, header.str()) &&
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float)) == (qint64)(values.size() * sizeof(float));
+    }//_if
+
+    std::ofstream lonFile(lonPath.toStdString());
+    if (!lonFile.is_open()) {
+        MITK_ERROR << ("Could not write fibres file: " + lonPath).toStdString();
+        return false;
+    }//_if
+
+    lonFile << numAxes << std::endl;
+    for (long long ix = 0; ix < nElem; ix++) {
+        for (size_t jx = 0; jx < valuesPerElement; jx++)
+            lonFile << std::fixed << std::setprecision(8) << fibres[ix * valuesPerElement + jx] << " ";
+        lonFile << std::endl;
+    }//_for
+    lonFile.close();
+    return true;
+}
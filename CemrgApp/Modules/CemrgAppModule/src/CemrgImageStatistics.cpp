@@ -0,0 +1,357 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Streaming Image Statistics
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "CemrgImageStatistics.h"
+
+namespace {
+    //Voxels per block, fixed so the merge order never depends on the threads
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    struct Moments {
+        uint64_t count = 0;
+        double mean = 0, m2 = 0;
+        double minimum = std::numeric_limits<double>::max();
+        double maximum = std::numeric_limits<double>::lowest();
+        bool integral = true;
+    };
+
+    template <typename TMask>
+    inline bool InMask(const TMask* mask, size_t i, int maskLabel) {
+        if (mask == nullptr)
+            return true;
+        return (maskLabel < 0) ? (mask[i] != 0) : (mask[i] == maskLabel);
+    }
+
+    //Masked and finite
+    template <typename TPixel, typename TMask>
+    inline bool Counted(const TPixel* image, const TMask* mask, size_t i, int maskLabel) {
+        if (!std::isfinite((double)image[i]))
+            return false;
+        return InMask(mask, i, maskLabel);
+    }
+
+    int NumberOfWorkers(int numberOfThreads, size_t numBlocks) {
+        int nThreads = numberOfThreads;
+        if (nThreads <= 0)
+            nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        return (int)std::min<size_t>(nThreads, std::max<size_t>(1, numBlocks));
+    }
+
+    template <typename TFunction>
+    void RunParallel(int numberOfThreads, size_t numBlocks, TFunction function) {
+        const int nThreads = NumberOfWorkers(numberOfThreads, numBlocks);
+
+        //Thread t takes blocks t, t + nThreads, ... so slabs stay balanced
+        auto work = [&](int t) {
+            for (size_t b = t; b < numBlocks; b += nThreads)
+                function(t, b);
+        };
+        if (nThreads == 1) {
+            work(0);
+            return;
+        }//_if
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(work, t));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+}
+
+CemrgImageStatistics::CemrgImageStatistics() : numberOfThreads(0), histogramOn(false), maxBins(65536) {
+
+    Clear();
+}
+
+void CemrgImageStatistics::Add(double value) {
+
+    if (!std::isfinite(value))
+        return;
+
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+
+    //Single values are not binned
+    histogram.clear();
+    histogramExact = false;
+}
+
+void CemrgImageStatistics::Merge(const CemrgImageStatistics& other) {
+
+    if (other.count == 0)
+        return;
+
+    if (count == 0) {
+        count = other.count;
+        mean = other.mean;
+        m2 = other.m2;
+        minimum = other.minimum;
+        maximum = other.maximum;
+        histogram = other.histogram;
+        histogramMinimum = other.histogramMinimum;
+        binWidth = other.binWidth;
+        histogramExact = other.histogramExact;
+        return;
+    }//_if
+
+    //Unit-width histograms are aligned on their minimum, any other combination is dropped
+    if (histogramExact && other.histogramExact && !histogram.empty() && !other.histogram.empty()) {
+        double newMinimum = std::min(histogramMinimum, other.histogramMinimum);
+        double newMaximum = std::max(histogramMinimum + histogram.size(), other.histogramMinimum + other.histogram.size());
+        std::vector<uint64_t> merged(static_cast<size_t>(newMaximum - newMinimum), 0);
+        size_t shift = static_cast<size_t>(histogramMinimum - newMinimum);
+        for (size_t b = 0; b < histogram.size(); b++)
+            merged[b + shift] += histogram[b];
+        shift = static_cast<size_t>(other.histogramMinimum - newMinimum);
+        for (size_t b = 0; b < other.histogram.size(); b++)
+            merged[b + shift] += other.histogram[b];
+        histogram.swap(merged);
+        histogramMinimum = newMinimum;
+    } else {
+        histogram.clear();
+        histogramExact = false;
+    }//_if
+
+    //Chan et al. pairwise update
+    uint64_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+    count = total;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+}
+
+void CemrgImageStatistics::Clear() {
+
+    count = 0;
+    mean = 0;
+    m2 = 0;
+    minimum = std::numeric_limits<double>::max();
+    maximum = std::numeric_limits<double>::lowest();
+    histogram.clear();
+    histogramMinimum = 0;
+    binWidth = 1;
+    histogramExact = false;
+}
+
+template <typename TPixel, typename TMask>
+bool CemrgImageStatistics::Accumulate(const TPixel* image, const TMask* mask, size_t numVoxels, int maskLabel) {
+
+    if (image == nullptr || numVoxels == 0)
+        return false;
+
+    //Welford within each block, blocks merged in order
+    const size_t numBlocks = (numVoxels + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<Moments> blocks(numBlocks);
+    RunParallel(numberOfThreads, numBlocks, [&](int, size_t b) {
+        Moments& m = blocks[b];
+        const size_t last = std::min(numVoxels, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < last; i++) {
+            if (!Counted(image, mask, i, maskLabel))
+                continue;
+            double value = image[i];
+            m.count++;
+            double delta = value - m.mean;
+            m.mean += delta / m.count;
+            m.m2 += delta * (value - m.mean);
+            if (value < m.minimum) m.minimum = value;
+            if (value > m.maximum) m.maximum = value;
+            if (m.integral && value != std::floor(value)) m.integral = false;
+        }//_for
+    });
+
+    CemrgImageStatistics batch;
+    bool integral = true;
+    for (const Moments& m : blocks) {
+        if (m.count == 0)
+            continue;
+        CemrgImageStatistics block;
+        block.count = m.count;
+        block.mean = m.mean;
+        block.m2 = m.m2;
+        block.minimum = m.minimum;
+        block.maximum = m.maximum;
+        batch.Merge(block);
+        integral = integral && m.integral;
+    }//_for
+    if (batch.count == 0)
+        return false;
+
+    if (histogramOn) {
+        //Second pass over the same blocks, now that the range is known
+        double range = batch.maximum - batch.minimum;
+        batch.histogramMinimum = batch.minimum;
+        if (integral && range + 1 <= maxBins) {
+            batch.histogramExact = true;
+            batch.binWidth = 1;
+            batch.histogram.assign(static_cast<size_t>(range) + 1, 0);
+        } else {
+            batch.histogramExact = false;
+            batch.binWidth = (range > 0) ? range / maxBins : 1;
+            batch.histogram.assign((range > 0) ? maxBins : 1, 0);
+        }//_if
+
+        const size_t numBins = batch.histogram.size();
+        const double binMinimum = batch.histogramMinimum, width = batch.binWidth;
+        std::vector<std::vector<uint64_t>> partial(NumberOfWorkers(numberOfThreads, numBlocks), std::vector<uint64_t>(numBins, 0));
+        RunParallel(numberOfThreads, numBlocks, [&](int t, size_t b) {
+            std::vector<uint64_t>& bins = partial[t];
+            const size_t last = std::min(numVoxels, (b + 1) * BLOCK_SIZE);
+            for (size_t i = b * BLOCK_SIZE; i < last; i++) {
+                if (!Counted(image, mask, i, maskLabel))
+                    continue;
+                size_t bin = static_cast<size_t>((image[i] - binMinimum) / width);
+                bins[std::min(bin, numBins - 1)]++;
+            }//_for
+        });
+        for (const std::vector<uint64_t>& bins : partial)
+            for (size_t k = 0; k < numBins; k++)
+                batch.histogram[k] += bins[k];
+    }//_if
+
+    Merge(batch);
+    return true;
+}
+
+bool CemrgImageStatistics::AccumulateHistogram(const std::vector<uint64_t>& counts, double firstValue) {
+
+    //Only the occupied range is kept
+    size_t first = 0, last = counts.size();
+    while (first < last && counts[first] == 0)
+        first++;
+    while (last > first && counts[last - 1] == 0)
+        last--;
+    if (first == last)
+        return false;
+
+    CemrgImageStatistics batch;
+    double sum = 0;
+    for (size_t k = first; k < last; k++) {
+        batch.count += counts[k];
+        sum += counts[k] * (firstValue + k);
+    }//_for
+    batch.mean = sum / batch.count;
+    for (size_t k = first; k < last; k++) {
+        double delta = (firstValue + k) - batch.mean;
+        batch.m2 += counts[k] * delta * delta;
+    }//_for
+    batch.minimum = firstValue + first;
+    batch.maximum = firstValue + last - 1;
+    batch.histogram.assign(counts.begin() + first, counts.begin() + last);
+    batch.histogramMinimum = batch.minimum;
+    batch.binWidth = 1;
+    batch.histogramExact = true;
+
+    Merge(batch);
+    return true;
+}
+
+double CemrgImageStatistics::GetStandardDeviation() const {
+
+    return std::sqrt(GetVariance());
+}
+
+double CemrgImageStatistics::BinValue(size_t bin, uint64_t rankInBin) const {
+
+    if (histogramExact)
+        return histogramMinimum + bin;
+    //Values spread evenly inside the bin
+    return histogramMinimum + binWidth * (bin + (rankInBin + 0.5) / histogram[bin]);
+}
+
+double CemrgImageStatistics::GetValueAtRank(uint64_t rank) const {
+
+    if (histogram.empty() || count == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    rank = std::min(rank, count - 1);
+    uint64_t before = 0;
+    for (size_t b = 0; b < histogram.size(); b++) {
+        if (rank < before + histogram[b])
+            return BinValue(b, rank - before);
+        before += histogram[b];
+    }//_for
+    return maximum;
+}
+
+double CemrgImageStatistics::GetRankSum(uint64_t first, uint64_t last) const {
+
+    if (histogram.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+
+    last = std::min(last, count);
+    double sum = 0;
+    uint64_t before = 0;
+    for (size_t b = 0; b < histogram.size() && before < last; b++) {
+        uint64_t binCount = histogram[b];
+        uint64_t r0 = std::max(first, before), r1 = std::min(last, before + binCount);
+        if (r0 < r1) {
+            double k = r1 - r0;
+            if (histogramExact) {
+                sum += k * (histogramMinimum + b);
+            } else {
+                //Sum of BinValue over the ranks r0 - before ... r1 - before - 1
+                double rankSum = ((r0 - before) + (r1 - before - 1)) * k / 2.0;
+                sum += k * (histogramMinimum + binWidth * b) + binWidth * (rankSum + 0.5 * k) / binCount;
+            }//_if
+        }//_if
+        before += binCount;
+    }//_for
+    return sum;
+}
+
+double CemrgImageStatistics::GetPercentile(double percent) const {
+
+    if (histogram.empty() || count == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    double position = std::min(std::max(percent, 0.0), 100.0) / 100.0 * (count - 1);
+    uint64_t lo = static_cast<uint64_t>(std::floor(position));
+    uint64_t hi = static_cast<uint64_t>(std::ceil(position));
+    double vLo = GetValueAtRank(lo);
+    if (hi == lo)
+        return vLo;
+    return vLo + (position - lo) * (GetValueAtRank(hi) - vLo);
+}
+
+//Pixel and mask types of the LGE images and segmentations used in the module
+template bool CemrgImageStatistics::Accumulate<short, short>(const short*, const short*, size_t, int);
+template bool CemrgImageStatistics::Accumulate<short, unsigned char>(const short*, const unsigned char*, size_t, int);
+template bool CemrgImageStatistics::Accumulate<float, float>(const float*, const float*, size_t, int);
+template bool CemrgImageStatistics::Accumulate<float, unsigned char>(const float*, const unsigned char*, size_t, int);
+template bool CemrgImageStatistics::Accumulate<double, double>(const double*, const double*, size_t, int);
@@ -0,0 +1,156 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Static KD-Tree Point Search
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// C++ Standard
+#include <algorithm>
+#include <limits>
+#include "CemrgKdTree.h"
+
+namespace {
+    const vtkIdType LEAF_SIZE = 8;
+}
+
+CemrgKdTree::CemrgKdTree() {
+}
+
+void CemrgKdTree::Build(vtkPoints* points) {
+
+    Clear();
+    if (points == nullptr || points->GetNumberOfPoints() == 0)
+        return;
+
+    vtkIdType numPoints = points->GetNumberOfPoints();
+    coords.resize(3 * numPoints);
+    order.resize(numPoints);
+    for (vtkIdType i = 0; i < numPoints; i++) {
+        points->GetPoint(i, &coords[3 * i]);
+        order[i] = i;
+    }//_for
+
+    nodes.reserve(2 * (numPoints / LEAF_SIZE + 1));
+    BuildNode(0, numPoints);
+}
+
+void CemrgKdTree::Clear() {
+
+    coords.clear();
+    order.clear();
+    nodes.clear();
+}
+
+int CemrgKdTree::BuildNode(vtkIdType begin, vtkIdType end) {
+
+    int nodeId = nodes.size();
+    nodes.push_back(Node{begin, end, -1, -1, 0, 0.0});
+    if (end - begin <= LEAF_SIZE)
+        return nodeId;
+
+    //Split the widest axis at the median
+    double lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+        lo[a] = std::numeric_limits<double>::max();
+        hi[a] = std::numeric_limits<double>::lowest();
+    }
+    for (vtkIdType i = begin; i < end; i++) {
+        const double* p = GetPoint(order[i]);
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], p[a]);
+            hi[a] = std::max(hi[a], p[a]);
+        }
+    }//_for
+    int axis = 0;
+    for (int a = 1; a < 3; a++)
+        if (hi[a] - lo[a] > hi[axis] - lo[axis])
+            axis = a;
+
+    vtkIdType mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [this, axis](vtkIdType a, vtkIdType b) { return coords[3 * a + axis] < coords[3 * b + axis]; });
+
+    double split = coords[3 * order[mid] + axis];
+    int left = BuildNode(begin, mid);
+    int right = BuildNode(mid, end);
+    nodes[nodeId].axis = axis;
+    nodes[nodeId].split = split;
+    nodes[nodeId].left = left;
+    nodes[nodeId].right = right;
+    return nodeId;
+}
+
+vtkIdType CemrgKdTree::FindClosestPoint(const double x[3], double& dist2) const {
+
+    std::vector<std::pair<double, vtkIdType>> result;
+    FindClosestNPoints(1, x, result);
+    if (result.empty()) {
+        dist2 = std::numeric_limits<double>::max();
+        return -1;
+    }
+    dist2 = result[0].first;
+    return result[0].second;
+}
+
+void CemrgKdTree::FindClosestNPoints(int k, const double x[3], std::vector<std::pair<double, vtkIdType>>& result) const {
+
+    result.clear();
+    if (!IsBuilt() || k <= 0)
+        return;
+
+    //Max-heap on distance holding the best k so far
+    result.reserve(k + 1);
+    SearchNode(0, x, (size_t)k, result);
+    std::sort_heap(result.begin(), result.end());
+}
+
+void CemrgKdTree::SearchNode(int nodeId, const double x[3], size_t k, std::vector<std::pair<double, vtkIdType>>& heap) const {
+
+    const Node& node = nodes[nodeId];
+    if (node.left < 0) {
+        for (vtkIdType i = node.begin; i < node.end; i++) {
+            const double* p = GetPoint(order[i]);
+            double d0 = p[0] - x[0], d1 = p[1] - x[1], d2 = p[2] - x[2];
+            std::pair<double, vtkIdType> candidate(d0 * d0 + d1 * d1 + d2 * d2, order[i]);
+            if (heap.size() < k) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (candidate < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end());
+            }//_if
+        }//_for
+        return;
+    }//_if
+
+    //Nearer side first, the far side only if it can still hold a closer point
+    double diff = x[node.axis] - node.split;
+    int nearChild = (diff < 0) ? node.left : node.right;
+    int farChild = (diff < 0) ? node.right : node.left;
+    SearchNode(nearChild, x, k, heap);
+    if (heap.size() < k || diff * diff <= heap.front().first)
+        SearchNode(farChild, x, k, heap);
+}
@@ -0,0 +1,288 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * LGE Sampling Along Normals
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// ITK
+#include <itkBSplineDecompositionImageFilter.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include "CemrgLgeSampler.h"
+
+namespace {
+    const short CUT_LABEL = 3;
+
+    //Interpolation weights of the TAPS voxels around t in [0,1)
+    template <int TAPS>
+    void KernelWeights(double t, float* w);
+
+    template <>
+    void KernelWeights<2>(double t, float* w) {
+        w[0] = 1.0 - t;
+        w[1] = t;
+    }
+
+    template <>
+    void KernelWeights<4>(double t, float* w) {
+        double s = 1.0 - t;
+        w[0] = s * s * s / 6.0;
+        w[1] = (3.0 * t * t * t - 6.0 * t * t + 4.0) / 6.0;
+        w[2] = (-3.0 * t * t * t + 3.0 * t * t + 3.0 * t + 1.0) / 6.0;
+        w[3] = t * t * t / 6.0;
+    }
+
+    inline itk::OffsetValueType Clamp(itk::OffsetValueType v, itk::OffsetValueType size) {
+        return std::min(std::max(v, itk::OffsetValueType(0)), size - 1);
+    }
+}
+
+CemrgLgeSampler::CemrgLgeSampler() : kernel(NEAREST), buffer(nullptr), cutBuffer(nullptr) {
+
+    for (int d = 0; d < 3; d++)
+        size[d] = stride[d] = 0;
+}
+
+void CemrgLgeSampler::Build(const ImageType* image, const ImageType* cutImage) {
+
+    Clear();
+    if (image == nullptr)
+        return;
+
+    const ImageType::SizeType imageSize = image->GetBufferedRegion().GetSize();
+    const itk::OffsetValueType* offsetTable = image->GetOffsetTable();
+    for (int d = 0; d < 3; d++) {
+        size[d] = imageSize[d];
+        stride[d] = offsetTable[d];
+    }//_for
+    buffer = image->GetBufferPointer();
+
+    if (cutImage != nullptr) {
+        if (cutImage->GetBufferedRegion().GetSize() == imageSize) {
+            cutBuffer = cutImage->GetBufferPointer();
+        } else {
+            MITK_WARN << "Cut image does not share the LGE grid, cut regions are not filtered.";
+        }//_if
+    }//_if
+
+    if (kernel == BSPLINE) {
+        //Cubic B-spline coefficients, so the spline passes through the voxel values
+        typedef itk::BSplineDecompositionImageFilter<ImageType, itk::Image<float, 3>> DecompositionType;
+        DecompositionType::Pointer decomposition = DecompositionType::New();
+        decomposition->SetSplineOrder(3);
+        decomposition->SetInput(image);
+        decomposition->Update();
+        const float* coefficientBuffer = decomposition->GetOutput()->GetBufferPointer();
+        coefficients.assign(coefficientBuffer, coefficientBuffer + size[0] * size[1] * size[2]);
+    }//_if
+}
+
+void CemrgLgeSampler::Clear() {
+
+    buffer = nullptr;
+    cutBuffer = nullptr;
+    coefficients.clear();
+    for (int d = 0; d < 3; d++)
+        size[d] = stride[d] = 0;
+}
+
+bool CemrgLgeSampler::SampleAlongNormal(const double centre[3], const double direction[3], int minStep, int maxStep,
+    std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const {
+
+    values.clear();
+    offsets.clear();
+    if (!IsBuilt())
+        return true;
+
+    for (double i = minStep; i <= maxStep; i += 1) {
+        double p[3];
+        for (int d = 0; d < 3; d++)
+            p[d] = centre[d] + (i * direction[d]);
+
+        bool kept = true;
+        switch (kernel) {
+            case NEAREST:
+                kept = SampleNearest(p, values, offsets);
+                break;
+            case TRILINEAR:
+                kept = SampleInterpolated<2>(buffer, p, values, offsets);
+                break;
+            case BSPLINE:
+                kept = coefficients.empty() ? SampleInterpolated<2>(buffer, p, values, offsets) : SampleInterpolated<4>(coefficients.data(), p, values, offsets);
+                break;
+        }//_switch
+        if (!kept)
+            return false;
+    }//_for
+
+    return true;
+}
+
+bool CemrgLgeSampler::SampleNearest(const double* p, std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const {
+
+    const itk::OffsetValueType x = std::floor(p[0]);
+    const itk::OffsetValueType y = std::floor(p[1]);
+    const itk::OffsetValueType z = std::floor(p[2]);
+
+    //Same visiting order as the ITK index loop it replaces (z fastest)
+    for (int a = -1; a <= 1; a++) {
+        if (x + a < 0 || x + a >= size[0])
+            continue;
+        for (int b = -1; b <= 1; b++) {
+            if (y + b < 0 || y + b >= size[1])
+                continue;
+            const itk::OffsetValueType rowOffset = (x + a) * stride[0] + (y + b) * stride[1];
+            for (int c = -1; c <= 1; c++) {
+                if (z + c < 0 || z + c >= size[2])
+                    continue;
+                const itk::OffsetValueType offset = rowOffset + (z + c) * stride[2];
+                if (cutBuffer != nullptr && cutBuffer[offset] == CUT_LABEL)
+                    return false;
+                values.push_back(buffer[offset]);
+                offsets.push_back(offset);
+            }//_for
+        }//_for
+    }//_for
+
+    return true;
+}
+
+template <int TAPS, typename TPixel>
+bool CemrgLgeSampler::SampleInterpolated(const TPixel* source, const double* p, std::vector<float>& values, std::vector<itk::OffsetValueType>& offsets) const {
+
+    //The 27 samples sit one voxel apart, so they share their weights and a BxBxB block of voxels
+    const int B = TAPS + 2;
+    float w[3][TAPS];
+    itk::OffsetValueType first[3];
+    bool inside = true;
+    for (int d = 0; d < 3; d++) {
+        double fl = std::floor(p[d]);
+        KernelWeights<TAPS>(p[d] - fl, w[d]);
+        first[d] = static_cast<itk::OffsetValueType>(fl) - TAPS / 2;
+        inside = inside && first[d] >= 0 && first[d] + B <= size[d];
+    }//_for
+
+    //Block in x-fastest order, borders replicated
+    float block[B * B * B];
+    for (int k = 0; k < B; k++) {
+        for (int j = 0; j < B; j++) {
+            float* row = block + (k * B + j) * B;
+            if (inside) {
+                const TPixel* src = source + (first[2] + k) * stride[2] + (first[1] + j) * stride[1] + first[0] * stride[0];
+                for (int i = 0; i < B; i++)
+                    row[i] = src[i * stride[0]];
+            } else {
+                const itk::OffsetValueType rowOffset = Clamp(first[2] + k, size[2]) * stride[2] + Clamp(first[1] + j, size[1]) * stride[1];
+                for (int i = 0; i < B; i++)
+                    row[i] = source[rowOffset + Clamp(first[0] + i, size[0]) * stride[0]];
+            }//_if
+        }//_for
+    }//_for
+
+    //Separable filtering, one axis at a time on contiguous data
+    float alongX[B * B * 3];
+    for (int kj = 0; kj < B * B; kj++) {
+        for (int a = 0; a < 3; a++) {
+            float sum = 0;
+            for (int t = 0; t < TAPS; t++)
+                sum += w[0][t] * block[kj * B + a + t];
+            alongX[kj * 3 + a] = sum;
+        }//_for
+    }//_for
+
+    float alongY[B * 3 * 3];
+    for (int k = 0; k < B; k++) {
+        for (int b = 0; b < 3; b++) {
+            for (int a = 0; a < 3; a++) {
+                float sum = 0;
+                for (int t = 0; t < TAPS; t++)
+                    sum += w[1][t] * alongX[(k * B + b + t) * 3 + a];
+                alongY[(k * 3 + b) * 3 + a] = sum;
+            }//_for
+        }//_for
+    }//_for
+
+    float samples[27];
+    for (int c = 0; c < 3; c++) {
+        for (int ba = 0; ba < 9; ba++) {
+            float sum = 0;
+            for (int t = 0; t < TAPS; t++)
+                sum += w[2][t] * alongY[(c + t) * 9 + ba];
+            samples[c * 9 + ba] = sum;
+        }//_for
+    }//_for
+
+    //Report each sample with its closest voxel, in the order of the nearest kernel
+    const itk::OffsetValueType x = std::floor(p[0] + 0.5);
+    const itk::OffsetValueType y = std::floor(p[1] + 0.5);
+    const itk::OffsetValueType z = std::floor(p[2] + 0.5);
+    for (int a = -1; a <= 1; a++) {
+        if (x + a < 0 || x + a >= size[0])
+            continue;
+        for (int b = -1; b <= 1; b++) {
+            if (y + b < 0 || y + b >= size[1])
+                continue;
+            for (int c = -1; c <= 1; c++) {
+                if (z + c < 0 || z + c >= size[2])
+                    continue;
+                const itk::OffsetValueType offset = (x + a) * stride[0] + (y + b) * stride[1] + (z + c) * stride[2];
+                if (cutBuffer != nullptr && cutBuffer[offset] == CUT_LABEL)
+                    return false;
+                values.push_back(samples[((c + 1) * 3 + (b + 1)) * 3 + (a + 1)]);
+                offsets.push_back(offset);
+            }//_for
+        }//_for
+    }//_for
+
+    return true;
+}
+
+CemrgLgeSampler::Kernel CemrgLgeSampler::KernelFromName(std::string name, bool* ok) {
+
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (ok != nullptr)
+        *ok = true;
+    if (name == "trilinear" || name == "linear")
+        return TRILINEAR;
+    if (name == "bspline" || name == "cubic")
+        return BSPLINE;
+    if (ok != nullptr)
+        *ok = (name == "nearest");
+    return NEAREST;
+}
+
+std::string CemrgLgeSampler::KernelName(Kernel k) {
+
+    switch (k) {
+        case TRILINEAR: return "trilinear";
+        case BSPLINE: return "bspline";
+        default: return "nearest";
+    }//_switch
+}
@@ -0,0 +1,195 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * LV Scar Segmentation Thresholds
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include "CemrgLvScarSegmentation.h"
+
+namespace {
+    const short SCAR_LABEL = 256;
+    const int SHORT_OFFSET = 32768;
+    const size_t SHORT_BINS = 65536;
+
+    struct Slab {
+        std::vector<uint64_t> wallHistogram, remoteHistogram;
+        std::vector<itk::SizeValueType> wallOffsets;
+        std::vector<short> wallValues;
+    };
+}
+
+CemrgLvScarSegmentation::CemrgLvScarSegmentation() : numberOfThreads(0) {
+
+    Clear();
+}
+
+bool CemrgLvScarSegmentation::Build(const ImageType* image, const ImageType* wall, const ImageType* remote) {
+
+    Clear();
+    if (image == nullptr || wall == nullptr)
+        return false;
+
+    const ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    if (wall->GetBufferedRegion().GetSize() != size || (remote != nullptr && remote->GetBufferedRegion().GetSize() != size)) {
+        MITK_WARN << "LV scar segmentation: the image and the segmentations do not share the same grid.";
+        return false;
+    }//_if
+
+    numVoxels = image->GetBufferedRegion().GetNumberOfPixels();
+    const short* pvImage = image->GetBufferPointer();
+    const short* pvWall = wall->GetBufferPointer();
+    const short* pvRemote = (remote != nullptr) ? remote->GetBufferPointer() : nullptr;
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = (int)std::min<itk::SizeValueType>(nThreads, std::max<itk::SizeValueType>(1, numVoxels / (1 << 16)));
+
+    //One pass: contiguous slabs, each with its own histograms and wall voxels
+    std::vector<Slab> slabs(nThreads);
+    auto scanSlab = [&](int t) {
+        Slab& slab = slabs[t];
+        slab.wallHistogram.assign(SHORT_BINS, 0);
+        if (pvRemote != nullptr)
+            slab.remoteHistogram.assign(SHORT_BINS, 0);
+        const itk::SizeValueType first = numVoxels * t / nThreads, last = numVoxels * (t + 1) / nThreads;
+        for (itk::SizeValueType i = first; i < last; i++) {
+            const short value = pvImage[i];
+            if (pvWall[i] != 0 && value != 0) {
+                slab.wallHistogram[value + SHORT_OFFSET]++;
+                slab.wallOffsets.push_back(i);
+                slab.wallValues.push_back(value);
+            }//_if
+            if (pvRemote != nullptr && pvRemote[i] != 0)
+                slab.remoteHistogram[value + SHORT_OFFSET]++;
+        }//_for
+    };
+
+    if (nThreads == 1) {
+        scanSlab(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(scanSlab, t));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }//_if
+
+    //Slabs are in buffer order, so the wall voxels stay sorted
+    std::vector<uint64_t> wallHistogram(SHORT_BINS, 0), remoteHistogram(SHORT_BINS, 0);
+    for (Slab& slab : slabs) {
+        for (size_t k = 0; k < SHORT_BINS; k++) {
+            wallHistogram[k] += slab.wallHistogram[k];
+            if (pvRemote != nullptr)
+                remoteHistogram[k] += slab.remoteHistogram[k];
+        }//_for
+        wallOffsets.insert(wallOffsets.end(), slab.wallOffsets.begin(), slab.wallOffsets.end());
+        wallValues.insert(wallValues.end(), slab.wallValues.begin(), slab.wallValues.end());
+    }//_for
+
+    if (!wallStats.AccumulateHistogram(wallHistogram, -SHORT_OFFSET)) {
+        MITK_WARN << "LV scar segmentation: the wall segmentation has no voxel with a non-zero intensity.";
+        Clear();
+        return false;
+    }//_if
+    //An empty remote region is allowed, HasRemote is false then
+    if (pvRemote != nullptr)
+        remoteStats.AccumulateHistogram(remoteHistogram, -SHORT_OFFSET);
+
+    built = true;
+    return true;
+}
+
+void CemrgLvScarSegmentation::Clear() {
+
+    built = false;
+    numVoxels = 0;
+    wallOffsets.clear();
+    wallValues.clear();
+    wallStats.Clear();
+    remoteStats.Clear();
+}
+
+double CemrgLvScarSegmentation::GetFWHMThreshold() const {
+
+    //Average of the top of the sorted wall intensities, same window as the sorted array it replaces
+    uint64_t m = wallStats.GetCount();
+    if (m == 0)
+        return 0;
+    uint64_t start = m * 0.998;
+    double peak = wallStats.GetRankSum(start > 0 ? start - 1 : 0, m) / (m - start);
+    return 0.5 * peak;
+}
+
+double CemrgLvScarSegmentation::GetSDThreshold(double n) const {
+
+    if (!HasRemote())
+        return std::numeric_limits<double>::quiet_NaN();
+    return remoteStats.GetMean() + n * remoteStats.GetStandardDeviation();
+}
+
+bool CemrgLvScarSegmentation::IsInRange(double threshold) const {
+
+    return wallStats.GetCount() > 0 && wallStats.GetMaximum() > threshold;
+}
+
+void CemrgLvScarSegmentation::WriteMask(ImageType* output, double threshold) const {
+
+    if (!built || output == nullptr || output->GetBufferedRegion().GetNumberOfPixels() != numVoxels)
+        return;
+
+    short* pvOutput = output->GetBufferPointer();
+    std::memset(pvOutput, 0, numVoxels * sizeof(short));
+    for (size_t i = 0; i < wallOffsets.size(); i++)
+        if (wallValues[i] >= threshold)
+            pvOutput[wallOffsets[i]] = SCAR_LABEL;
+}
+
+void CemrgLvScarSegmentation::WriteLabels(ImageType* output, std::vector<double> thresholds) const {
+
+    if (!built || output == nullptr || output->GetBufferedRegion().GetNumberOfPixels() != numVoxels)
+        return;
+
+    std::sort(thresholds.begin(), thresholds.end());
+    short* pvOutput = output->GetBufferPointer();
+    std::memset(pvOutput, 0, numVoxels * sizeof(short));
+
+    //Only the wall voxels are visited
+    for (size_t i = 0; i < wallOffsets.size(); i++) {
+        const short value = wallValues[i];
+        short label = 0;
+        while (label < (short)thresholds.size() && value >= thresholds[label])
+            label++;
+        pvOutput[wallOffsets[i]] = label;
+    }//_for
+}
@@ -29,16 +29,131 @@ PURPOSE.  See the above copyright notices for more information.
 
 // VTK
 #include <vtkPolyData.h>
+#include <vtkCellArray.h>
 #include <vtkMath.h>
 #include <vtkIdList.h>
-#include <vtkMassProperties.h>
+#include <vtkSmartPointer.h>
+
+// ITK
+#include <vnl/vnl_matrix.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
 
 // Qmitk
 #include <mitkIOUtil.h>
 
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
 // Qt
 #include "CemrgMeasure.h"
 
+namespace {
+
+//Neumaier summation, so the totals do not depend on how the triangles are split between threads
+struct CompensatedSum {
+
+    double sum = 0, compensation = 0;
+
+    inline void Add(double value) {
+        double t = sum + value;
+        compensation += (std::fabs(sum) >= std::fabs(value)) ? (sum - t) + value : (value - t) + sum;
+        sum = t;
+    }
+    inline void Add(const CompensatedSum& other) { Add(other.sum); Add(other.compensation); }
+    inline double Get() const { return sum + compensation; }
+};
+
+//Per chunk sums of the first pass: areas, vtkMassProperties volume terms and centroid
+struct AreaSums {
+    CompensatedSum heronArea, crossArea, kxyz[3], centroid[3];
+    vtkIdType munc[3] = {0, 0, 0};
+    vtkIdType wxyz = 0, wxy = 0, wxz = 0, wyz = 0;
+};
+
+//Per chunk sums of the second and third passes
+struct RadiusSums {
+    CompensatedSum radius, deviation, covariance[6]; // xx, yy, zz, xy, xz, yz
+    double maxEllipsoidNorm = 0;
+};
+
+//function(t, first, last) on contiguous chunks of [0, count)
+template <typename TFunction>
+void RunChunks(int nThreads, vtkIdType count, TFunction function) {
+    if (nThreads == 1) {
+        function(0, 0, count);
+        return;
+    }//_if
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.push_back(std::thread(function, t, count * t / nThreads, count * (t + 1) / nThreads));
+    for (unsigned int t = 0; t < workers.size(); t++)
+        workers[t].join();
+}
+
+//Area of the triangle as in the original sphericity code
+inline double CrossArea(const double* p1, const double* p2, const double* p3) {
+    double p1_p2[3], p2_p3[3], crossProduct[3];
+    vtkMath::Subtract(p1, p2, p1_p2);
+    vtkMath::Subtract(p2, p3, p2_p3);
+    vtkMath::Cross(p1_p2, p2_p3, crossProduct);
+    return 0.5 * vtkMath::Norm(crossProduct);
+}
+
+inline void TriangleCentre(const double* tri, double centre[3]) {
+    for (int a = 0; a < 3; a++)
+        centre[a] = (tri[a] + tri[3 + a] + tri[6 + a]) / 3;
+}
+
+//Area and volume terms of one triangle, same arithmetic as vtkMassProperties
+void AddMassProperties(const double* tri, AreaSums& sums) {
+
+    const double* p0 = tri;
+    const double* p1 = tri + 3;
+    const double* p2 = tri + 6;
+    double i[3], j[3], k[3], u[3], absu[3];
+    i[0] = p1[0] - p0[0]; j[0] = p1[1] - p0[1]; k[0] = p1[2] - p0[2];
+    i[1] = p2[0] - p0[0]; j[1] = p2[1] - p0[1]; k[1] = p2[2] - p0[2];
+    i[2] = p2[0] - p1[0]; j[2] = p2[1] - p1[1]; k[2] = p2[2] - p1[2];
+
+    u[0] = j[0] * k[1] - k[0] * j[1];
+    u[1] = k[0] * i[1] - i[0] * k[1];
+    u[2] = i[0] * j[1] - j[0] * i[1];
+    double length = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for (int a = 0; a < 3; a++) {
+        u[a] = (length != 0.0) ? u[a] / length : 0.0;
+        absu[a] = std::fabs(u[a]);
+    }//_for
+
+    //Projection plane of the triangle
+    if ((absu[0] > absu[1]) && (absu[0] > absu[2])) sums.munc[0]++;
+    else if ((absu[1] > absu[0]) && (absu[1] > absu[2])) sums.munc[1]++;
+    else if ((absu[2] > absu[0]) && (absu[2] > absu[1])) sums.munc[2]++;
+    else if ((absu[0] == absu[1]) && (absu[0] == absu[2])) sums.wxyz++;
+    else if ((absu[0] == absu[1]) && (absu[0] > absu[2])) sums.wxy++;
+    else if ((absu[0] == absu[2]) && (absu[0] > absu[1])) sums.wxz++;
+    else if ((absu[1] == absu[2]) && (absu[0] < absu[2])) sums.wyz++;
+    else return;
+
+    //Heron's formula
+    double a = std::sqrt(i[1] * i[1] + j[1] * j[1] + k[1] * k[1]);
+    double b = std::sqrt(i[0] * i[0] + j[0] * j[0] + k[0] * k[0]);
+    double c = std::sqrt(i[2] * i[2] + j[2] * j[2] + k[2] * k[2]);
+    double s = 0.5 * (a + b + c);
+    double area = std::sqrt(std::fabs(s * (s - a) * (s - b) * (s - c)));
+    sums.heronArea.Add(area);
+
+    double avg[3];
+    for (int d = 0; d < 3; d++) {
+        avg[d] = (p0[d] + p1[d] + p2[d]) / 3.0;
+        sums.kxyz[d].Add(area * u[d] * avg[d]);
+    }//_for
+}
+
+} // namespace
+
 void CemrgMeasure::Convert(QString dir, mitk::DataNode::Pointer node) {
 
     mitk::BaseData::Pointer data = node->GetData();
@@ -172,46 +287,182 @@ mitk::Point3D CemrgMeasure::FindCentre(mitk::PointSet::Pointer pointset) {
     return centrePoint;
 }
 
-double CemrgMeasure::GetSphericity(vtkPolyData* LAC_poly) {
+CemrgMeasure::MeshGeometry CemrgMeasure::ComputeMeshGeometry(vtkPolyData* poly, int numberOfThreads) {
+
+    MeshGeometry geometry;
+    if (poly == nullptr || poly->GetPolys() == nullptr)
+        return geometry;
+
+    //Triangles packed once into contiguous coordinates, polygons as fans
+    std::vector<double> tris;
+    tris.reserve(9 * poly->GetPolys()->GetNumberOfCells());
+    vtkCellArray* polys = poly->GetPolys();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    double p[3][3];
+    polys->InitTraversal();
+    while (polys->GetNextCell(cellPoints)) {
+        vtkIdType numIds = cellPoints->GetNumberOfIds();
+        if (numIds < 3)
+            continue;
+        poly->GetPoint(cellPoints->GetId(0), p[0]);
+        poly->GetPoint(cellPoints->GetId(1), p[2]);
+        for (vtkIdType n = 2; n < numIds; n++) {
+            std::copy(p[2], p[2] + 3, p[1]);
+            poly->GetPoint(cellPoints->GetId(n), p[2]);
+            tris.insert(tris.end(), &p[0][0], &p[0][0] + 9);
+        }//_for
+    }//_while
+
+    const vtkIdType numTris = tris.size() / 9;
+    geometry.numberOfTriangles = numTris;
+    if (numTris == 0)
+        return geometry;
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = (int)std::min<vtkIdType>(nThreads, std::max<vtkIdType>(1, numTris / 16384));
+
+    //Area, volume and centroid
+    std::vector<AreaSums> areaSums(nThreads);
+    RunChunks(nThreads, numTris, [&](int t, vtkIdType first, vtkIdType last) {
+        AreaSums& sums = areaSums[t];
+        double centre[3];
+        for (const double* tri = tris.data() + 9 * first; tri < tris.data() + 9 * last; tri += 9) {
+            AddMassProperties(tri, sums);
+            double area = CrossArea(tri, tri + 3, tri + 6);
+            TriangleCentre(tri, centre);
+            sums.crossArea.Add(area);
+            for (int a = 0; a < 3; a++)
+                sums.centroid[a].Add(area * centre[a]);
+        }//_for
+    });
+    AreaSums areas;
+    for (const AreaSums& sums : areaSums) {
+        areas.heronArea.Add(sums.heronArea);
+        areas.crossArea.Add(sums.crossArea);
+        for (int a = 0; a < 3; a++) {
+            areas.kxyz[a].Add(sums.kxyz[a]);
+            areas.centroid[a].Add(sums.centroid[a]);
+            areas.munc[a] += sums.munc[a];
+        }//_for
+        areas.wxyz += sums.wxyz;
+        areas.wxy += sums.wxy;
+        areas.wxz += sums.wxz;
+        areas.wyz += sums.wyz;
+    }//_for
 
-    double LACA;
-    double LAC_mc[3];
-    double AR, sigma, Sphericity;
+    double kx = (areas.munc[0] + (areas.wxyz / 3.0) + ((areas.wxy + areas.wxz) / 2.0)) / numTris;
+    double ky = (areas.munc[1] + (areas.wxyz / 3.0) + ((areas.wxy + areas.wyz) / 2.0)) / numTris;
+    double kz = (areas.munc[2] + (areas.wxyz / 3.0) + ((areas.wxz + areas.wyz) / 2.0)) / numTris;
+    geometry.area = areas.heronArea.Get();
+    geometry.volume = std::fabs(areas.kxyz[0].Get() * kx + areas.kxyz[1].Get() * ky + areas.kxyz[2].Get() * kz);
+
+    const double totalArea = areas.crossArea.Get();
+    if (totalArea <= 0)
+        return geometry;
+    const double* c = geometry.centroid;
+    for (int a = 0; a < 3; a++)
+        geometry.centroid[a] = areas.centroid[a].Get() / totalArea;
+
+    //Average radius and second moments of the surface about the centroid
+    std::vector<RadiusSums> radiusSums(nThreads);
+    RunChunks(nThreads, numTris, [&](int t, vtkIdType first, vtkIdType last) {
+        RadiusSums& sums = radiusSums[t];
+        double centre[3], v[3][3], sum[3];
+        for (const double* tri = tris.data() + 9 * first; tri < tris.data() + 9 * last; tri += 9) {
+            double area = CrossArea(tri, tri + 3, tri + 6);
+            TriangleCentre(tri, centre);
+            sums.radius.Add(area * std::sqrt(vtkMath::Distance2BetweenPoints(c, centre)));
+            for (int a = 0; a < 3; a++) {
+                sum[a] = 0;
+                for (int n = 0; n < 3; n++) {
+                    v[n][a] = tri[3 * n + a] - c[a];
+                    sum[a] += v[n][a];
+                }//_for
+            }//_for
+            //Integral of x x^T over the triangle, area/12 (sum of v v^T + s s^T)
+            const int rows[6] = {0, 1, 2, 0, 0, 1}, cols[6] = {0, 1, 2, 1, 2, 2};
+            for (int e = 0; e < 6; e++) {
+                double m = sum[rows[e]] * sum[cols[e]];
+                for (int n = 0; n < 3; n++)
+                    m += v[n][rows[e]] * v[n][cols[e]];
+                sums.covariance[e].Add(area / 12.0 * m);
+            }//_for
+        }//_for
+    });
+    RadiusSums radii;
+    for (const RadiusSums& sums : radiusSums) {
+        radii.radius.Add(sums.radius);
+        for (int e = 0; e < 6; e++)
+            radii.covariance[e].Add(sums.covariance[e]);
+    }//_for
+    geometry.averageRadius = radii.radius.Get() / totalArea;
 
-    //containers for centre of mass, area, etc.
-    double** TiMC;
-    double* TiA;
+    vnl_matrix<double> covariance(3, 3);
+    const int rows[6] = {0, 1, 2, 0, 0, 1}, cols[6] = {0, 1, 2, 1, 2, 2};
+    for (int e = 0; e < 6; e++) {
+        covariance(rows[e], cols[e]) = radii.covariance[e].Get() / totalArea;
+        covariance(cols[e], rows[e]) = covariance(rows[e], cols[e]);
+    }//_for
+    vnl_symmetric_eigensystem<double> eigen(covariance);
+    double lambda[3];
+    const double trace = std::max(0.0, eigen.D(0, 0) + eigen.D(1, 1) + eigen.D(2, 2));
+    for (int k = 0; k < 3; k++) {
+        lambda[k] = std::max(eigen.D(k, k), 1e-12 * trace);
+        for (int a = 0; a < 3; a++)
+            geometry.ellipsoidAxes[k][a] = eigen.V(a, k);
+    }//_for
 
-    TiMC = new double*[LAC_poly->GetNumberOfCells()];
-    for (int i = 0; i < LAC_poly->GetNumberOfCells(); i++) {
-        TiMC[i] = new double[3];
-    }
+    //Deviation of the radius, and how far the ellipsoid of the moments must grow to hold every vertex
+    RunChunks(nThreads, numTris, [&](int t, vtkIdType first, vtkIdType last) {
+        RadiusSums& sums = radiusSums[t];
+        double centre[3];
+        for (const double* tri = tris.data() + 9 * first; tri < tris.data() + 9 * last; tri += 9) {
+            double area = CrossArea(tri, tri + 3, tri + 6);
+            TriangleCentre(tri, centre);
+            double r = std::sqrt(vtkMath::Distance2BetweenPoints(c, centre)) - geometry.averageRadius;
+            sums.deviation.Add(area * r * r);
+            if (trace == 0)
+                continue;
+            for (int n = 0; n < 3; n++) {
+                double norm = 0;
+                for (int k = 0; k < 3; k++) {
+                    double proj = 0;
+                    for (int a = 0; a < 3; a++)
+                        proj += (tri[3 * n + a] - c[a]) * geometry.ellipsoidAxes[k][a];
+                    norm += proj * proj / lambda[k];
+                }//_for
+                sums.maxEllipsoidNorm = std::max(sums.maxEllipsoidNorm, norm);
+            }//_for
+        }//_for
+    });
+    for (const RadiusSums& sums : radiusSums) {
+        radii.deviation.Add(sums.deviation);
+        radii.maxEllipsoidNorm = std::max(radii.maxEllipsoidNorm, sums.maxEllipsoidNorm);
+    }//_for
+
+    geometry.sigma = std::sqrt(radii.deviation.Get() / totalArea);
+    geometry.sphericity = 100 * (1 - geometry.sigma / geometry.averageRadius);
+    for (int k = 0; k < 3; k++)
+        geometry.ellipsoidRadii[k] = (trace == 0) ? 0 : std::sqrt(lambda[k] * radii.maxEllipsoidNorm);
 
-    TiA = new double[LAC_poly->GetNumberOfCells()];
+    return geometry;
+}
 
-    GetCentreOfMassOfEachT(LAC_poly, TiMC);
-    GetArea(LAC_poly, TiA, LACA);
-    GetCentreOfMass(TiMC, TiA, LAC_poly->GetNumberOfCells(), LACA, LAC_mc);
-    GetAverageRadius(TiMC, TiA, LAC_poly->GetNumberOfCells(), LAC_mc, LACA, AR);
-    LASphericity(TiMC, TiA, LAC_poly->GetNumberOfCells(), LAC_mc, LACA, AR, sigma, Sphericity);
+double CemrgMeasure::GetSphericity(vtkPolyData* LAC_poly) {
 
-    return Sphericity;
+    return ComputeMeshGeometry(LAC_poly).sphericity;
 }
 
 double CemrgMeasure::calcVolumeMesh(mitk::Surface::Pointer surface) {
 
-    vtkSmartPointer<vtkMassProperties> mass = vtkSmartPointer<vtkMassProperties>::New();
-    mass->SetInputData(surface->GetVtkPolyData());
-    mass->Update();
-    return mass->GetVolume();
+    return ComputeMeshGeometry(surface->GetVtkPolyData()).volume;
 }
 
 double CemrgMeasure::calcSurfaceMesh(mitk::Surface::Pointer surface) {
 
-    vtkSmartPointer<vtkMassProperties> mass = vtkSmartPointer<vtkMassProperties>::New();
-    mass->SetInputData(surface->GetVtkPolyData());
-    mass->Update();
-    return mass->GetSurfaceArea();
+    return ComputeMeshGeometry(surface->GetVtkPolyData()).area;
 }
 
 /********************************************
@@ -279,110 +530,3 @@ std::vector<std::string>& CemrgMeasure::Split(const std::string& str, std::vecto
         elements.push_back(item);
     return elements;
 }
-
-void CemrgMeasure::GetArea(vtkPolyData* polys, double* TiA, double& LACA) {
-
-    double p1[3], p2[3], p3[3];
-    double p1_p2[3];		// p1 minus p2
-    double p2_p3[3];		// p2 minus p3
-    double crossProduct[3];
-    LACA = 0;
-    vtkSmartPointer<vtkIdList> cell_points = vtkSmartPointer<vtkIdList>::New();
-
-    for (int i = 0; i < polys->GetNumberOfCells(); i++) {
-
-        //vtkIdType neighbor_point;
-        polys->GetCellPoints(i, cell_points);
-
-        // Get all three vertices
-        vtkIdType neighbor_point_id = cell_points->GetId(0);
-        polys->GetPoint(neighbor_point_id, p1);
-
-        neighbor_point_id = cell_points->GetId(1);
-        polys->GetPoint(neighbor_point_id, p2);
-
-        neighbor_point_id = cell_points->GetId(2);
-        polys->GetPoint(neighbor_point_id, p3);
-
-        vtkMath::Subtract(p1, p2, p1_p2);
-        vtkMath::Subtract(p2, p3, p2_p3);
-
-        vtkMath::Cross(p1_p2, p2_p3, crossProduct);
-        TiA[i] = 0.5 * vtkMath::Norm(crossProduct);
-        LACA += TiA[i];
-    }
-    cout << "Total area LACA = " << LACA << endl;
-}
-
-void CemrgMeasure::GetCentreOfMass(double** TiMC, double* TiA, int TiMC_size, double LACA, double* LAC_mc) {
-
-    LAC_mc[0] = 0; LAC_mc[1] = 0; LAC_mc[2] = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double contrib = TiA[i] / LACA;
-        LAC_mc[0] += (contrib)*TiMC[i][0];
-        LAC_mc[1] += (contrib)*TiMC[i][1];
-        LAC_mc[2] += (contrib)*TiMC[i][2];
-    }
-}
-
-void CemrgMeasure::GetCentreOfMassOfEachT(vtkPolyData* polys, double** TiMC) {
-
-    vtkSmartPointer<vtkIdList> cell_points = vtkSmartPointer<vtkIdList>::New();
-
-    for (int i = 0; i < polys->GetNumberOfCells(); i++) {
-        double cX = 0, cY = 0, cZ = 0;
-        int num_points = 0;
-        polys->GetCellPoints(i, cell_points);
-        vtkIdType num_cell_points = cell_points->GetNumberOfIds();
-
-        for (vtkIdType neighbor_point = 0; neighbor_point < num_cell_points; ++neighbor_point) {
-            double cP[3];
-            // Get the neighbour point id
-            vtkIdType neighbor_point_id = cell_points->GetId(neighbor_point);
-            // Get the neighbour point position
-            polys->GetPoint(neighbor_point_id, cP);
-            cX += cP[0]; cY += cP[1]; cZ += cP[2];
-            num_points++;
-        }
-        cX /= num_points;
-        cY /= num_points;
-        cZ /= num_points;
-        TiMC[i][0] = cX;
-        TiMC[i][1] = cY;
-        TiMC[i][2] = cZ;
-    }
-}
-
-void CemrgMeasure::GetAverageRadius(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double& AR) {
-
-    AR = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double a[3] = {LAC_mc[0], LAC_mc[1], LAC_mc[2]};
-        double b[3] = {TiMC[i][0], TiMC[i][1], TiMC[i][2]};
-        double a_minus_b[3];
-        vtkMath::Subtract(a, b, a_minus_b);
-        double contrib = TiA[i] / LACA;
-        AR += contrib * vtkMath::Norm(a_minus_b);
-    }
-}
-
-void CemrgMeasure::LASphericity(double** TiMC, double* TiA, double TiMC_size, double* LAC_mc, double LACA, double AR, double& sigma, double& Sphericity) {
-
-    double eps = 0;
-
-    for (int i = 0; i < TiMC_size; i++) {
-        double contrib = TiA[i] / LACA;
-        double a[3] = {LAC_mc[0], LAC_mc[1], LAC_mc[2]};
-        double b[3] = {TiMC[i][0], TiMC[i][1], TiMC[i][2]};
-        double a_minus_b[3];
-        vtkMath::Subtract(a, b, a_minus_b);
-        double phi = (vtkMath::Norm(a_minus_b) - AR) * (vtkMath::Norm(a_minus_b) - AR);
-        eps += contrib * phi;
-    }
-
-    sigma = sqrt(eps);
-    double CVS = sigma / AR;
-    Sphericity = 100 * (1 - CVS);
-}
\ No newline at end of file
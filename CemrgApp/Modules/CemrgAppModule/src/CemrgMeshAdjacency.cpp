@@ -0,0 +1,143 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Mesh Point Adjacency Tools
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// VTK
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+
+// C++ Standard
+#include <algorithm>
+
+// CemrgApp
+#include "CemrgMeshAdjacency.h"
+
+CemrgMeshAdjacency::CemrgMeshAdjacency() {
+
+    this->epoch = 0;
+}
+
+void CemrgMeshAdjacency::Build(vtkPolyData* mesh) {
+
+    Clear();
+    if (mesh == NULL)
+        return;
+
+    vtkIdType numPoints = mesh->GetNumberOfPoints();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    std::vector<std::pair<vtkIdType, vtkIdType>> edges;
+
+    //Collect both directions of every cell edge
+    for (vtkIdType i = 0; i < mesh->GetNumberOfCells(); i++) {
+        mesh->GetCellPoints(i, cellPoints);
+        vtkIdType npts = cellPoints->GetNumberOfIds();
+        int cellType = mesh->GetCellType(i);
+
+        if (cellType == VTK_VERTEX || cellType == VTK_POLY_VERTEX) {
+            continue;
+        } else if (cellType == VTK_TRIANGLE_STRIP) {
+            for (vtkIdType j = 0; j + 1 < npts; j++) {
+                edges.push_back(std::make_pair(cellPoints->GetId(j), cellPoints->GetId(j + 1)));
+                if (j + 2 < npts)
+                    edges.push_back(std::make_pair(cellPoints->GetId(j), cellPoints->GetId(j + 2)));
+            }//_for
+        } else if (cellType == VTK_LINE || cellType == VTK_POLY_LINE) {
+            //Open chain, the last point is not joined to the first
+            for (vtkIdType j = 0; j + 1 < npts; j++)
+                edges.push_back(std::make_pair(cellPoints->GetId(j), cellPoints->GetId(j + 1)));
+        } else if (npts >= 3) {
+            //Polygons (triangle, quad, polygon) close back to their first point
+            for (vtkIdType j = 0; j < npts; j++)
+                edges.push_back(std::make_pair(cellPoints->GetId(j), cellPoints->GetId((j + 1) % npts)));
+        }//_if
+    }//_for
+
+    std::size_t numEdges = edges.size();
+    for (std::size_t e = 0; e < numEdges; e++)
+        edges.push_back(std::make_pair(edges[e].second, edges[e].first));
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    //Compressed sparse rows
+    offsets.assign(numPoints + 1, 0);
+    neighbours.reserve(edges.size());
+    for (std::size_t e = 0; e < edges.size(); e++) {
+        if (edges[e].first == edges[e].second)
+            continue;
+        offsets[edges[e].first + 1]++;
+        neighbours.push_back(edges[e].second);
+    }//_for
+    for (vtkIdType i = 0; i < numPoints; i++)
+        offsets[i + 1] += offsets[i];
+
+    visitedEpoch.assign(numPoints, 0);
+    epoch = 0;
+}
+
+void CemrgMeshAdjacency::Clear() {
+
+    offsets.clear();
+    neighbours.clear();
+    visitedEpoch.clear();
+    frontier.clear();
+    epoch = 0;
+}
+
+void CemrgMeshAdjacency::KRing(vtkIdType seed, int maxOrder, std::vector<std::pair<int, int>>& pointNeighbourAndOrder) {
+
+    if (maxOrder <= 0 || seed < 0 || seed >= GetNumberOfPoints())
+        return;
+
+    //New epoch instead of clearing the visited stamps
+    if (++epoch == 0) {
+        std::fill(visitedEpoch.begin(), visitedEpoch.end(), 0);
+        epoch = 1;
+    }//_if
+
+    frontier.clear();
+    frontier.push_back(seed);
+    visitedEpoch[seed] = epoch;
+    pointNeighbourAndOrder.push_back(std::make_pair((int)seed, maxOrder));
+
+    //Breadth first, one ring per order
+    std::size_t ringStart = 0;
+    for (int order = maxOrder - 1; order > 0 && ringStart < frontier.size(); order--) {
+        std::size_t ringEnd = frontier.size();
+        for (std::size_t f = ringStart; f < ringEnd; f++) {
+            vtkIdType id = frontier[f];
+            for (vtkIdType n = offsets[id]; n < offsets[id + 1]; n++) {
+                vtkIdType nb = neighbours[n];
+                if (visitedEpoch[nb] == epoch)
+                    continue;
+                visitedEpoch[nb] = epoch;
+                frontier.push_back(nb);
+                pointNeighbourAndOrder.push_back(std::make_pair((int)nb, order));
+            }//_for
+        }//_for
+        ringStart = ringEnd;
+    }//_for
+}
@@ -0,0 +1,276 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Projection Geometry Cache
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkCellData.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkPolyDataReader.h>
+#include <vtkPolyDataWriter.h>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+// C++ Standard
+#include <cmath>
+#include "CemrgProjectionGeometry.h"
+
+namespace {
+    const quint32 FILE_MAGIC = 0x43505247; // CPRG
+    const quint32 FILE_VERSION = 1;
+}
+
+CemrgProjectionGeometry::CemrgProjectionGeometry() {
+
+    Clear();
+}
+
+void CemrgProjectionGeometry::Compute(vtkSmartPointer<vtkPolyData> mesh, const ImageType* image) {
+
+    Clear();
+    origin = image->GetOrigin();
+    spacing = image->GetSpacing();
+    direction = image->GetDirection();
+    size = image->GetLargestPossibleRegion().GetSize();
+
+    //Calculate normals
+    vtkSmartPointer<vtkPolyDataNormals> normalsFilter = vtkSmartPointer<vtkPolyDataNormals>::New();
+    vtkSmartPointer<vtkPolyData> tempPD = vtkSmartPointer<vtkPolyData>::New();
+    tempPD->DeepCopy(mesh);
+    normalsFilter->ComputeCellNormalsOn();
+    normalsFilter->SetInputData(tempPD);
+    normalsFilter->SplittingOff();
+    normalsFilter->Update();
+    polyData = normalsFilter->GetOutput();
+
+    //Declarations
+    vtkIdType numCells = polyData->GetNumberOfCells();
+    vtkIdType numPoints = polyData->GetNumberOfPoints();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkFloatArray> cellNormals = vtkFloatArray::SafeDownCast(polyData->GetCellData()->GetNormals());
+    ImageType::IndexType pixelXYZ;
+    ImageType::PointType pointXYZ;
+
+    //Each point is transformed once, not once per cell sharing it
+    std::vector<double> pointIndices(3 * numPoints);
+    for (vtkIdType i = 0; i < numPoints; i++) {
+        double cP[3];
+        polyData->GetPoint(i, cP);
+
+        // ITK method
+        pointXYZ[0] = cP[0];
+        pointXYZ[1] = cP[1];
+        pointXYZ[2] = cP[2];
+        image->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
+        pointIndices[3 * i + 0] = pixelXYZ[0];
+        pointIndices[3 * i + 1] = pixelXYZ[1];
+        pointIndices[3 * i + 2] = pixelXYZ[2];
+    }//_for
+
+    //Cell centres and normals in index space
+    centres.assign(3 * numCells, 0.0);
+    normals.assign(3 * numCells, 0.0);
+    for (vtkIdType i = 0; i < numCells; i++) {
+        double pN[3];
+        cellNormals->GetTuple(i, pN);
+        double cX = 0, cY = 0, cZ = 0;
+        polyData->GetCellPoints(i, cellPoints);
+        vtkIdType numCellPoints = cellPoints->GetNumberOfIds();
+
+        for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
+            const double* cP = &pointIndices[3 * cellPoints->GetId(neighborPoint)];
+            cX += cP[0];
+            cY += cP[1];
+            cZ += cP[2];
+        }//_innerLoop
+
+        centres[3 * i + 0] = cX / numCellPoints;
+        centres[3 * i + 1] = cY / numCellPoints;
+        centres[3 * i + 2] = cZ / numCellPoints;
+
+        // ITK method
+        pointXYZ[0] = pN[0];
+        pointXYZ[1] = pN[1];
+        pointXYZ[2] = pN[2];
+        image->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
+        normals[3 * i + 0] = pixelXYZ[0];
+        normals[3 * i + 1] = pixelXYZ[1];
+        normals[3 * i + 2] = pixelXYZ[2];
+    }//_for
+}
+
+void CemrgProjectionGeometry::Clear() {
+
+    polyData = nullptr;
+    centres.clear();
+    normals.clear();
+    meshHash.clear();
+    origin.Fill(0);
+    spacing.Fill(1);
+    direction.SetIdentity();
+    size.Fill(0);
+}
+
+bool CemrgProjectionGeometry::Matches(const ImageType* image) const {
+
+    return !IsEmpty() && SameGrid(image);
+}
+
+bool CemrgProjectionGeometry::SameGrid(const ImageType* image) const {
+
+    const double tolerance = 1E-6;
+    if (image == nullptr || image->GetLargestPossibleRegion().GetSize() != size)
+        return false;
+    for (int i = 0; i < 3; i++) {
+        if (std::abs(image->GetOrigin()[i] - origin[i]) > tolerance || std::abs(image->GetSpacing()[i] - spacing[i]) > tolerance)
+            return false;
+        for (int j = 0; j < 3; j++)
+            if (std::abs(image->GetDirection()[i][j] - direction[i][j]) > tolerance)
+                return false;
+    }//_for
+    return true;
+}
+
+bool CemrgProjectionGeometry::Save(QString path) const {
+
+    if (IsEmpty())
+        return false;
+
+    //The mesh with its normals, as a binary legacy VTK string
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(polyData);
+    writer->SetFileTypeToBinary();
+    writer->WriteToOutputStringOn();
+    writer->Write();
+    QByteArray mesh(writer->GetOutputString(), writer->GetOutputStringLength());
+
+    //Written to a temporary file and renamed, so readers never see half a cache
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << FILE_MAGIC << FILE_VERSION << meshHash;
+    for (int i = 0; i < 3; i++) {
+        out << (quint64)size[i] << origin[i] << spacing[i];
+        for (int j = 0; j < 3; j++)
+            out << direction[i][j];
+    }//_for
+    out << (quint64)centres.size();
+    for (size_t i = 0; i < centres.size(); i++)
+        out << centres[i] << normals[i];
+    out << mesh;
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool CemrgProjectionGeometry::Load(QString path, QByteArray expectedMeshHash, const ImageType* image) {
+
+    Clear();
+    QFile file(path);
+    if (expectedMeshHash.isEmpty() || image == nullptr || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    in >> magic >> version >> meshHash;
+    if (magic != FILE_MAGIC || version != FILE_VERSION || meshHash != expectedMeshHash) {
+        Clear();
+        return false;
+    }//_if
+
+    for (int i = 0; i < 3; i++) {
+        quint64 dim;
+        in >> dim >> origin[i] >> spacing[i];
+        size[i] = dim;
+        for (int j = 0; j < 3; j++)
+            in >> direction[i][j];
+    }//_for
+
+    //Header checked before the arrays are read
+    if (in.status() != QDataStream::Ok || !SameGrid(image)) {
+        Clear();
+        return false;
+    }//_if
+
+    quint64 numValues;
+    in >> numValues;
+    if (in.status() != QDataStream::Ok || numValues % 3 != 0 || numValues > (quint64)file.size()) {
+        Clear();
+        return false;
+    }//_if
+    centres.resize(numValues);
+    normals.resize(numValues);
+    for (quint64 i = 0; i < numValues; i++)
+        in >> centres[i] >> normals[i];
+
+    QByteArray mesh;
+    in >> mesh;
+    if (in.status() != QDataStream::Ok || mesh.isEmpty()) {
+        Clear();
+        return false;
+    }//_if
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->ReadFromInputStringOn();
+    reader->SetBinaryInputString(mesh.constData(), mesh.size());
+    reader->Update();
+    polyData = reader->GetOutput();
+    if ((quint64)polyData->GetNumberOfCells() * 3 != numValues || polyData->GetCellData()->GetNormals() == nullptr) {
+        MITK_WARN << ("Projection geometry " + path + " is corrupt, ignoring it.").toStdString();
+        Clear();
+        return false;
+    }//_if
+
+    return true;
+}
+
+QString CemrgProjectionGeometry::CachePath(QString meshPath) {
+
+    return meshPath + ".geometry";
+}
+
+QByteArray CemrgProjectionGeometry::HashFile(QString path) {
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    QCryptographicHash hasher(QCryptographicHash::Sha1);
+    if (!hasher.addData(&file))
+        return QByteArray();
+    return hasher.result().toHex();
+}
@@ -60,9 +60,14 @@ PURPOSE.  See the above copyright notices for more information.
 
 // C++ Standard
 #include <numeric>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cmath>
 
 // CemrgApp
 #include "CemrgCommonUtils.h"
+#include "CemrgImageStatistics.h"
 #include "CemrgScar3D.h"
 
 CemrgScar3D::CemrgScar3D() {
@@ -70,8 +75,12 @@ CemrgScar3D::CemrgScar3D() {
     this->methodType = 2;
     this->minStep = -3, this->maxStep = 3;
     this->minScalar = 1E10, this->maxScalar = -1;
+    this->numberOfThreads = 0;
+    this->samplingKernel = CemrgLgeSampler::NEAREST;
     this->voxelBasedProjection = false;
     this->debugging = false;
+    this->deterministic = true;
+    this->geometryCache = false;
     this->scalars = vtkSmartPointer<vtkFloatArray>::New();
 }
 
@@ -80,85 +89,91 @@ mitk::Surface::Pointer CemrgScar3D::Scar3D(std::string directory, mitk::Image::P
     //Convert to itk image
     itkImageType::Pointer scarImage;
     mitk::CastToItkImage(lgeImage, scarImage);
-    itkImageType::Pointer visitedImage = itkImageType::New();
-    ItkDeepCopy(scarImage, visitedImage);
 
-    //Read in the mesh
+    //Read in the mesh, or its saved geometry
     std::string path = directory + "/" + segname;
-    mitk::Surface::Pointer surface = CemrgCommonUtils::LoadVTKMesh(path);
-    vtkSmartPointer<vtkPolyData> pd = surface->GetVtkPolyData();
+    return Scar3D(GetProjectionGeometry(path, scarImage), scarImage);
+}
+
+CemrgProjectionGeometry CemrgScar3D::ComputeProjectionGeometry(mitk::Surface::Pointer surface, mitk::Image::Pointer lgeImage) {
+
+    itkImageType::Pointer scarImage;
+    mitk::CastToItkImage(lgeImage, scarImage);
+    CemrgProjectionGeometry geometry;
+    geometry.Compute(surface->GetVtkPolyData(), scarImage);
+    return geometry;
+}
+
+CemrgProjectionGeometry CemrgScar3D::GetProjectionGeometry(std::string meshPath, mitk::Image::Pointer lgeImage) {
+
+    itkImageType::Pointer scarImage;
+    mitk::CastToItkImage(lgeImage, scarImage);
+    return GetProjectionGeometry(meshPath, scarImage);
+}
+
+CemrgProjectionGeometry CemrgScar3D::GetProjectionGeometry(std::string meshPath, itkImageType::Pointer scarImage) {
+
+    QString path = QString::fromStdString(meshPath);
+    QString cachePath = CemrgProjectionGeometry::CachePath(path);
+    QByteArray meshHash = geometryCache ? CemrgProjectionGeometry::HashFile(path) : QByteArray();
+
+    CemrgProjectionGeometry geometry;
+    if (!meshHash.isEmpty() && geometry.Load(cachePath, meshHash, scarImage)) {
+        MITK_INFO(debugging) << "Projection geometry read from " << cachePath.toStdString();
+        return geometry;
+    }//_if
+
+    geometry.Compute(CemrgCommonUtils::LoadVTKMesh(meshPath)->GetVtkPolyData(), scarImage);
+    geometry.SetMeshHash(meshHash);
+    if (!meshHash.isEmpty()) {
+        MITK_WARN(!geometry.Save(cachePath)) << "Could not save the projection geometry to " << cachePath.toStdString();
+    }//_if
+    return geometry;
+}
 
-    //Calculate normals
-    vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
-    vtkSmartPointer<vtkPolyData> tempPD = vtkSmartPointer<vtkPolyData>::New();
-    tempPD->DeepCopy(pd);
-    normals->ComputeCellNormalsOn();
-    normals->SetInputData(tempPD);
-    normals->SplittingOff();
-    normals->Update();
-    pd = normals->GetOutput();
+mitk::Surface::Pointer CemrgScar3D::Scar3D(const CemrgProjectionGeometry& geometry, mitk::Image::Pointer lgeImage) {
+
+    //Convert to itk image
+    itkImageType::Pointer scarImage;
+    mitk::CastToItkImage(lgeImage, scarImage);
+    return Scar3D(geometry, scarImage);
+}
+
+mitk::Surface::Pointer CemrgScar3D::Scar3D(const CemrgProjectionGeometry& geometry, itkImageType::Pointer scarImage) {
+
+    if (!geometry.Matches(scarImage)) {
+        MITK_WARN << "LGE image is not on the grid of the projection geometry, recomputing it.";
+        CemrgProjectionGeometry regridded;
+        regridded.Compute(geometry.GetPolyData(), scarImage);
+        return Scar3D(regridded, scarImage);
+    }//_if
+
+    itkImageType::Pointer visitedImage = itkImageType::New();
+    ItkDeepCopy(scarImage, visitedImage);
+
+    //Each projection gets its own mesh and scalars, the geometry is left untouched
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->ShallowCopy(geometry.GetPolyData());
+    vtkIdType numCells = pd->GetNumberOfCells();
+    scalars = vtkSmartPointer<vtkFloatArray>::New();
+    minScalar = 1E10, maxScalar = -1;
 
     //Declarations
-    vtkIdType numCellPoints;
-    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
-    vtkSmartPointer<vtkFloatArray> cellNormals = vtkFloatArray::SafeDownCast(pd->GetCellData()->GetNormals());
     std::vector<double> allScalarsInShell;
     vtkSmartPointer<vtkFloatArray> scalarsOnlyStDev = vtkSmartPointer<vtkFloatArray>::New();
     vtkSmartPointer<vtkFloatArray> scalarsOnlyMultiplier = vtkSmartPointer<vtkFloatArray>::New();
     vtkSmartPointer<vtkFloatArray> scalarsOnlyIntensity = vtkSmartPointer<vtkFloatArray>::New();
-    itkImageType::IndexType pixelXYZ;
-    itkImageType::PointType pointXYZ;
+
+    //Sample the LGE along each normal
+    std::vector<double> cellScalars(numCells, 0.0);
+    ProjectAlongNormals(scarImage, visitedImage, geometry.GetCentres(), geometry.GetNormals(), cellScalars);
 
     double maxSdev = -1e9;
     double maxSratio = -1e9;
     double mean = 0, var = 1;
 
-    for (int i = 0; i < pd->GetNumberOfCells(); i++) {
-        double pN[3];
-        cellNormals->GetTuple(i, pN);
-        double cX = 0, cY = 0, cZ = 0, numPoints = 0;
-        pd->GetCellPoints(i, cellPoints);
-        numCellPoints = cellPoints->GetNumberOfIds();
-
-        for (vtkIdType neighborPoint = 0; neighborPoint < numCellPoints; ++neighborPoint) {
-
-            //Get the neighbor point ID
-            vtkIdType neighborPointID = cellPoints->GetId(neighborPoint);
-
-            //Get the neighbor point position
-            double cP[3];
-            pd->GetPoint(neighborPointID, cP);
-
-            // ITK method
-            pointXYZ[0] = cP[0];
-            pointXYZ[1] = cP[1];
-            pointXYZ[2] = cP[2];
-            scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-            cP[0] = pixelXYZ[0];
-            cP[1] = pixelXYZ[1];
-            cP[2] = pixelXYZ[2];
-
-            cX += cP[0];
-            cY += cP[1];
-            cZ += cP[2];
-
-            numPoints++;
-        }//_innerLoop
-
-        cX /= numPoints;
-        cY /= numPoints;
-        cZ /= numPoints;
-
-        // ITK method
-        pointXYZ[0] = pN[0];
-        pointXYZ[1] = pN[1];
-        pointXYZ[2] = pN[2];
-        scarImage->TransformPhysicalPointToIndex(pointXYZ, pixelXYZ);
-        pN[0] = pixelXYZ[0];
-        pN[1] = pixelXYZ[1];
-        pN[2] = pixelXYZ[2];
-
-        double scalar = GetIntensityAlongNormal(scarImage, visitedImage, pN[0], pN[1], pN[2], cX, cY, cZ);
+    for (vtkIdType i = 0; i < numCells; i++) {
+        double scalar = cellScalars[i];
 
         if (scalar > maxScalar) maxScalar = scalar;
         if (scalar < minScalar) minScalar = scalar;
@@ -213,6 +228,7 @@ mitk::Surface::Pointer CemrgScar3D::Scar3D(std::string directory, mitk::Image::P
 
     scarDebugLabel = visitedImage;
     pd->GetCellData()->SetScalars(scalars);
+    mitk::Surface::Pointer surface = mitk::Surface::New();
     surface->SetVtkPolyData(pd);
     return surface;
 }
@@ -286,22 +302,15 @@ bool CemrgScar3D::CalculateMeanStd(mitk::Image::Pointer lgeImage, mitk::Image::P
         return false;
     }//_wrong dimensions
 
-    //Loop image voxels
-    std::vector<float> voxelValues;
-    for (int i = 0; i < dimsROI; i++) {
-        if (*pvROI == 1)
-            voxelValues.push_back(*pvLGE);
-        pvLGE++;
-        pvROI++;
-    }//_for
-
-    //Calculate mean and std
-    double sumDeviation = 0.0;
-    double sum = std::accumulate(voxelValues.begin(), voxelValues.end(), 0.0);
-    mean = sum / voxelValues.size();
-    for (unsigned int i = 0; i < voxelValues.size(); i++)
-        sumDeviation += (voxelValues[i] - mean) * (voxelValues[i] - mean);
-    stdv = std::sqrt(sumDeviation / voxelValues.size());
+    //Stream the bloodpool voxels, mean and std in a single pass
+    CemrgImageStatistics stats;
+    stats.SetNumberOfThreads(numberOfThreads);
+    if (!stats.Accumulate(pvLGE, pvROI, dimsROI, 1)) {
+        MITK_WARN << "The mask has no voxels with a finite intensity, mean and std not computed.";
+        return false;
+    }//_empty mask
+    mean = stats.GetMean();
+    stdv = stats.GetStandardDeviation();
     return true;
 }
 
@@ -320,6 +329,43 @@ double CemrgScar3D::Thresholding(double thresh) {
     return percentage;
 }
 
+std::vector<double> CemrgScar3D::ThresholdingSweep(const std::vector<double>& thresholds) {
+
+    //Sort the scalars once, vein cells (-1) are left out as in Thresholding
+    std::vector<double> sortedScalars;
+    sortedScalars.reserve(scalars->GetNumberOfTuples());
+    vtkIdType ctr1 = 0, ctrNaN = 0;
+    for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); i++) {
+        double value = scalars->GetValue(i);
+        if (value == -1) {
+            ctr1++;
+            continue;
+        }//_if
+        if (std::isnan(value)) {
+            //Never above a threshold but still part of the total
+            ctrNaN++;
+            continue;
+        }//_if
+        sortedScalars.push_back(value);
+    }//_for
+    std::sort(sortedScalars.begin(), sortedScalars.end());
+
+    //Number of cells above each threshold from the sorted table
+    std::vector<double> percentages;
+    percentages.reserve(thresholds.size());
+    for (unsigned int ix = 0; ix < thresholds.size(); ix++) {
+        vtkIdType ctr2 = sortedScalars.end() - std::upper_bound(sortedScalars.begin(), sortedScalars.end(), thresholds.at(ix));
+        percentages.push_back((ctr2 * 100.0) / (scalars->GetNumberOfTuples() - ctr1));
+    }//_for
+
+    return percentages;
+}
+
+double CemrgScar3D::ThresholdValue(double value, int threshType, double mean, double stdv) {
+
+    return (threshType == 1) ? mean * value : mean + value * stdv;
+}
+
 void CemrgScar3D::SaveNormalisedScalars(double divisor, mitk::Surface::Pointer surface, QString name) {
 
     MITK_INFO << "Dividing by the mean value of the bloodpool.";
@@ -353,13 +399,20 @@ void CemrgScar3D::SaveNormalisedScalars(double divisor, mitk::Surface::Pointer s
 }
 
 void CemrgScar3D::PrintThresholdingResults(QString dir, std::vector<double> values_vector, int threshType, double mean, double stdv, bool printGuide) {
+    std::vector<double> thresholds;
+    for (unsigned int ix = 0; ix < values_vector.size(); ix++)
+        thresholds.push_back(ThresholdValue(values_vector.at(ix), threshType, mean, stdv));
+    PrintThresholdingResults(dir, values_vector, threshType, mean, stdv, ThresholdingSweep(thresholds), printGuide);
+}
+
+void CemrgScar3D::PrintThresholdingResults(QString dir, std::vector<double> values_vector, int threshType, double mean, double stdv, const std::vector<double>& percentages, bool printGuide) {
     QString prodPath = dir + "/";
     std::ofstream prodFile1;
     prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
     for (unsigned int ix = 0; ix < values_vector.size(); ix++) {
         double thisValue = values_vector.at(ix);
-        double thisThresh = (threshType == 1) ? mean * thisValue : mean + thisValue * stdv;
-        double thisPercentage = Thresholding(thisThresh);
+        double thisThresh = ThresholdValue(thisValue, threshType, mean, stdv);
+        double thisPercentage = percentages.at(ix);
         prodFile1 << thisValue << "\n";
         prodFile1 << threshType << "\n";
         prodFile1 << mean << "\n";
@@ -430,143 +483,179 @@ void CemrgScar3D::SetVoxelBasedProjection(bool value) {
     voxelBasedProjection = value;
 }
 
-double CemrgScar3D::GetIntensityAlongNormal(itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
-    double n_x, double n_y, double n_z, double centre_x, double centre_y, double centre_z) {
+void CemrgScar3D::SetNumberOfThreads(int value) {
+
+    numberOfThreads = value;
+}
+
+void CemrgScar3D::SetSamplingKernel(CemrgLgeSampler::Kernel value) {
+
+    samplingKernel = value;
+}
+
+void CemrgScar3D::ProjectAlongNormals(itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage,
+    const std::vector<double>& centres, const std::vector<double>& normals, std::vector<double>& values) {
+
+    const long numCells = values.size();
+    const itk::SizeValueType numVoxels = scarImage->GetLargestPossibleRegion().GetNumberOfPixels();
+    const bool maxProjection = (methodType == 2);
+    const bool claimWhileSampling = maxProjection && voxelBasedProjection && !deterministic;
+
+    //Visited voxels of the max projection, zero initialised
+    std::unique_ptr<std::atomic<unsigned char>[]> visited;
+    if (maxProjection)
+        visited.reset(new std::atomic<unsigned char>[numVoxels]());
+
+    //Voxel picked by the max projection of each cell (-1 if none)
+    std::vector<itk::OffsetValueType> maxOffsets(numCells, -1);
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = (int)std::min<long>(nThreads, std::max(1L, numCells));
+    MITK_INFO(debugging) << "Projecting " << numCells << " cells using " << nThreads << " thread(s), deterministic: " << deterministic
+        << ", kernel: " << CemrgLgeSampler::KernelName(samplingKernel);
+
+    //Reads the pixel buffers directly, shared read-only by all threads
+    CemrgLgeSampler sampler;
+    sampler.SetKernel(samplingKernel);
+    sampler.Build(scarImage.GetPointer(), scarSegImage.GetPointer());
+
+    const int samplesPerCell = 27 * (maxStep - minStep + 1);
+    auto sampleCells = [&](long first, long last) {
+        //Scratch buffers reused by all the cells of this thread
+        std::vector<float> samples;
+        std::vector<itk::OffsetValueType> offsets;
+        samples.reserve(samplesPerCell);
+        offsets.reserve(samplesPerCell);
+        for (long i = first; i < last; i++) {
+            values[i] = GetIntensityAlongNormal(sampler, claimWhileSampling ? visited.get() : nullptr,
+                &normals[3 * i], &centres[3 * i], samples, offsets, maxOffsets[i]);
+        }//_for
+    };
+
+    if (nThreads == 1) {
+        sampleCells(0, numCells);
+    } else {
+        std::vector<std::thread> workers;
+        long chunk = (numCells + nThreads - 1) / nThreads;
+        for (long first = 0; first < numCells; first += chunk)
+            workers.push_back(std::thread(sampleCells, first, std::min(numCells, first + chunk)));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }//_if
+
+    if (!maxProjection)
+        return;
+
+    if (!claimWhileSampling) {
+        //Commit visited voxels in cell order, which gives the serial result.
+        //Only cells whose unconstrained maximum was already taken are resampled.
+        std::vector<float> samples;
+        std::vector<itk::OffsetValueType> offsets;
+        for (long i = 0; i < numCells; i++) {
+            if (maxOffsets[i] < 0)
+                continue;
+            if (!voxelBasedProjection || visited[maxOffsets[i]].load() < 1) {
+                visited[maxOffsets[i]].store(1);
+                continue;
+            }//_if
+            values[i] = GetIntensityAlongNormal(sampler, visited.get(), &normals[3 * i], &centres[3 * i], samples, offsets, maxOffsets[i]);
+        }//_for
+    }//_if
+
+    short* visitedBuffer = visitedImage->GetBufferPointer();
+    for (itk::SizeValueType v = 0; v < numVoxels; v++) {
+        if (visited[v].load() > 0)
+            visitedBuffer[v] = 1;
+    }//_for
+}
+
+double CemrgScar3D::GetIntensityAlongNormal(const CemrgLgeSampler& sampler, std::atomic<unsigned char>* visited,
+    const double* normal, const double* centre,
+    std::vector<float>& valuesOnAndAroundNormal, std::vector<itk::OffsetValueType>& offsetsOnAndAroundNormal, itk::OffsetValueType& maxOffset) {
 
     //Declarations
-    std::vector<mitk::Point3D> pointsOnAndAroundNormal;
+    maxOffset = -1;
 
     //Normalize
     double tempArr[3];
-    tempArr[0] = n_x;
-    tempArr[1] = n_y;
-    tempArr[2] = n_z;
+    tempArr[0] = normal[0];
+    tempArr[1] = normal[1];
+    tempArr[2] = normal[2];
     double norm = vtkMath::Normalize(tempArr);
-    n_x /= norm;
-    n_y /= norm;
-    n_z /= norm;
-
-    double scar_step_min = minStep;
-    double scar_step_max = maxStep;
-    double scar_step_size = 1;
-
-    const itkImageType::SizeType sizeOfImage = scarImage->GetLargestPossibleRegion().GetSize();
-    int maxX = sizeOfImage[0];
-    int maxY = sizeOfImage[1];
-    int maxZ = sizeOfImage[2];
-
-    for (double i = scar_step_min; i <= scar_step_max; i += scar_step_size) {
-        double x = floor(centre_x + (i * n_x));
-        double y = floor(centre_y + (i * n_y));
-        double z = floor(centre_z + (i * n_z));
-
-        for (int a = -1; a <= 1; a++) {
-            for (int b = -1; b <= 1; b++) {
-                for (int c = -1; c <= 1; c++) {
-                    if (x + a >= 0 && x + a < maxX && y + b >= 0 && y + b < maxY && z + c >= 0 && z + c < maxZ) {
-                        mitk::Point3D tempPoint;
-                        tempPoint.SetElement(0, x + a);
-                        tempPoint.SetElement(1, y + b);
-                        tempPoint.SetElement(2, z + c);
-                        pointsOnAndAroundNormal.push_back(tempPoint);
-                    }
-                }
-            }
-        }
-        //        a=0;b=0;c=0;
-        //        if (x+a>=0 && x+a<maxX && y+b>=0 && y+b<maxY && z+c>=0 && z+c<maxZ) {
-        //            mitk::Point3D tempPoint;
-        //            tempPoint.SetElement(0, x+a);
-        //            tempPoint.SetElement(1, y+b);
-        //            tempPoint.SetElement(2, z+c);
-        //            pointsOnAndAroundNormal.push_back(tempPoint);
-        //        }
-    }//_for
+    double direction[3] = {normal[0] / norm, normal[1] / norm, normal[2] / norm};
+
+    //Filter out cut regions
+    if (!sampler.SampleAlongNormal(centre, direction, minStep, maxStep, valuesOnAndAroundNormal, offsetsOnAndAroundNormal))
+        return -1;
 
     double insty = 0;
     if (methodType == 1) {
         //Statistical measure 1 returns mean
-        insty = GetStatisticalMeasure(pointsOnAndAroundNormal, scarImage, visitedImage, 1);
+        insty = GetStatisticalMeasure(valuesOnAndAroundNormal, offsetsOnAndAroundNormal, visited, 1, maxOffset);
     } else if (methodType == 2) {
         //Statistical measure 2 returns max
-        insty = GetStatisticalMeasure(pointsOnAndAroundNormal, scarImage, visitedImage, 2);
+        insty = GetStatisticalMeasure(valuesOnAndAroundNormal, offsetsOnAndAroundNormal, visited, 2, maxOffset);
     }//_if
 
     return insty;
 }
 
-double CemrgScar3D::GetStatisticalMeasure(std::vector<mitk::Point3D> pointsOnAndAroundNormal,
-    itkImageType::Pointer scarImage, itkImageType::Pointer visitedImage, int measure) {
+double CemrgScar3D::GetStatisticalMeasure(const std::vector<float>& valuesOnAndAroundNormal, const std::vector<itk::OffsetValueType>& offsetsOnAndAroundNormal,
+    std::atomic<unsigned char>* visited, int measure, itk::OffsetValueType& maxOffset) {
 
     //Declarations
-    itkImageType::IndexType pixel_xyz;
-    int size = pointsOnAndAroundNormal.size();
+    int size = valuesOnAndAroundNormal.size();
     double sum = 0, returnVal = 0;
 
-    //Filter out cut regions
-    for (int i = 0; i < size; i++) {
-        pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-        pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-        pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-        double val = scarSegImage->GetPixel(pixel_xyz);
-        if (std::abs(val - 3.0) < 1E-10)
-            return -1;
-    }//_for
-
     //Reutrn mean
     if (measure == 1) {
 
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            sum += scarImage->GetPixel(pixel_xyz);
-        }
+        for (int i = 0; i < size; i++)
+            sum += valuesOnAndAroundNormal[i];
         returnVal = sum / size;
     }//_if_mean
 
-    //Return max
+    //Return max, skipping visited voxels when a visited list is given
     if (measure == 2) {
-        double max = -1;
-        int maxIndex = 0;
-
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            double visitedStatus = visitedImage->GetPixel(pixel_xyz);
-            bool maxIntensity = greyVal > max;
-            if (voxelBasedProjection)
-                maxIntensity = (greyVal > max) && (visitedStatus < 1);
-            if (maxIntensity) {
-                max = greyVal;
-                maxIndex = i;
+        bool claimed = false;
+        while (!claimed) {
+            double max = -1;
+            int maxIndex = 0;
+
+            for (int i = 0; i < size; i++) {
+                double greyVal = valuesOnAndAroundNormal[i];
+                bool maxIntensity = greyVal > max;
+                if (visited != nullptr)
+                    maxIntensity = (greyVal > max) && (visited[offsetsOnAndAroundNormal[i]].load() < 1);
+                if (maxIntensity) {
+                    max = greyVal;
+                    maxIndex = i;
+                }
             }
-        }
 
-        if (max == -1) {
-            returnVal = 0;
-        } else {
+            if (max == -1) {
+                returnVal = 0;
+                break;
+            }//_if
+
             returnVal = max;
-            //Now change the visited status of this max pixel
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(maxIndex).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(maxIndex).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(maxIndex).GetElement(2);
-            visitedImage->SetPixel(pixel_xyz, 1);
-        }
+            maxOffset = offsetsOnAndAroundNormal[maxIndex];
+
+            //Now change the visited status of this max pixel, retry if another thread got it first
+            unsigned char notVisited = 0;
+            claimed = (visited == nullptr) || visited[maxOffset].compare_exchange_strong(notVisited, 1);
+            if (!claimed)
+                maxOffset = -1;
+        }//_while
     }//_if_max
 
     //Sum along the normal (integration)
     if (measure == 3) {
 
-        for (int i = 0; i < size; i++) {
-            pixel_xyz[0] = pointsOnAndAroundNormal.at(i).GetElement(0);
-            pixel_xyz[1] = pointsOnAndAroundNormal.at(i).GetElement(1);
-            pixel_xyz[2] = pointsOnAndAroundNormal.at(i).GetElement(2);
-            double greyVal = scarImage->GetPixel(pixel_xyz);
-            sum += greyVal;
-        }
+        for (int i = 0; i < size; i++)
+            sum += valuesOnAndAroundNormal[i];
         returnVal = sum;
     }//_if_sum
 
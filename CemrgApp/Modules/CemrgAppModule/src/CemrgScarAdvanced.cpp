@@ -52,6 +52,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkMassProperties.h>
 #include <vtkIdList.h>
 #include <vtkIdTypeArray.h>
+#include <vtkCellType.h>
 
 // ITK
 #include <itkPoint.h>
@@ -64,8 +65,11 @@ PURPOSE.  See the above copyright notices for more information.
 
 // C++ Standard
 #include <numeric>
+#include <algorithm>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <limits>
 
 
 #include "CemrgScarAdvanced.h"
@@ -94,6 +98,12 @@ CemrgScarAdvanced::CemrgScarAdvanced() {
     fi3_postScar = -1;
     fi3_overlapScar = -1;
     _debugScarAdvanced = false;
+    _adjacencyMTime = 0;
+    _transferMethod = TRANSFER_LOCATOR;
+    _transferNeighbours = 4;
+    _transferThreads = 0;
+    _transferCacheTree = true;
+    _transferTreeMTime = 0;
 }
 
 QString CemrgScarAdvanced::GetOutputSufix() {
@@ -550,7 +560,7 @@ int CemrgScarAdvanced::RecursivePointNeighbours(vtkIdType pointId, int order) {
             return 0;			// already visited, no need to look further down this route
         else {
             //vtkIdList* pointList = cell->GetPointIds();
-            vtkIdList* pointList = vtkIdList::New();
+            vtkSmartPointer<vtkIdList> pointList = vtkSmartPointer<vtkIdList>::New();
             // get all neighbouring points of this point
             GetConnectedVertices(_SourcePolyData, pointId, pointList);
 
@@ -576,18 +586,26 @@ bool CemrgScarAdvanced::InsertPointIntoVisitedList2(vtkIdType id, int order) {
 void CemrgScarAdvanced::GetNeighboursAroundPoint2(
     int pointID, std::vector<std::pair<int, int> >& pointNeighbourAndOrder, int max_order) {
 
-    _visited_point_list.clear();
-    RecursivePointNeighbours(pointID, max_order);
-
-    for (unsigned int i = 0; i < _visited_point_list.size(); i++) {
-        //pointNeighbours.push_back(_visited_point_list[i]);
-        pointNeighbourAndOrder.push_back(std::make_pair(_visited_point_list[i].first, _visited_point_list[i].second));
-    }
+    // breadth first k-ring on the cached adjacency, order = max_order - edge distance
+    UpdatePointAdjacency();
+    _adjacency.KRing(pointID, max_order, pointNeighbourAndOrder);
     MITK_INFO(IsDebug()) << ("[INFO] This point has (recursive order n = " +
         QString::number(max_order) + ") = " +
         QString::number(pointNeighbourAndOrder.size()) + " neighbours").toStdString();
 }
 
+void CemrgScarAdvanced::UpdatePointAdjacency() {
+
+    // rebuild only when the source mesh has changed since the last build
+    if (_adjacency.IsBuilt() && _adjacencyMTime == _SourcePolyData->GetMTime())
+        return;
+
+    _adjacency.Build(_SourcePolyData);
+    _adjacencyMTime = _SourcePolyData->GetMTime();
+    MITK_INFO(IsDebug()) << ("[INFO] Point adjacency built for " +
+        QString::number(_adjacency.GetNumberOfPoints()) + " points").toStdString();
+}
+
 void CemrgScarAdvanced::GetConnectedVertices(
     vtkSmartPointer<vtkPolyData> mesh, int seed, vtkSmartPointer<vtkIdList> connectedVertices) {
 
@@ -703,29 +721,77 @@ void CemrgScarAdvanced::TransformSource2Target() {
     vtkSmartPointer<vtkPolyData> Output_Poly = vtkSmartPointer<vtkPolyData>::New();
     Output_Poly->DeepCopy(_source);
 
-    vtkSmartPointer<vtkPointLocator> Target_Poly_PointLocator = vtkSmartPointer<vtkPointLocator>::New();
-    Target_Poly_PointLocator->SetDataSet(_target);
-    Target_Poly_PointLocator->AutomaticOn();
-    Target_Poly_PointLocator->BuildLocator();
-
-    vtkSmartPointer<vtkFloatArray> Target_Poly_Scalar = vtkFloatArray::SafeDownCast(_target->GetPointData()->GetScalars());
+    vtkIdType numSourcePoints = _source->GetNumberOfPoints();
     vtkSmartPointer<vtkFloatArray> Output_Poly_Scalar = vtkSmartPointer<vtkFloatArray>::New();
     Output_Poly_Scalar->SetNumberOfComponents(1);
+    Output_Poly_Scalar->SetNumberOfTuples(numSourcePoints);
 
-    double pStart[3];
     double _mapping_default_value = 0;
-    for (vtkIdType i = 0; i < _source->GetNumberOfPoints(); ++i) {
-        _source->GetPoint(i, pStart);
-        vtkIdType id_on_target = Target_Poly_PointLocator->FindClosestPoint(pStart);
+    vtkDataArray* Target_Poly_Scalar = _target->GetPointData()->GetScalars();
+    if (Target_Poly_Scalar == NULL || _target->GetNumberOfPoints() == 0) {
 
-        float mapped_value = 0;
-        if (id_on_target > 0) {
-            mapped_value = Target_Poly_Scalar->GetTuple1(id_on_target);
-        } else {
-            mapped_value = _mapping_default_value;
+        MITK_WARN << "[TransformSource2Target] Target mesh has no point scalars to transfer.";
+        Output_Poly_Scalar->FillComponent(0, _mapping_default_value);
+
+    } else if (_transferMethod == TRANSFER_LOCATOR) {
+
+        vtkSmartPointer<vtkPointLocator> Target_Poly_PointLocator = vtkSmartPointer<vtkPointLocator>::New();
+        Target_Poly_PointLocator->SetDataSet(_target);
+        Target_Poly_PointLocator->AutomaticOn();
+        Target_Poly_PointLocator->BuildLocator();
+
+        double pStart[3];
+        for (vtkIdType i = 0; i < numSourcePoints; ++i) {
+            _source->GetPoint(i, pStart);
+            vtkIdType id_on_target = Target_Poly_PointLocator->FindClosestPoint(pStart);
+
+            float mapped_value = 0;
+            if (id_on_target > 0) {
+                mapped_value = Target_Poly_Scalar->GetTuple1(id_on_target);
+            } else {
+                mapped_value = _mapping_default_value;
+            }
+            Output_Poly_Scalar->SetValue(i, mapped_value);
         }
-        Output_Poly_Scalar->InsertNextTuple1(mapped_value);
-    }
+
+    } else {
+
+        UpdateTransferTree();
+
+        // Plain copies: vtkDataArray tuple getters are not safe to share between threads
+        std::vector<double> targetValues(_target->GetNumberOfPoints());
+        for (vtkIdType i = 0; i < (vtkIdType)targetValues.size(); i++)
+            targetValues[i] = Target_Poly_Scalar->GetComponent(i, 0);
+        std::vector<double> sourcePoints(3 * numSourcePoints);
+        for (vtkIdType i = 0; i < numSourcePoints; i++)
+            _source->GetPoint(i, &sourcePoints[3 * i]);
+
+        int nThreads = _transferThreads;
+        if (nThreads <= 0)
+            nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        nThreads = (int)std::min<vtkIdType>(nThreads, std::max<vtkIdType>(1, numSourcePoints));
+
+        float* output = Output_Poly_Scalar->GetPointer(0);
+        auto transferPoints = [&](vtkIdType first, vtkIdType last) {
+            std::vector<std::pair<double, vtkIdType>> closest;
+            for (vtkIdType i = first; i < last; i++)
+                output[i] = TransferValue(&sourcePoints[3 * i], targetValues, closest);
+        };
+
+        vtkIdType chunk = (numSourcePoints + nThreads - 1) / nThreads;
+        std::vector<std::thread> workers;
+        for (int t = 1; t < nThreads; t++) {
+            vtkIdType first = t * chunk;
+            if (first < numSourcePoints)
+                workers.push_back(std::thread(transferPoints, first, std::min(numSourcePoints, first + chunk)));
+        }//_for
+        transferPoints(0, std::min(numSourcePoints, chunk));
+        for (auto& worker : workers)
+            worker.join();
+
+        MITK_INFO(IsDebug()) << ("[INFO] Transferred " + QString::number(numSourcePoints) + " values using " +
+            QString::number(nThreads) + " thread(s), method " + QString::number(_transferMethod)).toStdString();
+    }//_if
 
     Output_Poly->GetPointData()->SetScalars(Output_Poly_Scalar);
 
@@ -733,4 +799,134 @@ void CemrgScarAdvanced::TransformSource2Target() {
     writer->SetFileName((GetOutputPath() + "MaxScarPre_OnPost.vtk").c_str());
     writer->SetInputData(Output_Poly);
     writer->Write();
-}
\ No newline at end of file
+}
+
+void CemrgScarAdvanced::UpdateTransferTree() {
+
+    // rebuild only when caching is off or the target mesh has changed since the last build
+    if (_transferCacheTree && _transferTree.IsBuilt() && _transferTreeMesh == _target && _transferTreeMTime == _target->GetMTime())
+        return;
+
+    _transferTree.Build(_target->GetPoints());
+
+    // Triangles (quads and polygons fanned) and the triangles around each point, lines, vertices and strips are left out
+    vtkIdType numPoints = _target->GetNumberOfPoints();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    _transferTriangles.clear();
+    for (vtkIdType i = 0; i < _target->GetNumberOfCells(); i++) {
+        int cellType = _target->GetCellType(i);
+        if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON)
+            continue;
+        _target->GetCellPoints(i, cellPoints);
+        for (vtkIdType j = 1; j + 1 < cellPoints->GetNumberOfIds(); j++) {
+            _transferTriangles.push_back(cellPoints->GetId(0));
+            _transferTriangles.push_back(cellPoints->GetId(j));
+            _transferTriangles.push_back(cellPoints->GetId(j + 1));
+        }
+    }//_for
+
+    _transferPointCellOffsets.assign(numPoints + 1, 0);
+    for (size_t j = 0; j < _transferTriangles.size(); j++)
+        _transferPointCellOffsets[_transferTriangles[j] + 1]++;
+    for (vtkIdType i = 0; i < numPoints; i++)
+        _transferPointCellOffsets[i + 1] += _transferPointCellOffsets[i];
+    _transferPointCells.resize(_transferTriangles.size());
+    std::vector<vtkIdType> fill(_transferPointCellOffsets.begin(), _transferPointCellOffsets.end() - 1);
+    for (size_t j = 0; j < _transferTriangles.size(); j++)
+        _transferPointCells[fill[_transferTriangles[j]]++] = j / 3;
+
+    _transferTreeMesh = _target;
+    _transferTreeMTime = _target->GetMTime();
+    MITK_INFO(IsDebug()) << ("[INFO] Transfer KD-tree built for " + QString::number(numPoints) + " points").toStdString();
+}
+
+namespace {
+    // Closest point to p on triangle abc (Ericson, Real-Time Collision Detection 5.1.5); returns squared distance
+    double ClosestPointOnTriangle(const double p[3], const double a[3], const double b[3], const double c[3], double bary[3]) {
+
+        double ab[3], ac[3], ap[3];
+        for (int i = 0; i < 3; i++) {
+            ab[i] = b[i] - a[i];
+            ac[i] = c[i] - a[i];
+            ap[i] = p[i] - a[i];
+        }
+        double d1 = vtkMath::Dot(ab, ap), d2 = vtkMath::Dot(ac, ap);
+        if (d1 <= 0 && d2 <= 0) {
+            bary[0] = 1; bary[1] = 0; bary[2] = 0;
+        } else {
+            double bp[3], cp[3];
+            for (int i = 0; i < 3; i++) {
+                bp[i] = p[i] - b[i];
+                cp[i] = p[i] - c[i];
+            }
+            double d3 = vtkMath::Dot(ab, bp), d4 = vtkMath::Dot(ac, bp);
+            double d5 = vtkMath::Dot(ab, cp), d6 = vtkMath::Dot(ac, cp);
+            double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+            if (d3 >= 0 && d4 <= d3) {
+                bary[0] = 0; bary[1] = 1; bary[2] = 0;
+            } else if (d6 >= 0 && d5 <= d6) {
+                bary[0] = 0; bary[1] = 0; bary[2] = 1;
+            } else if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+                double v = d1 / (d1 - d3);
+                bary[0] = 1 - v; bary[1] = v; bary[2] = 0;
+            } else if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+                double w = d2 / (d2 - d6);
+                bary[0] = 1 - w; bary[1] = 0; bary[2] = w;
+            } else if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+                double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                bary[0] = 0; bary[1] = 1 - w; bary[2] = w;
+            } else {
+                double denom = 1.0 / (va + vb + vc);
+                bary[1] = vb * denom;
+                bary[2] = vc * denom;
+                bary[0] = 1 - bary[1] - bary[2];
+            }//_if
+        }//_if
+
+        double dist2 = 0;
+        for (int i = 0; i < 3; i++) {
+            double q = bary[0] * a[i] + bary[1] * b[i] + bary[2] * c[i];
+            dist2 += (p[i] - q) * (p[i] - q);
+        }
+        return dist2;
+    }
+}
+
+double CemrgScarAdvanced::TransferValue(const double x[3], const std::vector<double>& targetValues, std::vector<std::pair<double, vtkIdType>>& closest) {
+
+    int k = (_transferMethod == TRANSFER_NEAREST) ? 1 : std::max(1, _transferNeighbours);
+    _transferTree.FindClosestNPoints(k, x, closest);
+    if (closest.empty())
+        return 0;
+
+    if (_transferMethod == TRANSFER_IDW) {
+        if (closest[0].first == 0)
+            return targetValues[closest[0].second];
+        double sum = 0, weights = 0;
+        for (size_t j = 0; j < closest.size(); j++) {
+            double w = 1.0 / closest[j].first;
+            sum += w * targetValues[closest[j].second];
+            weights += w;
+        }
+        return sum / weights;
+
+    } else if (_transferMethod == TRANSFER_BARYCENTRIC) {
+        double bestDist2 = std::numeric_limits<double>::max();
+        double bestValue = targetValues[closest[0].second];
+        double bary[3];
+        for (size_t j = 0; j < closest.size(); j++) {
+            vtkIdType pid = closest[j].second;
+            for (vtkIdType c = _transferPointCellOffsets[pid]; c < _transferPointCellOffsets[pid + 1]; c++) {
+                const vtkIdType* tri = &_transferTriangles[3 * _transferPointCells[c]];
+                double dist2 = ClosestPointOnTriangle(x, _transferTree.GetPoint(tri[0]), _transferTree.GetPoint(tri[1]), _transferTree.GetPoint(tri[2]), bary);
+                if (dist2 < bestDist2) {
+                    bestDist2 = dist2;
+                    bestValue = bary[0] * targetValues[tri[0]] + bary[1] * targetValues[tri[1]] + bary[2] * targetValues[tri[2]];
+                }
+            }//_for
+        }//_for
+        return bestValue;
+    }//_if
+
+    return targetValues[closest[0].second];
+}
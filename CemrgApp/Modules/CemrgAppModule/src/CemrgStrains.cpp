@@ -46,9 +46,13 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkPlaneSource.h>
 #include <vtkProbeFilter.h>
 #include <vtkRegularPolygonSource.h>
+#include <vtkPolyDataReader.h>
+#include <vtkIdList.h>
 
 // C++ Standard
 #include <numeric>
+#include <thread>
+#include <atomic>
 
 // CemrgApp
 #include "CemrgCommonUtils.h"
@@ -62,10 +66,13 @@ PURPOSE.  See the above copyright notices for more information.
  * @brief TESTS remove later
  */
 CemrgStrains::CemrgStrains() {
+
+    this->numberOfThreads = 0;
 }
 
 CemrgStrains::CemrgStrains(QString dir, int refMeshNo) {
 
+    this->numberOfThreads = 0;
     this->projectDirectory = dir;
     this->refAhaArea.assign(16, 0);
     this->refSurface = ReadVTKMesh(refMeshNo);
@@ -221,7 +228,7 @@ std::vector<double> CemrgStrains::CalculateStrainsPlot(int meshNo, mitk::DataNod
 
         //Calculate deformation gradient
         mitk::Matrix<double, 3, 3> F;
-        F = K * refJ.at(index).GetInverse();
+        F = K * refJInv.at(index).GetVnlMatrix();
 
         //Calculate Strain Tensors
         mitk::Matrix<double, 3, 3> ET;
@@ -251,11 +258,102 @@ std::vector<double> CemrgStrains::CalculateStrainsPlot(int meshNo, mitk::DataNod
     }//_for
 
     for (int i = 0; i < 16; i++)
-        strainRCL.at(i) /= std::count(refCellLabels.begin(), refCellLabels.end(), i + 1);
+        strainRCL.at(i) /= refAhaCount.at(i);
 
     return strainRCL;
 }
 
+CemrgStrains::StrainCurves CemrgStrains::CalculateStrainCurves(int noFrames, mitk::DataNode::Pointer lmNode, bool largeStrain, int flatCurve) {
+
+    StrainCurves curves;
+    if (refTriLabel.empty() || noFrames <= 0)
+        return curves;
+
+    //Frame of reference shared by all frames, as in CalculateStrainsPlot
+    std::vector<mitk::Point3D> lm = ConvertMPS(lmNode);
+    if (lm.size() < 4)
+        return curves;
+
+    mitk::Point3D RIV2, centre;
+    if (lm.size() == 6) {
+        RIV2 = lm.at(5);
+        centre = Circlefit3d(ZeroPoint(lm.at(0), lm.at(1)), ZeroPoint(lm.at(0), lm.at(2)), ZeroPoint(lm.at(0), lm.at(3)));
+    } else {
+        RIV2 = lm.at(3);
+        centre = ZeroPoint(lm.at(0), lm.at(1));
+    }
+    mitk::Matrix<double, 3, 3> rotationMat = CalcRotationMatrix(centre, ZeroPoint(lm.at(0), RIV2));
+
+    double apex[3], rotation[9];
+    for (int i = 0; i < 3; i++) {
+        apex[i] = lm.at(0).GetElement(i);
+        for (int j = 0; j < 3; j++)
+            rotation[3 * i + j] = rotationMat[i][j];
+    }//_for
+
+    curves.sqz.resize(noFrames);
+    curves.radial.resize(noFrames);
+    curves.circumferential.resize(noFrames);
+    curves.longitudinal.resize(noFrames);
+    curves.flatSqz.resize(noFrames);
+    curves.flatRadial.resize(noFrames);
+    curves.flatCircumferential.resize(noFrames);
+    curves.flatLongitudinal.resize(noFrames);
+
+    int nThreads = numberOfThreads;
+    if (nThreads <= 0)
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    nThreads = std::min(nThreads, noFrames);
+
+    //Frames are independent: each worker reads and reduces whole frames
+    std::atomic<int> nextFrame(0);
+    std::vector<char> frameRead(noFrames, 0);
+    auto processFrames = [&]() {
+        std::vector<double> points;
+        for (int frame = nextFrame++; frame < noFrames; frame = nextFrame++) {
+            frameRead[frame] = ReadFramePoints(frame, points) ? 1 : 0;
+            if (frameRead[frame])
+                CalculateFrameCurves(points, apex, rotation, largeStrain, curves, frame);
+        }//_for
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < nThreads; t++)
+        workers.push_back(std::thread(processFrames));
+    processFrames();
+    for (auto& worker : workers)
+        worker.join();
+
+    for (int frame = 0; frame < noFrames; frame++) {
+        if (frameRead[frame])
+            continue;
+        MITK_WARN << "Could not read mesh transformed-" << frame << ".vtk matching the reference mesh.";
+        curves.sqz[frame].assign(16, 0.0);
+        curves.radial[frame].assign(16, 0.0);
+        curves.circumferential[frame].assign(16, 0.0);
+        curves.longitudinal[frame].assign(16, 0.0);
+        curves.flatSqz[frame].assign(refTriLabel.size(), 0.0f);
+        curves.flatRadial[frame].assign(refTriLabel.size(), 0.0f);
+        curves.flatCircumferential[frame].assign(refTriLabel.size(), 0.0f);
+        curves.flatLongitudinal[frame].assign(refTriLabel.size(), 0.0f);
+    }//_for
+
+    //Global maps of the last frame, as left by the per-frame calls
+    const std::vector<float>& flatValues =
+        (flatCurve == CURVE_RADIAL) ? curves.flatRadial.back() :
+        (flatCurve == CURVE_CIRCUMFERENTIAL) ? curves.flatCircumferential.back() :
+        (flatCurve == CURVE_LONGITUDINAL) ? curves.flatLongitudinal.back() : curves.flatSqz.back();
+    for (size_t index = 0; index < flatValues.size(); index++)
+        flatSurfScalars->InsertTuple1(index, flatValues[index]);
+
+    return curves;
+}
+
+void CemrgStrains::SetNumberOfThreads(int value) {
+
+    numberOfThreads = value;
+}
+
 double CemrgStrains::CalculateSDI(std::vector<std::vector<double>> valueVectors, int cycleLengths, int noFrames) {
 
     if (valueVectors.size() == 0)
@@ -529,6 +627,10 @@ mitk::Surface::Pointer CemrgStrains::ReferenceAHA(mitk::DataNode::Pointer lmNode
     AssigncLabels(2, refCellLabels, cAindex, cAngles, sepA, freeA);
 
     //Calculate reference mesh attributes
+    refArea.clear();
+    refAhaArea.assign(16, 0);
+    refJ.clear();
+    refQ.clear();
     for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
 
         //Ignore non AHA segments
@@ -547,6 +649,7 @@ mitk::Surface::Pointer CemrgStrains::ReferenceAHA(mitk::DataNode::Pointer lmNode
         refJ.push_back(J);
         refQ.push_back(Q);
     }
+    CacheReferenceGeometry(pd);
 
     //Setup flattened AHA mesh
     flatSurface = refSurface->Clone();
@@ -1013,6 +1116,170 @@ mitk::Matrix<double, 3, 3> CemrgStrains::CalcRotationMatrix(mitk::Point3D point1
     return R;
 }
 
+void CemrgStrains::CacheReferenceGeometry(vtkSmartPointer<vtkPolyData> pd) {
+
+    //Everything the frames need from the reference, computed once per ReferenceAHA
+    refJInv.clear();
+    refAhaCount.assign(16, 0);
+    refTriA.clear();
+    refTriB.clear();
+    refTriC.clear();
+    refTriLabel.clear();
+    refJInvFlat.clear();
+    refQFlat.clear();
+
+    vtkSmartPointer<vtkIdList> ptIds = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType cellID = 0; cellID < pd->GetNumberOfCells(); cellID++) {
+
+        //Ignore non AHA segments
+        if (refCellLabels[cellID] == 0)
+            continue;
+
+        pd->GetCellPoints(cellID, ptIds);
+        refTriA.push_back(ptIds->GetId(0));
+        refTriB.push_back(ptIds->GetId(1));
+        refTriC.push_back(ptIds->GetId(2));
+        refTriLabel.push_back(refCellLabels[cellID]);
+        refAhaCount.at(refCellLabels[cellID] - 1)++;
+    }//_for
+
+    for (size_t index = 0; index < refJ.size(); index++) {
+        refJInv.push_back(mitk::Matrix<double, 3, 3>(refJ.at(index).GetInverse()));
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                refJInvFlat.push_back(refJInv.back()[i][j]);
+                refQFlat.push_back(refQ.at(index)[i][j]);
+            }
+        }//_for
+    }//_for
+}
+
+bool CemrgStrains::ReadFramePoints(int meshNo, std::vector<double>& points) {
+
+    //Same file and orientation as ReadVTKMesh, read without the MITK IO services so frames can load concurrently
+    QString meshPath = projectDirectory + "/transformed-" + QString::number(meshNo) + ".vtk";
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName(meshPath.toStdString().c_str());
+    reader->Update();
+
+    vtkPolyData* pd = reader->GetOutput();
+    if (pd == nullptr || pd->GetNumberOfPoints() != (vtkIdType)refPointLabels.size())
+        return false;
+
+    //One thread per frame already, the flip runs serially
+    CemrgCommonUtils::FlipXYPoints(pd->GetPoints(), nullptr, 1);
+    points.resize(3 * pd->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < pd->GetNumberOfPoints(); i++)
+        pd->GetPoint(i, &points[3 * i]);
+
+    return true;
+}
+
+void CemrgStrains::CalculateFrameCurves(const std::vector<double>& points, const double apex[3], const double rotation[9], bool largeStrain, StrainCurves& curves, int frame) {
+
+    const size_t nTri = refTriLabel.size();
+    std::vector<double> sqz(16, 0), radial(16, 0), circumferential(16, 0), longitudinal(16, 0);
+    std::vector<float>& flatSqz = curves.flatSqz[frame];
+    std::vector<float>& flatRadial = curves.flatRadial[frame];
+    std::vector<float>& flatCircumferential = curves.flatCircumferential[frame];
+    std::vector<float>& flatLongitudinal = curves.flatLongitudinal[frame];
+    flatSqz.resize(nTri);
+    flatRadial.resize(nTri);
+    flatCircumferential.resize(nTri);
+    flatLongitudinal.resize(nTri);
+
+    for (size_t index = 0; index < nTri; index++) {
+
+        const vtkIdType ids[3] = {refTriA[index], refTriB[index], refTriC[index]};
+        const int segment = refTriLabel[index] - 1;
+
+        //Squeeze on the mesh as loaded
+        double pt[3][3];
+        for (int v = 0; v < 3; v++)
+            for (int i = 0; i < 3; i++)
+                pt[v][i] = points[3 * ids[v] + i];
+        double area = vtkTriangle::TriangleArea(pt[0], pt[1], pt[2]);
+        double sqze = (area - refArea[index]) / refArea[index];
+        double wsqz = area * sqze;
+        sqz[segment] += wsqz;
+        flatSqz[index] = wsqz;
+
+        //Zero relative to the apex and rotate, as ZeroVTKMesh and RotateVTKMesh do
+        double rt[3][3];
+        for (int v = 0; v < 3; v++) {
+            double d[3] = {pt[v][0] - apex[0], pt[v][1] - apex[1], pt[v][2] - apex[2]};
+            for (int i = 0; i < 3; i++)
+                rt[v][i] = rotation[3 * i] * d[0] + rotation[3 * i + 1] * d[1] + rotation[3 * i + 2] * d[2];
+        }//_for
+
+        //K matrix: triangle edges and unit normal as columns
+        double vc1[3], vc2[3], vc3[3];
+        for (int i = 0; i < 3; i++) {
+            vc1[i] = rt[1][i] - rt[0][i];
+            vc2[i] = rt[2][i] - rt[0][i];
+        }
+        vc3[0] = vc1[1] * vc2[2] - vc1[2] * vc2[1];
+        vc3[1] = vc1[2] * vc2[0] - vc1[0] * vc2[2];
+        vc3[2] = vc1[0] * vc2[1] - vc1[1] * vc2[0];
+        double norm = sqrt(vc3[0] * vc3[0] + vc3[1] * vc3[1] + vc3[2] * vc3[2]);
+        double K[3][3];
+        for (int i = 0; i < 3; i++) {
+            K[i][0] = vc1[i];
+            K[i][1] = vc2[i];
+            K[i][2] = vc3[i] / norm;
+        }
+
+        //Deformation gradient F = K * J^-1
+        const double* Jinv = &refJInvFlat[9 * index];
+        const double* Q = &refQFlat[9 * index];
+        double F[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                F[i][j] = K[i][0] * Jinv[j] + K[i][1] * Jinv[3 + j] + K[i][2] * Jinv[6 + j];
+
+        //Green-Lagrange or Engineering
+        double ET[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                double eye = (i == j) ? 1.0 : 0.0;
+                if (largeStrain)
+                    ET[i][j] = 0.5 * (F[0][i] * F[0][j] + F[1][i] * F[1][j] + F[2][i] * F[2][j] - eye);
+                else
+                    ET[i][j] = 0.5 * (F[i][j] + F[j][i]) - eye;
+            }
+        }//_for
+
+        //Diagonal of the rotated strain Q * ET * Q^T
+        double EV[3];
+        for (int i = 0; i < 3; i++) {
+            double QET[3];
+            for (int k = 0; k < 3; k++)
+                QET[k] = Q[3 * i] * ET[0][k] + Q[3 * i + 1] * ET[1][k] + Q[3 * i + 2] * ET[2][k];
+            EV[i] = QET[0] * Q[3 * i] + QET[1] * Q[3 * i + 1] + QET[2] * Q[3 * i + 2];
+        }
+
+        radial[segment] += EV[0];
+        circumferential[segment] += EV[1];
+        longitudinal[segment] += EV[2];
+        flatRadial[index] = EV[0];
+        flatCircumferential[index] = EV[1];
+        flatLongitudinal[index] = EV[2];
+    }//_for
+
+    //Average over AHA segments
+    for (int i = 0; i < 16; i++) {
+        sqz[i] /= refAhaArea.at(i);
+        radial[i] /= refAhaCount.at(i);
+        circumferential[i] /= refAhaCount.at(i);
+        longitudinal[i] /= refAhaCount.at(i);
+    }
+
+    curves.sqz[frame] = sqz;
+    curves.radial[frame] = radial;
+    curves.circumferential[frame] = circumferential;
+    curves.longitudinal[frame] = longitudinal;
+}
+
 void CemrgStrains::AssignpLabels(int layer, std::vector<double>& pLabel, std::vector<int> index, std::vector<double> pAngles, double sepA, double freeA) {
 
     double Csec;
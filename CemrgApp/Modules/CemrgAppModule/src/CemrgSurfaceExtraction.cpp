@@ -0,0 +1,337 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Surface Extraction
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkIOUtil.h>
+#include <mitkImageCast.h>
+#include <mitkProgressBar.h>
+
+// VTK
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkFloatArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFlyingEdges3D.h>
+#include <vtkReverseSense.h>
+#include <vtkWindowedSincPolyDataFilter.h>
+#include <vtkPolyDataReader.h>
+#include <vtkPolyDataWriter.h>
+
+// ITK
+#include <itkFlatStructuringElement.h>
+#include <itkGrayscaleDilateImageFilter.h>
+#include <itkGrayscaleErodeImageFilter.h>
+#include <itkSmoothingRecursiveGaussianImageFilter.h>
+
+// C++ Standard
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include "CemrgSurfaceExtraction.h"
+
+// CemrgApp
+#include "CemrgCommandLine.h"
+#include "CemrgKdTree.h"
+
+namespace {
+    typedef itk::Image<float, 3> FloatImageType;
+    typedef itk::FlatStructuringElement<3> StructuringElementType;
+
+    int NumberOfWorkers(int numberOfThreads, size_t count) {
+        int nThreads = numberOfThreads;
+        if (nThreads <= 0)
+            nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        return (int)std::min<size_t>(nThreads, std::max<size_t>(1, count / 4096));
+    }
+
+    //function(t, first, last) on contiguous chunks of [0, count)
+    template <typename TFunction>
+    void RunParallel(int nThreads, size_t count, TFunction function) {
+        if (nThreads == 1) {
+            function(0, 0, count);
+            return;
+        }//_if
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(function, t, count * t / nThreads, count * (t + 1) / nThreads));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+
+    //One MIRTK iteration: the 3x3x3 neighbourhood without its corners (18-connectivity)
+    StructuringElementType Connectivity18() {
+        StructuringElementType::RadiusType radius;
+        radius.Fill(1);
+        StructuringElementType element;
+        element.SetRadius(radius);
+        for (unsigned int i = 0; i < element.Size(); i++) {
+            StructuringElementType::OffsetType offset = element.GetOffset(i);
+            element[i] = (std::abs(offset[0]) + std::abs(offset[1]) + std::abs(offset[2])) <= 2;
+        }//_for
+        return element;
+    }
+
+    FloatImageType::Pointer Dilate(FloatImageType::Pointer image, int iter) {
+        typedef itk::GrayscaleDilateImageFilter<FloatImageType, FloatImageType, StructuringElementType> DilateFilterType;
+        for (int i = 0; i < iter; i++) {
+            DilateFilterType::Pointer dilate = DilateFilterType::New();
+            dilate->SetInput(image);
+            dilate->SetKernel(Connectivity18());
+            dilate->Update();
+            image = dilate->GetOutput();
+            image->DisconnectPipeline();
+        }//_for
+        return image;
+    }
+
+    FloatImageType::Pointer Erode(FloatImageType::Pointer image, int iter) {
+        typedef itk::GrayscaleErodeImageFilter<FloatImageType, FloatImageType, StructuringElementType> ErodeFilterType;
+        for (int i = 0; i < iter; i++) {
+            ErodeFilterType::Pointer erode = ErodeFilterType::New();
+            erode->SetInput(image);
+            erode->SetKernel(Connectivity18());
+            erode->Update();
+            image = erode->GetOutput();
+            image->DisconnectPipeline();
+        }//_for
+        return image;
+    }
+
+    double Determinant(const double m[3][3]) {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    //Largest distance from a vertex of source to the closest vertex of target
+    double DirectedHausdorff(vtkPolyData* source, const CemrgKdTree& target, int numberOfThreads) {
+        const size_t numPoints = source->GetNumberOfPoints();
+        const int nThreads = NumberOfWorkers(numberOfThreads, numPoints);
+        std::vector<double> maxDist2(nThreads, 0);
+        RunParallel(nThreads, numPoints, [&](int t, size_t first, size_t last) {
+            double x[3], dist2;
+            for (size_t i = first; i < last; i++) {
+                source->GetPoint(i, x);
+                target.FindClosestPoint(x, dist2);
+                maxDist2[t] = std::max(maxDist2[t], dist2);
+            }//_for
+        });
+        return std::sqrt(*std::max_element(maxDist2.begin(), maxDist2.end()));
+    }
+}
+
+CemrgSurfaceExtraction::CemrgSurfaceExtraction() :
+    numberOfThreads(0), fidelityMode(false), fidelityTolerance(1.0), commandLine(nullptr),
+    lastHausdorffDistance(-1), lastUsedNative(false) {
+}
+
+vtkSmartPointer<vtkPolyData> CemrgSurfaceExtraction::Execute(mitk::Image::Pointer segmentation, QString morphOperation, int iter, float th, int blur, int smth) {
+
+    if (segmentation.IsNull())
+        return nullptr;
+
+    FloatImageType::Pointer image = FloatImageType::New();
+    mitk::CastToItkImage(segmentation, image);
+
+    //Morphology, grayscale as in MIRTK
+    if (QString::compare(morphOperation, "dilate", Qt::CaseInsensitive)==0) {
+        image = Dilate(image, iter);
+    } else if (QString::compare(morphOperation, "erode", Qt::CaseInsensitive)==0) {
+        image = Erode(image, iter);
+    } else if (QString::compare(morphOperation, "open", Qt::CaseInsensitive)==0) {
+        image = Dilate(Erode(image, iter), iter);
+    } else if (QString::compare(morphOperation, "close", Qt::CaseInsensitive)==0) {
+        image = Erode(Dilate(image, iter), iter);
+    } else {
+        MITK_ERROR << ("Morphological operation: " + morphOperation + " misspelled or not supported.").toStdString();
+        return nullptr;
+    }//_if
+
+    //Blur, standard deviation in mm
+    if (blur > 0) {
+        typedef itk::SmoothingRecursiveGaussianImageFilter<FloatImageType, FloatImageType> GaussianFilterType;
+        GaussianFilterType::Pointer gaussian = GaussianFilterType::New();
+        gaussian->SetInput(image);
+        gaussian->SetSigma(blur);
+        gaussian->Update();
+        image = gaussian->GetOutput();
+    }//_if
+
+    //Index space volume padded by one voxel of background so the surface is closed
+    const FloatImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    const int dims[3] = {(int)size[0] + 2, (int)size[1] + 2, (int)size[2] + 2};
+    const float* buffer = image->GetBufferPointer();
+    const float background = std::min(0.0f, *std::min_element(buffer, buffer + image->GetBufferedRegion().GetNumberOfPixels()));
+    vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+    scalars->SetNumberOfTuples((vtkIdType)dims[0] * dims[1] * dims[2]);
+    float* volumeData = scalars->GetPointer(0);
+    std::fill(volumeData, volumeData + (size_t)dims[0] * dims[1] * dims[2], background);
+    for (size_t k = 0; k < size[2]; k++)
+        for (size_t j = 0; j < size[1]; j++)
+            std::copy(buffer + (k * size[1] + j) * size[0], buffer + (k * size[1] + j + 1) * size[0],
+                      volumeData + ((k + 1) * dims[1] + j + 1) * dims[0] + 1);
+    vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+    volume->SetDimensions(dims[0], dims[1], dims[2]);
+    volume->GetPointData()->SetScalars(scalars);
+
+    vtkSmartPointer<vtkFlyingEdges3D> surfacer = vtkSmartPointer<vtkFlyingEdges3D>::New();
+    surfacer->SetInputData(volume);
+    surfacer->SetValue(0, th);
+    surfacer->ComputeNormalsOff();
+    surfacer->ComputeGradientsOff();
+    surfacer->ComputeScalarsOff();
+    surfacer->Update();
+    vtkSmartPointer<vtkPolyData> surface = surfacer->GetOutput();
+    if (surface->GetNumberOfPoints() == 0) {
+        MITK_WARN << "No surface found at isovalue " << th;
+        return nullptr;
+    }//_if
+
+    //Index to physical space, then to the MIRTK frame
+    double m[3][3], origin[3];
+    for (int a = 0; a < 3; a++) {
+        origin[a] = image->GetOrigin()[a];
+        for (int b = 0; b < 3; b++)
+            m[a][b] = image->GetDirection()[a][b] * image->GetSpacing()[b];
+    }//_for
+    const size_t numPoints = surface->GetNumberOfPoints();
+    vtkSmartPointer<vtkDoubleArray> coords = vtkSmartPointer<vtkDoubleArray>::New();
+    coords->SetNumberOfComponents(3);
+    coords->SetNumberOfTuples(numPoints);
+    double* out = coords->GetPointer(0);
+    RunParallel(NumberOfWorkers(numberOfThreads, numPoints), numPoints, [&](int, size_t first, size_t last) {
+        double index[3];
+        for (size_t i = first; i < last; i++) {
+            surface->GetPoint(i, index);
+            for (int a = 0; a < 3; a++) {
+                double x = origin[a];
+                for (int b = 0; b < 3; b++)
+                    x += m[a][b] * (index[b] - 1);
+                out[3 * i + a] = (a < 2) ? -x : x;
+            }//_for
+        }//_for
+    });
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(coords);
+    surface->SetPoints(points);
+
+    //Keep the orientation of the triangles when the grid is mirrored
+    if (Determinant(m) < 0) {
+        vtkSmartPointer<vtkReverseSense> reverse = vtkSmartPointer<vtkReverseSense>::New();
+        reverse->SetInputData(surface);
+        reverse->ReverseCellsOn();
+        reverse->ReverseNormalsOff();
+        reverse->Update();
+        surface = reverse->GetOutput();
+    }//_if
+
+    if (smth > 0) {
+        vtkSmartPointer<vtkWindowedSincPolyDataFilter> smoother = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+        smoother->SetInputData(surface);
+        smoother->SetNumberOfIterations(smth);
+        smoother->SetPassBand(0.1);
+        smoother->BoundarySmoothingOff();
+        smoother->FeatureEdgeSmoothingOff();
+        smoother->NonManifoldSmoothingOn();
+        smoother->NormalizeCoordinatesOn();
+        smoother->Update();
+        surface = smoother->GetOutput();
+    }//_if
+
+    return surface;
+}
+
+QString CemrgSurfaceExtraction::ExecuteSurf(QString dir, QString segPath, QString morphOperation, int iter, float th, int blur, int smth) {
+
+    MITK_INFO << "[ATTENTION] SURFACE CREATION (in process): Close -> Surface -> Smooth";
+
+    QString inputImgFullPath = segPath.contains(dir, Qt::CaseSensitive) ? segPath : dir + "/" + segPath;
+    QString outAbsolutePath = dir + "/segmentation.vtk";
+    lastHausdorffDistance = -1;
+    lastUsedNative = false;
+
+    vtkSmartPointer<vtkPolyData> surface;
+    try {
+        surface = Execute(mitk::IOUtil::Load<mitk::Image>(inputImgFullPath.toStdString()), morphOperation, iter, th, blur, smth);
+    } catch (mitk::Exception& e) {
+        MITK_WARN << "Surface extraction failed to load " << inputImgFullPath.toStdString() << ": " << e.GetDescription();
+    }//_try
+
+    if (fidelityMode && commandLine != nullptr) {
+
+        QString mirtkOutput = commandLine->ExecuteSurf(dir, segPath, morphOperation, iter, th, blur, smth);
+        if (QString::compare(mirtkOutput, "ERROR_IN_PROCESSING")==0)
+            return surface ? WriteSurface(surface, outAbsolutePath) : mirtkOutput;
+
+        vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+        reader->SetFileName(mirtkOutput.toStdString().c_str());
+        reader->Update();
+        if (surface)
+            lastHausdorffDistance = HausdorffDistance(surface, reader->GetOutput(), numberOfThreads);
+
+        MITK_INFO << "[...] Hausdorff distance to the MIRTK surface: " << lastHausdorffDistance;
+        if (lastHausdorffDistance < 0 || lastHausdorffDistance > fidelityTolerance) {
+            MITK_WARN << "In process surface differs from the MIRTK surface, keeping the MIRTK output.";
+            return mirtkOutput;
+        }//_if
+        return WriteSurface(surface, mirtkOutput);
+
+    } else {
+        mitk::ProgressBar::GetInstance()->Progress(3);
+    }//_if
+
+    if (!surface)
+        return "ERROR_IN_PROCESSING";
+    return WriteSurface(surface, outAbsolutePath);
+}
+
+QString CemrgSurfaceExtraction::WriteSurface(vtkSmartPointer<vtkPolyData> surface, QString path) {
+
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(surface);
+    writer->SetFileName(path.toStdString().c_str());
+    writer->SetFileTypeToBinary();
+    if (writer->Write() == 0) {
+        MITK_WARN << "Surface could not be written to " << path.toStdString();
+        return "ERROR_IN_PROCESSING";
+    }//_if
+    lastUsedNative = true;
+    return path;
+}
+
+double CemrgSurfaceExtraction::HausdorffDistance(vtkPolyData* surface1, vtkPolyData* surface2, int numberOfThreads) {
+
+    if (surface1 == nullptr || surface2 == nullptr || surface1->GetNumberOfPoints() == 0 || surface2->GetNumberOfPoints() == 0)
+        return -1;
+
+    CemrgKdTree tree1, tree2;
+    tree1.Build(surface1->GetPoints());
+    tree2.Build(surface2->GetPoints());
+    return std::max(DirectedHausdorff(surface1, tree2, numberOfThreads), DirectedHausdorff(surface2, tree1, numberOfThreads));
+}
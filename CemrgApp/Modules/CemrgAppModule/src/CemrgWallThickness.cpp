@@ -0,0 +1,365 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * Wall Thickness
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrgapp.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+// Qmitk
+#include <mitkLogMacros.h>
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+
+// C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include "CemrgWallThickness.h"
+
+namespace {
+    //Codes of the voxels that are not wall, wall voxels hold their index in the wall list
+    const int OUTER = -1;
+    const int INNER = -2;
+    //Over-relaxation of the Laplace solve
+    const double SOR_FACTOR = 1.9;
+    //Sweeps of the streamline lengths, each one follows the potential
+    const int MAX_LENGTH_SWEEPS = 20;
+
+    int NumberOfWorkers(int numberOfThreads, size_t count) {
+        int nThreads = numberOfThreads;
+        if (nThreads <= 0)
+            nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        return (int)std::min<size_t>(nThreads, std::max<size_t>(1, count / 4096));
+    }
+
+    //function(t, first, last) on contiguous chunks of [0, count)
+    template <typename TFunction>
+    void RunParallel(int nThreads, size_t count, TFunction function) {
+        if (nThreads == 1) {
+            function(0, 0, count);
+            return;
+        }//_if
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nThreads; t++)
+            workers.push_back(std::thread(function, t, count * t / nThreads, count * (t + 1) / nThreads));
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+}
+
+CemrgWallThickness::CemrgWallThickness() :
+    wallLabel(1), numberOfThreads(0), tolerance(1e-5), maxIterations(5000), searchRadius(3) {
+
+    Clear();
+}
+
+void CemrgWallThickness::Clear() {
+
+    computed = false;
+    iterations = 0;
+    thicknessImage = nullptr;
+    wallIndex.clear();
+    wallVoxels.clear();
+    thickness.clear();
+}
+
+bool CemrgWallThickness::Compute(const ImageType* segmentation) {
+
+    Clear();
+    if (segmentation == nullptr)
+        return false;
+
+    const ImageType::RegionType region = segmentation->GetBufferedRegion();
+    const int64_t dims[3] = {(int64_t)region.GetSize(0), (int64_t)region.GetSize(1), (int64_t)region.GetSize(2)};
+    const int64_t step[3] = {1, dims[0], dims[0] * dims[1]};
+    const int64_t numVoxels = dims[0] * dims[1] * dims[2];
+    const short* labels = segmentation->GetBufferPointer();
+    double h[3];
+    for (int a = 0; a < 3; a++)
+        h[a] = segmentation->GetSpacing()[a];
+
+    //Outer side: background reached from the edge of the image without crossing a label
+    std::vector<char> outer(numVoxels, 0);
+    std::vector<int64_t> stack;
+    auto visit = [&](int64_t v) {
+        if (!outer[v] && labels[v] == 0) {
+            outer[v] = 1;
+            stack.push_back(v);
+        }//_if
+    };
+    for (int64_t k = 0; k < dims[2]; k++)
+        for (int64_t j = 0; j < dims[1]; j++)
+            for (int64_t i = 0; i < dims[0]; i++)
+                if (i == 0 || j == 0 || k == 0 || i == dims[0] - 1 || j == dims[1] - 1 || k == dims[2] - 1)
+                    visit((k * dims[1] + j) * dims[0] + i);
+    while (!stack.empty()) {
+        int64_t v = stack.back();
+        stack.pop_back();
+        int64_t idx[3] = {v % dims[0], (v / dims[0]) % dims[1], v / step[2]};
+        for (int a = 0; a < 3; a++) {
+            if (idx[a] > 0) visit(v - step[a]);
+            if (idx[a] < dims[a] - 1) visit(v + step[a]);
+        }//_for
+    }//_while
+
+    wallIndex.assign(numVoxels, OUTER);
+    for (int64_t v = 0; v < numVoxels; v++) {
+        if (labels[v] == wallLabel) {
+            wallIndex[v] = (int)wallVoxels.size();
+            wallVoxels.push_back(v);
+        } else if (!outer[v]) {
+            wallIndex[v] = INNER;
+        }//_if
+    }//_for
+    std::vector<char>().swap(outer);
+
+    const size_t numWall = wallVoxels.size();
+    if (numWall == 0) {
+        MITK_WARN << "Wall thickness: no voxels with the wall label " << wallLabel << ".";
+        return false;
+    }//_if
+
+    //Six neighbours of every wall voxel, past the edge of the image is outer
+    std::vector<int> neighbours(6 * numWall);
+    std::vector<int> colours[2];
+    bool hasInner = false;
+    for (size_t w = 0; w < numWall; w++) {
+        const int64_t v = wallVoxels[w];
+        const int64_t idx[3] = {v % dims[0], (v / dims[0]) % dims[1], v / step[2]};
+        for (int a = 0; a < 3; a++) {
+            neighbours[6 * w + 2 * a] = (idx[a] > 0) ? wallIndex[v - step[a]] : OUTER;
+            neighbours[6 * w + 2 * a + 1] = (idx[a] < dims[a] - 1) ? wallIndex[v + step[a]] : OUTER;
+            hasInner = hasInner || neighbours[6 * w + 2 * a] == INNER || neighbours[6 * w + 2 * a + 1] == INNER;
+        }//_for
+        colours[(idx[0] + idx[1] + idx[2]) % 2].push_back((int)w);
+    }//_for
+    if (!hasInner) {
+        MITK_WARN << "Wall thickness: the wall has no inner side.";
+        Clear();
+        return false;
+    }//_if
+
+    //Laplace potential, red-black SOR: each colour only reads the other one
+    std::vector<double> psi(numWall, 0.5);
+    auto potential = [&](int n) { return (n >= 0) ? psi[n] : (n == OUTER ? 1.0 : 0.0); };
+    const double weight[3] = {1.0 / (h[0] * h[0]), 1.0 / (h[1] * h[1]), 1.0 / (h[2] * h[2])};
+    const double weightSum = 2.0 * (weight[0] + weight[1] + weight[2]);
+    const int nThreads = NumberOfWorkers(numberOfThreads, numWall / 2);
+    std::vector<double> change(nThreads);
+
+    for (iterations = 0; iterations < maxIterations; iterations++) {
+        std::fill(change.begin(), change.end(), 0.0);
+        for (int c = 0; c < 2; c++) {
+            const std::vector<int>& colour = colours[c];
+            RunParallel(nThreads, colour.size(), [&](int t, size_t first, size_t last) {
+                double maxChange = change[t];
+                for (size_t q = first; q < last; q++) {
+                    const int w = colour[q];
+                    const int* n = &neighbours[6 * w];
+                    double sum = weight[0] * (potential(n[0]) + potential(n[1])) +
+                        weight[1] * (potential(n[2]) + potential(n[3])) +
+                        weight[2] * (potential(n[4]) + potential(n[5]));
+                    double update = SOR_FACTOR * (sum / weightSum - psi[w]);
+                    psi[w] += update;
+                    maxChange = std::max(maxChange, std::fabs(update));
+                }//_for
+                change[t] = maxChange;
+            });
+        }//_for
+        if (*std::max_element(change.begin(), change.end()) < tolerance)
+            break;
+    }//_for
+    MITK_INFO(iterations == maxIterations) << "Wall thickness: Laplace solve stopped at " << maxIterations << " iterations.";
+
+    //Unit tangent of the streamlines
+    std::vector<double> tangent(3 * numWall);
+    RunParallel(nThreads, numWall, [&](int, size_t first, size_t last) {
+        for (size_t w = first; w < last; w++) {
+            const int* n = &neighbours[6 * w];
+            double gradient[3], norm = 0;
+            for (int a = 0; a < 3; a++) {
+                gradient[a] = (potential(n[2 * a + 1]) - potential(n[2 * a])) / (2.0 * h[a]);
+                norm += gradient[a] * gradient[a];
+            }//_for
+            norm = std::sqrt(norm);
+            for (int a = 0; a < 3; a++)
+                tangent[3 * w + a] = (norm > 0) ? gradient[a] / norm : 0.0;
+        }//_for
+    });
+
+    //Streamline lengths from each side, upwind along the potential. The side
+    //itself sits half a step behind the first wall voxel.
+    std::vector<int> order(numWall);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return psi[a] < psi[b]; });
+    std::vector<double> lengths[2] = {std::vector<double>(numWall, 0.0), std::vector<double>(numWall, 0.0)};
+    for (int side = 0; side < 2; side++) {
+        std::vector<double>& length = lengths[side];
+        const double direction = (side == 0) ? 1.0 : -1.0;
+        for (int sweep = 0; sweep < MAX_LENGTH_SWEEPS; sweep++) {
+            double maxChange = 0;
+            for (size_t q = 0; q < numWall; q++) {
+                const int w = (side == 0) ? order[q] : order[numWall - 1 - q];
+                const int* n = &neighbours[6 * w];
+                double inverseStep = 0;
+                for (int a = 0; a < 3; a++)
+                    inverseStep += std::fabs(tangent[3 * w + a]) / h[a];
+                double numerator = 1.0, denominator = 0.0;
+                for (int a = 0; a < 3; a++) {
+                    double t = direction * tangent[3 * w + a];
+                    if (t == 0)
+                        continue;
+                    int upwind = (t > 0) ? n[2 * a] : n[2 * a + 1];
+                    double coefficient = std::fabs(t) / h[a];
+                    numerator += coefficient * ((upwind >= 0) ? length[upwind] : -0.5 / inverseStep);
+                    denominator += coefficient;
+                }//_for
+                double value = (denominator > 0) ? numerator / denominator : 0.0;
+                maxChange = std::max(maxChange, std::fabs(value - length[w]));
+                length[w] = value;
+            }//_for
+            if (maxChange < 1e-4 * std::min(h[0], std::min(h[1], h[2])))
+                break;
+        }//_for
+    }//_for
+
+    thickness.resize(numWall);
+    for (size_t w = 0; w < numWall; w++)
+        thickness[w] = lengths[0][w] + lengths[1][w];
+
+    thicknessImage = ThicknessImageType::New();
+    thicknessImage->CopyInformation(segmentation);
+    thicknessImage->SetRegions(region);
+    thicknessImage->Allocate();
+    thicknessImage->FillBuffer(0);
+    float* pvThickness = thicknessImage->GetBufferPointer();
+    for (size_t w = 0; w < numWall; w++)
+        pvThickness[wallVoxels[w]] = (float)thickness[w];
+
+    computed = true;
+    MITK_INFO << "Wall thickness: " << numWall << " wall voxels, " << iterations << " iterations, mean " << GetMeanThickness() << " mm.";
+    return true;
+}
+
+double CemrgWallThickness::GetMeanThickness() const {
+
+    if (thickness.empty())
+        return 0;
+    return std::accumulate(thickness.begin(), thickness.end(), 0.0) / thickness.size();
+}
+
+double CemrgWallThickness::GetThicknessAt(const double point[3]) const {
+
+    if (!computed)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    ThicknessImageType::PointType physical;
+    for (int a = 0; a < 3; a++)
+        physical[a] = point[a];
+    itk::ContinuousIndex<double, 3> cidx;
+    thicknessImage->TransformPhysicalPointToContinuousIndex(physical, cidx);
+
+    const ThicknessImageType::RegionType region = thicknessImage->GetBufferedRegion();
+    int64_t dims[3], base[3];
+    double h[3], local[3];
+    for (int a = 0; a < 3; a++) {
+        dims[a] = region.GetSize(a);
+        h[a] = thicknessImage->GetSpacing()[a];
+        local[a] = cidx[a] - region.GetIndex(a);
+        base[a] = (int64_t)std::floor(local[a]);
+    }//_for
+
+    //Growing boxes around the point until one holds wall voxels
+    for (int r = 1; r <= searchRadius; r++) {
+        int64_t lower[3], upper[3];
+        bool empty = false;
+        for (int a = 0; a < 3; a++) {
+            lower[a] = std::max<int64_t>(0, base[a] - r + 1);
+            upper[a] = std::min<int64_t>(dims[a] - 1, base[a] + r);
+            empty = empty || lower[a] > upper[a];
+        }//_for
+        if (empty)
+            continue;
+
+        double sum = 0, weights = 0;
+        for (int64_t k = lower[2]; k <= upper[2]; k++) {
+            for (int64_t j = lower[1]; j <= upper[1]; j++) {
+                for (int64_t i = lower[0]; i <= upper[0]; i++) {
+                    int w = wallIndex[(k * dims[1] + j) * dims[0] + i];
+                    if (w < 0)
+                        continue;
+                    const int64_t idx[3] = {i, j, k};
+                    double d2 = 0;
+                    for (int a = 0; a < 3; a++)
+                        d2 += (idx[a] - local[a]) * (idx[a] - local[a]) * h[a] * h[a];
+                    double weight = 1.0 / (d2 + 1e-6);
+                    sum += weight * thickness[w];
+                    weights += weight;
+                }//_for
+            }//_for
+        }//_for
+        if (weights > 0)
+            return sum / weights;
+    }//_for
+
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+bool CemrgWallThickness::MapToSurface(vtkSmartPointer<vtkPolyData> surface, std::string arrayName) const {
+
+    if (!computed || surface.GetPointer() == nullptr)
+        return false;
+
+    const vtkIdType numPoints = surface->GetNumberOfPoints();
+    vtkSmartPointer<vtkFloatArray> values = vtkSmartPointer<vtkFloatArray>::New();
+    values->SetName(arrayName.c_str());
+    values->SetNumberOfComponents(1);
+    values->SetNumberOfTuples(numPoints);
+
+    std::atomic<vtkIdType> misses(0);
+    RunParallel(NumberOfWorkers(numberOfThreads, numPoints), numPoints, [&](int, size_t first, size_t last) {
+        vtkIdType localMisses = 0;
+        for (vtkIdType i = first; i < (vtkIdType)last; i++) {
+            double point[3];
+            surface->GetPoint(i, point);
+            double value = GetThicknessAt(point);
+            if (std::isnan(value)) {
+                value = 0;
+                localMisses++;
+            }//_if
+            values->SetValue(i, (float)value);
+        }//_for
+        misses += localMisses;
+    });
+
+    MITK_WARN(misses > 0) << "Wall thickness: " << misses.load() << " of " << numPoints << " vertices are not near the wall, set to 0.";
+    surface->GetPointData()->AddArray(values);
+    surface->GetPointData()->SetActiveScalars(arrayName.c_str());
+    return true;
+}
@@ -0,0 +1,242 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgAtriaClipperTest.hpp"
+#include <CemrgSurfaceExtraction.h>
+#include <mitkITKImageImport.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIterator.h>
+#include <vtkPointLocator.h>
+#include <vtkFieldData.h>
+#include <vtkDataArray.h>
+#include <vtkIdList.h>
+
+namespace {
+    const double atriumRadius = 20.0;
+    const double veinRadius = 5.0;
+    const double veinLength = 38.0;
+}
+
+TestCemrgAtriaClipper::ImageType::Pointer TestCemrgAtriaClipper::AtriumPhantom(const vector<array<double, 3>>& veins, const double spacing[3]) {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::SpacingType itkSpacing;
+    ImageType::PointType origin;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, (itk::SizeValueType)ceil(2 * (veinLength + 8) / spacing[a]));
+        itkSpacing[a] = spacing[a];
+        origin[a] = -0.5 * (region.GetSize(a) - 1) * spacing[a];
+    }
+    image->SetRegions(region);
+    image->SetSpacing(itkSpacing);
+    image->SetOrigin(origin);
+    image->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        ImageType::PointType point;
+        image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+        double r = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+        short value = (r < atriumRadius) ? 1 : 0;
+        if (value == 1 && point[2] < -0.8 * atriumRadius)
+            value = 2;
+        for (const array<double, 3>& vein : veins) {
+            double along = point[0] * vein[0] + point[1] * vein[1] + point[2] * vein[2];
+            double across = sqrt(max(0.0, r * r - along * along));
+            if (value == 0 && along > 0 && along < veinLength && across < veinRadius)
+                value = 1;
+        }
+        it.Set(value);
+    }
+    return image;
+}
+
+vector<array<double, 3>> TestCemrgAtriaClipper::VeinDirections() {
+    vector<array<double, 3>> veins = VeinDirections();
+    return veins;
+}
+
+mitk::Surface::Pointer TestCemrgAtriaClipper::Shell(ImageType::Pointer phantom, const vector<array<double, 3>>& veins, vtkSmartPointer<vtkIdList> seedIds) {
+    // Shell in the MIRTK frame, as the clipper views load it
+    mitk::Image::Pointer segmentation = mitk::ImportItkImage(phantom)->Clone();
+    CemrgSurfaceExtraction extraction;
+    mitk::Surface::Pointer shell = mitk::Surface::New();
+    shell->SetVtkPolyData(extraction.Execute(segmentation, "close", 1, 0.5, 0, 10));
+
+    vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+    locator->SetDataSet(shell->GetVtkPolyData());
+    locator->BuildLocator();
+    for (const array<double, 3>& vein : veins) {
+        const double tip[3] = {-(veinLength - 2) * vein[0], -(veinLength - 2) * vein[1], (veinLength - 2) * vein[2]};
+        seedIds->InsertNextId(locator->FindClosestPoint(tip));
+    }
+    return shell;
+}
+
+TestCemrgAtriaClipper::ImageType::Pointer TestCemrgAtriaClipper::Clip(ImageType::Pointer phantom, const vector<array<double, 3>>& veins, const vector<int>& labels, bool roiClipping, QString directory, ImageType::Pointer& labelled) {
+    QDir(directory).removeRecursively();
+    QDir().mkpath(directory);
+
+    mitk::Image::Pointer segmentation = mitk::ImportItkImage(phantom)->Clone();
+    vtkSmartPointer<vtkIdList> seedIds = vtkSmartPointer<vtkIdList>::New();
+    mitk::Surface::Pointer shell = Shell(phantom, veins, seedIds);
+
+    CemrgAtriaClipper clipper(directory, shell);
+    clipper.SetClipImageRegionsOfInterest(roiClipping);
+    if (!clipper.ComputeCtrLines(labels, seedIds, true) || !clipper.ComputeCtrLinesClippers(labels))
+        return nullptr;
+    clipper.ClipVeinsImage(labels, segmentation, false);
+
+    labelled = ImageType::New();
+    mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>((directory + "/PVeinsLabelled.nii").toStdString()), labelled);
+    ImageType::Pointer cropped = ImageType::New();
+    mitk::CastToItkImage(clipper.GetClippedSegImage(), cropped);
+    return cropped;
+}
+
+bool TestCemrgAtriaClipper::SameVoxels(ImageType::Pointer image1, ImageType::Pointer image2, size_t& differences) {
+    differences = 0;
+    if (image1->GetLargestPossibleRegion() != image2->GetLargestPossibleRegion())
+        return false;
+    itk::ImageRegionConstIterator<ImageType> it1(image1, image1->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<ImageType> it2(image2, image2->GetLargestPossibleRegion());
+    for (it1.GoToBegin(), it2.GoToBegin(); !it1.IsAtEnd(); ++it1, ++it2)
+        if (it1.Get() != it2.Get())
+            differences++;
+    return differences == 0;
+}
+
+void TestCemrgAtriaClipper::ClipVeinsImageRegionsOfInterest_data() {
+    QTest::addColumn<double>("sx");
+    QTest::addColumn<double>("sz");
+    QTest::addColumn<vector<int>>("labels");
+
+    QTest::newRow("Four veins, isotropic voxels") << 1.0 << 1.0 << vector<int>{11, 13, 15, 17};
+    QTest::newRow("Veins and uncut appendage, anisotropic voxels") << 0.9 << 1.3 << vector<int>{11, 13, 15, 20};
+}
+
+void TestCemrgAtriaClipper::ClipVeinsImageRegionsOfInterest() {
+    QFETCH(double, sx);
+    QFETCH(double, sz);
+    QFETCH(vector<int>, labels);
+
+    vector<array<double, 3>> veins = VeinDirections();
+    const double spacing[3] = {sx, sx, sz};
+    ImageType::Pointer phantom = AtriumPhantom(veins, spacing);
+
+    // Each mode on its own clipper, ClipVeinsImage changes the cutters
+    ImageType::Pointer labelledFull, labelledRoi;
+    ImageType::Pointer croppedFull = Clip(phantom, veins, labels, false, QDir::currentPath() + "/clipper_full", labelledFull);
+    ImageType::Pointer croppedRoi = Clip(phantom, veins, labels, true, QDir::currentPath() + "/clipper_roi", labelledRoi);
+    QVERIFY(croppedFull.IsNotNull());
+    QVERIFY(croppedRoi.IsNotNull());
+
+    // The veins were cut off the phantom
+    size_t differences;
+    QVERIFY(!SameVoxels(phantom, croppedFull, differences));
+    QVERIFY(differences > 0);
+    itk::ImageRegionConstIterator<ImageType> itLbl(labelledFull, labelledFull->GetLargestPossibleRegion());
+    std::map<short, size_t> labelCounts;
+    for (itLbl.GoToBegin(); !itLbl.IsAtEnd(); ++itLbl)
+        labelCounts[itLbl.Get()]++;
+    for (int label : labels)
+        QVERIFY2(labelCounts[label] > 0, ("No voxels labelled " + to_string(label)).c_str());
+
+    // Voxel by voxel, PVeinsCroppedImage.nii and PVeinsLabelled.nii
+    QVERIFY2(SameVoxels(croppedFull, croppedRoi, differences), (to_string(differences) + " cropped voxels differ").c_str());
+    QVERIFY2(SameVoxels(labelledFull, labelledRoi, differences), (to_string(differences) + " labelled voxels differ").c_str());
+}
+
+void TestCemrgAtriaClipper::ComputeCtrLinesConcurrent() {
+    const QString directory = QDir::currentPath() + "/clipper_centrelines";
+    QDir().mkpath(directory);
+    const vector<int> labels {11, 13, 15, 17};
+    const vector<array<double, 3>> veins = VeinDirections();
+    const double spacing[3] = {1.0, 1.0, 1.0};
+    vtkSmartPointer<vtkIdList> seedIds = vtkSmartPointer<vtkIdList>::New();
+    mitk::Surface::Pointer shell = Shell(AtriumPhantom(veins, spacing), veins, seedIds);
+
+    // Each mode on its own copy of the same shell
+    mitk::Surface::Pointer shellCopy = mitk::Surface::New();
+    vtkSmartPointer<vtkPolyData> copy = vtkSmartPointer<vtkPolyData>::New();
+    copy->DeepCopy(shell->GetVtkPolyData());
+    shellCopy->SetVtkPolyData(copy);
+
+    CemrgAtriaClipper sequential(directory, shell);
+    CemrgAtriaClipper concurrent(directory, shellCopy);
+    concurrent.ConcurrentCentreLinesOn();
+    concurrent.SetNumberOfThreads(3);
+    QVERIFY(sequential.ComputeCtrLines(labels, seedIds, true));
+    QVERIFY(concurrent.ComputeCtrLines(labels, seedIds, true));
+
+    // Same centre lines, point by point, in the order of the seeds
+    vector<vtkSmartPointer<vtkvmtkPolyDataCenterlines>> linesSequential = sequential.GetCentreLines();
+    vector<vtkSmartPointer<vtkvmtkPolyDataCenterlines>> linesConcurrent = concurrent.GetCentreLines();
+    QCOMPARE(linesSequential.size(), labels.size());
+    QCOMPARE(linesConcurrent.size(), labels.size());
+    for (size_t i = 0; i < labels.size(); i++) {
+        vtkPolyData* lineSequential = linesSequential[i]->GetOutput();
+        vtkPolyData* lineConcurrent = linesConcurrent[i]->GetOutput();
+        QVERIFY(lineSequential->GetNumberOfPoints() > 0);
+        QCOMPARE(lineConcurrent->GetNumberOfPoints(), lineSequential->GetNumberOfPoints());
+        for (vtkIdType p = 0; p < lineSequential->GetNumberOfPoints(); p++) {
+            double x1[3], x2[3];
+            lineSequential->GetPoint(p, x1);
+            lineConcurrent->GetPoint(p, x2);
+            QVERIFY2(x1[0] == x2[0] && x1[1] == x2[1] && x1[2] == x2[2], ("Vein " + to_string(i) + ", point " + to_string(p)).c_str());
+        }
+        QCOMPARE(lineConcurrent->GetFieldData()->GetArray("PickedSeedLabels")->GetComponent(0, 0), (double)labels[i]);
+        QCOMPARE(lineSequential->GetFieldData()->GetArray("PickedSeedLabels")->GetComponent(0, 0), (double)labels[i]);
+    }
+
+    // A seed off the shell or a missing seed fails both modes and leaves no centre lines
+    vtkSmartPointer<vtkIdList> offShell = vtkSmartPointer<vtkIdList>::New();
+    offShell->DeepCopy(seedIds);
+    offShell->SetId(2, shell->GetVtkPolyData()->GetNumberOfPoints());
+    vtkSmartPointer<vtkIdList> missing = vtkSmartPointer<vtkIdList>::New();
+    missing->DeepCopy(seedIds);
+    missing->SetNumberOfIds(labels.size() - 1);
+    for (vtkSmartPointer<vtkIdList> badSeeds : {offShell, missing}) {
+        CemrgAtriaClipper sequentialFail(directory, shell);
+        CemrgAtriaClipper concurrentFail(directory, shellCopy);
+        concurrentFail.ConcurrentCentreLinesOn();
+        QVERIFY(!sequentialFail.ComputeCtrLines(labels, badSeeds, true));
+        QVERIFY(!concurrentFail.ComputeCtrLines(labels, badSeeds, true));
+        QVERIFY(sequentialFail.GetCentreLines().empty());
+        QVERIFY(concurrentFail.GetCentreLines().empty());
+    }
+}
+
+int CemrgAtriaClipperTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgAtriaClipper tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,60 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgAtriaClipper.h>
+#include <mitkSurface.h>
+#include <itkImage.h>
+#include <vtkIdList.h>
+#include <map>
+
+using namespace std;
+
+class TestCemrgAtriaClipper : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef itk::Image<short, 3> ImageType;
+
+    // Spherical body (label 1) with a mitral slab (label 2) and cylindrical veins along the given directions
+    ImageType::Pointer AtriumPhantom(const vector<array<double, 3>>& veins, const double spacing[3]);
+    static vector<array<double, 3>> VeinDirections();
+    // Shell of the phantom in the MIRTK frame, with a seed near the tip of each vein
+    static mitk::Surface::Pointer Shell(ImageType::Pointer phantom, const vector<array<double, 3>>& veins, vtkSmartPointer<vtkIdList> seedIds);
+    // Clips the phantom in directory, returns the cropped image and loads PVeinsLabelled.nii into labelled
+    ImageType::Pointer Clip(ImageType::Pointer phantom, const vector<array<double, 3>>& veins, const vector<int>& labels, bool roiClipping, QString directory, ImageType::Pointer& labelled);
+    static bool SameVoxels(ImageType::Pointer image1, ImageType::Pointer image2, size_t& differences);
+
+private slots:
+    void ClipVeinsImageRegionsOfInterest_data();
+    void ClipVeinsImageRegionsOfInterest();
+
+    void ComputeCtrLinesConcurrent();
+};
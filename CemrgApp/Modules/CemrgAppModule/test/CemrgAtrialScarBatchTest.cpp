@@ -0,0 +1,237 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgAtrialScarBatchTest.hpp"
+#include <mitkITKImageImport.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+
+namespace {
+    const QStringList stageNames = {"segmentation", "registration", "clean", "veins", "clipping", "surface", "scar"};
+    const double atriumRadius = 20.0;
+    const double wallThickness = 3.0;
+    const double veinRadius = 5.0;
+    const double veinLength = 38.0;
+}
+
+TestCemrgAtrialScarBatch::ImageType::Pointer TestCemrgAtrialScarBatch::AtriumLabels() {
+    vector<array<double, 3>> veins {{1.0, 0.5, 0.6}, {1.0, -0.5, 0.4}, {-1.0, 0.5, 0.6}, {-1.0, -0.6, 0.3}};
+    for (array<double, 3>& vein : veins) {
+        double norm = sqrt(vein[0] * vein[0] + vein[1] * vein[1] + vein[2] * vein[2]);
+        for (double& component : vein)
+            component /= norm;
+    }
+
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::PointType origin;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, (itk::SizeValueType)(2 * (veinLength + 8)));
+        origin[a] = -0.5 * (region.GetSize(a) - 1);
+    }
+    image->SetRegions(region);
+    image->SetOrigin(origin);
+    image->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        ImageType::PointType point;
+        image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+        double r = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+        short value = (r < atriumRadius) ? 1 : 0;
+        if (value == 1 && point[2] < -0.8 * atriumRadius)
+            value = 3;
+        for (const array<double, 3>& vein : veins) {
+            double along = point[0] * vein[0] + point[1] * vein[1] + point[2] * vein[2];
+            double across = sqrt(max(0.0, r * r - along * along));
+            if (value == 0 && along > 0 && along < veinLength && across < veinRadius)
+                value = 2;
+        }
+        it.Set(value);
+    }
+    return image;
+}
+
+bool TestCemrgAtrialScarBatch::WriteStub(QString name, QString body) {
+    QFile script(stubPath + "/" + name);
+    if (!script.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    script.write(("#!/bin/sh\necho " + name + " >> \"" + stubPath + "/calls.log\"\n" + body + "\n").toUtf8());
+    script.close();
+    return script.setPermissions(script.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+}
+
+bool TestCemrgAtrialScarBatch::RunCase(bool force, QJsonObject& report) {
+    // docker is found on the PATH, register and transform-image in --mirtk-dir
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("PATH", stubPath + ":" + environment.value("PATH"));
+    environment.insert("QT_QPA_PLATFORM", "offscreen");
+
+    QStringList arguments;
+    arguments << "--case" << casePath << "--mirtk-dir" << stubPath << "--threads" << "1";
+    if (force)
+        arguments << "--force";
+
+    QProcess process;
+    process.setProcessEnvironment(environment);
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(batchPath, arguments);
+    if (!process.waitForFinished(-1)) {
+        qWarning() << process.errorString();
+        return false;
+    }
+
+    QFile reportFile(casePath + "/CemrgAtrialScarBatch.json");
+    if (!reportFile.open(QIODevice::ReadOnly))
+        return false;
+    report = QJsonDocument::fromJson(reportFile.readAll()).object();
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+        qWarning().noquote() << QString::fromUtf8(process.readAll());
+    return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
+QStringList TestCemrgAtrialScarBatch::StageStatuses(const QJsonObject& report) {
+    QStringList statuses;
+    for (const QJsonValue& stage : report.value("stages").toArray())
+        statuses << stage.toObject().value("name").toString() + "=" + stage.toObject().value("status").toString();
+    return statuses;
+}
+
+QStringList TestCemrgAtrialScarBatch::StubCalls() {
+    QFile log(stubPath + "/calls.log");
+    if (!log.open(QIODevice::ReadOnly | QIODevice::Text))
+        return {};
+    return QString::fromUtf8(log.readAll()).split("\n", QString::SkipEmptyParts);
+}
+
+void TestCemrgAtrialScarBatch::initTestCase() {
+#ifdef _WIN32
+    QSKIP("The stub executables are shell scripts");
+#endif
+    batchPath = QCoreApplication::applicationDirPath() + "/CemrgAtrialScarBatch";
+    if (!QFileInfo(batchPath).isExecutable())
+        QSKIP("CemrgAtrialScarBatch was not built");
+
+    casePath = QDir::currentPath() + "/batch_case";
+    stubPath = QDir::currentPath() + "/batch_stubs";
+    QDir(casePath).removeRecursively();
+    QDir(stubPath).removeRecursively();
+    QVERIFY(QDir().mkpath(casePath));
+    QVERIFY(QDir().mkpath(stubPath));
+
+    // The MRA and LGE share the grid of the labels, so the stub registration is the identity
+    ImageType::Pointer labels = AtriumLabels();
+    ImageType::Pointer mra = ImageType::New();
+    ImageType::Pointer lge = ImageType::New();
+    for (ImageType::Pointer image : {mra, lge}) {
+        image->SetRegions(labels->GetLargestPossibleRegion());
+        image->SetOrigin(labels->GetOrigin());
+        image->SetSpacing(labels->GetSpacing());
+        image->Allocate();
+    }
+    itk::ImageRegionIteratorWithIndex<ImageType> itLbl(labels, labels->GetLargestPossibleRegion());
+    itk::ImageRegionIteratorWithIndex<ImageType> itMra(mra, mra->GetLargestPossibleRegion());
+    itk::ImageRegionIteratorWithIndex<ImageType> itLge(lge, lge->GetLargestPossibleRegion());
+    for (itLbl.GoToBegin(), itMra.GoToBegin(), itLge.GoToBegin(); !itLbl.IsAtEnd(); ++itLbl, ++itMra, ++itLge) {
+        ImageType::PointType point;
+        labels->TransformIndexToPhysicalPoint(itLbl.GetIndex(), point);
+        double r = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+        bool wall = itLbl.Get() == 0 && r < atriumRadius + wallThickness;
+        itMra.Set(itLbl.Get() != 0 ? 300 : 50);
+        itLge.Set(wall ? 400 : (itLbl.Get() != 0 ? 150 : 60));
+    }
+    mitk::IOUtil::Save(mitk::ImportItkImage(mra), (casePath + "/dcm-MRA.nii").toStdString());
+    mitk::IOUtil::Save(mitk::ImportItkImage(lge), (casePath + "/dcm-LGE.nii").toStdString());
+    mitk::IOUtil::Save(mitk::ImportItkImage(labels), (stubPath + "/prediction.nii").toStdString());
+
+    // CemrgNet writes output.nii next to the MRA, register and transform-image are called as in MIRTK
+    QVERIFY(WriteStub("docker", "cp \"" + stubPath + "/prediction.nii\" \"" + casePath + "/output.nii\""));
+    QVERIFY(WriteStub("register", "printf \"rigid\\n\" > \"$4\""));
+    QVERIFY(WriteStub("transform-image", "cp \"$1\" \"$2\""));
+}
+
+void TestCemrgAtrialScarBatch::FirstRun() {
+    QJsonObject report;
+    QVERIFY2(RunCase(false, report), qPrintable(report.value("message").toString()));
+
+    QCOMPARE(report.value("case").toString(), QDir(casePath).absolutePath());
+    QCOMPARE(report.value("status").toString(), QString("done"));
+    QStringList expected;
+    for (const QString& name : stageNames)
+        expected << name + "=done";
+    QCOMPARE(StageStatuses(report), expected);
+    for (const QJsonValue& stage : report.value("stages").toArray()) {
+        QVERIFY(stage.toObject().value("wallSeconds").toDouble() >= 0);
+        QVERIFY(stage.toObject().contains("cpuSeconds"));
+    }
+
+    // register and transform-image are reported as commands of the registration stage
+    QJsonArray commands = report.value("stages").toArray().at(1).toObject().value("commands").toArray();
+    QCOMPARE(commands.size(), 2);
+    QCOMPARE(commands.at(0).toObject().value("name").toString(), QString("register"));
+    QCOMPARE(commands.at(1).toObject().value("name").toString(), QString("transform-image"));
+    QCOMPARE(commands.at(0).toObject().value("threads").toInt(), 1);
+    QCOMPARE(StubCalls(), QStringList({"docker", "register", "transform-image"}));
+    QVERIFY(QFileInfo(casePath + "/MaxScar.vtk").size() > 0);
+    QVERIFY(QFileInfo(casePath + "/prodThresholds.txt").size() > 0);
+}
+
+void TestCemrgAtrialScarBatch::RerunSkipsUpToDateStages() {
+    QJsonObject report;
+    QVERIFY(RunCase(false, report));
+
+    QCOMPARE(report.value("status").toString(), QString("done"));
+    QStringList expected;
+    for (const QString& name : stageNames)
+        expected << name + "=skipped";
+    QCOMPARE(StageStatuses(report), expected);
+    QCOMPARE(StubCalls().size(), 3);
+}
+
+void TestCemrgAtrialScarBatch::ForceRerunsEveryStage() {
+    QJsonObject report;
+    QVERIFY(RunCase(true, report));
+
+    QCOMPARE(report.value("status").toString(), QString("done"));
+    QStringList expected;
+    for (const QString& name : stageNames)
+        expected << name + "=done";
+    QCOMPARE(StageStatuses(report), expected);
+    QCOMPARE(StubCalls(), QStringList({"docker", "register", "transform-image", "docker", "register", "transform-image"}));
+}
+
+int CemrgAtrialScarBatchTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgAtrialScarBatch tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,61 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <itkImage.h>
+#include <QJsonObject>
+
+using namespace std;
+
+class TestCemrgAtrialScarBatch : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef itk::Image<short, 3> ImageType;
+
+    QString batchPath;
+    QString casePath;
+    QString stubPath;
+
+    // Atrium (label 1) with veins outside it (label 2) and a mitral slab (label 3)
+    ImageType::Pointer AtriumLabels();
+    // Writes a shell script that logs its name to calls.log before running body
+    bool WriteStub(QString name, QString body);
+    // Runs the case in the batch executable and reads its JSON report
+    bool RunCase(bool force, QJsonObject& report);
+    QStringList StageStatuses(const QJsonObject& report);
+    QStringList StubCalls();
+
+private slots:
+    void initTestCase();
+    void FirstRun();
+    void RerunSkipsUpToDateStages();
+    void ForceRerunsEveryStage();
+};
@@ -69,6 +69,18 @@ static bool CopyDirectory(const QString& src, const QString& dst) {
 
     return true;
 }
+static QString CreateFakeExecutable() {
+    // Echoes its first argument, writes it to the file given second and exits with the third
+    const QString scriptPath = QDir::currentPath() + "/fake_command.sh";
+    QFile script(scriptPath);
+    if (!script.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return {};
+    script.write("#!/bin/sh\necho \"fake $1\"\nprintf \"%s\" \"$1\" > \"$2\"\nexit $3\n");
+    script.close();
+    script.setPermissions(script.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+    return scriptPath;
+}
+
 /*
 static QString PrepareSegmentationForCGALMesh(QString dir, QString segmentationFileName) {
     QFileInfo segFileInfo(dir + "/" + segmentationFileName);
@@ -154,6 +166,43 @@ void TestCemrgCommandLine::ExecuteSurf() {
     QVERIFY2(EqualFiles(surfOutput, dataPath + result), "The function output is different from the expected output!");
 }
 
+void TestCemrgCommandLine::ExecuteSurfInProcess_data() {
+    ExecuteSurf_data();
+}
+
+void TestCemrgCommandLine::ExecuteSurfInProcess() {
+    QFETCH(QString, segPath);
+    QFETCH(QString, morphOperation);
+    QFETCH(int, iterations);
+    QFETCH(float, threshold);
+    QFETCH(int, blur);
+    QFETCH(int, smoothness);
+    QFETCH(QString, result);
+
+    // Same surface as MIRTK, within a voxel
+    CemrgSurfaceExtraction surf;
+    QString surfOutput = surf.ExecuteSurf(dataPath, segPath, morphOperation, iterations, threshold, blur, smoothness);
+    QVERIFY(surf.GetLastUsedNative());
+
+    vtkSmartPointer<vtkPolyDataReader> nativeReader = vtkSmartPointer<vtkPolyDataReader>::New();
+    nativeReader->SetFileName(surfOutput.toStdString().c_str());
+    nativeReader->Update();
+    vtkSmartPointer<vtkPolyDataReader> mirtkReader = vtkSmartPointer<vtkPolyDataReader>::New();
+    mirtkReader->SetFileName((dataPath + result).toStdString().c_str());
+    mirtkReader->Update();
+    const double distance = CemrgSurfaceExtraction::HausdorffDistance(nativeReader->GetOutput(), mirtkReader->GetOutput());
+    QVERIFY(distance >= 0);
+    QVERIFY2(distance <= 1.0, ("Hausdorff distance to the MIRTK surface: " + to_string(distance)).c_str());
+
+    // Fidelity mode runs MIRTK as well and keeps the in process surface
+    surf.SetCommandLine(cemrgCommandLine.get());
+    surf.SetFidelityModeOn();
+    surfOutput = surf.ExecuteSurf(dataPath, segPath, morphOperation, iterations, threshold, blur, smoothness);
+    QVERIFY(surf.GetLastHausdorffDistance() >= 0);
+    QCOMPARE(surf.GetLastUsedNative(), surf.GetLastHausdorffDistance() <= 1.0);
+    QVERIFY(cemrgCommandLine->IsOutputSuccessful(surfOutput));
+}
+
 void TestCemrgCommandLine::ExecuteRegistration_data() {
     QTest::addColumn<QString>("fixedFileName");
     QTest::addColumn<QString>("movingFileName");
@@ -287,6 +336,50 @@ void TestCemrgCommandLine::ExecuteApplying() {
         QVERIFY2(EqualFiles(dataPath + "/transformed-" + QString::number(i) + ".vtk", dataPath + result + QString::number(i) + ".vtk"), "The function output is different from the expected output!");
 }
 
+void TestCemrgCommandLine::ExecuteApplyingConcurrent() {
+#ifdef _WIN32
+    QSKIP("The fake executable is a shell script");
+#endif
+    // Fake transform-points writing its arguments to the output mesh
+    const QString fakeMirtk = QDir::currentPath() + "/fake_mlib";
+    const QString workDir = QDir::currentPath() + "/fake_applying";
+    QDir(workDir).removeRecursively();
+    QDir().mkpath(fakeMirtk);
+    QDir().mkpath(workDir);
+    QFile script(fakeMirtk + "/transform-points");
+    QVERIFY(script.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    script.write("#!/bin/sh\nsleep 0.2\necho \"$@\" > \"$2\"\n");
+    script.close();
+    script.setPermissions(script.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+
+    const QString previousMirtk = cemrgCommandLine->GetMirtkDirectory();
+    cemrgCommandLine->SetMirtkDirectory(fakeMirtk);
+    cemrgCommandLine->SetMaximumConcurrentJobs(4);
+    int maxRunning = 0;
+    CemrgCommandLineJobRunner* runner = cemrgCommandLine->GetJobRunner();
+    QMetaObject::Connection connection = connect(runner, &CemrgCommandLineJobRunner::JobStarted, [runner, &maxRunning](CemrgCommandLineJob*) {
+        maxRunning = max(maxRunning, runner->GetNumberOfRunningJobs());
+    });
+
+    // 5 frames with smoothness 2: 10 outputs, 5 ms apart starting at 10
+    const int noFrames = 5, smoothness = 2;
+    cemrgCommandLine->ExecuteApplying(workDir, "mesh.vtk", 10, "tsffd.dof", noFrames, smoothness);
+
+    disconnect(connection);
+    cemrgCommandLine->SetMaximumConcurrentJobs(1);
+    cemrgCommandLine->SetMirtkDirectory(previousMirtk);
+
+    QVERIFY(maxRunning > 1);
+    QVERIFY(maxRunning <= 4);
+    for (int i = 0; i < noFrames * smoothness; i++) {
+        QFile output(workDir + "/transformed-" + QString::number(i) + ".vtk");
+        QVERIFY(output.open(QIODevice::ReadOnly));
+        const QString line = QString(output.readAll()).trimmed();
+        QVERIFY2(line.contains(workDir + "/transformed-" + QString::number(i) + ".vtk"), qPrintable(line));
+        QVERIFY2(line.contains("-St " + QString::number(10 + 5 * i) + " "), qPrintable(line));
+    }
+}
+
 void TestCemrgCommandLine::ExecuteCreateCGALMesh_data() {
     QTest::addColumn<QString>("imageFileName");
     QTest::addColumn<QString>("paramsFileName");
@@ -310,6 +403,203 @@ void TestCemrgCommandLine::ExecuteCreateCGALMesh() {
     QVERIFY(QFileInfo(cgalMeshOutput).exists());
 }
 
+void TestCemrgCommandLine::JobRunner_data() {
+    QTest::addColumn<QString>("message");
+    QTest::addColumn<int>("exitCode");
+
+    const array<tuple<QString, int>, 2> jobData { {
+        {"success", 0},
+        {"failure", 3}
+    } };
+
+    for (size_t i = 0; i < jobData.size(); i++)
+        QTest::newRow(("Test " + to_string(i + 1)).c_str()) << get<0>(jobData[i]) << get<1>(jobData[i]);
+}
+
+void TestCemrgCommandLine::JobRunner() {
+#ifdef _WIN32
+    QSKIP("The fake executable is a shell script");
+#endif
+    QFETCH(QString, message);
+    QFETCH(int, exitCode);
+
+    const QString fakeExe = CreateFakeExecutable();
+    QVERIFY(!fakeExe.isEmpty());
+    const QString outputPath = QDir::currentPath() + "/job_" + message + ".txt";
+    QFile::remove(outputPath);
+
+    CemrgCommandLineJob::Pointer job = cemrgCommandLine->SubmitCommand(fakeExe, QStringList() << message << outputPath << QString::number(exitCode));
+    QVERIFY(job->Wait(10000));
+    QCOMPARE(job->GetState(), CemrgCommandLineJob::FINISHED);
+    QCOMPARE(job->GetExitCode(), exitCode);
+    QCOMPARE(job->IsSuccessful(), exitCode == 0);
+    QVERIFY(job->GetLog().contains("fake " + message));
+
+    // The blocking wrapper judges success by the output file
+    QFile::remove(outputPath);
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, QStringList() << message << outputPath << QString::number(exitCode), outputPath));
+
+    // Missing executables fail to start instead of hanging
+    CemrgCommandLineJob::Pointer missing = cemrgCommandLine->SubmitCommand(QDir::currentPath() + "/does_not_exist", QStringList());
+    QVERIFY(missing->Wait(10000));
+    QCOMPARE(missing->GetState(), CemrgCommandLineJob::FAILED_TO_START);
+}
+
+void TestCemrgCommandLine::JobRunnerConcurrency() {
+#ifdef _WIN32
+    QSKIP("The fake executable is a shell script");
+#endif
+    const QString fakeExe = CreateFakeExecutable();
+    QVERIFY(!fakeExe.isEmpty());
+
+    CemrgCommandLineJobRunner runner(2);
+    int maxRunning = 0;
+    connect(&runner, &CemrgCommandLineJobRunner::JobStarted, [&runner, &maxRunning](CemrgCommandLineJob*) {
+        maxRunning = max(maxRunning, runner.GetNumberOfRunningJobs());
+    });
+
+    vector<CemrgCommandLineJob::Pointer> jobs;
+    for (int i = 0; i < 6; i++) {
+        const QString outputPath = QDir::currentPath() + "/job_concurrent_" + QString::number(i) + ".txt";
+        jobs.push_back(runner.Submit(fakeExe, QStringList() << QString::number(i) << outputPath << "0"));
+    }
+
+    QVERIFY(runner.GetNumberOfRunningJobs() <= 2);
+    QVERIFY(runner.WaitForAll(20000));
+    QVERIFY(maxRunning <= 2);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        QVERIFY(jobs[i]->IsSuccessful());
+        QVERIFY(jobs[i]->GetLog().contains("fake " + QString::number(i)));
+    }
+}
+
+void TestCemrgCommandLine::JobRunnerThreadCap() {
+#ifdef _WIN32
+    QSKIP("The fake executable is a shell script");
+#endif
+    const QString fakeExe = CreateFakeExecutable();
+    QVERIFY(!fakeExe.isEmpty());
+
+    // 3 threads each under a cap of 7: two jobs at a time even though 6 are allowed
+    CemrgCommandLineJobRunner runner(6);
+    runner.SetMaximumConcurrentThreads(7);
+    int maxThreads = 0;
+    connect(&runner, &CemrgCommandLineJobRunner::JobStarted, [&runner, &maxThreads](CemrgCommandLineJob* job) {
+        if (job->GetThreads() == 3)
+            maxThreads = max(maxThreads, runner.GetNumberOfRunningThreads());
+    });
+
+    vector<CemrgCommandLineJob::Pointer> jobs;
+    for (int i = 0; i < 6; i++) {
+        const QString outputPath = QDir::currentPath() + "/job_threads_" + QString::number(i) + ".txt";
+        jobs.push_back(runner.Submit(fakeExe, QStringList() << QString::number(i) << outputPath << "0", "", QProcessEnvironment(), 3));
+    }
+    // Larger than the cap: runs on its own
+    jobs.push_back(runner.Submit(fakeExe, QStringList() << "big" << QDir::currentPath() + "/job_threads_big.txt" << "0", "", QProcessEnvironment(), 12));
+
+    QVERIFY(runner.WaitForAll(20000));
+    QVERIFY(maxThreads <= 7);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        QVERIFY(jobs[i]->IsSuccessful());
+        QVERIFY(jobs[i]->GetElapsedSeconds() >= 0);
+        if (i < 6) QCOMPARE(jobs[i]->GetThreads(), 3);
+    }
+
+    // Each MIRTK wrapper passes the configured -threads to the runner
+    cemrgCommandLine->SetThreadsPerJob(5);
+    QCOMPARE(cemrgCommandLine->GetThreadsPerJob(), 5);
+    cemrgCommandLine->SetMaximumConcurrentThreads(4);
+    QCOMPARE(cemrgCommandLine->GetThreadsPerJob(), 4);
+    CemrgCommandLineJob::Pointer job = cemrgCommandLine->SubmitCommand(fakeExe, QStringList() << "t" << QDir::currentPath() + "/job_threads_cmd.txt" << "0" << "-threads" << "4");
+    QVERIFY(job->Wait(10000));
+    QCOMPARE(job->GetThreads(), 4);
+    QVERIFY(!cemrgCommandLine->GetStageTimings().empty());
+    QCOMPARE(cemrgCommandLine->GetStageTimings().back().threads, 4);
+    cemrgCommandLine->SetResourceProfile(CemrgCommandLine::ResourceProfile());
+}
+
+void TestCemrgCommandLine::OutputCache() {
+#ifdef _WIN32
+    QSKIP("The fake executable is a shell script");
+#endif
+    const QString fakeExe = CreateFakeExecutable();
+    QVERIFY(!fakeExe.isEmpty());
+
+    shared_ptr<CemrgCommandLineCache> cache = make_shared<CemrgCommandLineCache>(QDir::currentPath() + "/command_cache");
+    cache->Clear();
+    cemrgCommandLine->SetOutputCache(cache);
+
+    const QString outputPath = QDir::currentPath() + "/job_cached.txt";
+    const QStringList cachedArgs = QStringList() << "cached" << outputPath << "0";
+    const QStringList otherArgs = QStringList() << "other" << outputPath << "0";
+
+    // First run spawns the process and fills the cache
+    QFile::remove(outputPath);
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, cachedArgs, outputPath));
+    QCOMPARE(cache->GetMisses(), 1);
+    QCOMPARE(cache->GetHits(), 0);
+
+    // Same command restores the output without running
+    QThread::msleep(10);
+    QFile::remove(outputPath);
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, cachedArgs, outputPath));
+    QCOMPARE(cache->GetHits(), 1);
+    QFile restored(outputPath);
+    QVERIFY(restored.open(QIODevice::ReadOnly));
+    QCOMPARE(restored.readAll(), QByteArray("cached"));
+    restored.close();
+
+    // Different arguments are a different entry
+    QThread::msleep(10);
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, otherArgs, outputPath));
+    QCOMPARE(cache->GetMisses(), 2);
+    QCOMPARE(cache->GetSize(), qint64(11));
+
+    // Over the cap the least recently used entry goes first
+    cache->SetMaximumSize(6);
+    cache->Evict();
+    QCOMPARE(cache->GetSize(), qint64(5));
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, otherArgs, outputPath));
+    QCOMPARE(cache->GetHits(), 2);
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, cachedArgs, outputPath));
+    QCOMPARE(cache->GetMisses(), 3);
+
+    // Thread count of the command is not part of the key
+    const QString key = cache->Key(fakeExe, cachedArgs, outputPath);
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(cache->Key(fakeExe, QStringList(cachedArgs) << "-threads" << "2", outputPath), cache->Key(fakeExe, QStringList(cachedArgs) << "-threads" << "16", outputPath));
+    QCOMPARE(cache->Key(fakeExe, QStringList(cachedArgs) << "-threads" << "2", outputPath), key);
+    QVERIFY(cache->Key(fakeExe, QStringList(cachedArgs) << "-other" << "2", outputPath) != key);
+
+    // Relative inputs of two cases: the case directory and the declared inputs tell them apart
+    QDir home(QDir::currentPath());
+    QVERIFY(home.mkpath("cache_case_a") && home.mkpath("cache_case_b"));
+    const QString frameA = home.absoluteFilePath("cache_case_a/dcm-0.nii");
+    const QString frameB = home.absoluteFilePath("cache_case_b/dcm-0.nii");
+    QFile fileA(frameA), fileB(frameB);
+    QVERIFY(fileA.open(QIODevice::WriteOnly) && fileA.write("frame a") > 0);
+    QVERIFY(fileB.open(QIODevice::WriteOnly) && fileB.write("frame b") > 0);
+    fileA.close();
+    fileB.close();
+
+    const QStringList volumeArgs = QStringList() << "-msh=dcm-0" << outputPath;
+    QVERIFY(cache->Key(fakeExe, QStringList(volumeArgs) << home.absoluteFilePath("cache_case_a"), outputPath) != cache->Key(fakeExe, QStringList(volumeArgs) << home.absoluteFilePath("cache_case_b"), outputPath));
+    QVERIFY(cache->Key(fakeExe, volumeArgs, outputPath, QStringList() << frameA) != cache->Key(fakeExe, volumeArgs, outputPath, QStringList() << frameB));
+    QVERIFY(cache->Key(fakeExe, volumeArgs, outputPath, QStringList() << home.absoluteFilePath("cache_case_a/missing.nii")).isEmpty());
+
+    // Same arguments run by another image build
+    QVERIFY(cache->Key(fakeExe, volumeArgs, outputPath, QStringList(), QStringList() << "sha256:aa") != cache->Key(fakeExe, volumeArgs, outputPath, QStringList(), QStringList() << "sha256:bb"));
+
+    // Commands with undeclared inputs run without the cache
+    const int hits = cache->GetHits();
+    const int misses = cache->GetMisses();
+    QVERIFY(cemrgCommandLine->ExecuteCommand(fakeExe, cachedArgs, outputPath, true, QStringList(), false));
+    QCOMPARE(cache->GetHits(), hits);
+    QCOMPARE(cache->GetMisses(), misses);
+
+    cemrgCommandLine->SetOutputCache(nullptr);
+}
+
 int CemrgCommandLineTest(int argc, char *argv[]) {
     QApplication app(argc, argv);
     app.setAttribute(Qt::AA_Use96Dpi, true);
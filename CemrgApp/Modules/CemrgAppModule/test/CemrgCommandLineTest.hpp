@@ -30,6 +30,10 @@ PURPOSE.  See the above copyright notices for more information.
 // CemrgApp
 #include "CemrgTestCommon.hpp"
 #include <CemrgCommandLine.h>
+#include <CemrgSurfaceExtraction.h>
+
+// VTK
+#include <vtkPolyDataReader.h>
 
 using namespace std;
 
@@ -49,6 +53,9 @@ private slots:
     void ExecuteSurf_data();
     void ExecuteSurf();
 
+    void ExecuteSurfInProcess_data();
+    void ExecuteSurfInProcess();
+
     void ExecuteRegistration_data();
     void ExecuteRegistration();
 
@@ -63,7 +70,16 @@ private slots:
 
     void ExecuteApplying_data();
     void ExecuteApplying();
+    void ExecuteApplyingConcurrent();
 
     void ExecuteCreateCGALMesh_data();
     void ExecuteCreateCGALMesh();
+
+    void JobRunner_data();
+    void JobRunner();
+
+    void JobRunnerConcurrency();
+    void JobRunnerThreadCap();
+
+    void OutputCache();
 };
\ No newline at end of file
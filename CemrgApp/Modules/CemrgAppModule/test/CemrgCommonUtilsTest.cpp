@@ -0,0 +1,402 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgCommonUtilsTest.hpp"
+
+typedef CemrgCommonUtils::CarpElements CarpElements;
+
+static void WriteTextFile(const QString& path, const string& contents) {
+    ofstream file(path.toStdString(), ios::binary);
+    file << contents;
+}
+
+void TestCemrgCommonUtils::ReadCarpPoints_data() {
+    QTest::addColumn<QString>("contents");
+
+    QTest::newRow("Integers") << "2\n0 0 0\n1 -2 3\n";
+    QTest::newRow("Decimals") << "3\n0.1 -2.25 300.5\n12345.678901234 -0.000125 7\n1e-5 -1.0E+3 2.5e2\n";
+    QTest::newRow("Long mantissa") << "2\n0.12345678901234567890123 98765432109876543210 1e300\n-2.2250738585072014e-308 1.7976931348623157e308 0.3333333333333333\n";
+    QTest::newRow("CRLF and no trailing newline") << "2\r\n1.5 2.5 3.5\r\n-1.5 -2.5 -3.5";
+}
+
+void TestCemrgCommonUtils::ReadCarpPoints() {
+    QFETCH(QString, contents);
+
+    const QString path = "./fastpath.pts";
+    WriteTextFile(path, contents.toStdString());
+
+    // Reference values read with the standard stream parser
+    ifstream reference(path.toStdString());
+    int nPts;
+    reference >> nPts;
+    vector<double> expected(3 * nPts);
+    for (size_t i = 0; i < expected.size(); i++)
+        reference >> expected[i];
+
+    vector<double> pts;
+    QVERIFY(CemrgCommonUtils::ReadCarpPoints(path, pts));
+    QCOMPARE(pts.size(), expected.size());
+    for (size_t i = 0; i < pts.size(); i++)
+        QVERIFY2(pts[i] == expected[i], ("Value " + to_string(i) + " doesn't match!").c_str());
+}
+
+void TestCemrgCommonUtils::CarpPointsRoundTrip_data() {
+    QTest::addColumn<QString>("contents");
+
+    QTest::newRow("Single point") << "1\n-12.5 33.25 1000\n";
+    QTest::newRow("Several points") << "4\n0 0 0\n1000.5 -2000.25 3000.125\n0.5 0.25 0.125\n-7 8 -9\n";
+}
+
+void TestCemrgCommonUtils::CarpPointsRoundTrip() {
+    QFETCH(QString, contents);
+
+    WriteTextFile("./roundtrip.pts", contents.toStdString());
+    vector<double> ascii, binary, asciiAgain;
+    QVERIFY(CemrgCommonUtils::ReadCarpPoints("./roundtrip.pts", ascii));
+
+    QVERIFY(CemrgCommonUtils::WriteCarpPoints("./roundtrip.bpts", ascii));
+    QVERIFY(CemrgCommonUtils::ReadCarpPoints("./roundtrip.bpts", binary));
+    QCOMPARE(binary.size(), ascii.size());
+    for (size_t i = 0; i < ascii.size(); i++)
+        QCOMPARE(binary[i], (double)(float)ascii[i]);
+
+    QVERIFY(CemrgCommonUtils::WriteCarpPoints("./roundtrip_copy.pts", binary));
+    QVERIFY(CemrgCommonUtils::ReadCarpPoints("./roundtrip_copy.pts", asciiAgain));
+    QVERIFY(asciiAgain == binary);
+}
+
+void TestCemrgCommonUtils::CarpElementsRoundTrip_data() {
+    QTest::addColumn<QString>("contents");
+    QTest::addColumn<vector<int>>("types");
+    QTest::addColumn<vector<int>>("nodes");
+    QTest::addColumn<vector<int>>("regions");
+
+    QTest::newRow("Tetrahedra") << "2\nTt 0 1 2 3 1\nTt 1 2 3 4 2\n"
+        << vector<int>{CemrgCommonUtils::CARP_TT, CemrgCommonUtils::CARP_TT}
+        << vector<int>{0, 1, 2, 3, 1, 2, 3, 4}
+        << vector<int>{1, 2};
+    QTest::newRow("Mixed elements") << "3\nTr 0 1 2 5\nHx 0 1 2 3 4 5 6 7 2\nTt 3 2 1 0\n"
+        << vector<int>{CemrgCommonUtils::CARP_TR, CemrgCommonUtils::CARP_HX, CemrgCommonUtils::CARP_TT}
+        << vector<int>{0, 1, 2, 0, 1, 2, 3, 4, 5, 6, 7, 3, 2, 1, 0}
+        << vector<int>{5, 2, 0};
+}
+
+void TestCemrgCommonUtils::CarpElementsRoundTrip() {
+    QFETCH(QString, contents);
+    QFETCH(vector<int>, types);
+    QFETCH(vector<int>, nodes);
+    QFETCH(vector<int>, regions);
+
+    WriteTextFile("./roundtrip.elem", contents.toStdString());
+    CarpElements ascii, binary, asciiAgain;
+    QVERIFY(CemrgCommonUtils::ReadCarpElements("./roundtrip.elem", ascii));
+    QVERIFY(ascii.types == types);
+    QVERIFY(ascii.nodes == nodes);
+    QVERIFY(ascii.regions == regions);
+
+    QVERIFY(CemrgCommonUtils::WriteCarpElements("./roundtrip.belem", ascii));
+    QVERIFY(CemrgCommonUtils::ReadCarpElements("./roundtrip.belem", binary));
+    QVERIFY(binary.types == ascii.types);
+    QVERIFY(binary.offsets == ascii.offsets);
+    QVERIFY(binary.nodes == ascii.nodes);
+    QVERIFY(binary.regions == ascii.regions);
+
+    QVERIFY(CemrgCommonUtils::WriteCarpElements("./roundtrip_copy.elem", binary));
+    QVERIFY(CemrgCommonUtils::ReadCarpElements("./roundtrip_copy.elem", asciiAgain));
+    QVERIFY(asciiAgain.types == ascii.types);
+    QVERIFY(asciiAgain.offsets == ascii.offsets);
+    QVERIFY(asciiAgain.nodes == ascii.nodes);
+    QVERIFY(asciiAgain.regions == ascii.regions);
+}
+
+void TestCemrgCommonUtils::CarpFibresRoundTrip_data() {
+    QTest::addColumn<QString>("contents");
+    QTest::addColumn<int>("numAxes");
+
+    QTest::newRow("Fibres") << "1\n1 0 0\n0.5 0.5 0\n0 0 -1\n" << 1;
+    QTest::newRow("Fibres and sheets") << "2\n1 0 0 0 1 0\n0.25 0.5 0.125 0 0 1\n" << 2;
+}
+
+void TestCemrgCommonUtils::CarpFibresRoundTrip() {
+    QFETCH(QString, contents);
+    QFETCH(int, numAxes);
+
+    WriteTextFile("./roundtrip.lon", contents.toStdString());
+    vector<double> ascii, binary, asciiAgain;
+    int axesAscii, axesBinary, axesAsciiAgain;
+    QVERIFY(CemrgCommonUtils::ReadCarpFibres("./roundtrip.lon", ascii, axesAscii));
+    QCOMPARE(axesAscii, numAxes);
+
+    QVERIFY(CemrgCommonUtils::WriteCarpFibres("./roundtrip.blon", ascii, axesAscii));
+    QVERIFY(CemrgCommonUtils::ReadCarpFibres("./roundtrip.blon", binary, axesBinary));
+    QCOMPARE(axesBinary, numAxes);
+    QCOMPARE(binary.size(), ascii.size());
+    for (size_t i = 0; i < ascii.size(); i++)
+        QCOMPARE(binary[i], (double)(float)ascii[i]);
+
+    QVERIFY(CemrgCommonUtils::WriteCarpFibres("./roundtrip_copy.lon", binary, axesBinary));
+    QVERIFY(CemrgCommonUtils::ReadCarpFibres("./roundtrip_copy.lon", asciiAgain, axesAsciiAgain));
+    QCOMPARE(axesAsciiAgain, numAxes);
+    QVERIFY(asciiAgain == binary);
+}
+
+void TestCemrgCommonUtils::CarpToVtkFields_data() {
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QString>("outputPath");
+
+    QTest::newRow("ASCII legacy") << (int)CemrgCommonUtils::CARP_VTK_ASCII << "./carptovtk_ascii.vtk";
+    QTest::newRow("Binary legacy") << (int)CemrgCommonUtils::CARP_VTK_BINARY << "./carptovtk_binary.vtk";
+    QTest::newRow("Appended VTU") << (int)CemrgCommonUtils::CARP_VTU_APPENDED << "./carptovtk_appended.vtu";
+}
+
+void TestCemrgCommonUtils::CarpToVtkFields() {
+    QFETCH(int, format);
+    QFETCH(QString, outputPath);
+
+    WriteTextFile("./carptovtk.pts", "6\n0 0 0\n1 0 0\n0 1 0\n0 0 1\n1 1 0\n1 1 1\n");
+    WriteTextFile("./carptovtk.elem", "3\nTt 0 1 2 3 1\nTr 1 4 2 7\nPr 0 1 2 3 5 4 2\n");
+
+    vector<CemrgCommonUtils::CarpVtkField> fields(3);
+    fields[0] = {"pointScalar", false, 1, {0.5, 1.5, 2.5, 3.5, 4.5, 5.5}};
+    fields[1] = {"cellScalar", true, 1, {-1, -2, -3}};
+    fields[2] = {"cellVector", true, 3, {1, 0, 0, 0, 1, 0, 0, 0, 1}};
+    QVERIFY(CemrgCommonUtils::CarpToVtkFields("./carptovtk.elem", "./carptovtk.pts", outputPath, fields, format, true));
+
+    vtkSmartPointer<vtkUnstructuredGrid> grid;
+    if (format == CemrgCommonUtils::CARP_VTU_APPENDED) {
+        vtkSmartPointer<vtkXMLUnstructuredGridReader> reader = vtkSmartPointer<vtkXMLUnstructuredGridReader>::New();
+        reader->SetFileName(outputPath.toStdString().c_str());
+        reader->Update();
+        grid = reader->GetOutput();
+    } else {
+        vtkSmartPointer<vtkUnstructuredGridReader> reader = vtkSmartPointer<vtkUnstructuredGridReader>::New();
+        reader->SetFileName(outputPath.toStdString().c_str());
+        reader->Update();
+        grid = reader->GetOutput();
+    }
+
+    QCOMPARE(grid->GetNumberOfPoints(), (vtkIdType)6);
+    QCOMPARE(grid->GetNumberOfCells(), (vtkIdType)3);
+    QCOMPARE(grid->GetCellType(0), VTK_TETRA);
+    QCOMPARE(grid->GetCellType(1), VTK_TRIANGLE);
+    QCOMPARE(grid->GetCellType(2), VTK_WEDGE);
+    QCOMPARE(grid->GetCell(2)->GetPointId(4), (vtkIdType)5);
+
+    double x[3];
+    grid->GetPoint(5, x);
+    QCOMPARE(x[0] + x[1] + x[2], 3.0);
+
+    vtkDataArray* regions = grid->GetCellData()->GetArray("region_labels");
+    vtkDataArray* cellScalar = grid->GetCellData()->GetArray("cellScalar");
+    vtkDataArray* cellVector = grid->GetCellData()->GetArray("cellVector");
+    vtkDataArray* pointScalar = grid->GetPointData()->GetArray("pointScalar");
+    QVERIFY(regions != nullptr && cellScalar != nullptr && cellVector != nullptr && pointScalar != nullptr);
+    QCOMPARE(regions->GetTuple1(1), 7.0);
+    QCOMPARE(regions->GetTuple1(2), 2.0);
+    QCOMPARE(cellScalar->GetTuple1(2), -3.0);
+    QCOMPARE(cellVector->GetNumberOfComponents(), 3);
+    QCOMPARE(cellVector->GetComponent(1, 1), 1.0);
+    QCOMPARE(pointScalar->GetTuple1(4), 4.5);
+}
+
+void TestCemrgCommonUtils::ComputeLabelGeometry_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("Single thread") << 1;
+    QTest::newRow("Three threads") << 3;
+}
+
+void TestCemrgCommonUtils::ComputeLabelGeometry() {
+    QFETCH(int, threads);
+
+    typedef CemrgCommonUtils::LabelImageType ImageType;
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    region.SetIndex(0, 0); region.SetIndex(1, 0); region.SetIndex(2, 0);
+    region.SetSize(0, 20); region.SetSize(1, 16); region.SetSize(2, 12);
+    image->SetRegions(region);
+    double spacing[3] = {0.5, 1.0, 2.0};
+    double origin[3] = {-10.0, 5.0, 2.5};
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->Allocate();
+    image->FillBuffer(0);
+
+    // A box (label 1), a rod along x (label 4) and a single voxel (label 7)
+    typedef itk::ImageRegionIteratorWithIndex<ImageType> ItType;
+    ItType it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        ImageType::IndexType idx = it.GetIndex();
+        if (idx[0] >= 2 && idx[0] <= 6 && idx[1] >= 3 && idx[1] <= 9 && idx[2] >= 1 && idx[2] <= 4)
+            it.Set(1);
+        else if (idx[1] == 12 && idx[2] == 8 && idx[0] >= 4)
+            it.Set(4);
+    }
+    ImageType::IndexType single;
+    single[0] = 19; single[1] = 15; single[2] = 11;
+    image->SetPixel(single, 7);
+
+    vector<CemrgCommonUtils::LabelGeometry> geometry = CemrgCommonUtils::ComputeLabelGeometry(image, true, threads);
+    QCOMPARE(geometry.size(), (size_t)3);
+    QCOMPARE(geometry[0].label, 1);
+    QCOMPARE(geometry[1].label, 4);
+    QCOMPARE(geometry[2].label, 7);
+    QVERIFY(CemrgCommonUtils::FindLabelGeometry(geometry, 2) == nullptr);
+    QCOMPARE(CemrgCommonUtils::FindLabelGeometry(geometry, 4)->count, (uint64_t)16);
+
+    // Reference centroids and boxes from a plain sweep per label
+    for (const CemrgCommonUtils::LabelGeometry& g : geometry) {
+        uint64_t count = 0;
+        double centroid[3] = {0, 0, 0};
+        for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+            if (it.Get() != g.label)
+                continue;
+            ImageType::PointType point;
+            image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+            for (int a = 0; a < 3; a++)
+                centroid[a] += point[a];
+            count++;
+        }
+        QCOMPARE(g.count, count);
+        for (int a = 0; a < 3; a++)
+            QVERIFY(std::abs(g.centroid[a] - centroid[a] / count) < 1e-9);
+        QCOMPARE((uint64_t)g.Region().GetNumberOfPixels(), g.count);
+    }
+
+    // The rod has a single non-zero moment, along x
+    const CemrgCommonUtils::LabelGeometry& rod = geometry[1];
+    QVERIFY(rod.principalMoments[0] < 1e-9 && rod.principalMoments[1] < 1e-9);
+    QVERIFY(std::abs(rod.principalMoments[2] - 0.25 * (16 * 16 - 1) / 12.0) < 1e-9);
+    QVERIFY(std::abs(std::abs(rod.principalAxes[2][0]) - 1.0) < 1e-9);
+
+    vector<CemrgCommonUtils::LabelGeometry> withBackground = CemrgCommonUtils::ComputeLabelGeometry(image, false, threads);
+    QCOMPARE(withBackground.size(), (size_t)4);
+    QCOMPARE(withBackground[0].label, 0);
+    QCOMPARE(withBackground[0].count, (uint64_t)(20 * 16 * 12) - 140 - 16 - 1);
+}
+
+void TestCemrgCommonUtils::FlipXYPoints_data() {
+    QTest::addColumn<int>("dataType");
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("Float, single thread") << (int)VTK_FLOAT << 1;
+    QTest::newRow("Float, four threads") << (int)VTK_FLOAT << 4;
+    QTest::newRow("Double, four threads") << (int)VTK_DOUBLE << 4;
+    QTest::newRow("Int, fallback") << (int)VTK_INT << 4;
+}
+
+void TestCemrgCommonUtils::FlipXYPoints() {
+    QFETCH(int, dataType);
+    QFETCH(int, threads);
+
+    // Enough points for several chunks
+    const vtkIdType numPoints = 300000;
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New(dataType);
+    points->SetNumberOfPoints(numPoints);
+    for (vtkIdType i = 0; i < numPoints; i++)
+        points->SetPoint(i, (i % 97) - 40, (i % 89) - 10, (i % 83) + 5);
+    double expectedBounds[6] = {-56, 40, -78, 10, 5, 87};
+
+    double bounds[6];
+    CemrgCommonUtils::FlipXYPoints(points, bounds, threads);
+    for (int a = 0; a < 6; a++)
+        QCOMPARE(bounds[a], expectedBounds[a]);
+    for (vtkIdType i = 0; i < numPoints; i += 997) {
+        double point[3];
+        points->GetPoint(i, point);
+        QCOMPARE(point[0], -(double)((i % 97) - 40));
+        QCOMPARE(point[1], -(double)((i % 89) - 10));
+        QCOMPARE(point[2], (double)((i % 83) + 5));
+    }
+
+    // Flipping twice gives the points back
+    CemrgCommonUtils::FlipXYPoints(points, nullptr, threads);
+    double point[3];
+    points->GetPoint(numPoints - 1, point);
+    QCOMPARE(point[0], (double)(((numPoints - 1) % 97) - 40));
+    QCOMPARE(point[1], (double)(((numPoints - 1) % 89) - 10));
+}
+
+void TestCemrgCommonUtils::LoadVTKMeshLazyFlip() {
+    // Off-centre sphere, so a flip of x and y moves the bounds
+    const QString path = QDir::currentPath() + "/lazy_flip.vtk";
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetCenter(13.0, -4.5, 7.0);
+    sphere->SetRadius(6.0);
+    sphere->SetThetaResolution(20);
+    sphere->SetPhiResolution(15);
+    sphere->Update();
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(sphere->GetOutput());
+    writer->SetFileName(path.toStdString().c_str());
+    writer->Write();
+
+    mitk::Surface::Pointer eager = CemrgCommonUtils::LoadVTKMesh(path.toStdString());
+    mitk::Surface::Pointer lazy = CemrgCommonUtils::LoadVTKMesh(path.toStdString(), true);
+    vtkPolyData* eagerPd = eager->GetVtkPolyData();
+    vtkPolyData* lazyPd = lazy->GetVtkPolyData();
+    QCOMPARE(lazyPd->GetNumberOfPoints(), eagerPd->GetNumberOfPoints());
+    QVERIFY(lazyPd->GetNumberOfPoints() > 0);
+
+    // The lazy points stay as read, the geometry maps each one on its eager flip
+    for (vtkIdType i = 0; i < lazyPd->GetNumberOfPoints(); i++) {
+        double original[3], flipped[3];
+        lazyPd->GetPoint(i, original);
+        eagerPd->GetPoint(i, flipped);
+        QCOMPARE(original[0], -flipped[0]);
+        QCOMPARE(original[1], -flipped[1]);
+        mitk::Point3D index, world;
+        index[0] = original[0];
+        index[1] = original[1];
+        index[2] = original[2];
+        lazy->GetGeometry()->IndexToWorld(index, world);
+        QCOMPARE(world[0], flipped[0]);
+        QCOMPARE(world[1], flipped[1]);
+        QCOMPARE(world[2], flipped[2]);
+    }
+
+    // World bounds of both surfaces are those of the flipped points
+    double expectedBounds[6];
+    eagerPd->GetBounds(expectedBounds);
+    QVERIFY(expectedBounds[1] < 0);
+    mitk::BoundingBox::BoundsArrayType eagerBounds = eager->GetGeometry()->CalculateBoundingBoxRelativeToTransform(nullptr)->GetBounds();
+    mitk::BoundingBox::BoundsArrayType lazyBounds = lazy->GetGeometry()->CalculateBoundingBoxRelativeToTransform(nullptr)->GetBounds();
+    for (int a = 0; a < 6; a++) {
+        QCOMPARE((double)eagerBounds[a], expectedBounds[a]);
+        QCOMPARE((double)lazyBounds[a], expectedBounds[a]);
+    }
+}
+
+int CemrgCommonUtilsTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgCommonUtils tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
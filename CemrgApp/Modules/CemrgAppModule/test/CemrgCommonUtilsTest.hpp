@@ -0,0 +1,72 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgCommonUtils.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkUnstructuredGridReader.h>
+#include <vtkXMLUnstructuredGridReader.h>
+#include <vtkCellData.h>
+#include <vtkPointData.h>
+#include <vtkSphereSource.h>
+#include <vtkPolyDataWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+using namespace std;
+
+class TestCemrgCommonUtils : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void ReadCarpPoints_data();
+    void ReadCarpPoints();
+
+    void CarpPointsRoundTrip_data();
+    void CarpPointsRoundTrip();
+
+    void CarpElementsRoundTrip_data();
+    void CarpElementsRoundTrip();
+
+    void CarpFibresRoundTrip_data();
+    void CarpFibresRoundTrip();
+
+    void CarpToVtkFields_data();
+    void CarpToVtkFields();
+
+    void ComputeLabelGeometry_data();
+    void ComputeLabelGeometry();
+
+    void FlipXYPoints_data();
+    void FlipXYPoints();
+
+    void LoadVTKMeshLazyFlip();
+};
+
+Q_DECLARE_METATYPE(vector<int>)
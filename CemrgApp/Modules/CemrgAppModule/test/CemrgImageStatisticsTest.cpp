@@ -0,0 +1,249 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgImageStatisticsTest.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+vector<float> TestCemrgImageStatistics::Image(int type, size_t numVoxels) {
+    mt19937 generator(7);
+    vector<float> image(numVoxels);
+    if (type == 0) {
+        uniform_int_distribution<int> values(-40, 250);
+        for (size_t i = 0; i < numVoxels; i++)
+            image[i] = values(generator);
+    } else {
+        normal_distribution<float> values(100.0f, 25.0f);
+        for (size_t i = 0; i < numVoxels; i++)
+            image[i] = values(generator);
+        for (size_t i = 3; i < numVoxels; i += 997)
+            image[i] = numeric_limits<float>::quiet_NaN();
+        for (size_t i = 5; i < numVoxels; i += 1999)
+            image[i] = (i % 2 == 0) ? numeric_limits<float>::infinity() : -numeric_limits<float>::infinity();
+    }
+    return image;
+}
+
+vector<float> TestCemrgImageStatistics::Mask(size_t numVoxels) {
+    vector<float> mask(numVoxels);
+    for (size_t i = 0; i < numVoxels; i++)
+        mask[i] = (i % 3 == 2) ? 2 : 1;
+    return mask;
+}
+
+vector<double> TestCemrgImageStatistics::Reference(const vector<float>& image, const vector<float>& mask, int maskLabel) {
+    vector<double> values;
+    for (size_t i = 0; i < image.size(); i++) {
+        bool inMask = mask.empty() || (maskLabel < 0 ? mask[i] != 0 : mask[i] == maskLabel);
+        if (inMask && isfinite(image[i]))
+            values.push_back(image[i]);
+    }
+    sort(values.begin(), values.end());
+    return values;
+}
+
+void TestCemrgImageStatistics::Moments_data() {
+    QTest::addColumn<int>("type");
+    QTest::addColumn<int>("maskLabel");
+    QTest::addColumn<int>("threads");
+
+    for (int type = 0; type < 2; type++)
+        for (int maskLabel : {-1, 1})
+            for (int threads : {1, 4})
+                QTest::newRow(("Type " + to_string(type) + ", label " + to_string(maskLabel) + ", " + to_string(threads) + " threads").c_str())
+                    << type << maskLabel << threads;
+}
+
+void TestCemrgImageStatistics::Moments() {
+    QFETCH(int, type);
+    QFETCH(int, maskLabel);
+    QFETCH(int, threads);
+
+    // Five blocks, the last one partial
+    const size_t numVoxels = 300000;
+    vector<float> image = Image(type, numVoxels);
+    vector<float> mask = Mask(numVoxels);
+
+    CemrgImageStatistics stats;
+    stats.SetNumberOfThreads(threads);
+    QVERIFY(stats.Accumulate(image.data(), mask.data(), numVoxels, maskLabel));
+
+    // Two-pass reference on the finite voxels only
+    vector<double> values = Reference(image, mask, maskLabel);
+    double mean = accumulate(values.begin(), values.end(), 0.0) / values.size();
+    double m2 = 0;
+    for (double value : values)
+        m2 += (value - mean) * (value - mean);
+
+    QCOMPARE(stats.GetCount(), (uint64_t)values.size());
+    QVERIFY(fabs(stats.GetMean() - mean) <= 1e-9 * fabs(mean));
+    QVERIFY(fabs(stats.GetVariance() - m2 / values.size()) <= 1e-9 * m2 / values.size());
+    QCOMPARE(stats.GetMinimum(), values.front());
+    QCOMPARE(stats.GetMaximum(), values.back());
+
+    // Chan merge of two halves against the whole
+    CemrgImageStatistics first, second;
+    first.Accumulate(image.data(), mask.data(), numVoxels / 3, maskLabel);
+    second.Accumulate(image.data() + numVoxels / 3, mask.data() + numVoxels / 3, numVoxels - numVoxels / 3, maskLabel);
+    first.Merge(second);
+    QCOMPARE(first.GetCount(), stats.GetCount());
+    QVERIFY(fabs(first.GetMean() - mean) <= 1e-9 * fabs(mean));
+    QVERIFY(fabs(first.GetVariance() - m2 / values.size()) <= 1e-9 * m2 / values.size());
+}
+
+void TestCemrgImageStatistics::Threads_data() {
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("Integers") << 0;
+    QTest::newRow("Floats with NaN and Inf") << 1;
+}
+
+void TestCemrgImageStatistics::Threads() {
+    QFETCH(int, type);
+
+    const size_t numVoxels = 300000;
+    vector<float> image = Image(type, numVoxels);
+    vector<float> mask = Mask(numVoxels);
+
+    // Fixed blocks merged in order, so the threads change nothing, not even the last bit
+    CemrgImageStatistics single;
+    single.SetNumberOfThreads(1);
+    single.SetHistogramOn();
+    QVERIFY(single.Accumulate(image.data(), mask.data(), numVoxels, 1));
+    for (int threads : {2, 3, 8}) {
+        CemrgImageStatistics multi;
+        multi.SetNumberOfThreads(threads);
+        multi.SetHistogramOn();
+        QVERIFY(multi.Accumulate(image.data(), mask.data(), numVoxels, 1));
+        QCOMPARE(multi.GetCount(), single.GetCount());
+        QVERIFY(multi.GetMean() == single.GetMean());
+        QVERIFY(multi.GetVariance() == single.GetVariance());
+        QVERIFY(multi.GetMinimum() == single.GetMinimum());
+        QVERIFY(multi.GetMaximum() == single.GetMaximum());
+        QVERIFY(multi.GetHistogram() == single.GetHistogram());
+    }
+}
+
+void TestCemrgImageStatistics::Percentiles_data() {
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("Integers, exact histogram") << 0;
+    QTest::newRow("Floats, binned histogram") << 1;
+}
+
+void TestCemrgImageStatistics::Percentiles() {
+    QFETCH(int, type);
+
+    const size_t numVoxels = 200000;
+    vector<float> image = Image(type, numVoxels);
+    vector<float> mask = Mask(numVoxels);
+
+    CemrgImageStatistics stats;
+    stats.SetHistogramOn();
+    stats.SetMaximumNumberOfBins(4096);
+    QVERIFY(stats.Accumulate(image.data(), mask.data(), numVoxels, 1));
+    QCOMPARE(stats.IsHistogramExact(), type == 0);
+
+    // Exact answers on integers, within one bin otherwise
+    vector<double> values = Reference(image, mask, 1);
+    double tolerance = (type == 0) ? 0 : stats.GetBinWidth();
+    for (double percent : {0.0, 0.2, 5.0, 25.0, 50.0, 75.0, 99.8, 100.0}) {
+        double position = percent / 100.0 * (values.size() - 1);
+        size_t lo = (size_t)floor(position), hi = (size_t)ceil(position);
+        double expected = values[lo] + (position - lo) * (values[hi] - values[lo]);
+        QVERIFY2(fabs(stats.GetPercentile(percent) - expected) <= tolerance, ("Percentile " + to_string(percent)).c_str());
+    }
+}
+
+void TestCemrgImageStatistics::RanksWithTies() {
+    // Few distinct values, each repeated a different number of times
+    vector<float> image;
+    for (int value = 3; value < 12; value++)
+        image.insert(image.end(), (value * 7) % 5 + 1, (float)value);
+    image.push_back(-2);
+    image.push_back(-2);
+
+    CemrgImageStatistics stats;
+    stats.SetHistogramOn();
+    const float* noMask = nullptr;
+    QVERIFY(stats.Accumulate(image.data(), noMask, image.size()));
+    QVERIFY(stats.IsHistogramExact());
+
+    vector<double> values = Reference(image, vector<float>(), -1);
+    QCOMPARE(stats.GetCount(), (uint64_t)values.size());
+    for (size_t r = 0; r < values.size(); r++)
+        QCOMPARE(stats.GetValueAtRank(r), values[r]);
+    // Past the end clamps to the largest value
+    QCOMPARE(stats.GetValueAtRank(values.size() + 5), values.back());
+
+    // Every window, including ones that start or end inside a run of ties
+    for (size_t first = 0; first <= values.size(); first++)
+        for (size_t last = first; last <= values.size(); last++)
+            QCOMPARE(stats.GetRankSum(first, last), accumulate(values.begin() + first, values.begin() + last, 0.0));
+}
+
+void TestCemrgImageStatistics::EmptyMask() {
+    const size_t numVoxels = 70000;
+    vector<float> image = Image(1, numVoxels);
+    vector<float> mask(numVoxels, 0);
+
+    CemrgImageStatistics stats;
+    stats.SetHistogramOn();
+    QVERIFY(!stats.Accumulate(image.data(), mask.data(), numVoxels));
+    QCOMPARE(stats.GetCount(), (uint64_t)0);
+    QVERIFY(!stats.HasHistogram());
+    QVERIFY(std::isnan(stats.GetPercentile(50)));
+
+    // A label nobody has, and a mask that only covers NaN and Inf voxels
+    QVERIFY(!stats.Accumulate(image.data(), Mask(numVoxels).data(), numVoxels, 3));
+    mask[3] = 1;
+    mask[5] = 1;
+    QVERIFY(!stats.Accumulate(image.data(), mask.data(), numVoxels));
+    QCOMPARE(stats.GetCount(), (uint64_t)0);
+
+    // All-zero histogram
+    QVERIFY(!stats.AccumulateHistogram(vector<uint64_t>(10, 0), 0));
+    QCOMPARE(stats.GetCount(), (uint64_t)0);
+
+    // The non-finite voxels do not spoil the rest of the image
+    mask[4] = 1;
+    QVERIFY(stats.Accumulate(image.data(), mask.data(), numVoxels));
+    QCOMPARE(stats.GetCount(), (uint64_t)1);
+    QCOMPARE(stats.GetMean(), (double)image[4]);
+}
+
+int CemrgImageStatisticsTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgImageStatistics tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
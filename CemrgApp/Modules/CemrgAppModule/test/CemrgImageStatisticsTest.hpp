@@ -0,0 +1,59 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgImageStatistics.h>
+
+using namespace std;
+
+class TestCemrgImageStatistics : public QObject {
+
+    Q_OBJECT
+
+private:
+    // Reproducible voxels over several blocks: 0 integers with many ties, 1 floats with NaN and Inf
+    static vector<float> Image(int type, size_t numVoxels);
+    // Label 1 on roughly two voxels out of three, 2 elsewhere
+    static vector<float> Mask(size_t numVoxels);
+    // Finite voxels under the mask, sorted
+    static vector<double> Reference(const vector<float>& image, const vector<float>& mask, int maskLabel);
+
+private slots:
+    void Moments_data();
+    void Moments();
+
+    void Threads_data();
+    void Threads();
+
+    void Percentiles_data();
+    void Percentiles();
+
+    void RanksWithTies();
+    void EmptyMask();
+};
@@ -0,0 +1,224 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgLgeSamplerTest.hpp"
+#include <itkImageRegionIteratorWithIndex.h>
+
+namespace {
+    const int minStep = -3;
+    const int maxStep = 3;
+
+    void RandomDirection(mt19937& generator, double direction[3]) {
+        normal_distribution<double> normal(0.0, 1.0);
+        double norm = 0;
+        while (norm < 1e-6) {
+            norm = 0;
+            for (int a = 0; a < 3; a++) {
+                direction[a] = normal(generator);
+                norm += direction[a] * direction[a];
+            }
+            norm = sqrt(norm);
+        }
+        for (int a = 0; a < 3; a++)
+            direction[a] /= norm;
+    }
+}
+
+TestCemrgLgeSampler::ImageType::Pointer TestCemrgLgeSampler::NewImage(const int size[3]) {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, size[a]);
+    }
+    image->SetRegions(region);
+    image->Allocate();
+    image->FillBuffer(0);
+    return image;
+}
+
+bool TestCemrgLgeSampler::ReferenceGather(const ImageType* image, const ImageType* cutImage, const double centre[3], const double direction[3],
+    int minStep, int maxStep, vector<float>& values, vector<itk::OffsetValueType>& offsets) {
+    values.clear();
+    offsets.clear();
+    const ImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    vector<ImageType::IndexType> points;
+    for (double i = minStep; i <= maxStep; i += 1) {
+        double x = floor(centre[0] + (i * direction[0]));
+        double y = floor(centre[1] + (i * direction[1]));
+        double z = floor(centre[2] + (i * direction[2]));
+        for (int a = -1; a <= 1; a++) {
+            for (int b = -1; b <= 1; b++) {
+                for (int c = -1; c <= 1; c++) {
+                    if (x + a >= 0 && x + a < size[0] && y + b >= 0 && y + b < size[1] && z + c >= 0 && z + c < size[2]) {
+                        ImageType::IndexType index;
+                        index[0] = x + a;
+                        index[1] = y + b;
+                        index[2] = z + c;
+                        points.push_back(index);
+                    }
+                }
+            }
+        }
+    }
+    for (const ImageType::IndexType& index : points)
+        if (cutImage != nullptr && cutImage->GetPixel(index) == 3)
+            return false;
+    for (const ImageType::IndexType& index : points) {
+        values.push_back(image->GetPixel(index));
+        offsets.push_back(image->ComputeOffset(index));
+    }
+    return true;
+}
+
+void TestCemrgLgeSampler::NearestMatchesGather() {
+    const int size[3] = {21, 17, 13};
+    mt19937 generator(42);
+    uniform_int_distribution<int> intensity(0, 1000);
+    uniform_int_distribution<int> percent(0, 99);
+
+    // Random intensities, a few cut voxels
+    ImageType::Pointer image = NewImage(size);
+    ImageType::Pointer cutImage = NewImage(size);
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+    itk::ImageRegionIteratorWithIndex<ImageType> itCut(cutImage, cutImage->GetLargestPossibleRegion());
+    for (it.GoToBegin(), itCut.GoToBegin(); !it.IsAtEnd(); ++it, ++itCut) {
+        it.Set(intensity(generator));
+        itCut.Set(percent(generator) == 0 ? 3 : 1);
+    }
+
+    CemrgLgeSampler sampler, cutSampler;
+    sampler.Build(image);
+    cutSampler.Build(image, cutImage);
+    QCOMPARE(sampler.GetKernel(), CemrgLgeSampler::NEAREST);
+
+    // Centres over the whole image and past its borders
+    uniform_real_distribution<double> position(-2.0, 1.0);
+    int cutCount = 0;
+    vector<float> values, expectedValues;
+    vector<itk::OffsetValueType> offsets, expectedOffsets;
+    for (int n = 0; n < 2000; n++) {
+        double centre[3], direction[3];
+        for (int a = 0; a < 3; a++)
+            centre[a] = position(generator) + (size[a] + 3) * (n % 97) / 97.0;
+        RandomDirection(generator, direction);
+
+        QVERIFY(sampler.SampleAlongNormal(centre, direction, minStep, maxStep, values, offsets));
+        QVERIFY(ReferenceGather(image, nullptr, centre, direction, minStep, maxStep, expectedValues, expectedOffsets));
+        QVERIFY(values == expectedValues);
+        QVERIFY(offsets == expectedOffsets);
+
+        bool kept = cutSampler.SampleAlongNormal(centre, direction, minStep, maxStep, values, offsets);
+        QCOMPARE(kept, ReferenceGather(image, cutImage, centre, direction, minStep, maxStep, expectedValues, expectedOffsets));
+        if (kept) {
+            QVERIFY(values == expectedValues);
+            QVERIFY(offsets == expectedOffsets);
+        } else {
+            cutCount++;
+        }
+    }
+    QVERIFY(cutCount > 0 && cutCount < 2000);
+}
+
+void TestCemrgLgeSampler::LinearRamp_data() {
+    QTest::addColumn<int>("kernel");
+    QTest::addColumn<int>("margin");
+
+    // B-spline coefficients follow the mirrored border for a few voxels
+    QTest::newRow("Trilinear") << (int)CemrgLgeSampler::TRILINEAR << 2;
+    QTest::newRow("B-spline") << (int)CemrgLgeSampler::BSPLINE << 12;
+}
+
+void TestCemrgLgeSampler::LinearRamp() {
+    QFETCH(int, kernel);
+    QFETCH(int, margin);
+
+    const int size[3] = {48, 44, 40};
+    const double slope[3] = {2.0, 3.0, 5.0};
+    auto ramp = [&slope](const double p[3]) {
+        return 10.0 + slope[0] * p[0] + slope[1] * p[1] + slope[2] * p[2];
+    };
+
+    ImageType::Pointer image = NewImage(size);
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        const double p[3] = {(double)it.GetIndex()[0], (double)it.GetIndex()[1], (double)it.GetIndex()[2]};
+        it.Set((short)ramp(p));
+    }
+
+    CemrgLgeSampler sampler;
+    sampler.SetKernel((CemrgLgeSampler::Kernel)kernel);
+    sampler.Build(image);
+
+    // Steps and their neighbours stay clear of the borders
+    mt19937 generator(7);
+    vector<float> values;
+    vector<itk::OffsetValueType> offsets;
+    double maxError = 0;
+    for (int n = 0; n < 500; n++) {
+        double centre[3], direction[3];
+        for (int a = 0; a < 3; a++) {
+            uniform_real_distribution<double> position(margin + maxStep + 1, size[a] - 1 - margin - maxStep - 1);
+            centre[a] = position(generator);
+        }
+        RandomDirection(generator, direction);
+        QVERIFY(sampler.SampleAlongNormal(centre, direction, minStep, maxStep, values, offsets));
+        QCOMPARE((int)values.size(), 27 * (maxStep - minStep + 1));
+
+        // Sample (a, b, c) of a step is the value one voxel away from it, reported with its closest voxel
+        size_t k = 0;
+        for (int i = minStep; i <= maxStep; i++) {
+            double p[3];
+            for (int d = 0; d < 3; d++)
+                p[d] = centre[d] + i * direction[d];
+            for (int a = -1; a <= 1; a++) {
+                for (int b = -1; b <= 1; b++) {
+                    for (int c = -1; c <= 1; c++, k++) {
+                        const int shift[3] = {a, b, c};
+                        const double q[3] = {p[0] + a, p[1] + b, p[2] + c};
+                        maxError = max(maxError, abs(values[k] - ramp(q)));
+                        ImageType::IndexType index;
+                        for (int d = 0; d < 3; d++)
+                            index[d] = (itk::IndexValueType)floor(p[d] + 0.5) + shift[d];
+                        QCOMPARE(offsets[k], image->ComputeOffset(index));
+                    }
+                }
+            }
+        }
+    }
+    // Exact up to single precision on values of a few hundred
+    QVERIFY2(maxError < 1e-3, ("Largest error " + to_string(maxError)).c_str());
+}
+
+int CemrgLgeSamplerTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgLgeSampler tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
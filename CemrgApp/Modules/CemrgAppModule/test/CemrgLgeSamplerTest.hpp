@@ -0,0 +1,53 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgLgeSampler.h>
+#include <random>
+
+using namespace std;
+
+class TestCemrgLgeSampler : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef CemrgLgeSampler::ImageType ImageType;
+
+    static ImageType::Pointer NewImage(const int size[3]);
+    // The 3x3x3 GetPixel gather of the original projection, false if a voxel is cut
+    static bool ReferenceGather(const ImageType* image, const ImageType* cutImage, const double centre[3], const double direction[3],
+        int minStep, int maxStep, vector<float>& values, vector<itk::OffsetValueType>& offsets);
+
+private slots:
+    void NearestMatchesGather();
+
+    void LinearRamp_data();
+    void LinearRamp();
+};
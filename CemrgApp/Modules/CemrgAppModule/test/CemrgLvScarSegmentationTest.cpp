@@ -0,0 +1,191 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgLvScarSegmentationTest.hpp"
+#include <itkImageRegionIteratorWithIndex.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const int phantomSize[3] = {48, 44, 30};
+}
+
+TestCemrgLvScarSegmentation::ImageType::Pointer TestCemrgLvScarSegmentation::NewImage(const int size[3]) {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, size[a]);
+    }
+    image->SetRegions(region);
+    image->Allocate();
+    image->FillBuffer(0);
+    return image;
+}
+
+void TestCemrgLvScarSegmentation::Phantom(ImageType::Pointer& image, ImageType::Pointer& wall, ImageType::Pointer& remote) {
+    image = NewImage(phantomSize);
+    wall = NewImage(phantomSize);
+    remote = NewImage(phantomSize);
+
+    mt19937 generator(17);
+    normal_distribution<double> blood(300.0, 40.0), myocardium(120.0, 25.0), infarct(700.0, 80.0);
+    uniform_int_distribution<int> percent(0, 99);
+
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        ImageType::IndexType index = it.GetIndex();
+        double x = index[0] - 24.0, y = index[1] - 22.0;
+        double radius = sqrt(x * x + y * y);
+        bool inWall = radius >= 10 && radius < 15 && index[2] > 2 && index[2] < 27;
+        double value = (radius < 10) ? blood(generator) : myocardium(generator);
+        if (inWall && x > 3 && y > 0)
+            value = infarct(generator);
+        // Zero-intensity voxels are not part of the wall
+        if (inWall && percent(generator) < 3)
+            value = 0;
+        it.Set((short)std::max(0.0, round(value)));
+        wall->SetPixel(index, inWall ? 1 : 0);
+        remote->SetPixel(index, (inWall && x < -8 && fabs(y) < 4) ? 1 : 0);
+    }
+}
+
+TestCemrgLvScarSegmentation::ImageType::Pointer TestCemrgLvScarSegmentation::ReferenceLV(const ImageType* image, const ImageType* wall) {
+    ImageType::Pointer lv = NewImage(phantomSize);
+    itk::ImageRegionIteratorWithIndex<ImageType> it(lv, lv->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+        it.Set(wall->GetPixel(it.GetIndex()) != 0 ? image->GetPixel(it.GetIndex()) : 0);
+    return lv;
+}
+
+double TestCemrgLvScarSegmentation::ReferencePeak(const ImageType* lv) {
+    // Sorted non-zero wall intensities, mean of the top 0.2% as in FWMH_getPeak_SORT
+    vector<int> arr;
+    const short* buffer = lv->GetBufferPointer();
+    for (itk::SizeValueType i = 0; i < lv->GetLargestPossibleRegion().GetNumberOfPixels(); i++)
+        if (buffer[i] != 0)
+            arr.push_back(buffer[i]);
+    sort(arr.begin(), arr.end());
+    int m = arr.size();
+    int start = m * 0.998;
+    double max = 0;
+    for (int i = start - 1; i < m; i++)
+        max += arr[i];
+    return max / (m - start);
+}
+
+double TestCemrgLvScarSegmentation::ReferenceStats(const ImageType* image, const ImageType* mask, int a) {
+    // GetStats: 1 mean, 2 population standard deviation, 3 maximum
+    int n = 0;
+    double sum = 0, diff = 0, max = -1;
+    const short* pvImage = image->GetBufferPointer();
+    const short* pvMask = mask->GetBufferPointer();
+    const itk::SizeValueType numVoxels = image->GetLargestPossibleRegion().GetNumberOfPixels();
+    for (itk::SizeValueType i = 0; i < numVoxels; i++) {
+        if (pvMask[i] != 0) {
+            max = std::max(max, (double)pvImage[i]);
+            sum += pvImage[i];
+            n++;
+        }
+    }
+    double mean = sum / n;
+    for (itk::SizeValueType i = 0; i < numVoxels; i++)
+        if (pvMask[i] != 0)
+            diff += (pvImage[i] - mean) * (pvImage[i] - mean);
+    return (a == 1) ? mean : (a == 2) ? sqrt(diff / n) : max;
+}
+
+TestCemrgLvScarSegmentation::ImageType::Pointer TestCemrgLvScarSegmentation::ReferenceMask(const ImageType* image, const ImageType* lv, double threshold) {
+    // thresholdImage on a copy of the LGE
+    ImageType::Pointer mask = NewImage(phantomSize);
+    itk::ImageRegionIteratorWithIndex<ImageType> it(mask, mask->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+        it.Set((image->GetPixel(it.GetIndex()) >= threshold && lv->GetPixel(it.GetIndex()) != 0) ? 256 : 0);
+    return mask;
+}
+
+void TestCemrgLvScarSegmentation::MatchesPerClick_data() {
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void TestCemrgLvScarSegmentation::MatchesPerClick() {
+    QFETCH(int, threads);
+
+    ImageType::Pointer image, wall, remote;
+    Phantom(image, wall, remote);
+    ImageType::Pointer lv = ReferenceLV(image, wall);
+
+    CemrgLvScarSegmentation engine;
+    engine.SetNumberOfThreads(threads);
+    QVERIFY(engine.Build(image, wall, remote));
+    QVERIFY(engine.HasRemote());
+
+    const itk::SizeValueType numVoxels = image->GetLargestPossibleRegion().GetNumberOfPixels();
+    ImageType::Pointer output = NewImage(phantomSize);
+
+    // FWHM, half the peak of the wall
+    double fwhm = 0.5 * ReferencePeak(lv);
+    QVERIFY(fabs(engine.GetFWHMThreshold() - fwhm) <= 1e-9 * fwhm);
+    engine.WriteMask(output, engine.GetFWHMThreshold());
+    ImageType::Pointer expected = ReferenceMask(image, lv, fwhm);
+    QVERIFY(equal(output->GetBufferPointer(), output->GetBufferPointer() + numVoxels, expected->GetBufferPointer()));
+
+    // Remote mean + n SD, in range only below the wall maximum
+    double mean = ReferenceStats(image, remote, 1), sd = ReferenceStats(image, remote, 2), max = ReferenceStats(image, lv, 3);
+    for (int n : {2, 4, 6, 60}) {
+        double threshold = mean + n * sd;
+        QVERIFY2(fabs(engine.GetSDThreshold(n) - threshold) <= 1e-9 * threshold, ("SD " + to_string(n)).c_str());
+        QCOMPARE(engine.IsInRange(engine.GetSDThreshold(n)), max > threshold);
+        if (max > threshold) {
+            engine.WriteMask(output, engine.GetSDThreshold(n));
+            expected = ReferenceMask(image, lv, threshold);
+            QVERIFY2(equal(output->GetBufferPointer(), output->GetBufferPointer() + numVoxels, expected->GetBufferPointer()), ("SD " + to_string(n)).c_str());
+        }
+    }
+}
+
+void TestCemrgLvScarSegmentation::EmptyWall() {
+    ImageType::Pointer image, wall, remote;
+    Phantom(image, wall, remote);
+    wall->FillBuffer(0);
+
+    CemrgLvScarSegmentation engine;
+    QVERIFY(!engine.Build(image, wall, remote));
+    QVERIFY(!engine.IsBuilt());
+}
+
+int CemrgLvScarSegmentationTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgLvScarSegmentation tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,57 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgLvScarSegmentation.h>
+#include <random>
+
+using namespace std;
+
+class TestCemrgLvScarSegmentation : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef CemrgLvScarSegmentation::ImageType ImageType;
+
+    static ImageType::Pointer NewImage(const int size[3]);
+    // LV wall shell with a bright infarct, zero-intensity holes and a remote patch
+    static void Phantom(ImageType::Pointer& image, ImageType::Pointer& wall, ImageType::Pointer& remote);
+    // The per-click YZSegView computations the engine replaces
+    static ImageType::Pointer ReferenceLV(const ImageType* image, const ImageType* wall);
+    static double ReferencePeak(const ImageType* lv);
+    static double ReferenceStats(const ImageType* image, const ImageType* mask, int a);
+    static ImageType::Pointer ReferenceMask(const ImageType* image, const ImageType* lv, double threshold);
+
+private slots:
+    void MatchesPerClick_data();
+    void MatchesPerClick();
+
+    void EmptyWall();
+};
@@ -37,6 +37,14 @@ void TestCemrgMeasure::initTestCase() {
         surfaceData[i].first = QFINDTESTDATA(CemrgTestData::surfacePaths[i]);
         surfaceData[i].second = mitk::IOUtil::Load<mitk::Surface>(surfaceData[i].first.toStdString());
     }
+
+    vtkSmartPointer<vtkSphereSource> sphereSource = vtkSmartPointer<vtkSphereSource>::New();
+    sphereSource->SetCenter(3.0, -2.0, 5.0);
+    sphereSource->SetRadius(20.0);
+    sphereSource->SetThetaResolution(400);
+    sphereSource->SetPhiResolution(200);
+    sphereSource->Update();
+    largeSphere = sphereSource->GetOutput();
 }
 
 void TestCemrgMeasure::cleanupTestCase() {
@@ -202,6 +210,110 @@ void TestCemrgMeasure::calcSurfaceMesh() {
     QCOMPARE(cemrgMeasure->calcSurfaceMesh(surface), result);
 }
 
+double TestCemrgMeasure::ReferenceSphericity(vtkPolyData* polyData) {
+    const vtkIdType numCells = polyData->GetNumberOfCells();
+    vector<double> areas(numCells);
+    vector<array<double, 3>> centres(numCells);
+    double totalArea = 0, centroid[3] = {0, 0, 0};
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType i = 0; i < numCells; i++) {
+        double p[3][3], e1[3], e2[3], cross[3];
+        polyData->GetCellPoints(i, cellPoints);
+        for (int n = 0; n < 3; n++)
+            polyData->GetPoint(cellPoints->GetId(n), p[n]);
+        vtkMath::Subtract(p[0], p[1], e1);
+        vtkMath::Subtract(p[1], p[2], e2);
+        vtkMath::Cross(e1, e2, cross);
+        areas[i] = 0.5 * vtkMath::Norm(cross);
+        totalArea += areas[i];
+        for (int a = 0; a < 3; a++)
+            centres[i][a] = (p[0][a] + p[1][a] + p[2][a]) / 3;
+    }
+    for (vtkIdType i = 0; i < numCells; i++)
+        for (int a = 0; a < 3; a++)
+            centroid[a] += areas[i] / totalArea * centres[i][a];
+    double averageRadius = 0;
+    for (vtkIdType i = 0; i < numCells; i++)
+        averageRadius += areas[i] / totalArea * sqrt(vtkMath::Distance2BetweenPoints(centroid, centres[i].data()));
+    double deviation = 0;
+    for (vtkIdType i = 0; i < numCells; i++) {
+        double r = sqrt(vtkMath::Distance2BetweenPoints(centroid, centres[i].data())) - averageRadius;
+        deviation += areas[i] / totalArea * r * r;
+    }
+    return 100 * (1 - sqrt(deviation) / averageRadius);
+}
+
+void TestCemrgMeasure::ComputeMeshGeometry_data() {
+    QTest::addColumn<vtkPolyData*>("polyData");
+
+    for (size_t i = 0; i < surfaceData.size(); i++)
+        QTest::newRow(("Test " + QFileInfo(surfaceData[i].first).fileName().toStdString()).c_str()) << surfaceData[i].second->GetVtkPolyData();
+    QTest::newRow("Test generated sphere") << largeSphere.GetPointer();
+}
+
+void TestCemrgMeasure::ComputeMeshGeometry() {
+    QFETCH(vtkPolyData*, polyData);
+
+    auto relativeError = [](double value, double expected) {
+        return abs(value - expected) / max(1.0, abs(expected));
+    };
+
+    CemrgMeasure::MeshGeometry serial = cemrgMeasure->ComputeMeshGeometry(polyData, 1);
+    CemrgMeasure::MeshGeometry parallel = cemrgMeasure->ComputeMeshGeometry(polyData, 4);
+    QCOMPARE(serial.numberOfTriangles, polyData->GetNumberOfCells());
+
+    //Area and volume of vtkMassProperties, sphericity of the per-triangle computation
+    vtkSmartPointer<vtkMassProperties> massProperties = vtkSmartPointer<vtkMassProperties>::New();
+    massProperties->SetInputData(polyData);
+    massProperties->Update();
+    QVERIFY(relativeError(serial.area, massProperties->GetSurfaceArea()) < 1e-9);
+    QVERIFY(relativeError(serial.volume, massProperties->GetVolume()) < 1e-9);
+    QVERIFY(relativeError(serial.sphericity, ReferenceSphericity(polyData)) < 1e-9);
+
+    //Independent of the number of threads, the generated sphere is split between 4 workers
+    if (polyData == largeSphere.GetPointer())
+        QVERIFY(polyData->GetNumberOfCells() >= 4 * 16384);
+    QCOMPARE(parallel.numberOfTriangles, serial.numberOfTriangles);
+    QVERIFY(relativeError(parallel.area, serial.area) < 1e-12);
+    QVERIFY(relativeError(parallel.volume, serial.volume) < 1e-12);
+    QVERIFY(relativeError(parallel.sphericity, serial.sphericity) < 1e-12);
+    for (int k = 0; k < 3; k++) {
+        QVERIFY(relativeError(parallel.centroid[k], serial.centroid[k]) < 1e-12);
+        QVERIFY(relativeError(parallel.ellipsoidRadii[k], serial.ellipsoidRadii[k]) < 1e-9);
+    }
+
+    //Close to the analytic values on the generated sphere
+    if (polyData == largeSphere.GetPointer()) {
+        const double radius = 20.0;
+        QVERIFY(relativeError(serial.area, 4 * vtkMath::Pi() * radius * radius) < 1e-3);
+        QVERIFY(relativeError(serial.volume, 4.0 / 3.0 * vtkMath::Pi() * radius * radius * radius) < 1e-3);
+        QVERIFY(serial.sphericity > 99.9);
+        QVERIFY(abs(serial.centroid[0] - 3.0) < 1e-4 && abs(serial.centroid[1] + 2.0) < 1e-4 && abs(serial.centroid[2] - 5.0) < 1e-4);
+        for (int k = 0; k < 3; k++)
+            QVERIFY(abs(serial.ellipsoidRadii[k] - radius) < 0.05);
+    }
+
+    //Ellipsoid radii sorted and holding every vertex
+    QVERIFY(serial.ellipsoidRadii[0] <= serial.ellipsoidRadii[1]);
+    QVERIFY(serial.ellipsoidRadii[1] <= serial.ellipsoidRadii[2]);
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    double maxNorm = 0;
+    for (vtkIdType i = 0; i < polyData->GetNumberOfCells(); i++) {
+        polyData->GetCellPoints(i, cellPoints);
+        for (vtkIdType j = 0; j < cellPoints->GetNumberOfIds(); j++) {
+            double point[3], norm = 0;
+            polyData->GetPoint(cellPoints->GetId(j), point);
+            for (int k = 0; k < 3; k++) {
+                double proj = 0;
+                for (int a = 0; a < 3; a++)
+                    proj += (point[a] - serial.centroid[a]) * serial.ellipsoidAxes[k][a];
+                norm += (proj * proj) / (serial.ellipsoidRadii[k] * serial.ellipsoidRadii[k]);
+            }
+            maxNorm = max(maxNorm, norm);
+        }
+    }
+    QVERIFY(maxNorm <= 1 + 1e-6);
+}
 
 /*****************************************************************************************************/
 /***************************************  Conversion Functions ***************************************/
@@ -29,6 +29,10 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "CemrgTestCommon.hpp"
 #include <CemrgMeasure.h>
+#include <vtkIdList.h>
+#include <vtkSphereSource.h>
+#include <vtkMassProperties.h>
+#include <vtkMath.h>
 
 using namespace std;
 
@@ -40,6 +44,11 @@ private:
     unique_ptr<CemrgMeasure> cemrgMeasure { new CemrgMeasure() };
 
     array<pair<QString, mitk::Surface::Pointer>, CemrgTestData::surfacePaths.size()> surfaceData;
+    // Over 100k triangles, enough for several workers in ComputeMeshGeometry
+    vtkSmartPointer<vtkPolyData> largeSphere;
+
+    // Sphericity as computed before ComputeMeshGeometry, one triangle at a time
+    static double ReferenceSphericity(vtkPolyData* polyData);
 
 private slots:
     void initTestCase();
@@ -66,6 +75,9 @@ private slots:
     void calcSurfaceMesh_data();
     void calcSurfaceMesh();
 
+    void ComputeMeshGeometry_data();
+    void ComputeMeshGeometry();
+
     void Convert_data();
     void Convert();
 
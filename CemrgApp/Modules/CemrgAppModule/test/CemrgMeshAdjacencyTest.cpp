@@ -0,0 +1,201 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgMeshAdjacencyTest.hpp"
+#include <vtkSphereSource.h>
+#include <vtkCellArray.h>
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkPoints.h>
+#include <algorithm>
+
+vtkSmartPointer<vtkPolyData> TestCemrgMeshAdjacency::Mesh(int type) {
+    if (type == 0) {
+        vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+        sphere->SetThetaResolution(9);
+        sphere->SetPhiResolution(7);
+        sphere->Update();
+        return sphere->GetOutput();
+    }
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    if (type == 1) {
+        // Zig-zag strip of 9 points, 7 triangles
+        cells->InsertNextCell(9);
+        for (int j = 0; j < 9; j++) {
+            points->InsertNextPoint(0.5 * j, j % 2, 0);
+            cells->InsertCellPoint(j);
+        }
+        mesh->SetPoints(points);
+        mesh->SetStrips(cells);
+    } else {
+        // Poly-line 0-1-2-3-4, a 2-point line 4-5, vertices on 2 and on the isolated point 6
+        for (int j = 0; j < 7; j++)
+            points->InsertNextPoint(j, 0.1 * j * j, 0);
+        cells->InsertNextCell(5);
+        for (int j = 0; j < 5; j++)
+            cells->InsertCellPoint(j);
+        cells->InsertNextCell(2);
+        cells->InsertCellPoint(4);
+        cells->InsertCellPoint(5);
+        vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+        verts->InsertNextCell(1);
+        verts->InsertCellPoint(2);
+        verts->InsertNextCell(1);
+        verts->InsertCellPoint(6);
+        mesh->SetPoints(points);
+        mesh->SetLines(cells);
+        mesh->SetVerts(verts);
+    }
+    mesh->BuildLinks();
+    return mesh;
+}
+
+set<vtkIdType> TestCemrgMeshAdjacency::ReferenceNeighbours(vtkPolyData* mesh, vtkIdType id) {
+    set<vtkIdType> neighbours;
+    vtkSmartPointer<vtkIdList> cells = vtkSmartPointer<vtkIdList>::New();
+    vtkSmartPointer<vtkIdList> cellPoints = vtkSmartPointer<vtkIdList>::New();
+    mesh->GetPointCells(id, cells);
+
+    for (vtkIdType c = 0; c < cells->GetNumberOfIds(); c++) {
+        int cellType = mesh->GetCellType(cells->GetId(c));
+        mesh->GetCellPoints(cells->GetId(c), cellPoints);
+        vtkIdType npts = cellPoints->GetNumberOfIds();
+
+        vector<int> steps;
+        bool closed = false;
+        if (cellType == VTK_TRIANGLE_STRIP) {
+            steps = {-2, -1, 1, 2};
+        } else if (cellType == VTK_LINE || cellType == VTK_POLY_LINE) {
+            steps = {-1, 1};
+        } else if (cellType != VTK_VERTEX && cellType != VTK_POLY_VERTEX) {
+            steps = {-1, 1};
+            closed = true;
+        }
+
+        for (vtkIdType k = 0; k < npts; k++) {
+            if (cellPoints->GetId(k) != id)
+                continue;
+            for (int step : steps) {
+                vtkIdType other = k + step;
+                if (closed)
+                    other = (other + npts) % npts;
+                if (other >= 0 && other < npts && cellPoints->GetId(other) != id)
+                    neighbours.insert(cellPoints->GetId(other));
+            }
+        }
+    }
+    return neighbours;
+}
+
+vector<pair<int, int>> TestCemrgMeshAdjacency::ReferenceKRing(vtkPolyData* mesh, vtkIdType seed, int maxOrder) {
+    // Plain breadth first search over the reference neighbours
+    map<vtkIdType, int> distance;
+    vector<vtkIdType> queue(1, seed);
+    distance[seed] = 0;
+    for (size_t q = 0; q < queue.size(); q++) {
+        int d = distance[queue[q]];
+        if (d + 1 >= maxOrder)
+            continue;
+        for (vtkIdType nb : ReferenceNeighbours(mesh, queue[q])) {
+            if (distance.count(nb))
+                continue;
+            distance[nb] = d + 1;
+            queue.push_back(nb);
+        }
+    }
+
+    vector<pair<int, int>> ring;
+    for (const auto& entry : distance)
+        ring.push_back(make_pair((int)entry.first, maxOrder - entry.second));
+    return ring;
+}
+
+void TestCemrgMeshAdjacency::Build_data() {
+    QTest::addColumn<int>("type");
+    QTest::newRow("triangles") << 0;
+    QTest::newRow("strip") << 1;
+    QTest::newRow("poly-line") << 2;
+}
+
+void TestCemrgMeshAdjacency::Build() {
+    QFETCH(int, type);
+    vtkSmartPointer<vtkPolyData> mesh = Mesh(type);
+
+    CemrgMeshAdjacency adjacency;
+    adjacency.Build(mesh);
+    QVERIFY(adjacency.IsBuilt());
+    QCOMPARE(adjacency.GetNumberOfPoints(), mesh->GetNumberOfPoints());
+
+    for (vtkIdType i = 0; i < mesh->GetNumberOfPoints(); i++) {
+        set<vtkIdType> expected = ReferenceNeighbours(mesh, i);
+        set<vtkIdType> built(adjacency.GetNeighbours(i), adjacency.GetNeighbours(i) + adjacency.GetDegree(i));
+        QCOMPARE(adjacency.GetDegree(i), (vtkIdType)built.size());
+        QVERIFY2(built == expected, ("Point " + to_string(i) + " has " + to_string(built.size()) + " neighbours instead of " + to_string(expected.size())).c_str());
+    }
+
+    if (type == 2) {
+        // The poly-line is not closed and vertices add no neighbours
+        set<vtkIdType> first(adjacency.GetNeighbours(0), adjacency.GetNeighbours(0) + adjacency.GetDegree(0));
+        QVERIFY(first == set<vtkIdType>({1}));
+        QCOMPARE(adjacency.GetDegree(6), (vtkIdType)0);
+    }
+}
+
+void TestCemrgMeshAdjacency::KRing_data() {
+    Build_data();
+}
+
+void TestCemrgMeshAdjacency::KRing() {
+    QFETCH(int, type);
+    vtkSmartPointer<vtkPolyData> mesh = Mesh(type);
+
+    CemrgMeshAdjacency adjacency;
+    adjacency.Build(mesh);
+
+    // Repeated queries on the same adjacency, as the corridor functions do
+    for (int maxOrder = 1; maxOrder <= 4; maxOrder++) {
+        for (vtkIdType seed = 0; seed < mesh->GetNumberOfPoints(); seed++) {
+            vector<pair<int, int>> ring;
+            adjacency.KRing(seed, maxOrder, ring);
+            sort(ring.begin(), ring.end());
+            QVERIFY2(ring == ReferenceKRing(mesh, seed, maxOrder),
+                ("Seed " + to_string(seed) + ", order " + to_string(maxOrder)).c_str());
+        }
+    }
+}
+
+int CemrgMeshAdjacencyTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgMeshAdjacency tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
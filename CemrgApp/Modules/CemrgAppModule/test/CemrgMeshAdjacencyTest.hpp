@@ -0,0 +1,54 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgMeshAdjacency.h>
+#include <set>
+#include <map>
+
+using namespace std;
+
+class TestCemrgMeshAdjacency : public QObject {
+
+    Q_OBJECT
+
+private:
+    // 0: triangulated sphere, 1: triangle strip, 2: open poly-line with vertex cells
+    static vtkSmartPointer<vtkPolyData> Mesh(int type);
+    // Neighbours from GetPointCells and GetCellPoints, by cell type
+    static set<vtkIdType> ReferenceNeighbours(vtkPolyData* mesh, vtkIdType id);
+    static vector<pair<int, int>> ReferenceKRing(vtkPolyData* mesh, vtkIdType seed, int maxOrder);
+
+private slots:
+    void Build_data();
+    void Build();
+
+    void KRing_data();
+    void KRing();
+};
@@ -0,0 +1,177 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgProjectionGeometryTest.hpp"
+#include <CemrgCommonUtils.h>
+#include <mitkITKImageImport.h>
+
+TestCemrgProjectionGeometry::ImageType::Pointer TestCemrgProjectionGeometry::NewImage(double spacing) {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::SpacingType itkSpacing;
+    ImageType::PointType origin;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, 40);
+        itkSpacing[a] = spacing;
+        origin[a] = -20.0 * spacing;
+    }
+    image->SetRegions(region);
+    image->SetSpacing(itkSpacing);
+    image->SetOrigin(origin);
+    image->Allocate();
+    image->FillBuffer(0);
+    return image;
+}
+
+void TestCemrgProjectionGeometry::WriteSphere(QString path, double radius, int resolution) {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(radius);
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->Update();
+    vtkSmartPointer<vtkPolyDataWriter> writer = vtkSmartPointer<vtkPolyDataWriter>::New();
+    writer->SetInputData(sphere->GetOutput());
+    writer->SetFileName(path.toStdString().c_str());
+    writer->Write();
+}
+
+void TestCemrgProjectionGeometry::SaveLoadRoundTrip() {
+    const QString meshPath = QDir::currentPath() + "/geometry_roundtrip.vtk";
+    const QString cachePath = CemrgProjectionGeometry::CachePath(meshPath);
+    WriteSphere(meshPath, 10.0, 24);
+    ImageType::Pointer image = NewImage(1.0);
+
+    CemrgProjectionGeometry geometry;
+    geometry.Compute(CemrgCommonUtils::LoadVTKMesh(meshPath.toStdString())->GetVtkPolyData(), image);
+    geometry.SetMeshHash(CemrgProjectionGeometry::HashFile(meshPath));
+    QVERIFY(!geometry.IsEmpty());
+    QVERIFY(!geometry.GetMeshHash().isEmpty());
+    QFile::remove(cachePath);
+    QVERIFY(geometry.Save(cachePath));
+
+    CemrgProjectionGeometry loaded;
+    QVERIFY(loaded.Load(cachePath, geometry.GetMeshHash(), image));
+    QVERIFY(loaded.Matches(image));
+    QCOMPARE(loaded.GetMeshHash(), geometry.GetMeshHash());
+    QVERIFY(loaded.GetCentres() == geometry.GetCentres());
+    QVERIFY(loaded.GetNormals() == geometry.GetNormals());
+    QCOMPARE(loaded.GetPolyData()->GetNumberOfPoints(), geometry.GetPolyData()->GetNumberOfPoints());
+    QCOMPARE(loaded.GetPolyData()->GetNumberOfCells(), geometry.GetPolyData()->GetNumberOfCells());
+    QVERIFY(loaded.GetPolyData()->GetCellData()->GetNormals() != nullptr);
+    for (vtkIdType i = 0; i < geometry.GetPolyData()->GetNumberOfPoints(); i++) {
+        double p1[3], p2[3];
+        geometry.GetPolyData()->GetPoint(i, p1);
+        loaded.GetPolyData()->GetPoint(i, p2);
+        QCOMPARE(p2[0], p1[0]);
+        QCOMPARE(p2[1], p1[1]);
+        QCOMPARE(p2[2], p1[2]);
+    }
+}
+
+void TestCemrgProjectionGeometry::LoadRejectsStaleGeometry() {
+    const QString meshPath = QDir::currentPath() + "/geometry_stale.vtk";
+    const QString cachePath = CemrgProjectionGeometry::CachePath(meshPath);
+    WriteSphere(meshPath, 10.0, 24);
+    ImageType::Pointer image = NewImage(1.0);
+
+    CemrgProjectionGeometry geometry;
+    geometry.Compute(CemrgCommonUtils::LoadVTKMesh(meshPath.toStdString())->GetVtkPolyData(), image);
+    const QByteArray hash = CemrgProjectionGeometry::HashFile(meshPath);
+    geometry.SetMeshHash(hash);
+    QVERIFY(geometry.Save(cachePath));
+
+    // Edited mesh
+    WriteSphere(meshPath, 11.0, 24);
+    const QByteArray editedHash = CemrgProjectionGeometry::HashFile(meshPath);
+    QVERIFY(editedHash != hash);
+    CemrgProjectionGeometry loaded;
+    QVERIFY(!loaded.Load(cachePath, editedHash, image));
+    QVERIFY(loaded.IsEmpty());
+
+    // Changed grid: spacing, then origin
+    QVERIFY(!loaded.Load(cachePath, hash, NewImage(1.1)));
+    QVERIFY(loaded.IsEmpty());
+    ImageType::Pointer shifted = NewImage(1.0);
+    ImageType::PointType origin = shifted->GetOrigin();
+    origin[2] += 0.5;
+    shifted->SetOrigin(origin);
+    QVERIFY(!loaded.Load(cachePath, hash, shifted));
+    QVERIFY(!geometry.Matches(shifted));
+
+    // Missing or unreadable file
+    QVERIFY(!loaded.Load(cachePath + ".missing", hash, image));
+    QFile corrupt(cachePath);
+    QVERIFY(corrupt.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    corrupt.write("not a geometry");
+    corrupt.close();
+    QVERIFY(!loaded.Load(cachePath, hash, image));
+
+    // Same mesh and grid still load
+    QVERIFY(geometry.Save(cachePath));
+    QVERIFY(loaded.Load(cachePath, hash, image));
+}
+
+void TestCemrgProjectionGeometry::Scar3DCacheOptIn() {
+    const QString meshPath = QDir::currentPath() + "/geometry_scar.vtk";
+    const QString cachePath = CemrgProjectionGeometry::CachePath(meshPath);
+    WriteSphere(meshPath, 10.0, 24);
+    QFile::remove(cachePath);
+    mitk::Image::Pointer lge = mitk::ImportItkImage(NewImage(1.0))->Clone();
+
+    // Nothing written next to the mesh by default
+    CemrgScar3D scar;
+    CemrgProjectionGeometry geometry = scar.GetProjectionGeometry(meshPath.toStdString(), lge);
+    QVERIFY(!geometry.IsEmpty());
+    QVERIFY(!QFileInfo::exists(cachePath));
+
+    // Written once switched on, and used while the mesh is unchanged
+    scar.SetGeometryCacheOn();
+    geometry = scar.GetProjectionGeometry(meshPath.toStdString(), lge);
+    QVERIFY(QFileInfo::exists(cachePath));
+    const QDateTime written = QFileInfo(cachePath).lastModified();
+    QThread::msleep(1100);
+    CemrgProjectionGeometry cached = scar.GetProjectionGeometry(meshPath.toStdString(), lge);
+    QCOMPARE(QFileInfo(cachePath).lastModified(), written);
+    QVERIFY(cached.GetCentres() == geometry.GetCentres());
+
+    // An edited mesh is projected again and the file replaced
+    WriteSphere(meshPath, 10.0, 16);
+    CemrgProjectionGeometry edited = scar.GetProjectionGeometry(meshPath.toStdString(), lge);
+    QVERIFY(edited.GetPolyData()->GetNumberOfCells() != geometry.GetPolyData()->GetNumberOfCells());
+    QVERIFY(QFileInfo(cachePath).lastModified() > written);
+    QCOMPARE(edited.GetMeshHash(), CemrgProjectionGeometry::HashFile(meshPath));
+}
+
+int CemrgProjectionGeometryTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgProjectionGeometry tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
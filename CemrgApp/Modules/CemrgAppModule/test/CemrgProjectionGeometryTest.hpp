@@ -0,0 +1,55 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgProjectionGeometry.h>
+#include <CemrgScar3D.h>
+#include <vtkSphereSource.h>
+#include <vtkPolyDataWriter.h>
+#include <vtkCellData.h>
+
+using namespace std;
+
+class TestCemrgProjectionGeometry : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef CemrgProjectionGeometry::ImageType ImageType;
+
+    // 40 voxels a side around the origin
+    static ImageType::Pointer NewImage(double spacing);
+    // Sphere around the origin written as legacy VTK
+    static void WriteSphere(QString path, double radius, int resolution);
+
+private slots:
+    void SaveLoadRoundTrip();
+    void LoadRejectsStaleGeometry();
+    void Scar3DCacheOptIn();
+};
@@ -0,0 +1,164 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgScar3DTest.hpp"
+#include <mitkITKImageImport.h>
+#include <vtkSphereSource.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkFloatArray.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <cstring>
+#include <limits>
+
+TestCemrgScar3D::ImageType::Pointer TestCemrgScar3D::NoisyImage() {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::SpacingType spacing;
+    ImageType::PointType origin;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, 40);
+        spacing[a] = 1.0;
+        origin[a] = -20.0;
+    }
+    image->SetRegions(region);
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->Allocate();
+
+    // Few distinct intensities, so neighbouring cells often share their maximum voxel
+    mt19937 generator(3);
+    uniform_int_distribution<int> noise(0, 20);
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        int value = 100 + 10 * noise(generator);
+        if (abs(it.GetIndex()[2] - 20) < 3)
+            value += 400;
+        it.Set(value);
+    }
+    return image;
+}
+
+vtkSmartPointer<vtkPolyData> TestCemrgScar3D::Shell() {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(10.0);
+    sphere->SetThetaResolution(48);
+    sphere->SetPhiResolution(48);
+    sphere->Update();
+    return sphere->GetOutput();
+}
+
+vector<float> TestCemrgScar3D::CellScalars(mitk::Surface::Pointer surface) {
+    vtkDataArray* array = surface->GetVtkPolyData()->GetCellData()->GetScalars();
+    vector<float> values(array->GetNumberOfTuples());
+    for (vtkIdType i = 0; i < array->GetNumberOfTuples(); i++)
+        values[i] = array->GetTuple1(i);
+    return values;
+}
+
+void TestCemrgScar3D::DeterministicThreads_data() {
+    QTest::addColumn<int>("methodType");
+    QTest::addColumn<bool>("voxelBased");
+    QTest::addColumn<int>("kernel");
+
+    QTest::newRow("Max, voxel based") << 2 << true << (int)CemrgLgeSampler::NEAREST;
+    QTest::newRow("Max") << 2 << false << (int)CemrgLgeSampler::NEAREST;
+    QTest::newRow("Mean") << 1 << false << (int)CemrgLgeSampler::NEAREST;
+    QTest::newRow("Max, voxel based, trilinear") << 2 << true << (int)CemrgLgeSampler::TRILINEAR;
+}
+
+void TestCemrgScar3D::DeterministicThreads() {
+    QFETCH(int, methodType);
+    QFETCH(bool, voxelBased);
+    QFETCH(int, kernel);
+
+    ImageType::Pointer image = NoisyImage();
+    mitk::Image::Pointer lge = mitk::ImportItkImage(image)->Clone();
+    CemrgProjectionGeometry geometry;
+    geometry.Compute(Shell(), image);
+
+    // One thread is the serial projection, the others must give the same bits
+    vector<float> serial;
+    for (int threads : {1, 2, 4, 7}) {
+        CemrgScar3D scar;
+        scar.SetMethodType(methodType);
+        scar.SetVoxelBasedProjection(voxelBased);
+        scar.SetSamplingKernel((CemrgLgeSampler::Kernel)kernel);
+        scar.SetDeterministicOn();
+        scar.SetNumberOfThreads(threads);
+        vector<float> values = CellScalars(scar.Scar3D(geometry, lge));
+        QCOMPARE((vtkIdType)values.size(), geometry.GetPolyData()->GetNumberOfCells());
+        if (threads == 1) {
+            serial = values;
+            continue;
+        }
+        QVERIFY2(memcmp(values.data(), serial.data(), values.size() * sizeof(float)) == 0,
+            (to_string(threads) + " threads differ from the serial projection").c_str());
+    }
+}
+
+void TestCemrgScar3D::ThresholdingSweep() {
+    // Vein cells (-1), NaN, and many values exactly on the thresholds
+    mt19937 generator(11);
+    uniform_int_distribution<int> value(0, 40);
+    vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+    for (int i = 0; i < 5000; i++) {
+        if (i % 17 == 0)
+            scalars->InsertNextValue(-1);
+        else if (i % 29 == 0)
+            scalars->InsertNextValue(numeric_limits<float>::quiet_NaN());
+        else
+            scalars->InsertNextValue(0.25f * value(generator));
+    }
+
+    CemrgScar3D scar;
+    scar.SetScalars(scalars);
+    vector<double> thresholds = {-2, -1, 0, 0.25, 1.5, 1.6, 5, 7.75, 9.99, 10, 12};
+    vector<double> percentages = scar.ThresholdingSweep(thresholds);
+    QCOMPARE(percentages.size(), thresholds.size());
+    for (size_t ix = 0; ix < thresholds.size(); ix++)
+        QVERIFY2(percentages[ix] == scar.Thresholding(thresholds[ix]), ("Threshold " + to_string(thresholds[ix])).c_str());
+
+    // Only vein cells and NaN: nothing above any threshold
+    vtkSmartPointer<vtkFloatArray> noScar = vtkSmartPointer<vtkFloatArray>::New();
+    noScar->InsertNextValue(-1);
+    noScar->InsertNextValue(numeric_limits<float>::quiet_NaN());
+    scar.SetScalars(noScar);
+    percentages = scar.ThresholdingSweep(thresholds);
+    for (size_t ix = 0; ix < thresholds.size(); ix++)
+        QVERIFY(percentages[ix] == scar.Thresholding(thresholds[ix]));
+}
+
+int CemrgScar3DTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgScar3D tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
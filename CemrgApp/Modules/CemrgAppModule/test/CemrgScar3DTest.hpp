@@ -0,0 +1,54 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgScar3D.h>
+#include <random>
+
+using namespace std;
+
+class TestCemrgScar3D : public QObject {
+
+    Q_OBJECT
+
+private:
+    typedef CemrgProjectionGeometry::ImageType ImageType;
+
+    // Noisy LGE, 40 voxels a side around the origin, with a bright band across the shell
+    static ImageType::Pointer NoisyImage();
+    // Sphere of radius 10 around the origin
+    static vtkSmartPointer<vtkPolyData> Shell();
+    static vector<float> CellScalars(mitk::Surface::Pointer surface);
+
+private slots:
+    void DeterministicThreads_data();
+    void DeterministicThreads();
+
+    void ThresholdingSweep();
+};
@@ -0,0 +1,240 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgScarAdvancedTest.hpp"
+#include <vtkSphereSource.h>
+#include <vtkTransform.h>
+#include <vtkTransformPolyDataFilter.h>
+#include <vtkPolyDataReader.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkGenericCell.h>
+#include <vtkMath.h>
+#include <random>
+#include <limits>
+
+vtkSmartPointer<vtkPolyData> TestCemrgScarAdvanced::TargetMesh() {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(10.0);
+    sphere->SetThetaResolution(24);
+    sphere->SetPhiResolution(24);
+    sphere->Update();
+
+    vtkSmartPointer<vtkPolyData> target = sphere->GetOutput();
+    vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+    scalars->SetNumberOfTuples(target->GetNumberOfPoints());
+    for (vtkIdType i = 0; i < target->GetNumberOfPoints(); i++) {
+        double x[3];
+        target->GetPoint(i, x);
+        scalars->SetValue(i, x[0] + 2 * x[1] + 3 * x[2] + 0.05 * x[0] * x[1]);
+    }
+    target->GetPointData()->SetScalars(scalars);
+    return target;
+}
+
+vtkSmartPointer<vtkPolyData> TestCemrgScarAdvanced::SourceMesh() {
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetRadius(10.3);
+    sphere->SetThetaResolution(17);
+    sphere->SetPhiResolution(19);
+
+    // Rotated so no source point is equally close to two target points
+    vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+    rotation->RotateX(7.0);
+    rotation->RotateY(11.0);
+    vtkSmartPointer<vtkTransformPolyDataFilter> transformer = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
+    transformer->SetInputConnection(sphere->GetOutputPort());
+    transformer->SetTransform(rotation);
+    transformer->Update();
+    return transformer->GetOutput();
+}
+
+double TestCemrgScarAdvanced::ReferenceValue(int method, int k, const double x[3], vtkPolyData* target, vtkPointLocator* locator) {
+    vtkDataArray* values = target->GetPointData()->GetScalars();
+    vtkSmartPointer<vtkIdList> closest = vtkSmartPointer<vtkIdList>::New();
+    locator->FindClosestNPoints((method == CemrgScarAdvanced::TRANSFER_IDW || method == CemrgScarAdvanced::TRANSFER_BARYCENTRIC) ? k : 1, x, closest);
+
+    if (method == CemrgScarAdvanced::TRANSFER_IDW) {
+        double sum = 0, weights = 0;
+        for (vtkIdType j = 0; j < closest->GetNumberOfIds(); j++) {
+            double dist2 = vtkMath::Distance2BetweenPoints(x, target->GetPoint(closest->GetId(j)));
+            if (dist2 == 0)
+                return values->GetComponent(closest->GetId(j), 0);
+            sum += values->GetComponent(closest->GetId(j), 0) / dist2;
+            weights += 1.0 / dist2;
+        }
+        return sum / weights;
+
+    } else if (method == CemrgScarAdvanced::TRANSFER_BARYCENTRIC) {
+        // Closest of the triangles around the k closest points
+        vtkSmartPointer<vtkIdList> cells = vtkSmartPointer<vtkIdList>::New();
+        vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
+        double bestDist2 = numeric_limits<double>::max(), bestValue = values->GetComponent(closest->GetId(0), 0);
+        for (vtkIdType j = 0; j < closest->GetNumberOfIds(); j++) {
+            target->GetPointCells(closest->GetId(j), cells);
+            for (vtkIdType c = 0; c < cells->GetNumberOfIds(); c++) {
+                target->GetCell(cells->GetId(c), cell);
+                double closestPoint[3], pcoords[3], weights[3], dist2;
+                int subId;
+                cell->EvaluatePosition(x, closestPoint, subId, pcoords, dist2, weights);
+                // The weights of x extrapolate when it projects outside the triangle, take those of the closest point
+                double onTriangle[3], onTriangleDist2;
+                cell->EvaluatePosition(closestPoint, onTriangle, subId, pcoords, onTriangleDist2, weights);
+                if (dist2 < bestDist2) {
+                    bestDist2 = dist2;
+                    bestValue = 0;
+                    for (int v = 0; v < 3; v++)
+                        bestValue += weights[v] * values->GetComponent(cell->GetPointId(v), 0);
+                }
+            }
+        }
+        return bestValue;
+    }
+
+    // The locator transfer leaves the default value where target point 0 is the closest
+    if (method == CemrgScarAdvanced::TRANSFER_LOCATOR && closest->GetId(0) == 0)
+        return 0;
+    return values->GetComponent(closest->GetId(0), 0);
+}
+
+void TestCemrgScarAdvanced::KdTreeFindClosestPoint() {
+    mt19937 generator(42);
+    uniform_real_distribution<double> coordinate(-10.0, 10.0);
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    for (int i = 0; i < 2000; i++)
+        points->InsertNextPoint(coordinate(generator), coordinate(generator), coordinate(generator));
+    vtkSmartPointer<vtkPolyData> cloud = vtkSmartPointer<vtkPolyData>::New();
+    cloud->SetPoints(points);
+
+    CemrgKdTree tree;
+    tree.Build(points);
+    QVERIFY(tree.IsBuilt());
+    QCOMPARE(tree.GetNumberOfPoints(), points->GetNumberOfPoints());
+    vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+    locator->SetDataSet(cloud);
+    locator->BuildLocator();
+
+    // Queries inside and around the cloud
+    uniform_real_distribution<double> query(-12.0, 12.0);
+    for (int q = 0; q < 500; q++) {
+        const double x[3] = {query(generator), query(generator), query(generator)};
+        double dist2;
+        vtkIdType id = tree.FindClosestPoint(x, dist2);
+        vtkIdType expected = locator->FindClosestPoint(x);
+        QCOMPARE(id, expected);
+        QCOMPARE(dist2, vtkMath::Distance2BetweenPoints(x, points->GetPoint(expected)));
+    }
+
+    tree.Clear();
+    double dist2;
+    const double origin[3] = {0, 0, 0};
+    QCOMPARE(tree.FindClosestPoint(origin, dist2), (vtkIdType)-1);
+}
+
+void TestCemrgScarAdvanced::KdTreeFindClosestNPoints() {
+    vtkSmartPointer<vtkPolyData> target = TargetMesh();
+    CemrgKdTree tree;
+    tree.Build(target->GetPoints());
+    vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+    locator->SetDataSet(target);
+    locator->BuildLocator();
+
+    vtkSmartPointer<vtkPolyData> source = SourceMesh();
+    vtkSmartPointer<vtkIdList> expected = vtkSmartPointer<vtkIdList>::New();
+    vector<pair<double, vtkIdType>> closest;
+    for (int k : {1, 4, 8}) {
+        for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++) {
+            double x[3];
+            source->GetPoint(i, x);
+            tree.FindClosestNPoints(k, x, closest);
+            locator->FindClosestNPoints(k, x, expected);
+            QCOMPARE((vtkIdType)closest.size(), expected->GetNumberOfIds());
+            for (size_t j = 0; j < closest.size(); j++) {
+                QCOMPARE(closest[j].second, expected->GetId(j));
+                QCOMPARE(closest[j].first, vtkMath::Distance2BetweenPoints(x, target->GetPoint(expected->GetId(j))));
+            }
+        }
+    }
+}
+
+void TestCemrgScarAdvanced::TransformSource2Target_data() {
+    QTest::addColumn<int>("method");
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("Locator") << (int)CemrgScarAdvanced::TRANSFER_LOCATOR << 1;
+    QTest::newRow("Nearest, 1 thread") << (int)CemrgScarAdvanced::TRANSFER_NEAREST << 1;
+    QTest::newRow("Nearest, 4 threads") << (int)CemrgScarAdvanced::TRANSFER_NEAREST << 4;
+    QTest::newRow("Inverse distance, 4 threads") << (int)CemrgScarAdvanced::TRANSFER_IDW << 4;
+    QTest::newRow("Barycentric, 4 threads") << (int)CemrgScarAdvanced::TRANSFER_BARYCENTRIC << 4;
+}
+
+void TestCemrgScarAdvanced::TransformSource2Target() {
+    QFETCH(int, method);
+    QFETCH(int, threads);
+
+    vtkSmartPointer<vtkPolyData> target = TargetMesh();
+    vtkSmartPointer<vtkPolyData> source = SourceMesh();
+    const int k = 4;
+
+    CemrgScarAdvanced scarAdvanced;
+    QCOMPARE(scarAdvanced._transferMethod, (int)CemrgScarAdvanced::TRANSFER_LOCATOR);
+    scarAdvanced.SetOutputPath(QDir::currentPath().toStdString() + "/");
+    scarAdvanced.SetTransferMethod(method);
+    scarAdvanced.SetTransferNeighbours(k);
+    scarAdvanced.SetTransferThreads(threads);
+    scarAdvanced.SetSourceAndTarget(source, target);
+    scarAdvanced.TransformSource2Target();
+
+    vtkSmartPointer<vtkPolyDataReader> reader = vtkSmartPointer<vtkPolyDataReader>::New();
+    reader->SetFileName((QDir::currentPath() + "/MaxScarPre_OnPost.vtk").toStdString().c_str());
+    reader->Update();
+    vtkDataArray* transferred = reader->GetOutput()->GetPointData()->GetScalars();
+    QVERIFY(transferred != nullptr);
+    QCOMPARE(transferred->GetNumberOfTuples(), source->GetNumberOfPoints());
+
+    vtkSmartPointer<vtkPointLocator> locator = vtkSmartPointer<vtkPointLocator>::New();
+    locator->SetDataSet(target);
+    locator->BuildLocator();
+    target->BuildLinks();
+    for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++) {
+        double x[3];
+        source->GetPoint(i, x);
+        float expected = ReferenceValue(method, k, x, target, locator);
+        float value = transferred->GetComponent(i, 0);
+        QVERIFY2(fabs(value - expected) <= 1e-4 * max(1.0f, fabs(expected)),
+            ("Point " + to_string(i) + ": " + to_string(value) + " instead of " + to_string(expected)).c_str());
+    }
+}
+
+int CemrgScarAdvancedTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgScarAdvanced tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
@@ -0,0 +1,55 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgScarAdvanced.h>
+#include <CemrgKdTree.h>
+#include <vtkPointLocator.h>
+#include <vtkIdList.h>
+
+using namespace std;
+
+class TestCemrgScarAdvanced : public QObject {
+
+    Q_OBJECT
+
+private:
+    // Target sphere with a smooth point field, source sphere slightly larger and rotated
+    static vtkSmartPointer<vtkPolyData> TargetMesh();
+    static vtkSmartPointer<vtkPolyData> SourceMesh();
+    // Expected transferred value at x, computed with vtkPointLocator
+    static double ReferenceValue(int method, int k, const double x[3], vtkPolyData* target, vtkPointLocator* locator);
+
+private slots:
+    void KdTreeFindClosestPoint();
+    void KdTreeFindClosestNPoints();
+
+    void TransformSource2Target_data();
+    void TransformSource2Target();
+};
@@ -155,6 +155,56 @@ void TestCemrgStrains::CalculateSDI() {
     QCOMPARE(cemrgStrains->CalculateSDI(valueVectors, cycleLengths, noFrames), result);
 }
 
+void TestCemrgStrains::CalculateStrainCurves_data() {
+    QTest::addColumn<mitk::DataNode::Pointer>("lmNode");
+    QTest::addColumn<bool>("largeStrain");
+    QTest::addColumn<int>("numberOfThreads");
+
+    // Preparation for tests
+    mitk::DataNode::Pointer lmNode = ReferenceAHA();
+
+    QTest::newRow("Small strain") << lmNode << false << 1;
+    QTest::newRow("Large strain") << lmNode << true << 2;
+}
+
+void TestCemrgStrains::CalculateStrainCurves() {
+    QFETCH(mitk::DataNode::Pointer, lmNode);
+    QFETCH(bool, largeStrain);
+    QFETCH(int, numberOfThreads);
+
+    // The batch must agree with the per-frame calls
+    cemrgStrains->SetNumberOfThreads(numberOfThreads);
+    CemrgStrains::StrainCurves curves = cemrgStrains->CalculateStrainCurves(CemrgTestData::strainDataSize, lmNode, largeStrain, CemrgStrains::CURVE_LONGITUDINAL);
+    QCOMPARE(curves.sqz.size(), (size_t)CemrgTestData::strainDataSize);
+
+    // Flat scalars of the last frame, as left by the per-frame calls
+    vtkSmartPointer<vtkFloatArray> flatScalars = vtkSmartPointer<vtkFloatArray>::New();
+    flatScalars->DeepCopy(cemrgStrains->GetFlatSurfScalars());
+    QCOMPARE((size_t)flatScalars->GetNumberOfTuples(), curves.flatLongitudinal.back().size());
+    for (vtkIdType j = 0; j < flatScalars->GetNumberOfTuples(); j++)
+        QCOMPARE(flatScalars->GetValue(j), curves.flatLongitudinal.back().at(j));
+
+    for (int i = 0; i < (int)CemrgTestData::strainDataSize; i++) {
+        vector<double> sqz = cemrgStrains->CalculateSqzPlot(i);
+        QVERIFY(equal(begin(sqz), end(sqz), begin(curves.sqz[i]), FuzzyCompare));
+
+        vector<double> circumferential = cemrgStrains->CalculateStrainsPlot(i, lmNode, largeStrain ? 3 : 1);
+        QVERIFY(equal(begin(circumferential), end(circumferential), begin(curves.circumferential[i]), FuzzyCompare));
+
+        vector<double> longitudinal = cemrgStrains->CalculateStrainsPlot(i, lmNode, largeStrain ? 4 : 2);
+        QVERIFY(equal(begin(longitudinal), end(longitudinal), begin(curves.longitudinal[i]), FuzzyCompare));
+        if (i == (int)CemrgTestData::strainDataSize - 1) {
+            for (vtkIdType j = 0; j < flatScalars->GetNumberOfTuples(); j++)
+                QVERIFY(FuzzyCompare(flatScalars->GetValue(j), cemrgStrains->GetFlatSurfScalars()->GetValue(j)));
+        }
+
+        if (!largeStrain) {
+            vector<double> radial = cemrgStrains->CalculateStrainsPlot(i, lmNode, 0);
+            QVERIFY(equal(begin(radial), end(radial), begin(curves.radial[i]), FuzzyCompare));
+        }
+    }
+}
+
 void TestCemrgStrains::ReferenceGuideLines_data() {
     QTest::addColumn<mitk::DataNode::Pointer>("lmNode");
     QTest::addColumn<vector<mitk::Surface::Pointer>>("result");
@@ -59,6 +59,9 @@ private slots:
     void CalculateSDI_data();
     void CalculateSDI();
 
+    void CalculateStrainCurves_data();
+    void CalculateStrainCurves();
+
     void ReferenceGuideLines_data();
     void ReferenceGuideLines();
 };
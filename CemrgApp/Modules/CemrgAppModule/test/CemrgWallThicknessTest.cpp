@@ -0,0 +1,170 @@
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgWallThicknessTest.hpp"
+
+typedef CemrgWallThickness::ImageType ImageType;
+
+ImageType::Pointer TestCemrgWallThickness::ShellPhantom(double r1, double r2, const double spacing[3], short bloodPoolLabel, double centre[3]) {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::SpacingType itkSpacing;
+    ImageType::PointType origin;
+    for (int a = 0; a < 3; a++) {
+        region.SetIndex(a, 0);
+        region.SetSize(a, (itk::SizeValueType)ceil(2 * (r2 + 3) / spacing[a]));
+        itkSpacing[a] = spacing[a];
+        origin[a] = -10.0 * (a + 1);
+        centre[a] = origin[a] + 0.5 * region.GetSize(a) * spacing[a];
+    }
+    image->SetRegions(region);
+    image->SetSpacing(itkSpacing);
+    image->SetOrigin(origin);
+    image->Allocate();
+
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+        ImageType::PointType point;
+        image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+        double r = point.EuclideanDistanceTo(ImageType::PointType(centre));
+        it.Set(r < r1 ? bloodPoolLabel : (r < r2 ? 1 : 0));
+    }
+    return image;
+}
+
+void TestCemrgWallThickness::SphericalShell_data() {
+    QTest::addColumn<double>("r1");
+    QTest::addColumn<double>("r2");
+    QTest::addColumn<double>("sx");
+    QTest::addColumn<double>("sz");
+    QTest::addColumn<int>("bloodPoolLabel");
+
+    QTest::newRow("5 mm wall, blood pool label") << 15.0 << 20.0 << 1.0 << 1.0 << 2;
+    QTest::newRow("5 mm wall, enclosed background") << 15.0 << 20.0 << 1.0 << 1.0 << 0;
+    QTest::newRow("5 mm wall, anisotropic voxels") << 15.0 << 20.0 << 0.8 << 1.6 << 2;
+    QTest::newRow("3 mm wall, fine voxels") << 20.0 << 23.0 << 0.5 << 0.5 << 2;
+    QTest::newRow("2.5 mm wall, thin shell") << 30.0 << 32.5 << 0.7 << 0.7 << 2;
+}
+
+void TestCemrgWallThickness::SphericalShell() {
+    QFETCH(double, r1);
+    QFETCH(double, r2);
+    QFETCH(double, sx);
+    QFETCH(double, sz);
+    QFETCH(int, bloodPoolLabel);
+
+    const double spacing[3] = {sx, sx, sz};
+    double centre[3];
+    ImageType::Pointer image = ShellPhantom(r1, r2, spacing, bloodPoolLabel, centre);
+
+    CemrgWallThickness wallThickness;
+    QVERIFY(wallThickness.Compute(image));
+    const double expected = r2 - r1;
+
+    // Mean over the wall within 5%
+    QVERIFY2(abs(wallThickness.GetMeanThickness() - expected) < 0.05 * expected,
+        ("Mean thickness " + to_string(wallThickness.GetMeanThickness()) + " for a " + to_string(expected) + " mm wall").c_str());
+
+    // Points spread over both analytic surfaces within half the coarsest voxel on average
+    const int numPoints = 400;
+    for (double radius : {r1, r2}) {
+        double error = 0;
+        for (int q = 0; q < numPoints; q++) {
+            double u = (q + 0.5) / numPoints * 2 - 1, phi = q * 2.399963;
+            double point[3] = {
+                centre[0] + radius * sqrt(1 - u * u) * cos(phi),
+                centre[1] + radius * sqrt(1 - u * u) * sin(phi),
+                centre[2] + radius * u};
+            double value = wallThickness.GetThicknessAt(point);
+            QVERIFY(!std::isnan(value));
+            error += abs(value - expected);
+        }
+        QVERIFY2(error / numPoints < 0.5 * max(sx, sz),
+            ("Mean error " + to_string(error / numPoints) + " on the surface of radius " + to_string(radius)).c_str());
+    }
+}
+
+void TestCemrgWallThickness::ThreadInvariance() {
+    const double spacing[3] = {1.0, 1.0, 1.0};
+    double centre[3];
+    ImageType::Pointer image = ShellPhantom(20.0, 28.0, spacing, 2, centre);
+
+    CemrgWallThickness serial, threaded;
+    serial.SetNumberOfThreads(1);
+    threaded.SetNumberOfThreads(4);
+    QVERIFY(serial.Compute(image));
+    QVERIFY(threaded.Compute(image));
+
+    // Each colour of the red-black sweep is large enough for 4 workers of 4096 voxels
+    QVERIFY(threaded.GetNumberOfWallVoxels() / 2 >= 4 * 4096);
+    QCOMPARE(serial.GetNumberOfIterations(), threaded.GetNumberOfIterations());
+    QVERIFY(serial.GetVoxelThickness() == threaded.GetVoxelThickness());
+
+    // No wall label, or a wall without an inner side
+    CemrgWallThickness missing;
+    missing.SetWallLabel(5);
+    QVERIFY(!missing.Compute(image));
+    ImageType::Pointer solid = ShellPhantom(20.0, 28.0, spacing, 1, centre);
+    QVERIFY(!serial.Compute(solid));
+    QVERIFY(!serial.IsComputed());
+}
+
+void TestCemrgWallThickness::MapToSurface() {
+    const double spacing[3] = {1.0, 1.0, 1.0};
+    double centre[3];
+    ImageType::Pointer image = ShellPhantom(15.0, 20.0, spacing, 2, centre);
+
+    CemrgWallThickness wallThickness;
+    QVERIFY(wallThickness.Compute(image));
+
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetCenter(centre);
+    sphere->SetRadius(20.0);
+    sphere->SetThetaResolution(24);
+    sphere->SetPhiResolution(24);
+    sphere->Update();
+    vtkSmartPointer<vtkPolyData> surface = sphere->GetOutput();
+
+    QVERIFY(wallThickness.MapToSurface(surface));
+    vtkDataArray* values = surface->GetPointData()->GetArray("Thickness");
+    QVERIFY(values != nullptr);
+    QCOMPARE(values->GetNumberOfTuples(), surface->GetNumberOfPoints());
+    double mean = 0;
+    for (vtkIdType i = 0; i < values->GetNumberOfTuples(); i++)
+        mean += values->GetTuple1(i);
+    mean /= values->GetNumberOfTuples();
+    QVERIFY(abs(mean - 5.0) < 0.5);
+}
+
+int CemrgWallThicknessTest(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    TestCemrgWallThickness tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
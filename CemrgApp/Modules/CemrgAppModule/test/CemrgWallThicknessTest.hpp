@@ -0,0 +1,52 @@
+
+/*=========================================================================
+
+Program:   Medical Imaging & Interaction Toolkit
+Language:  C++
+Date:      $Date$
+Version:   $Revision$
+
+Copyright (c) German Cancer Research Center, Division of Medical and
+Biological Informatics. All rights reserved.
+See MITKCopyright.txt or http://www.mitk.org/copyright.html for details.
+
+This software is distributed WITHOUT ANY WARRANTY; without even
+the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+/*=========================================================================
+ *
+ * CEMRGAPPMODULE TESTS
+ *
+ * Cardiac Electromechanics Research Group
+ * http://www.cemrg.com
+ * orod.razeghi@kcl.ac.uk
+ *
+ * This software is distributed WITHOUT ANY WARRANTY or SUPPORT!
+ *
+=========================================================================*/
+
+#include "CemrgTestCommon.hpp"
+#include <CemrgWallThickness.h>
+#include <vtkSphereSource.h>
+#include <vtkPointData.h>
+
+using namespace std;
+
+class TestCemrgWallThickness : public QObject {
+
+    Q_OBJECT
+
+private:
+    // Spherical shell, inner radius r1 and outer radius r2 (mm) around the centre of the image.
+    // The cavity takes bloodPoolLabel (0 for enclosed background), the wall takes 1.
+    CemrgWallThickness::ImageType::Pointer ShellPhantom(double r1, double r2, const double spacing[3], short bloodPoolLabel, double centre[3]);
+
+private slots:
+    void SphericalShell_data();
+    void SphericalShell();
+
+    void ThreadInvariance();
+    void MapToSurface();
+};
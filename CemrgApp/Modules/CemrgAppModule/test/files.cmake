@@ -1,7 +1,18 @@
 set(MOC_H_FILES
+  CemrgAtriaClipperTest.hpp
+  CemrgAtrialScarBatchTest.hpp
   CemrgCommandLineTest.hpp
+  CemrgCommonUtilsTest.hpp
+  CemrgImageStatisticsTest.hpp
+  CemrgLgeSamplerTest.hpp
+  CemrgLvScarSegmentationTest.hpp
   CemrgMeasureTest.hpp
+  CemrgMeshAdjacencyTest.hpp
+  CemrgProjectionGeometryTest.hpp
+  CemrgScar3DTest.hpp
+  CemrgScarAdvancedTest.hpp
   CemrgStrainsTest.hpp
+  CemrgWallThicknessTest.hpp
 )
 
 set(CPP_FILES
@@ -9,9 +20,20 @@ set(CPP_FILES
 )
 
 set(MODULE_TESTS
+  CemrgAtriaClipperTest.cpp
+  CemrgAtrialScarBatchTest.cpp
   CemrgCommandLineTest.cpp
+  CemrgCommonUtilsTest.cpp
+  CemrgImageStatisticsTest.cpp
+  CemrgLgeSamplerTest.cpp
+  CemrgLvScarSegmentationTest.cpp
   CemrgMeasureTest.cpp
+  CemrgMeshAdjacencyTest.cpp
+  CemrgProjectionGeometryTest.cpp
+  CemrgScar3DTest.cpp
+  CemrgScarAdvancedTest.cpp
   CemrgStrainsTest.cpp
+  CemrgWallThicknessTest.cpp
 )
 
 set(MODULE_CUSTOM_TESTS
@@ -217,35 +217,49 @@ void QmitkCemrgAppCommonTools::ConvertCarpToVtk() {
         return;
     }
 
+    std::vector<double> pts;
+    CemrgCommonUtils::CarpElements elems;
+    if (!CemrgCommonUtils::ReadCarpPoints(pathPts, pts) || !CemrgCommonUtils::ReadCarpElements(pathElem, elems)) {
+        QMessageBox::warning(NULL, "Attention", "Could not read the CARP mesh files!");
+        return;
+    }
+    int nElem = elems.Size();
+    int nPts = pts.size() / 3;
+
     int regionScalarsReply = QMessageBox::question(NULL, "Question", "Include region as (cell) scalar field?", QMessageBox::Yes, QMessageBox::No);
-    CemrgCommonUtils::CarpToVtk(pathElem, pathPts, vtkPath, (regionScalarsReply == QMessageBox::Yes));
 
+    //Collect every field first, the mesh is then written once
+    std::vector<CemrgCommonUtils::CarpVtkField> fields;
     int appendScalarFieldReply = QMessageBox::question(NULL, "Question", "Append a scalar field from a file?", QMessageBox::Yes, QMessageBox::No);
-    if (appendScalarFieldReply == QMessageBox::Yes) {
-        QString typeData = "";
-        int nElem = CemrgCommonUtils::GetTotalFromCarpFile(pathElem);
-        int nPts = CemrgCommonUtils::GetTotalFromCarpFile(pathPts);
-        int countFields = 0;
-
-        while (appendScalarFieldReply == QMessageBox::Yes) {
-            QString path = QFileDialog::getOpenFileName(NULL, "Open Scalar field (.dat) file", dir.toStdString().c_str());
-            QFileInfo fi2(path);
-            std::vector<double> field = CemrgCommonUtils::ReadScalarField(path);
-
-            int nField = field.size();
-            MITK_INFO << ("FieldSize: " + QString::number(nField)).toStdString();
-            if (nField == nElem) {
-                typeData = "CELL";
-            } else if (nField == nPts) {
-                typeData = "POINT";
-            } else {
-                MITK_INFO << "Inconsistent file size";
-                break;
-            }
-            CemrgCommonUtils::AppendScalarFieldToVtk(vtkPath, fi2.baseName(), typeData, field, (countFields == 0));
-            countFields++;
-            appendScalarFieldReply = QMessageBox::question(NULL, "Question",
-                "Append another scalar field from a file?", QMessageBox::Yes, QMessageBox::No);
+    while (appendScalarFieldReply == QMessageBox::Yes) {
+        QString path = QFileDialog::getOpenFileName(NULL, "Open Scalar field (.dat) file", dir.toStdString().c_str());
+        QFileInfo fi2(path);
+        std::vector<double> field = CemrgCommonUtils::ReadScalarField(path);
+
+        int nField = field.size();
+        MITK_INFO << ("FieldSize: " + QString::number(nField)).toStdString();
+        if (nField != nElem && nField != nPts) {
+            MITK_INFO << "Inconsistent file size";
+            break;
         }
+        CemrgCommonUtils::CarpVtkField carpField;
+        carpField.name = fi2.baseName().toStdString();
+        carpField.cellData = (nField == nElem);
+        carpField.numberOfComponents = 1;
+        carpField.values.swap(field);
+        fields.push_back(carpField);
+
+        appendScalarFieldReply = QMessageBox::question(NULL, "Question",
+            "Append another scalar field from a file?", QMessageBox::Yes, QMessageBox::No);
     }
+
+    int format = CemrgCommonUtils::CARP_VTK_BINARY;
+    int vtuReply = QMessageBox::question(NULL, "Question", "Save as XML unstructured grid (.vtu)?", QMessageBox::Yes, QMessageBox::No);
+    if (vtuReply == QMessageBox::Yes) {
+        format = CemrgCommonUtils::CARP_VTU_APPENDED;
+        vtkPath = dir + "/" + fi.baseName() + ".vtu";
+    }
+
+    if (!CemrgCommonUtils::WriteCarpVtk(vtkPath, pts, elems, fields, format, (regionScalarsReply == QMessageBox::Yes)))
+        QMessageBox::warning(NULL, "Attention", "Could not write the VTK file!");
 }
\ No newline at end of file
@@ -813,6 +813,7 @@ void MmcwView::Applying() {
         this->BusyCursorOn();
         mitk::ProgressBar::GetInstance()->AddStepsToDo(frames * smoothness);
         std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
+        cmd->SetMaximumConcurrentJobs(0); // one frame per core
         cmd->ExecuteApplying(directory, input, iniTime, dofin, frames, smoothness);
         QMessageBox::information(NULL, "Attention", "Command Line Operations Finished!");
         MmcwViewPlot::SetNoFrames(frames, smoothness);
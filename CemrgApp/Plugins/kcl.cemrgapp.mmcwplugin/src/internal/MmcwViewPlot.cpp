@@ -208,54 +208,31 @@ void MmcwViewPlot::PlotData() {
     plotValueVectors.clear();
     std::string plotType = m_Controls.comboBox->currentText().toStdString();
 
-    if (plotType.compare("Area Change") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateSqzPlot(i));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
-    } else if (plotType.compare("Circumferential Small Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 1));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
-    } else if (plotType.compare("Circumferential Large Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 3));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
-    } else if (plotType.compare("Longitudinal Small Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 2));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
-    } else if (plotType.compare("Longitudinal Large Strain") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, segRatios, false);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateStrainsPlot(i, lmNode, 4));
-            vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
-            flatPlotScalars.push_back(holder);
-        }
-    } else if (plotType.compare("Pacing site Squeez") == 0) {
-        refSurf = strain->ReferenceAHA(lmNode, pacingSegRatios, true);
-        for (int i = 0; i < noFrames * smoothness; i++) {
-            plotValueVectors.push_back(strain->CalculateSqzPlot(i));
+    bool areaPlot = plotType.compare("Area Change") == 0 || plotType.compare("Pacing site Squeez") == 0;
+    bool circPlot = plotType.compare("Circumferential Small Strain") == 0 || plotType.compare("Circumferential Large Strain") == 0;
+    bool longPlot = plotType.compare("Longitudinal Small Strain") == 0 || plotType.compare("Longitudinal Large Strain") == 0;
+
+    if (areaPlot || circPlot || longPlot) {
+
+        bool pacingSite = plotType.compare("Pacing site Squeez") == 0;
+        bool largeStrain = plotType.find("Large Strain") != std::string::npos;
+        refSurf = strain->ReferenceAHA(lmNode, pacingSite ? pacingSegRatios : segRatios, pacingSite);
+
+        //All frames in one pass
+        int flatCurve = areaPlot ? CemrgStrains::CURVE_SQUEEZE : (circPlot ? CemrgStrains::CURVE_CIRCUMFERENTIAL : CemrgStrains::CURVE_LONGITUDINAL);
+        CemrgStrains::StrainCurves curves = strain->CalculateStrainCurves(noFrames * smoothness, lmNode, largeStrain, flatCurve);
+        std::vector<std::vector<double>>& values = areaPlot ? curves.sqz : (circPlot ? curves.circumferential : curves.longitudinal);
+        std::vector<std::vector<float>>& flatValues = areaPlot ? curves.flatSqz : (circPlot ? curves.flatCircumferential : curves.flatLongitudinal);
+
+        for (size_t i = 0; i < values.size(); i++) {
+            plotValueVectors.push_back(values.at(i));
             vtkSmartPointer<vtkFloatArray> holder = vtkSmartPointer<vtkFloatArray>::New();
-            holder->DeepCopy(strain->GetFlatSurfScalars());
+            holder->SetNumberOfValues(flatValues.at(i).size());
+            for (size_t j = 0; j < flatValues.at(i).size(); j++)
+                holder->SetValue(j, flatValues.at(i).at(j));
             flatPlotScalars.push_back(holder);
-        }
+        }//_for
+
     }//_if
 
     //Visualise AHA plots
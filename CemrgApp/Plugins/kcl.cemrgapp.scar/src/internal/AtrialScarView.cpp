@@ -85,7 +85,6 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QStringList>
 
@@ -94,9 +93,11 @@ PURPOSE.  See the above copyright notices for more information.
 
 // CemrgAppModule
 #include <CemrgAtriaClipper.h>
+#include <CemrgAtrialScarPipeline.h>
 #include <CemrgCommandLine.h>
 #include <CemrgMeasure.h>
 #include <CemrgCommonUtils.h>
+#include <CemrgSurfaceExtraction.h>
 
 const std::string AtrialScarView::VIEW_ID = "org.mitk.views.scar";
 
@@ -330,7 +331,7 @@ void AtrialScarView::AutomaticAnalysis() {
     MITK_INFO << "Performing automatic analysis.";
     MITK_INFO << "============= Automatic segmentation module ====================";
 
-    QString direct, mraPath, lgePath, cnnPath;
+    QString direct;
     bool debugging = true;
 
     if (directory.isEmpty()) {
@@ -343,23 +344,13 @@ void AtrialScarView::AutomaticAnalysis() {
         direct = directory;
     }//_dir
 
-    QDirIterator searchit(direct, QDirIterator::Subdirectories);
-
+    //Same stages as the CemrgAtrialScarBatch app
+    std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
+    MITK_INFO << "[AUTOMATIC_ANALYSIS] Setting Docker on MIRTK to OFF";
+    cmd->SetUseDockerContainers(_useDockerInPlugin);
+    CemrgAtrialScarPipeline pipeline(direct, cmd.get());
     MITK_INFO(debugging) << "[DEBUG] Searching for CEMRGNET output";
-
-    while (searchit.hasNext()) {
-        QFileInfo searchfinfo(searchit.next());
-        if (searchfinfo.fileName().contains(".nii", Qt::CaseSensitive)) {
-            if (searchfinfo.fileName().contains("dcm-LGE", Qt::CaseSensitive))
-                lgePath = searchfinfo.absoluteFilePath();
-
-            if (searchfinfo.fileName().contains("dcm-MRA", Qt::CaseSensitive))
-                mraPath = searchfinfo.absoluteFilePath();
-
-            if (debugging && searchfinfo.fileName().contains("LA-cemrgnet.nii", Qt::CaseSensitive))
-                cnnPath = searchfinfo.absoluteFilePath();
-        }
-    }//_while
+    bool inputsFound = pipeline.FindInputs();
 
     QDialog* inputs = new QDialog(0, 0);
     m_UIcemrgnet.setupUi(inputs);
@@ -449,374 +440,52 @@ void AtrialScarView::AutomaticAnalysis() {
 
     }//_if
 
-    MITK_INFO << ("Files to be read: \n\n [LGE]: " + lgePath + "\n [MRA]: " + mraPath).toStdString();
+    MITK_INFO << ("Files to be read: \n\n [LGE]: " + pipeline.GetLgePath() + "\n [MRA]: " + pipeline.GetMraPath()).toStdString();
 
-    if (!mraPath.isEmpty()) {
+    if (inputsFound) {
 
         vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
-        typedef itk::Image<short, 3> ImageTypeSHRT;
-        typedef itk::Image<short, 3> ImageTypeCHAR;
-        std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
-        MITK_INFO << "[AUTOMATIC_ANALYSIS] Setting Docker on MIRTK to OFF";
-        cmd->SetUseDockerContainers(_useDockerInPlugin);
+        pipeline.SetMinStep(minStep_UI);
+        pipeline.SetMaxStep(maxStep_UI);
+        pipeline.SetMethodType(methodType_UI);
+        pipeline.SetThresholdType(thresh_methodType_UI);
+        pipeline.SetThresholds(values_vector);
 
+        //Each stage reads the files written by the ones before it
         timerLog->StartTimer();
-        if (cnnPath.isEmpty()) {
+        bool successful = pipeline.HasPrediction();
+        if (!successful) {
             MITK_INFO << "[AUTOMATIC_ANALYSIS] Computing automatic segmentation step.";
-            cnnPath = cmd->DockerCemrgNetPrediction(mraPath);
-        }
-
-        MITK_INFO << "Round pixel values from automatic segmentation.";
-        CemrgCommonUtils::RoundPixelValues(cnnPath);
-
-        if (!cnnPath.isEmpty()) {
-
-            MITK_INFO << ("Successful prediction with file " + cnnPath).toStdString();
-            // QString direct = finfo.absolutePath();
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][1] Adjust CNN label to MRA";
-            mitk::Image::Pointer mraIMG = mitk::IOUtil::Load<mitk::Image>(mraPath.toStdString());
-            mitk::Image::Pointer cnnIMG = mitk::IOUtil::Load<mitk::Image>(cnnPath.toStdString());
-            double origin[3]; double spacing[3];
-            mraIMG->GetGeometry()->GetOrigin().ToArray(origin);
-            mraIMG->GetGeometry()->GetSpacing().ToArray(spacing);
-
-            vtkSmartPointer<vtkImageResize> resizeFilter = vtkSmartPointer<vtkImageResize>::New();
-            resizeFilter->SetResizeMethodToOutputDimensions();
-            resizeFilter->SetOutputDimensions(mraIMG->GetDimension(0), mraIMG->GetDimension(1), mraIMG->GetDimension(2));
-            resizeFilter->InterpolateOff();
-            resizeFilter->SetInputData(cnnIMG->GetVtkImageData());
-            resizeFilter->Update();
-
-            vtkSmartPointer<vtkImageChangeInformation> changeFilter = vtkSmartPointer<vtkImageChangeInformation>::New();
-            changeFilter->SetInputConnection(resizeFilter->GetOutputPort());
-            changeFilter->SetOutputSpacing(spacing);
-            changeFilter->SetOutputOrigin(origin);
-            changeFilter->Update();
-
-            cnnIMG->Initialize(changeFilter->GetOutput());
-            cnnIMG->SetVolume(changeFilter->GetOutput()->GetScalarPointer());
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][2] Image registration";
-            cnnPath = direct + "/LA.nii";
-            QString laregPath = direct + "/LA-reg.nii";
-
-            mitk::IOUtil::Save(cnnIMG, cnnPath.toStdString());
-            cmd->ExecuteRegistration(direct, lgePath, mraPath); // rigid.dof is the default name
-            cmd->ExecuteTransformation(direct, cnnPath, laregPath);
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][3] Clean segmentation";
-            typedef itk::ImageRegionIteratorWithIndex<ImageTypeCHAR> ItType;
-            typedef itk::ConnectedComponentImageFilter<ImageTypeCHAR, ImageTypeCHAR> ConnectedComponentImageFilterType;
-            typedef itk::LabelShapeKeepNObjectsImageFilter<ImageTypeCHAR> LabelShapeKeepNObjImgFilterType;
-            using DuplicatorType = itk::ImageDuplicator<ImageTypeCHAR>;
-
-            ImageTypeCHAR::Pointer orgSegImage = ImageTypeCHAR::New();
-            mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(laregPath.toStdString()), orgSegImage);
-
-            ConnectedComponentImageFilterType::Pointer connected1 = ConnectedComponentImageFilterType::New();
-            connected1->SetInput(orgSegImage);
-            connected1->Update();
-
-            LabelShapeKeepNObjImgFilterType::Pointer lblShpKpNObjImgFltr1 = LabelShapeKeepNObjImgFilterType::New();
-            lblShpKpNObjImgFltr1->SetInput(connected1->GetOutput());
-            lblShpKpNObjImgFltr1->SetBackgroundValue(0);
-            lblShpKpNObjImgFltr1->SetNumberOfObjects(1);
-            lblShpKpNObjImgFltr1->SetAttribute(LabelShapeKeepNObjImgFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-            lblShpKpNObjImgFltr1->Update();
-
-            DuplicatorType::Pointer duplicator = DuplicatorType::New();
-            duplicator->SetInputImage(lblShpKpNObjImgFltr1->GetOutput());
-            duplicator->Update();
-            ItType itDUP(duplicator->GetOutput(), duplicator->GetOutput()->GetRequestedRegion());
-            for (itDUP.GoToBegin(); !itDUP.IsAtEnd(); ++itDUP)
-                if ((int)itDUP.Get() != 0)
-                    itDUP.Set(1);
-            QString segCleanPath = direct + "/prodClean.nii";
-            mitk::IOUtil::Save(mitk::ImportItkImage(duplicator->GetOutput()), segCleanPath.toStdString());
-            MITK_INFO << ("[...][3.1] Saved file: " + segCleanPath).toStdString();
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][4] Vein clipping mesh";
-            QString output1 = cmd->ExecuteSurf(direct, segCleanPath, "close", 1, .5, 0, 10);
-            mitk::Surface::Pointer shell = mitk::IOUtil::Load<mitk::Surface>(output1.toStdString());
-            vtkSmartPointer<vtkDecimatePro> deci = vtkSmartPointer<vtkDecimatePro>::New();
-            deci->SetInputData(shell->GetVtkPolyData());
-            deci->SetTargetReduction(0.1);
-            deci->PreserveTopologyOn();
-            deci->Update();
-            shell->SetVtkPolyData(deci->GetOutput());
-
-            vtkSmartPointer<vtkPointLocator> pointLocator = vtkSmartPointer<vtkPointLocator>::New();
-            vtkSmartPointer<vtkPolyData> pd = shell->Clone()->GetVtkPolyData();
-            for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-                double* point = pd->GetPoint(i);
-                point[0] = -point[0];
-                point[1] = -point[1];
-                pd->GetPoints()->SetPoint(i, point);
-            }//_for
-            pointLocator->SetDataSet(pd);
-            pointLocator->BuildLocator();
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][5] Separate veins";
-            typedef itk::BinaryCrossStructuringElement<ImageTypeCHAR::PixelType, 3> CrossType;
-            typedef itk::BinaryMorphologicalOpeningImageFilter<ImageTypeCHAR, ImageTypeCHAR, CrossType> MorphFilterType;
-            typedef itk::RelabelComponentImageFilter<ImageTypeCHAR, ImageTypeCHAR> RelabelFilterType;
-
-            ImageTypeCHAR::Pointer veinsSegImage = lblShpKpNObjImgFltr1->GetOutput();
-            ItType itORG(orgSegImage, orgSegImage->GetRequestedRegion());
-            ItType itVEN(veinsSegImage, veinsSegImage->GetRequestedRegion());
-            itORG.GoToBegin();
-
-            for (itVEN.GoToBegin(); !itVEN.IsAtEnd(); ++itVEN) {
-                if ((int)itVEN.Get() != 0)
-                    itVEN.Set((int)itORG.Get());
-                ++itORG;
-            }
-            for (itVEN.GoToBegin(); !itVEN.IsAtEnd(); ++itVEN)
-                if ((int)itVEN.Get() != 2)
-                    itVEN.Set(0);
-
-            CrossType binaryCross;
-            binaryCross.SetRadius(2.0);
-            binaryCross.CreateStructuringElement();
-            MorphFilterType::Pointer morphFilter = MorphFilterType::New();
-            morphFilter->SetInput(veinsSegImage);
-            morphFilter->SetKernel(binaryCross);
-            morphFilter->SetForegroundValue(2);
-            morphFilter->SetBackgroundValue(0);
-            morphFilter->UpdateLargestPossibleRegion();
-            veinsSegImage = morphFilter->GetOutput();
-            mitk::IOUtil::Save(mitk::ImportItkImage(veinsSegImage), (direct + "/prodVeins.nii").toStdString());
-
-            ConnectedComponentImageFilterType::Pointer connected2 = ConnectedComponentImageFilterType::New();
-            connected2->SetInput(veinsSegImage);
-            connected2->Update();
-
-            RelabelFilterType::Pointer relabeler = RelabelFilterType::New();
-            relabeler->SetInput(connected2->GetOutput());
-            relabeler->Update();
-            mitk::IOUtil::Save(mitk::ImportItkImage(relabeler->GetOutput()), (direct + "/prodSeparatedVeins.nii").toStdString());
-            MITK_INFO << ("[...][5.1] Saved file: " + direct + "/prodSeparatedVeins.nii").toStdString();
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][6] Find vein landmark";
-            veinsSegImage = relabeler->GetOutput();
-            ItType itLMK(veinsSegImage, veinsSegImage->GetRequestedRegion());
-            vtkSmartPointer<vtkIdList> pickedSeedIds = vtkSmartPointer<vtkIdList>::New();
-            pickedSeedIds->Initialize();
-            std::vector<std::vector<double>> veinsCentre;
-            const int nveins = static_cast<int>(connected2->GetObjectCount());
-
-            MITK_INFO << ("[...][6.1] Number of veins found: " + QString::number(nveins)).toStdString();
-            for (int j = 0; j < nveins; j++) {
-                int ctrVeinsVoxels = 0;
-                std::vector<double> veinLandmark(3, 0.0);
-                for (itLMK.GoToBegin(); !itLMK.IsAtEnd(); ++itLMK) {
-                    if ((int)itLMK.Get() == (j + 1)) {
-                        ImageTypeCHAR::PointType point;
-                        veinsSegImage->TransformIndexToPhysicalPoint(itLMK.GetIndex(), point);
-                        veinLandmark[0] += point[0];
-                        veinLandmark[1] += point[1];
-                        veinLandmark[2] += point[2];
-                        ctrVeinsVoxels++;
-                    }
-                }//_for
-                veinLandmark[0] /= ctrVeinsVoxels;
-                veinLandmark[1] /= ctrVeinsVoxels;
-                veinLandmark[2] /= ctrVeinsVoxels;
-                veinsCentre.push_back(veinLandmark);
-            }//_nveins
-            for (int j = 0; j < nveins; j++) {
-                double veinLandmark[3];
-                veinLandmark[0] = veinsCentre.at(j)[0];
-                veinLandmark[1] = veinsCentre.at(j)[1];
-                veinLandmark[2] = veinsCentre.at(j)[2];
-                vtkIdType id = pointLocator->FindClosestPoint(veinLandmark);
-                pickedSeedIds->InsertNextId(id);
-            }//_nveins
-            std::vector<int> pickedSeedLabels;
-            for (int j = 0; j < nveins; j++)
-                pickedSeedLabels.push_back(21);
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][7] Clip the veins";
-
-            std::unique_ptr<CemrgAtriaClipper> clipper(new CemrgAtriaClipper(direct, shell));
-            bool successful = clipper->ComputeCtrLines(pickedSeedLabels, pickedSeedIds, true);
-            if (!successful) {
-                QMessageBox::critical(NULL, "Attention", "Computation of Centrelines Failed!");
-                return;
-            }//_Check for failure
-            MITK_INFO << "[...][7.1] ComputeCtrLines finished .";
-
-            successful = clipper->ComputeCtrLinesClippers(pickedSeedLabels);
-            if (!successful) {
-                QMessageBox::critical(NULL, "Attention", "Computation of Clipper Planes Failed!");
-                return;
-            }//_if
-            MITK_INFO << "[...][7.2] ComputeCtrLinesClippers finished .";
-
-            clipper->ClipVeinsImage(pickedSeedLabels, mitk::ImportItkImage(duplicator->GetOutput()), false);
-            MITK_INFO << "[...][7.3] ClipVeinsImage finished .";
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][8] Create a mesh from clipped segmentation of veins";
-            QString output2 = cmd->ExecuteSurf(direct, (direct + "/PVeinsCroppedImage.nii"), "close", 1, .5, 0, 10);
-            mitk::Surface::Pointer LAShell = mitk::IOUtil::Load<mitk::Surface>(output2.toStdString());
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][9] Clip the mitral valve";
-            ImageTypeCHAR::Pointer mvImage = ImageTypeCHAR::New();
-            mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(segCleanPath.toStdString()), mvImage);
-            ItType itMVI1(mvImage, mvImage->GetRequestedRegion());
-            itORG.GoToBegin();
-            for (itMVI1.GoToBegin(); !itMVI1.IsAtEnd(); ++itMVI1) {
-                if ((int)itMVI1.Get() != 0)
-                    itMVI1.Set((int)itORG.Get());
-                ++itORG;
-            }
-            for (itMVI1.GoToBegin(); !itMVI1.IsAtEnd(); ++itMVI1)
-                if ((int)itMVI1.Get() != 3)
-                    itMVI1.Set(0);
-            typedef itk::ConnectedComponentImageFilter<ImageTypeCHAR, ImageTypeCHAR> ConnectedComponentImageFilterType;
-            ConnectedComponentImageFilterType::Pointer connected3 = ConnectedComponentImageFilterType::New();
-            connected3->SetInput(mvImage);
-            connected3->Update();
-            typedef itk::LabelShapeKeepNObjectsImageFilter<ImageTypeCHAR> LabelShapeKeepNObjImgFilterType;
-            LabelShapeKeepNObjImgFilterType::Pointer lblShpKpNObjImgFltr2 = LabelShapeKeepNObjImgFilterType::New();
-            lblShpKpNObjImgFltr2->SetInput(connected3->GetOutput());
-            lblShpKpNObjImgFltr2->SetBackgroundValue(0);
-            lblShpKpNObjImgFltr2->SetNumberOfObjects(1);
-            lblShpKpNObjImgFltr2->SetAttribute(LabelShapeKeepNObjImgFilterType::LabelObjectType::NUMBER_OF_PIXELS);
-            lblShpKpNObjImgFltr2->Update();
-            mvImage = lblShpKpNObjImgFltr2->GetOutput();
-            mitk::IOUtil::Save(mitk::ImportItkImage(mvImage), (direct + "/prodMVI.nii").toStdString());
-
-            // Make vtk of prodMVI
-            QString mviShellPath = cmd->ExecuteSurf(direct, "prodMVI.nii", "close", 1, 0.5, 0, 10);
-            // Implement code from command line tool
-            mitk::Surface::Pointer ClipperSurface = mitk::IOUtil::Load<mitk::Surface>(mviShellPath.toStdString());
-            vtkSmartPointer<vtkImplicitPolyDataDistance> implicitFn = vtkSmartPointer<vtkImplicitPolyDataDistance>::New();
-            implicitFn->SetInput(ClipperSurface->GetVtkPolyData());
-            vtkMTimeType mtime = implicitFn->GetMTime();
-            std::cout << "MTime: " << mtime << std::endl;
-            vtkSmartPointer<vtkClipPolyData> mvclipper = vtkSmartPointer<vtkClipPolyData>::New();
-            mvclipper->SetClipFunction(implicitFn);
-            mvclipper->SetInputData(LAShell->GetVtkPolyData());
-            mvclipper->InsideOutOff();
-            mvclipper->Update();
-
-            MITK_INFO << "[...][9.1] Extract and clean surface mesh.";
-            vtkSmartPointer<vtkDataSetSurfaceFilter> surfer = vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
-            surfer->SetInputData(mvclipper->GetOutput());
-            surfer->Update();
-
-            MITK_INFO << "[...][9.2] Cleaning...";
-            vtkSmartPointer<vtkCleanPolyData> clean = vtkSmartPointer<vtkCleanPolyData>::New();
-            clean->SetInputConnection(surfer->GetOutputPort());
-            clean->Update();
-
-            MITK_INFO << "[...][9.3] Largest region...";
-            vtkSmartPointer<vtkPolyDataConnectivityFilter> lrgRegion = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-            lrgRegion->SetInputConnection(clean->GetOutputPort());
-            lrgRegion->SetExtractionModeToLargestRegion();
-            lrgRegion->Update();
-            clean = vtkSmartPointer<vtkCleanPolyData>::New();
-            clean->SetInputConnection(lrgRegion->GetOutputPort());
-            clean->Update();
-
-            MITK_INFO << ("[...][9.4] Saving to file: " + output2).toStdString();
-            LAShell->SetVtkPolyData(clean->GetOutput());
-            mitk::IOUtil::Save(LAShell, output2.toStdString());
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][10] Scar projection";
-            int minStep = minStep_UI;
-            int maxStep = maxStep_UI;
-            int methodType = methodType_UI;
-            std::unique_ptr<CemrgScar3D> scar(new CemrgScar3D());
-            scar->SetMinStep(minStep);
-            scar->SetMaxStep(maxStep);
-            scar->SetMethodType(methodType);
-            ImageTypeCHAR::Pointer segITK = ImageTypeCHAR::New();
-            mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>((direct + "/PVeinsCroppedImage.nii").toStdString()), segITK);
-            ImageTypeSHRT::Pointer lgeITK = ImageTypeSHRT::New();
-            mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeITK);
-            itk::ResampleImageFilter<ImageTypeCHAR, ImageTypeCHAR>::Pointer resampleFilter;
-            resampleFilter = itk::ResampleImageFilter<ImageTypeCHAR, ImageTypeCHAR>::New();
-            resampleFilter->SetInput(segITK);
-            resampleFilter->SetReferenceImage(lgeITK);
-            resampleFilter->SetUseReferenceImage(true);
-            resampleFilter->SetInterpolator(itk::NearestNeighborInterpolateImageFunction<ImageTypeCHAR>::New());
-            resampleFilter->SetDefaultPixelValue(0);
-            resampleFilter->UpdateLargestPossibleRegion();
-            segITK = resampleFilter->GetOutput();
-            mitk::IOUtil::Save(mitk::ImportItkImage(segITK), (direct + "/PVeinsCroppedImage.nii").toStdString());
-            scar->SetScarSegImage(mitk::ImportItkImage(segITK));
-            mitk::Surface::Pointer scarShell = scar->Scar3D(direct.toStdString(), mitk::ImportItkImage(lgeITK));
-            MITK_INFO << "[...][10.1] Converting cell to point data";
-            vtkSmartPointer<vtkCellDataToPointData> cell_to_point = vtkSmartPointer<vtkCellDataToPointData>::New();
-            cell_to_point->SetInputData(scarShell->GetVtkPolyData());
-            cell_to_point->PassCellDataOn();
-            cell_to_point->Update();
-            scarShell->SetVtkPolyData(cell_to_point->GetPolyDataOutput());
-            mitk::IOUtil::Save(scarShell, (direct + "/MaxScar.vtk").toStdString());
-            scar->SaveScarDebugImage("Max_debugScar.nii", direct);
-
-            MITK_INFO << "[AUTOMATIC_ANALYSIS][11] Thresholding";
-            int vxls = 3;
-            int threshType = thresh_methodType_UI;
-
-            typedef itk::Image<float, 3> ImageType;
-            typedef itk::BinaryBallStructuringElement<ImageTypeCHAR::PixelType, 3> BallType;
-            typedef itk::GrayscaleErodeImageFilter<ImageTypeCHAR, ImageType, BallType> ErosionFilterType;
-            BallType binaryBall;
-            binaryBall.SetRadius(vxls);
-            binaryBall.CreateStructuringElement();
-            ErosionFilterType::Pointer erosionFilter = ErosionFilterType::New();
-            erosionFilter->SetInput(segITK);
-            erosionFilter->SetKernel(binaryBall);
-            erosionFilter->UpdateLargestPossibleRegion();
-            mitk::Image::Pointer roiImage = mitk::ImportItkImage(erosionFilter->GetOutput())->Clone();
-            ImageType::Pointer lgeFloat = ImageType::New();
-            mitk::CastToItkImage(mitk::IOUtil::Load<mitk::Image>(lgePath.toStdString()), lgeFloat);
-            double mean = 0.0, stdv = 0.0;
-            scar->CalculateMeanStd(mitk::ImportItkImage(lgeFloat), roiImage, mean, stdv);
-            MITK_INFO << "[...][11.1] Creating Scar map normalised by Mean blood pool.";
-            QString prodPath = direct + "/";
-            scar->SaveNormalisedScalars(mean, scarShell, (prodPath + "MaxScar_Normalised.vtk"));
-            MITK_INFO << "[...][11.2] Saving to files.";
-            ofstream prodFile1, prodFileExplanation;
-            prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
-            for (unsigned int ix = 0; ix < values_vector.size(); ix++) {
-                double thisValue = values_vector.at(ix);
-                double thisThresh = (threshType == 1) ? mean * thisValue : mean + thisValue * stdv;
-                double thisPercentage = scar->Thresholding(thisThresh);
-                prodFile1 << thisValue << "\n";
-                prodFile1 << threshType << "\n";
-                prodFile1 << mean << "\n";
-                prodFile1 << stdv << "\n";
-                prodFile1 << thisThresh << "\n";
-                prodFile1 << "SCORE: " << thisPercentage << "\n";
-                prodFile1 << "=============== separation ================\n";
-            }
-            prodFileExplanation.open((prodPath + "prodThresholds_Guide.txt").toStdString());
-            prodFileExplanation << "VALUE\n";
-            prodFileExplanation << "THRESHOLD TYPE: (1 = V*IIR, 2 = MEAN + V*STDev)\n";
-            prodFileExplanation << "MEAN INTENSITY\n";
-            prodFileExplanation << "STANDARD DEVIATION (STDev)\n";
-            prodFileExplanation << "THRESHOLD\n";
-            prodFileExplanation << "SCAR SCORE (percentage)\n";
-            prodFileExplanation << "=============== separation ================";
-            prodFile1.close();
-            prodFileExplanation.close();
-            timerLog->StopTimer();
+            successful = pipeline.Segmentation();
+        }//_if
+        MITK_INFO(successful) << ("Successful prediction with file " + pipeline.GetCnnPath()).toStdString();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][1-2] Adjust CNN label to MRA, image registration";
+        successful = successful && pipeline.Registration();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][3] Clean segmentation";
+        successful = successful && pipeline.Clean();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][4-5] Separate veins";
+        successful = successful && pipeline.SeparateVeins();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][6-7] Find vein landmarks, clip the veins";
+        successful = successful && pipeline.ClipVeins();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][8-9] Create a mesh from clipped segmentation of veins, clip the mitral valve";
+        successful = successful && pipeline.ClipMitralValve();
+        MITK_INFO(successful) << "[AUTOMATIC_ANALYSIS][10-11] Scar projection, thresholding";
+        successful = successful && pipeline.ScarProjection();
+        timerLog->StopTimer();
+
+        if (successful) {
 
             QStringList rtminsec = QString::number(timerLog->GetElapsedTime() / 60).split(".");
             QString rtmin = rtminsec.at(0);
-            QString rtsec = QString::number(("0." + rtminsec.at(1)).toFloat() * 60, 'f', 1);
+            QString rtsec = QString::number(("0." + rtminsec.value(1, "0")).toFloat() * 60, 'f', 1);
             QString outstr = "Operation finshed in " + rtmin + " min and " + rtsec + " s.";
             MITK_INFO << "[AUTOMATIC_ANALYSIS][FINISHED]";
             QMessageBox::information(NULL, "Automatic analysis", outstr);
 
         } else
-            QMessageBox::warning(NULL, "Attention", "Error with automatic segmentation! Check the LOG file.");
+            QMessageBox::warning(NULL, "Attention", "Error with automatic analysis: " + pipeline.GetErrorMessage() + ". Check the LOG file.");
     } else
-        QMessageBox::information(NULL, "Attention", "Operation Cancelled!");
+        QMessageBox::information(NULL, "Attention", pipeline.GetErrorMessage());
 }
 
 void AtrialScarView::SegmentIMGS() {
@@ -1389,12 +1058,8 @@ void AtrialScarView::ClipMitralValve() {
     //Reverse coordination of surface for writing MIRTK style
     mitk::Surface::Pointer surfCloned = surface->Clone();
     vtkSmartPointer<vtkPolyData> pd = surfCloned->GetVtkPolyData();
-    for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-        double* point = pd->GetPoint(i);
-        point[0] = -point[0];
-        point[1] = -point[1];
-        pd->GetPoints()->SetPoint(i, point);
-    }//_for
+    CemrgCommonUtils::FlipXYPoints(pd->GetPoints());
+    pd->Modified();
     mitk::IOUtil::Save(surfCloned, path.toStdString());
 }
 
@@ -1668,12 +1333,15 @@ void AtrialScarView::Threshold() {
     //Act on dialog return code
     if (dialogCode == QDialog::Accepted) {
 
-        bool ok;
-        double value = m_UISQuant.lineEdit->text().toDouble(&ok);
+        bool ok = true;
+        std::vector<double> values;
+        QStringList valuesList = m_UISQuant.lineEdit->text().split(",", QString::SkipEmptyParts);
+        for (int ix = 0; ix < valuesList.size() && ok; ix++)
+            values.push_back(valuesList.at(ix).trimmed().toDouble(&ok));
         int methodType = m_UISQuant.radioButton_1->isChecked() ? 1 : 2;
 
         //Set default values
-        if (!ok) {
+        if (!ok || values.empty()) {
             QMessageBox::warning(NULL, "Attention", "Please enter a valid value!");
             return;
         }//_ok
@@ -1681,30 +1349,50 @@ void AtrialScarView::Threshold() {
         this->BusyCursorOn();
         mitk::ProgressBar::GetInstance()->AddStepsToDo(1);
 
-        double percentage = 0;
-        double thresh = (methodType == 1) ? mean * value : mean + value * stdv;
-
-        /*
-         * Producibility Test
-         **/
-        QString prodPath = directory + "/";
-        ofstream prodFile1;
-        prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
-        prodFile1 << value << "\n";
-        prodFile1 << methodType << "\n";
-        prodFile1 << mean << "\n";
-        prodFile1 << stdv << "\n";
-        prodFile1 << thresh << "\n";
-        prodFile1.close();
-        /*
-         * End Test
-         **/
-
-        if (scar) percentage = scar->Thresholding(thresh);
-        std::ostringstream os;
-        os << std::fixed << std::setprecision(2) << percentage;
-        QString message = "The percentage scar is " + QString::fromStdString(os.str()) + "% of total segmented volume.";
-        QMessageBox::information(NULL, "Scar Quantification", message);
+        if (values.size() == 1) {
+
+            double value = values.at(0);
+            double percentage = 0;
+            double thresh = CemrgScar3D::ThresholdValue(value, methodType, mean, stdv);
+
+            /*
+             * Producibility Test
+             **/
+            QString prodPath = directory + "/";
+            ofstream prodFile1;
+            prodFile1.open((prodPath + "prodThresholds.txt").toStdString());
+            prodFile1 << value << "\n";
+            prodFile1 << methodType << "\n";
+            prodFile1 << mean << "\n";
+            prodFile1 << stdv << "\n";
+            prodFile1 << thresh << "\n";
+            prodFile1.close();
+            /*
+             * End Test
+             **/
+
+            if (scar) percentage = scar->Thresholding(thresh);
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(2) << percentage;
+            QString message = "The percentage scar is " + QString::fromStdString(os.str()) + "% of total segmented volume.";
+            QMessageBox::information(NULL, "Scar Quantification", message);
+
+        } else if (scar) {
+
+            //Several values are answered from a single sweep over the scalars
+            std::vector<double> thresholds;
+            for (unsigned int ix = 0; ix < values.size(); ix++)
+                thresholds.push_back(CemrgScar3D::ThresholdValue(values.at(ix), methodType, mean, stdv));
+            std::vector<double> percentages = scar->ThresholdingSweep(thresholds);
+            scar->PrintThresholdingResults(directory, values, methodType, mean, stdv, percentages, false);
+
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(2);
+            for (unsigned int ix = 0; ix < values.size(); ix++)
+                os << "V=" << values.at(ix) << ": " << percentages.at(ix) << "%\n";
+            QString message = "The percentage scar of total segmented volume is:\n" + QString::fromStdString(os.str());
+            QMessageBox::information(NULL, "Scar Quantification", message);
+        }//_if
 
         mitk::ProgressBar::GetInstance()->Progress();
         this->BusyCursorOff();
@@ -64,6 +64,9 @@ PURPOSE.  See the above copyright notices for more information.
 #include <QFileDialog>
 #include <QInputDialog>
 
+// CemrgApp
+#include <CemrgLvScarSegmentation.h>
+
 const std::string YZSegView::VIEW_ID = "org.mitk.views.scaryzseg";
 
 void YZSegView::CreateQtPartControl(QWidget *parent) {
@@ -299,75 +302,18 @@ void YZSegView::ScarSeg_FWHM() {
 
     //Check for selection of images
     QList<mitk::DataNode::Pointer> nodes = this->GetDataManagerSelection();
-    if (nodes.empty()) {
+    if (nodes.size() < 2) {
         QMessageBox::warning(NULL, "Attention", "Please select an image from the Data Manager to add landmarks!");
         return;
     }
 
-    mitk::DataNode::Pointer imgNode = nodes.at(0);
-    mitk::DataNode::Pointer segNode = nodes.at(1);
-    mitk::BaseData::Pointer imgdata = imgNode->GetData();
-    mitk::BaseData::Pointer segdata = segNode->GetData();
-
-    //if the selected data are images
-    if (imgdata && segdata) {
-
-        mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(imgdata.GetPointer());
-        mitk::Image::Pointer seg = dynamic_cast<mitk::Image*>(segdata.GetPointer());
-
-        if (image && seg) {
-
-            typedef itk::Image<short, 3> ImageType;
-            ImageType::Pointer itkImage = ImageType::New();
-            mitk::CastToItkImage(image, itkImage);
-
-            ImageType::Pointer itkSeg = ImageType::New();
-            mitk::CastToItkImage(seg, itkSeg);
-
-            //Create an empty image LV of the same size as the input images
-            ImageType::Pointer LV = ImageType::New();
-            ImageType::IndexType start;
-            start[0] = 0;
-            start[1] = 0;
-            start[2] = 0;
-
-            ImageType::SizeType size = itkImage->GetRequestedRegion().GetSize();
-            ImageType::RegionType region;
-            region.SetSize(size);
-            region.SetIndex(start);
-
-            LV->SetRegions(region);
-            LV->Allocate();
-
-            //Segment the LV from the input image
-            ConstIteratorType inIm(itkImage, itkImage->GetRequestedRegion());
-            ConstIteratorType inSeg(itkSeg, itkSeg->GetRequestedRegion());
-            IteratorType outLV(LV, LV->GetRequestedRegion());
-
-            //Loop over the image
-            for (inIm.GoToBegin(), inSeg.GoToBegin(), outLV.GoToBegin(); !inIm.IsAtEnd(); ++inIm, ++inSeg, ++outLV) {
-
-                //if we are on the left ventricular wall
-                if (inSeg.Get() != 0) {
-                    outLV.Set(inIm.Get());
-                } else {
-                    //Set all the values not on the LV wall to be 0
-                    outLV.Set(0);
-                }//_if
-            }
-
-            //Find the maximum infart value within LV
-            double max_inf = FWMH_getPeak_SORT(LV);
-
-            //Apply the threshold
-            thresholdImage(itkImage, LV, 0.5 * max_inf); //, max_inf, 1); // based on Schmidt et al. that SICore > 0.5 x Peak-infarct
-        }//_if_image
-
-    } else {
-
-        QMessageBox::warning(NULL, "Attention", "Please select an image from the Data Manager to add landmarks!");
+    ImageType::Pointer itkImage;
+    CemrgLvScarSegmentation* engine = GetScarEngine(nodes, false, "Please select an image from the Data Manager to add landmarks!", itkImage);
+    if (engine == nullptr)
         return;
-    }//_if_data
+
+    //Apply the threshold, based on Schmidt et al. that SICore > 0.5 x Peak-infarct
+    engine->WriteMask(itkImage, engine->GetFWHMThreshold());
 }
 
 void YZSegView::ScarSeg_SD() {
@@ -404,270 +350,17 @@ void YZSegView::ScarSeg_SD() {
 
 void YZSegView::ScarSeg_4SD() {
 
-    //Check for selection of images
-    QList<mitk::DataNode::Pointer> nodes = this->GetDataManagerSelection();
-    if (nodes.size() != 3) {
-        QMessageBox::warning(
-            NULL, "Attention",
-            "Please select the LGE image, LV segmentation and the remote myocardium in this order from the Data Manager!");
-        return;
-    }
-
-    mitk::DataNode::Pointer imgNode = nodes.at(0);
-    mitk::DataNode::Pointer segNode = nodes.at(1);
-    mitk::DataNode::Pointer myoNode = nodes.at(2);
-    mitk::BaseData::Pointer imgdata = imgNode->GetData();
-    mitk::BaseData::Pointer segdata = segNode->GetData();
-    mitk::BaseData::Pointer myodata = myoNode->GetData();
-
-    //if the selected data are images
-    if (imgdata && segdata && myodata) {
-
-        mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(imgdata.GetPointer());
-        mitk::Image::Pointer seg = dynamic_cast<mitk::Image*>(segdata.GetPointer());
-        mitk::Image::Pointer myo = dynamic_cast<mitk::Image*>(myodata.GetPointer());
-
-        if (image && seg && myo) {
-
-            ImageType::Pointer itkImage = ImageType::New();
-            mitk::CastToItkImage(image, itkImage);
-
-            ImageType::Pointer itkSeg = ImageType::New();
-            mitk::CastToItkImage(seg, itkSeg);
-
-            ImageType::Pointer itkMyo = ImageType::New();
-            mitk::CastToItkImage(myo, itkMyo);
-
-            //Create an empty image LV of the same size as the input images
-            ImageType::Pointer LV = ImageType::New();
-            ImageType::IndexType start;
-            start[0] = 0;
-            start[1] = 0;
-            start[2] = 0;
-
-            ImageType::SizeType size = itkImage->GetRequestedRegion().GetSize();
-            ImageType::RegionType region;
-            region.SetSize(size);
-            region.SetIndex(start);
-
-            LV->SetRegions(region);
-            LV->Allocate();
-
-            //Segment the LV from the input image
-            ConstIteratorType inIm(itkImage, itkImage->GetRequestedRegion());
-            ConstIteratorType inSeg(itkSeg, itkSeg->GetRequestedRegion());
-            IteratorType outLV(LV, LV->GetRequestedRegion());
-
-            //Loop over the image
-            for (inIm.GoToBegin(), inSeg.GoToBegin(), outLV.GoToBegin(); !inIm.IsAtEnd(); ++inIm, ++inSeg, ++outLV) {
-
-                //if we are on the left ventricular wall
-                if (inSeg.Get() != 0) {
-                    outLV.Set(inIm.Get());
-                } else {
-                    //Set all the values not on the LV wall to be 0
-                    outLV.Set(0);
-                }
-            }//_for
-
-            double mean = GetStats(itkImage, itkMyo, 1);
-            double std = GetStats(itkImage, itkMyo, 2);
-            double max = GetStats(itkImage, LV, 3);
-
-            if (max > mean + 4 * std)
-                thresholdImage(itkImage, LV, mean + 4 * std);
-            else {
-                QMessageBox::warning(
-                    NULL, "Attention!",
-                    "4 Standard Deviation away from the mean is out of range! Please try again with the customised SD!");
-                return;
-            }
-        }//_if_images
-
-    } else {
-        QMessageBox::warning(NULL, "Attention", "Please select images from the Data Manager to segment!");
-        return;
-    }//_if_data
+    ScarSeg_ThresholdSD(4, "Please select images from the Data Manager to segment!");
 }
 
 void YZSegView::ScarSeg_6SD() {
 
-    //Check for selection of images
-    QList<mitk::DataNode::Pointer> nodes = this->GetDataManagerSelection();
-    if (nodes.empty() || nodes.size() != 3) {
-        QMessageBox::warning(
-            NULL, "Attention",
-            "Please select the LGE image, LV segmentation and the remote myocardium in this order from the Data Manager!");
-        return;
-    }
-
-    mitk::DataNode::Pointer imgNode = nodes.at(0);
-    mitk::DataNode::Pointer segNode = nodes.at(1);
-    mitk::DataNode::Pointer myoNode = nodes.at(2);
-    mitk::BaseData::Pointer imgdata = imgNode->GetData();
-    mitk::BaseData::Pointer segdata = segNode->GetData();
-    mitk::BaseData::Pointer myodata = myoNode->GetData();
-
-    //if the selected data are images
-    if (imgdata && segdata && myodata) {
-
-        mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(imgdata.GetPointer());
-        mitk::Image::Pointer seg = dynamic_cast<mitk::Image*>(segdata.GetPointer());
-        mitk::Image::Pointer myo = dynamic_cast<mitk::Image*>(myodata.GetPointer());
-
-        if (image && seg && myo) {
-
-            ImageType::Pointer itkImage = ImageType::New();
-            mitk::CastToItkImage(image, itkImage);
-
-            ImageType::Pointer itkSeg = ImageType::New();
-            mitk::CastToItkImage(seg, itkSeg);
-
-            ImageType::Pointer itkMyo = ImageType::New();
-            mitk::CastToItkImage(myo, itkMyo);
-
-            //Create an empty image LV of the same size as the input images
-            ImageType::Pointer LV = ImageType::New();
-            ImageType::IndexType start;
-            start[0] = 0;
-            start[1] = 0;
-            start[2] = 0;
-
-            ImageType::SizeType size = itkImage->GetRequestedRegion().GetSize();
-            ImageType::RegionType region;
-            region.SetSize(size);
-            region.SetIndex(start);
-
-            LV->SetRegions(region);
-            LV->Allocate();
-
-            //Segment the LV from the input image
-            ConstIteratorType inIm(itkImage, itkImage->GetRequestedRegion());
-            ConstIteratorType inSeg(itkSeg, itkSeg->GetRequestedRegion());
-            IteratorType outLV(LV, LV->GetRequestedRegion());
-
-            //Loop over the image
-            for (inIm.GoToBegin(), inSeg.GoToBegin(), outLV.GoToBegin(); !inIm.IsAtEnd(); ++inIm, ++inSeg, ++outLV) {
-                //if we are on the left ventricular wall
-                if (inSeg.Get() != 0) {
-                    outLV.Set(inIm.Get());
-                } else {
-                    //Set all the values not on the LV wall to be 0
-                    outLV.Set(0);
-                }
-            }//_for
-
-            double mean = GetStats(itkImage, itkMyo, 1);
-            double std = GetStats(itkImage, itkMyo, 2);
-            double max = GetStats(itkImage, LV, 3);
-
-            if (max > mean + 6 * std)
-                thresholdImage(itkImage, LV, mean + 6 * std);
-            else {
-                QMessageBox::warning(
-                    NULL, "Attention!",
-                    "6 Standard Deviation away from the mean is out of range! Please try again with the customised SD!");
-                return;
-            }
-        }//_if_image
-
-    } else {
-        QMessageBox::warning(NULL, "Attention", "Please select an image from the Data Manager to add landmarks!");
-        return;
-    }//_if_data
+    ScarSeg_ThresholdSD(6, "Please select an image from the Data Manager to add landmarks!");
 }
 
 void YZSegView::ScarSeg_CustomisedSD() {
 
-    //Check for selection of images
-    QList<mitk::DataNode::Pointer> nodes = this->GetDataManagerSelection();
-    if (nodes.empty() || nodes.size() != 3) {
-        QMessageBox::warning(
-            NULL, "Attention",
-            "Please select the LGE image, LV segmentation and the remote myocardium in this order from the Data Manager!");
-        return;
-    }
-
-    mitk::DataNode::Pointer imgNode = nodes.at(0);
-    mitk::DataNode::Pointer segNode = nodes.at(1);
-    mitk::DataNode::Pointer myoNode = nodes.at(2);
-    mitk::BaseData::Pointer imgdata = imgNode->GetData();
-    mitk::BaseData::Pointer segdata = segNode->GetData();
-    mitk::BaseData::Pointer myodata = myoNode->GetData();
-
-    //if the selected data are images
-    if (imgdata && segdata && myodata) {
-
-        mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(imgdata.GetPointer());
-        mitk::Image::Pointer seg = dynamic_cast<mitk::Image*>(segdata.GetPointer());
-        mitk::Image::Pointer myo = dynamic_cast<mitk::Image*>(myodata.GetPointer());
-
-        if (image && seg && myo) {
-
-            ImageType::Pointer itkImage = ImageType::New();
-            mitk::CastToItkImage(image, itkImage);
-
-            ImageType::Pointer itkSeg = ImageType::New();
-            mitk::CastToItkImage(seg, itkSeg);
-
-            ImageType::Pointer itkMyo = ImageType::New();
-            mitk::CastToItkImage(myo, itkMyo);
-
-            //Create an empty image LV of the same size as the input images
-            ImageType::Pointer LV = ImageType::New();
-            ImageType::IndexType start;
-            start[0] = 0;
-            start[1] = 0;
-            start[2] = 0;
-
-            ImageType::SizeType size = itkImage->GetRequestedRegion().GetSize();
-            ImageType::RegionType region;
-            region.SetSize(size);
-            region.SetIndex(start);
-
-            LV->SetRegions(region);
-            LV->Allocate();
-
-            //Segment the LV from the input image
-            ConstIteratorType inIm(itkImage, itkImage->GetRequestedRegion());
-            ConstIteratorType inSeg(itkSeg, itkSeg->GetRequestedRegion());
-            IteratorType outLV(LV, LV->GetRequestedRegion());
-
-            //Loop over the image
-            for (inIm.GoToBegin(), inSeg.GoToBegin(), outLV.GoToBegin(); !inIm.IsAtEnd(); ++inIm, ++inSeg, ++outLV) {
-
-                //if we are on the left ventricular wall
-                if (inSeg.Get() != 0) {
-                    outLV.Set(inIm.Get());
-                } else {
-                    //Set all the values not on the LV wall to be 0
-                    outLV.Set(0);
-                }
-            }//_for
-
-            double mean = GetStats(itkImage, itkMyo, 1);
-            double std = GetStats(itkImage, itkMyo, 2);
-            double max = GetStats(itkImage, LV, 3);
-
-            bool ok;
-            QString msg = "Please enter a whole number to set the threshold ";
-            int num = QInputDialog::getInt(NULL, tr("Scar Segmentation: SD method: "), msg, 0, 0, 10, 1, &ok);
-            if (ok) {
-                if (max > mean + num * std)
-                    thresholdImage(itkImage, LV, mean + num * std);
-                else {
-                    QMessageBox::warning(
-                        NULL, "Attention!",
-                        QString::number(num) + " Standard Deviation away from the mean is out of range! Please try again with the customised SD!");
-                    return;
-                }
-            }
-        }//_if_images
-
-    } else {
-        QMessageBox::warning(NULL, "Attention", "Please select an image from the Data Manager!");
-        return;
-    }//_if_data
+    ScarSeg_ThresholdSD(-1, "Please select an image from the Data Manager!");
 }
 
 void YZSegView::ScarSeg_save() {
@@ -722,114 +415,84 @@ void YZSegView::ScarSeg_save() {
         return;
 }
 
-/**
- * @brief This function returns the average top 5% of the maximum intensity value in the left ventricular myocardium
- * @param x
- * @return
- */
-double YZSegView::FWMH_getPeak_SORT(ImageType::Pointer x) {
-
-    //Copy all the intensity values to a temporary 1D array arr, which will be sorted later
-    int m = 0;
-    ConstIteratorType in(x, x->GetRequestedRegion());
-
-    //Find the number of non-zero elements in the image
-    for (in.GoToBegin(); !in.IsAtEnd(); ++in) {
-        if (in.Get() != 0)
-            m++;
-    }
+void YZSegView::ScarSeg_ThresholdSD(int num, QString noDataMessage) {
 
-    //Assign the non-zero elements to the new array arr
-    int n = 0;
-    int * arr = new int[m];
-    for (in.GoToBegin(); !in.IsAtEnd(); ++in) {
-        if (in.Get() != 0) {
-            arr[n] = in.Get();
-            n++;
-        }
+    //Check for selection of images
+    QList<mitk::DataNode::Pointer> nodes = this->GetDataManagerSelection();
+    if (nodes.size() != 3) {
+        QMessageBox::warning(
+            NULL, "Attention",
+            "Please select the LGE image, LV segmentation and the remote myocardium in this order from the Data Manager!");
+        return;
     }
 
-    //Sort the temporary array arr in the ascending order
-    insertion_sort(arr, m);
+    ImageType::Pointer itkImage;
+    CemrgLvScarSegmentation* engine = GetScarEngine(nodes, true, noDataMessage, itkImage);
+    if (engine == nullptr)
+        return;
 
-    //Find the average value of the top 5% of the intensity values
-    double max = 0;
-    int start = m * 0.998;
-    for (int i = start - 1; i < m; i++) {
-        max += arr[i];
-    }
-    delete[] arr;
-    max = max / (m - start);
-    return max;
+    //Customised: ask for the number of standard deviations
+    if (num < 0) {
+        bool ok;
+        QString msg = "Please enter a whole number to set the threshold ";
+        num = QInputDialog::getInt(NULL, tr("Scar Segmentation: SD method: "), msg, 0, 0, 10, 1, &ok);
+        if (!ok)
+            return;
+    }//_if
+
+    double threshold = engine->GetSDThreshold(num);
+    if (engine->IsInRange(threshold)) {
+        engine->WriteMask(itkImage, threshold);
+    } else {
+        QMessageBox::warning(
+            NULL, "Attention!",
+            QString::number(num) + " Standard Deviation away from the mean is out of range! Please try again with the customised SD!");
+    }//_if
 }
 
-void YZSegView::thresholdImage(ImageType::Pointer img, ImageType::Pointer mask, double threshold) {
+CemrgLvScarSegmentation* YZSegView::GetScarEngine(QList<mitk::DataNode::Pointer> nodes, bool withRemote, QString noDataMessage, ImageType::Pointer& itkImage) {
 
-    //Create two iterators for the image and the mask
-    IteratorType in_img(img, img->GetRequestedRegion());
-    ConstIteratorType in_mask(mask, mask->GetRequestedRegion());
+    mitk::BaseData::Pointer imgdata = nodes.at(0)->GetData();
+    mitk::BaseData::Pointer segdata = nodes.at(1)->GetData();
+    mitk::BaseData::Pointer myodata = withRemote ? nodes.at(2)->GetData() : nullptr;
 
-    //Loop over the image
-    for (in_img.GoToBegin(), in_mask.GoToBegin(); !in_img.IsAtEnd(); ++in_img, ++in_mask) {
+    //if the selected data are images
+    if (!imgdata || !segdata || (withRemote && !myodata)) {
+        QMessageBox::warning(NULL, "Attention", noDataMessage);
+        return nullptr;
+    }//_if_data
 
-        //if inside the mask
-        if (in_img.Get() >= threshold && in_mask.Get() != 0) {
-            in_img.Set(256);
-        } else {
-            //Set all the voxels outside the mask to be 0
-            in_img.Set(0);
-        }
-    }//_for
-}
+    mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(imgdata.GetPointer());
+    mitk::Image::Pointer seg = dynamic_cast<mitk::Image*>(segdata.GetPointer());
+    mitk::Image::Pointer myo = withRemote ? dynamic_cast<mitk::Image*>(myodata.GetPointer()) : nullptr;
+    if (!image || !seg || (withRemote && !myo))
+        return nullptr;
+
+    //The masks are written over the LGE, so its intensities are only read when the selection changes
+    itkImage = ImageType::New();
+    mitk::CastToItkImage(image, itkImage);
+
+    //Same data objects, none of them modified since the engine was built
+    std::vector<mitk::BaseData::Pointer> key = {imgdata, segdata, myodata};
+    std::vector<unsigned long> keyTimes = {image->GetMTime(), seg->GetMTime(), myo ? myo->GetMTime() : 0};
+    if (scarEngine && scarEngineKey == key && scarEngineTimes == keyTimes)
+        return scarEngine.get();
+
+    ImageType::Pointer itkSeg = ImageType::New();
+    mitk::CastToItkImage(seg, itkSeg);
+    ImageType::Pointer itkMyo;
+    if (myo) {
+        itkMyo = ImageType::New();
+        mitk::CastToItkImage(myo, itkMyo);
+    }//_if
 
-void YZSegView::insertion_sort(int array[], int l) {
-
-    for (int i = 0; i < l; i++) {
-        int j = i;
-        while (j > 0 && array[j] < array[j - 1]) {
-            int temp = array[j];
-            array[j] = array[j - 1];
-            array[j - 1] = temp;
-            j--;
-        }
-    }//_for
+    scarEngine.reset(new CemrgLvScarSegmentation());
+    if (!scarEngine->Build(itkImage, itkSeg, itkMyo)) {
+        scarEngine.reset();
+        QMessageBox::warning(NULL, "Attention", "The LGE image and the segmentations do not have the same dimensions, or the wall segmentation is empty!");
+        return nullptr;
+    }//_if
+    scarEngineKey = key;
+    scarEngineTimes = keyTimes;
+    return scarEngine.get();
 }
-
-double YZSegView::GetStats(ImageType::Pointer im, ImageType::Pointer mask, int a) {
-
-    int n = 0;
-    double sum = 0;
-    double diff = 0;
-    double max = -1;
-
-    //Loop over the selected region of myocardium segmentation
-    IteratorType in_im(im, im->GetRequestedRegion());
-    ConstIteratorType in_mask(mask, mask->GetRequestedRegion());
-
-    for (in_im.GoToBegin(), in_mask.GoToBegin(); !in_im.IsAtEnd(); ++in_im, ++in_mask) {
-        if (in_mask.Get() != 0) {
-            if (max <= in_im.Get())
-                max = in_im.Get();
-            sum += in_im.Get();
-            n++;
-        }
-    }//_for
-
-    double mean = sum / n;
-    for (in_im.GoToBegin(), in_mask.GoToBegin(); !in_im.IsAtEnd(); ++in_im, ++in_mask) {
-        if (in_mask.Get() != 0)
-            diff += (in_im.Get() - mean) * (in_im.Get() - mean);
-    }
-
-    double sd = sqrt(diff / n);
-    if (a == 1)
-        return mean;
-    else if (a == 2)
-        return sd;
-    else if (a == 3)
-        return max;
-    else {
-        QMessageBox::warning(NULL, "Attention", "error in function GetStats");
-        return -1;
-    }
-}
\ No newline at end of file
@@ -40,6 +40,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <itkImage.h>
 
 #include <CemrgScar3D.h>
+#include <CemrgLvScarSegmentation.h>
 #include "ui_YZSegViewControls.h"
 
 //Define the Image type and ITK iterator types
@@ -65,13 +66,6 @@ public:
 
     static const std::string VIEW_ID;
 
-    double FWMH_getPeak_SORT(ImageType::Pointer x);
-    double GetStats(ImageType::Pointer im, ImageType::Pointer mask, int a);
-
-    void thresholdImage(ImageType::Pointer img, ImageType::Pointer mask, double threshold);
-    void insertion_sort(int array[], int l);
-
-
 protected slots:
 
     /// \brief Called when the user clicks the GUI button
@@ -99,9 +93,16 @@ protected:
 
 private:
 
+    void ScarSeg_ThresholdSD(int num, QString noDataMessage);
+    //Selected LGE, LV wall and remote myocardium, rescanned only when the selection changes
+    CemrgLvScarSegmentation* GetScarEngine(QList<mitk::DataNode::Pointer> nodes, bool withRemote, QString noDataMessage, ImageType::Pointer& itkImage);
+
     QString fileName;
     QString directory;
     std::unique_ptr<CemrgScar3D> scar;
+    std::unique_ptr<CemrgLvScarSegmentation> scarEngine;
+    std::vector<mitk::BaseData::Pointer> scarEngineKey;
+    std::vector<unsigned long> scarEngineTimes;
 };
 
 #endif // YZSegView_h
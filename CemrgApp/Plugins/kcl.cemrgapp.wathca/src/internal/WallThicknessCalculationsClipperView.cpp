@@ -78,6 +78,7 @@ PURPOSE.  See the above copyright notices for more information.
 // CemrgAppModule
 #include <CemrgAtriaClipper.h>
 #include <CemrgCommandLine.h>
+#include <CemrgCommonUtils.h>
 
 QString WallThicknessCalculationsClipperView::fileName;
 QString WallThicknessCalculationsClipperView::directory;
@@ -233,12 +234,8 @@ void WallThicknessCalculationsClipperView::iniPreSurf() {
                 vtkSmartPointer<vtkPolyData> pd = shell->GetVtkPolyData();
                 pd->SetVerts(nullptr);
                 pd->SetLines(nullptr);
-                for (int i = 0; i < pd->GetNumberOfPoints(); i++) {
-                    double* point = pd->GetPoint(i);
-                    point[0] = -point[0];
-                    point[1] = -point[1];
-                    pd->GetPoints()->SetPoint(i, point);
-                }//_for
+                CemrgCommonUtils::FlipXYPoints(pd->GetPoints());
+                pd->Modified();
                 vtkSmartPointer<vtkPolyDataConnectivityFilter> connectivityFilter = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
                 connectivityFilter->SetInputData(pd);
                 connectivityFilter->ColorRegionsOff();
@@ -69,12 +69,15 @@ PURPOSE.  See the above copyright notices for more information.
 #include <vtkPolyDataNormals.h>
 #include <vtkPolyDataConnectivityFilter.h>
 #include <vtkWindowedSincPolyDataFilter.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
 
 // ITK
 #include <itkAddImageFilter.h>
 #include <itkRelabelComponentImageFilter.h>
 #include <itkConnectedComponentImageFilter.h>
 #include <itkImageRegionIteratorWithIndex.h>
+#include <itkBinaryThresholdImageFilter.h>
 #include "itkLabelObject.h"
 #include "itkLabelMap.h"
 #include "itkLabelImageToLabelMapFilter.h"
@@ -90,6 +93,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include <CemrgCommonUtils.h>
 #include <CemrgCommandLine.h>
 #include <CemrgMeasure.h>
+#include <CemrgWallThickness.h>
 
 const std::string WallThicknessCalculationsView::VIEW_ID = "org.mitk.views.wathcaview";
 
@@ -650,10 +654,12 @@ void WallThicknessCalculationsView::MorphologyAnalysis() {
 
                 //Volume and surface calculations
                 std::unique_ptr<CemrgMeasure> morphAnal = std::unique_ptr<CemrgMeasure>(new CemrgMeasure());
-                double surfceLA = morphAnal->calcSurfaceMesh(surfLA);
-                double volumeLA = morphAnal->calcVolumeMesh(surfLA);
-                double surfceAP = morphAnal->calcSurfaceMesh(surfAP);
-                double volumeAP = morphAnal->calcVolumeMesh(surfAP);
+                CemrgMeasure::MeshGeometry geometryLA = morphAnal->ComputeMeshGeometry(surfLA->GetVtkPolyData());
+                CemrgMeasure::MeshGeometry geometryAP = morphAnal->ComputeMeshGeometry(surfAP->GetVtkPolyData());
+                double surfceLA = geometryLA.area;
+                double volumeLA = geometryLA.volume;
+                double surfceAP = geometryAP.area;
+                double volumeAP = geometryAP.volume;
 
                 //Store in text file
                 ofstream morphResult;
@@ -777,7 +783,6 @@ void WallThicknessCalculationsView::ThicknessCalculator() {
 
     //Find the selected node
     QString templatePath;
-    mitk::Point3D origin;
     mitk::DataNode::Pointer segNode = nodes.at(0);
     mitk::BaseData::Pointer data = segNode->GetData();
     if (data) {
@@ -786,41 +791,8 @@ void WallThicknessCalculationsView::ThicknessCalculator() {
         mitk::Image::Pointer image = dynamic_cast<mitk::Image*>(data.GetPointer());
         if (image) {
 
-            origin = image->GetGeometry()->GetOrigin();
-            int dimensions = image->GetDimension(0)*image->GetDimension(1)*image->GetDimension(2);
-
             try {
 
-                //Convert image to right type
-                itk::Image<uint8_t,3>::Pointer itkImage = itk::Image<uint8_t,3>::New();
-                mitk::CastToItkImage(image, itkImage);
-                mitk::CastToMitkImage(itkImage, image);
-
-                //Access image volume
-                mitk::ImagePixelReadAccessor<uint8_t,3> readAccess(image);
-                uint8_t* pv = (uint8_t*)readAccess.GetData();
-
-                //Prepare header of inr file (BUGS IN RELEASE MODE DUE TO NULL TERMINATOR \0)
-                char header[256] = {};
-                int bitlength = 8;
-                const char* btype = "unsigned fixed";
-                mitk::Vector3D spacing = image->GetGeometry()->GetSpacing();
-                int n = sprintf(header, "#INRIMAGE-4#{\nXDIM=%d\nYDIM=%d\nZDIM=%d\nVDIM=1\nTYPE=%s\nPIXSIZE=%d bits\nCPU=decm\nVX=%6.4f\nVY=%6.4f\nVZ=%6.4f\n", image->GetDimension(0), image->GetDimension(1), image->GetDimension(2), btype, bitlength, spacing.GetElement(0), spacing.GetElement(1), spacing.GetElement(2));
-                for (int i = n; i < 252; i++)
-                    header[i] = '\n';
-
-                header[252] = '#';
-                header[253] = '#';
-                header[254] = '}';
-                header[255] = '\n';
-
-                //Write to binary file
-                std::string path = (directory + "/converted.inr").toStdString();
-                ofstream myFile(path, ios::out | ios::binary);
-                myFile.write((char*)header, 256 * sizeof(char));
-                myFile.write((char*)pv, dimensions * sizeof(uint8_t));
-                myFile.close();
-
                 //Ask for user input to set the parameters
                 QDialog* inputs = new QDialog(0,0);
                 m_Thickness.setupUi(inputs);
@@ -832,29 +804,109 @@ void WallThicknessCalculationsView::ThicknessCalculator() {
                 //Act on dialog return code
                 if (dialogCode == QDialog::Accepted) {
 
-                    //Checking input files
+                    int wallLabel = m_Thickness.spinBox_1->value();
+                    bool volumetricMesh = m_Thickness.checkBox_1->isChecked();
                     templatePath = m_Thickness.lineEdit_1->text();
-
-                    //Absolute path
-                    if (templatePath.isEmpty()) {
-                        QString paramFileName = "param-template.par";
-                        QString thicknessCalc = "1";
-                        templatePath = CemrgCommonUtils::M3dlibParamFileGenerator(directory,paramFileName,thicknessCalc);
-                    }//_if
+                    inputs->close();
+                    inputs->deleteLater();
 
                     //FileName checks
                     QString meshName = "CGALMesh";
-                    if (fileName.endsWith(".nrrd"))
+                    QString thicknessName = "WallThickness";
+                    if (fileName.endsWith(".nrrd")) {
                         meshName = fileName.left(fileName.length() - 5);
+                        thicknessName = meshName + "-Thickness";
+                    }//_if
 
-                    //Run Mesh3DTool
                     this->BusyCursorOn();
-                    mitk::ProgressBar::GetInstance()->AddStepsToDo(1);
-                    std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
-                    cmd->ExecuteCreateCGALMesh(directory, meshName, templatePath);
-                    QMessageBox::information(NULL, "Attention", "Command Line Operations Finished!");
+                    mitk::ProgressBar::GetInstance()->AddStepsToDo(volumetricMesh ? 3 : 2);
+
+                    //Thickness on the segmentation in memory
+                    typedef itk::Image<short,3> ImageType;
+                    ImageType::Pointer itkImage = ImageType::New();
+                    mitk::CastToItkImage(image, itkImage);
+                    std::unique_ptr<CemrgWallThickness> wallThickness(new CemrgWallThickness());
+                    wallThickness->SetWallLabel(wallLabel);
+                    if (!wallThickness->Compute(itkImage)) {
+                        mitk::ProgressBar::GetInstance()->Reset();
+                        this->BusyCursorOff();
+                        QMessageBox::warning(NULL, "Attention", "No wall found with label " + QString::number(wallLabel) + ", or the wall does not enclose a cavity!");
+                        return;
+                    }//_if
+                    mitk::ProgressBar::GetInstance()->Progress();
+
+                    //Per-vertex thickness on the surface of the wall
+                    typedef itk::BinaryThresholdImageFilter<ImageType, ImageType> ThresholdFilterType;
+                    ThresholdFilterType::Pointer thresholdFilter = ThresholdFilterType::New();
+                    thresholdFilter->SetInput(itkImage);
+                    thresholdFilter->SetLowerThreshold(wallLabel);
+                    thresholdFilter->SetUpperThreshold(wallLabel);
+                    thresholdFilter->SetInsideValue(1);
+                    thresholdFilter->SetOutsideValue(0);
+                    thresholdFilter->Update();
+                    mitk::Surface::Pointer surface = CemrgCommonUtils::ExtractSurfaceFromSegmentation(mitk::ImportItkImage(thresholdFilter->GetOutput()));
+                    wallThickness->MapToSurface(surface->GetVtkPolyData());
+
+                    QString path = directory + "/" + thicknessName + ".vtk";
+                    mitk::IOUtil::Save(surface, path.toStdString());
+                    mitk::DataNode::Pointer node = CemrgCommonUtils::AddToStorage(surface, thicknessName.toStdString(), this->GetDataStorage());
+                    double range[2];
+                    surface->GetVtkPolyData()->GetPointData()->GetScalars()->GetRange(range);
+                    node->SetProperty("scalar visibility", mitk::BoolProperty::New(true));
+                    node->SetFloatProperty("ScalarsRangeMinimum", range[0]);
+                    node->SetFloatProperty("ScalarsRangeMaximum", range[1]);
                     mitk::ProgressBar::GetInstance()->Progress();
+
+                    //The mesher is only needed for a volumetric mesh
+                    if (volumetricMesh) {
+
+                        //Convert image to right type
+                        int dimensions = image->GetDimension(0)*image->GetDimension(1)*image->GetDimension(2);
+                        itk::Image<uint8_t,3>::Pointer itkImage8 = itk::Image<uint8_t,3>::New();
+                        mitk::CastToItkImage(image, itkImage8);
+                        mitk::Image::Pointer image8 = mitk::Image::New();
+                        mitk::CastToMitkImage(itkImage8, image8);
+
+                        //Access image volume
+                        mitk::ImagePixelReadAccessor<uint8_t,3> readAccess(image8);
+                        uint8_t* pv = (uint8_t*)readAccess.GetData();
+
+                        //Prepare header of inr file (BUGS IN RELEASE MODE DUE TO NULL TERMINATOR \0)
+                        char header[256] = {};
+                        int bitlength = 8;
+                        const char* btype = "unsigned fixed";
+                        mitk::Vector3D spacing = image8->GetGeometry()->GetSpacing();
+                        int n = sprintf(header, "#INRIMAGE-4#{\nXDIM=%d\nYDIM=%d\nZDIM=%d\nVDIM=1\nTYPE=%s\nPIXSIZE=%d bits\nCPU=decm\nVX=%6.4f\nVY=%6.4f\nVZ=%6.4f\n", image8->GetDimension(0), image8->GetDimension(1), image8->GetDimension(2), btype, bitlength, spacing.GetElement(0), spacing.GetElement(1), spacing.GetElement(2));
+                        for (int i = n; i < 252; i++)
+                            header[i] = '\n';
+
+                        header[252] = '#';
+                        header[253] = '#';
+                        header[254] = '}';
+                        header[255] = '\n';
+
+                        //Write to binary file
+                        std::string inrPath = (directory + "/converted.inr").toStdString();
+                        ofstream myFile(inrPath, ios::out | ios::binary);
+                        myFile.write((char*)header, 256 * sizeof(char));
+                        myFile.write((char*)pv, dimensions * sizeof(uint8_t));
+                        myFile.close();
+
+                        //Absolute path, thickness is already on the surface
+                        if (templatePath.isEmpty()) {
+                            QString paramFileName = "param-template.par";
+                            QString thicknessCalc = "0";
+                            templatePath = CemrgCommonUtils::M3dlibParamFileGenerator(directory,paramFileName,thicknessCalc);
+                        }//_if
+
+                        //Run Mesh3DTool
+                        std::unique_ptr<CemrgCommandLine> cmd(new CemrgCommandLine());
+                        cmd->ExecuteCreateCGALMesh(directory, meshName, templatePath);
+                        mitk::ProgressBar::GetInstance()->Progress();
+                    }//_if
+
                     this->BusyCursorOff();
+                    QMessageBox::information(NULL, "Attention", "Wall thickness saved to " + path + "\nMean thickness: " + QString::number(wallThickness->GetMeanThickness(), 'f', 2) + " mm");
 
                 } else if (dialogCode == QDialog::Rejected) {
                     inputs->close();